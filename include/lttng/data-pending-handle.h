@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2021 EfficiOS Inc.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only
+ *
+ */
+
+#ifndef LTTNG_DATA_PENDING_HANDLE_H
+#define LTTNG_DATA_PENDING_HANDLE_H
+
+#include <lttng/lttng-error.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Handle used to represent a specific wait for the data of a session to be
+ * available.
+ */
+struct lttng_data_pending_handle;
+
+/*
+ * Negative values indicate errors. Values >= 0 indicate success.
+ */
+enum lttng_data_pending_handle_status {
+	LTTNG_DATA_PENDING_HANDLE_STATUS_ERROR = -2,
+	LTTNG_DATA_PENDING_HANDLE_STATUS_INVALID = -1,
+	LTTNG_DATA_PENDING_HANDLE_STATUS_OK = 0,
+	LTTNG_DATA_PENDING_HANDLE_STATUS_COMPLETED = 1,
+	LTTNG_DATA_PENDING_HANDLE_STATUS_TIMEOUT = 2,
+};
+
+/*
+ * Start waiting until the data of a session is ready to be read, that is
+ * until lttng_data_pending() would return 0. The session must be stopped.
+ *
+ * The session daemon replies once the data is available. The wait is
+ * cancelled when the handle is destroyed.
+ *
+ * Returns LTTNG_OK on success. The returned handle is owned by the caller
+ * and must be free'd using lttng_data_pending_handle_destroy().
+ */
+extern enum lttng_error_code lttng_wait_data_pending_ext(
+		const char *session_name,
+		struct lttng_data_pending_handle **handle);
+
+/*
+ * Destroy an lttng_data_pending_handle.
+ * The handle should be discarded after this call.
+ */
+extern void lttng_data_pending_handle_destroy(
+		struct lttng_data_pending_handle *handle);
+
+/*
+ * Wait for the data of a session to be available.
+ *
+ * A negative timeout_ms value can be used to wait indefinitely. The wait can
+ * be resumed, with the same handle, after a timeout.
+ *
+ * Returns LTTNG_DATA_PENDING_HANDLE_STATUS_COMPLETED if the wait completed.
+ * LTTNG_DATA_PENDING_HANDLE_STATUS_TIMEOUT is returned to indicate that the
+ * wait timed out while the data is still pending.
+ * On error, one of the negative lttng_data_pending_handle_status is returned.
+ *
+ * Note: This function returning a success status does not mean that the data
+ * is available; use lttng_data_pending_handle_get_result() to check it.
+ */
+extern enum lttng_data_pending_handle_status
+	lttng_data_pending_handle_wait_for_completion(
+		struct lttng_data_pending_handle *handle, int timeout_ms);
+
+/*
+ * Get the result of a wait for the data of a session to be available.
+ *
+ * This function must be used on a handle which was successfully waited on.
+ *
+ * Returns LTTNG_DATA_PENDING_HANDLE_STATUS_OK if the result of the wait could
+ * be obtained. 'result' is LTTNG_OK if the data of the session is available.
+ *
+ * On error, one of the negative lttng_data_pending_handle_status is returned.
+ * Returns LTTNG_DATA_PENDING_HANDLE_STATUS_INVALID if the wait did not
+ * complete or if the arguments of the function are invalid (e.g. NULL).
+ */
+extern enum lttng_data_pending_handle_status
+	lttng_data_pending_handle_get_result(
+		const struct lttng_data_pending_handle *handle,
+		enum lttng_error_code *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LTTNG_DATA_PENDING_HANDLE_H */
@@ -492,6 +492,24 @@ extern int lttng_enable_event_with_exclusions(struct lttng_handle *handle,
 		const char *filter_expression,
 		int exclusion_count, char **exclusion_names);
 
+/*
+ * Create or enable many events at once, all with the same filter expression
+ * and exclusions, in a single request to the session daemon.
+ *
+ * Events with an empty name are enabled as "*". Userspace probe events are
+ * not supported and must be enabled with lttng_enable_event_with_exclusions().
+ *
+ * On success, ret_codes, an array of event_count elements, holds the result of
+ * each event: 0 if it was enabled, else a negative LTTng error code.
+ *
+ * Return 0 on success else a negative LTTng error code, in which case
+ * ret_codes is left untouched.
+ */
+extern int lttng_enable_events_with_exclusions(struct lttng_handle *handle,
+		struct lttng_event *events, unsigned int event_count,
+		const char *channel_name, const char *filter_expression,
+		int exclusion_count, char **exclusion_names, int *ret_codes);
+
 /*
  * Disable event(s) of a channel and domain.
  *
@@ -31,6 +31,7 @@
 #include <lttng/condition/evaluation.h>
 #include <lttng/condition/session-consumed-size.h>
 #include <lttng/condition/session-rotation.h>
+#include <lttng/data-pending-handle.h>
 #include <lttng/destruction-handle.h>
 #include <lttng/domain.h>
 #include <lttng/endpoint.h>
@@ -90,6 +91,31 @@ extern int lttng_session_daemon_alive(void);
  */
 extern int lttng_set_tracing_group(const char *name);
 
+/*
+ * Open a persistent connection to the session daemon.
+ *
+ * Until lttng_close_persistent_connection() is called, the commands sent to
+ * the session daemon by this library go through this connection instead of
+ * connecting to the session daemon for every command, which makes sending a
+ * large number of commands (e.g. enabling many events) much faster. The
+ * connection is transparently re-established if the session daemon closes it,
+ * which it does after a failed command.
+ *
+ * The persistent connection is shared by the whole process and, like the rest
+ * of this library, must not be used concurrently by multiple threads.
+ *
+ * Return 0 on success else a negative LTTng error code.
+ */
+extern int lttng_open_persistent_connection(void);
+
+/*
+ * Close the persistent connection to the session daemon opened by
+ * lttng_open_persistent_connection().
+ *
+ * Return 0 on success else a negative LTTng error code.
+ */
+extern int lttng_close_persistent_connection(void);
+
 /*
  * This call registers an "outside consumer" for a session and an lttng domain.
  * No consumer will be spawned and all fds/commands will go through the socket
@@ -176,6 +202,21 @@ extern int lttng_set_consumer_url(struct lttng_handle *handle,
  */
 extern int lttng_data_pending(const char *session_name);
 
+/*
+ * Wait until the data of a session is ready to be read, that is until
+ * lttng_data_pending() would return 0, for at most timeout_ms milliseconds.
+ * A negative timeout_ms value can be used to wait indefinitely. The session
+ * must be stopped.
+ *
+ * Unlike calling lttng_data_pending() in a loop, the session daemon replies
+ * once the data is available.
+ *
+ * Return 0 once the data is available, or 1 if it is still pending when the
+ * timeout expires. On error, a negative value is returned and readable by
+ * lttng_strerror().
+ */
+extern int lttng_wait_data_pending(const char *session_name, int timeout_ms);
+
 /*
  * Deprecated, replaced by lttng_regenerate_metadata.
  */
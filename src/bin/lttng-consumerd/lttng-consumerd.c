@@ -44,7 +44,7 @@
 
 /* threads (channel handling, poll, metadata, sessiond) */
 
-static pthread_t channel_thread, data_thread, metadata_thread,
+static pthread_t channel_thread, metadata_thread,
 		sessiond_thread, metadata_timer_thread, health_thread;
 static bool metadata_timer_thread_online;
 
@@ -271,6 +271,121 @@ end:
 	return ret;
 }
 
+/*
+ * Get the number of data threads from the environment.
+ *
+ * Return the number of data threads or 0 on error.
+ */
+static unsigned int get_data_thread_count(void)
+{
+	unsigned long count;
+	char *endptr;
+	const char *env_count =
+			lttng_secure_getenv(DEFAULT_CONSUMERD_DATA_THREAD_COUNT_ENV);
+
+	if (!env_count) {
+		return DEFAULT_CONSUMERD_DATA_THREAD_COUNT;
+	}
+
+	errno = 0;
+	count = strtoul(env_count, &endptr, 10);
+	if (errno != 0 || *endptr != '\0' || count == 0 || count > UINT_MAX) {
+		ERR("Invalid value for environment variable \"%s\": %s",
+				DEFAULT_CONSUMERD_DATA_THREAD_COUNT_ENV,
+				env_count);
+		return 0;
+	}
+
+	return (unsigned int) count;
+}
+
+/*
+ * Get the submission queue size of the io_uring of each data thread from the
+ * environment. A size of 0 disables the io_uring output engine.
+ *
+ * Return 0 on success or else -1.
+ */
+static int get_io_uring_entries(unsigned int *entries)
+{
+	unsigned long count;
+	char *endptr;
+	const char *env_entries =
+			lttng_secure_getenv(DEFAULT_CONSUMERD_IO_URING_ENTRIES_ENV);
+
+	if (!env_entries) {
+		*entries = DEFAULT_CONSUMERD_IO_URING_ENTRIES;
+		return 0;
+	}
+
+	errno = 0;
+	count = strtoul(env_entries, &endptr, 10);
+	if (errno != 0 || *endptr != '\0' || count > UINT_MAX) {
+		ERR("Invalid value for environment variable \"%s\": %s",
+				DEFAULT_CONSUMERD_IO_URING_ENTRIES_ENV,
+				env_entries);
+		return -1;
+	}
+
+	*entries = (unsigned int) count;
+	return 0;
+}
+
+/*
+ * Get whether the padding of the packets written to local trace files is left
+ * as a hole from the environment.
+ *
+ * Return 0 on success or else -1.
+ */
+static int get_sparse_padding(bool *sparse_padding)
+{
+	const char *env_value =
+			lttng_secure_getenv(DEFAULT_CONSUMERD_SPARSE_PADDING_ENV);
+
+	if (!env_value) {
+		*sparse_padding = false;
+		return 0;
+	}
+
+	if (strcmp(env_value, "0") && strcmp(env_value, "1")) {
+		ERR("Invalid value for environment variable \"%s\": %s",
+				DEFAULT_CONSUMERD_SPARSE_PADDING_ENV,
+				env_value);
+		return -1;
+	}
+
+	*sparse_padding = !strcmp(env_value, "1");
+	return 0;
+}
+
+/*
+ * Get the number of threads copying the streams of a snapshot from the
+ * environment.
+ *
+ * Return the number of snapshot threads or 0 on error.
+ */
+static unsigned int get_snapshot_thread_count(void)
+{
+	unsigned long count;
+	char *endptr;
+	const char *env_count = lttng_secure_getenv(
+			DEFAULT_CONSUMERD_SNAPSHOT_THREAD_COUNT_ENV);
+
+	if (!env_count) {
+		return DEFAULT_CONSUMERD_SNAPSHOT_THREAD_COUNT;
+	}
+
+	errno = 0;
+	count = strtoul(env_count, &endptr, 10);
+	if (errno != 0 || *endptr != '\0' || count == 0 || count > UINT_MAX) {
+		ERR("Invalid value for environment variable \"%s\": %s",
+				DEFAULT_CONSUMERD_SNAPSHOT_THREAD_COUNT_ENV,
+				env_count);
+		return 0;
+	}
+
+	return (unsigned int) count;
+}
+
 /*
  * Set open files limit to unlimited. This daemon can open a large number of
  * file descriptors in order to consumer multiple kernel traces.
@@ -297,6 +412,8 @@ int main(int argc, char **argv)
 {
 	int ret = 0, retval = 0;
 	void *status;
+	unsigned int i, data_thread_count, launched_data_thread_count = 0;
+	unsigned int io_uring_entries;
 	struct lttng_consumer_local_data *tmp_ctx;
 
 	rcu_register_thread();
@@ -405,9 +522,31 @@ int main(int argc, char **argv)
 		set_ulimit();
 	}
 
+	data_thread_count = get_data_thread_count();
+	if (!data_thread_count) {
+		retval = -1;
+		goto exit_init_data;
+	}
+
+	if (get_io_uring_entries(&io_uring_entries)) {
+		retval = -1;
+		goto exit_init_data;
+	}
+
+	if (get_sparse_padding(&consumer_data.sparse_padding)) {
+		retval = -1;
+		goto exit_init_data;
+	}
+
+	consumer_data.snapshot_thread_count = get_snapshot_thread_count();
+	if (!consumer_data.snapshot_thread_count) {
+		retval = -1;
+		goto exit_init_data;
+	}
+
 	/* create the consumer instance with and assign the callbacks */
 	ctx = lttng_consumer_create(opt_type, lttng_consumer_read_subbuffer,
-		NULL, lttng_consumer_on_recv_stream, NULL);
+		NULL, lttng_consumer_on_recv_stream, NULL, data_thread_count);
 	if (!ctx) {
 		retval = -1;
 		goto exit_init_data;
@@ -463,15 +602,16 @@ int main(int argc, char **argv)
 	lttng_consumer_set_error_sock(ctx, ret);
 
 	/*
-	 * Block RT signals used for UST periodical metadata flush and the live
-	 * timer in main, and create a dedicated thread to handle these signals.
+	 * Create the timerfd driving the UST periodical metadata flush, live
+	 * and monitor timers, which a dedicated thread handles.
 	 */
-	if (consumer_signal_init()) {
+	if (consumer_timer_init()) {
 		retval = -1;
 		goto exit_init_data;
 	}
 
 	ctx->type = opt_type;
+	ctx->io_uring_entries = io_uring_entries;
 
 	if (utils_create_pipe(health_quit_pipe)) {
 		retval = -1;
@@ -533,14 +673,19 @@ int main(int argc, char **argv)
 		goto exit_metadata_thread;
 	}
 
-	/* Create thread to manage the polling/writing of trace data */
-	ret = pthread_create(&data_thread, default_pthread_attr(),
-			consumer_thread_data_poll, (void *) ctx);
-	if (ret) {
-		errno = ret;
-		PERROR("pthread_create");
-		retval = -1;
-		goto exit_data_thread;
+	/* Create threads to manage the polling/writing of trace data */
+	for (i = 0; i < data_thread_count; i++) {
+		ret = pthread_create(&ctx->data_threads[i].thread,
+				default_pthread_attr(),
+				consumer_thread_data_poll,
+				(void *) &ctx->data_threads[i]);
+		if (ret) {
+			errno = ret;
+			PERROR("pthread_create");
+			retval = -1;
+			goto exit_data_thread;
+		}
+		launched_data_thread_count++;
 	}
 
 	/* Create the thread to manage the reception of fds */
@@ -568,13 +713,15 @@ int main(int argc, char **argv)
 	}
 exit_sessiond_thread:
 
-	ret = pthread_join(data_thread, &status);
-	if (ret) {
-		errno = ret;
-		PERROR("pthread_join data_thread");
-		retval = -1;
-	}
 exit_data_thread:
+	for (i = 0; i < launched_data_thread_count; i++) {
+		ret = pthread_join(ctx->data_threads[i].thread, &status);
+		if (ret) {
+			errno = ret;
+			PERROR("pthread_join data_thread");
+			retval = -1;
+		}
+	}
 
 	ret = pthread_join(metadata_thread, &status);
 	if (ret) {
@@ -625,7 +772,7 @@ exit_init_data:
 		 * threads are gone, because it is required to perform timer
 		 * teardown synchronization.
 		 */
-		kill(getpid(), LTTNG_CONSUMER_SIG_EXIT);
+		(void) consumer_timer_thread_quit();
 		ret = pthread_join(metadata_timer_thread, &status);
 		if (ret) {
 			errno = ret;
@@ -641,6 +788,7 @@ exit_init_data:
 		}
 		metadata_timer_thread_online = false;
 	}
+	consumer_timer_fini();
 	tmp_ctx = ctx;
 	ctx = NULL;
 	cmm_barrier();	/* Clear ctx for signal handler. */
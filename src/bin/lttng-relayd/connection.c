@@ -120,6 +120,9 @@ static void rcu_free_connection(struct rcu_head *head)
 	if (conn->type == RELAY_CONTROL) {
 		lttng_dynamic_buffer_reset(
 				&conn->protocol.ctrl.reception_buffer);
+	} else if (conn->type == RELAY_VIEWER_COMMAND) {
+		lttng_dynamic_buffer_reset(
+				&conn->protocol.viewer.packet_buffer);
 	}
 	free(conn);
 }
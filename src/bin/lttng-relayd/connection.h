@@ -71,7 +71,8 @@ struct ctrl_connection_state_receive_payload {
  * from the live worker thread.
  *
  * The connections between the consumerd/sessiond and the relayd are only
- * handled by the "main" worker thread (as in, the worker thread in main.c).
+ * handled by the "main" worker thread to which they were dispatched (as in,
+ * one of the worker threads in main.c).
  *
  * This is why there are no back references to connections from the
  * sessions and session list.
@@ -126,6 +127,13 @@ struct relay_connection {
 			} state;
 			struct lttng_dynamic_buffer reception_buffer;
 		} ctrl;
+		struct {
+			/*
+			 * Data of the packets which can't be sent straight
+			 * from their trace file. Reused across requests.
+			 */
+			struct lttng_dynamic_buffer packet_buffer;
+		} viewer;
 	} protocol;
 };
 
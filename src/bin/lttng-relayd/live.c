@@ -21,6 +21,9 @@
 #include <sys/mman.h>
 #include <sys/mount.h>
 #include <sys/resource.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -64,17 +67,29 @@
 static struct lttng_uri *live_uri;
 
 /*
- * This pipe is used to inform the worker thread that a command is queued and
- * ready to be processed.
+ * A live worker thread serves a subset of the viewer connections. Each
+ * connection is assigned to a single worker by the dispatcher thread and is
+ * only ever accessed by that worker afterwards.
  */
-static int live_conn_pipe[2] = { -1, -1 };
+struct live_worker {
+	unsigned int id;
+	pthread_t thread;
+	/*
+	 * This pipe is used to inform the worker thread that a connection is
+	 * queued and ready to be processed.
+	 */
+	int conn_pipe[2];
+};
 
 /* Shared between threads */
 static int live_dispatch_thread_exit;
 
 static pthread_t live_listener_thread;
 static pthread_t live_dispatcher_thread;
-static pthread_t live_worker_thread;
+
+static struct live_worker *live_workers;
+static unsigned int live_worker_count;
+static unsigned int launched_live_worker_count;
 
 /*
  * Relay command queue.
@@ -832,6 +847,8 @@ void *thread_dispatcher(void *data)
 	ssize_t ret;
 	struct cds_wfcq_node *node;
 	struct relay_connection *conn = NULL;
+	struct live_worker *worker;
+	unsigned int next_worker_id = 0;
 
 	DBG("[thread] Live viewer relay dispatcher started");
 
@@ -866,8 +883,15 @@ void *thread_dispatcher(void *data)
 				break;
 			}
 			conn = caa_container_of(node, struct relay_connection, qnode);
-			DBG("Dispatching viewer request waiting on sock %d",
-					conn->sock->fd);
+
+			/*
+			 * Viewer connections are assigned to the workers in
+			 * turn: their load does not depend on their socket.
+			 */
+			worker = &live_workers[next_worker_id];
+			next_worker_id = (next_worker_id + 1) % live_worker_count;
+			DBG("Dispatching viewer request waiting on sock %d to live worker %u",
+					conn->sock->fd, worker->id);
 
 			/*
 			 * Inform worker thread of the new request. This
@@ -875,7 +899,7 @@ void *thread_dispatcher(void *data)
 			 * the data will be read at some point in time
 			 * or wait to the end of the world :)
 			 */
-			ret = lttng_write(live_conn_pipe[1], &conn, sizeof(conn));
+			ret = lttng_write(worker->conn_pipe[1], &conn, sizeof(conn));
 			if (ret < 0) {
 				PERROR("write conn pipe");
 				connection_put(conn);
@@ -952,6 +976,7 @@ int viewer_connect(struct relay_connection *conn)
 
 	if (be32toh(msg.type) == LTTNG_VIEWER_CLIENT_COMMAND) {
 		conn->type = RELAY_VIEWER_COMMAND;
+		lttng_dynamic_buffer_init(&conn->protocol.viewer.packet_buffer);
 	} else if (be32toh(msg.type) == LTTNG_VIEWER_CLIENT_NOTIFICATION) {
 		conn->type = RELAY_VIEWER_NOTIFICATION;
 	} else {
@@ -963,15 +988,18 @@ int viewer_connect(struct relay_connection *conn)
 	reply.major = htobe32(reply.major);
 	reply.minor = htobe32(reply.minor);
 	if (conn->type == RELAY_VIEWER_COMMAND) {
+		uint64_t viewer_session_id;
+
 		/*
 		 * Increment outside of htobe64 macro, because the argument can
 		 * be used more than once within the macro, and thus the
-		 * operation may be undefined.
+		 * operation may be undefined. The id is copied under the lock
+		 * since the viewers connect through several worker threads.
 		 */
 		pthread_mutex_lock(&last_relay_viewer_session_id_lock);
-		last_relay_viewer_session_id++;
+		viewer_session_id = ++last_relay_viewer_session_id;
 		pthread_mutex_unlock(&last_relay_viewer_session_id_lock);
-		reply.viewer_session_id = htobe64(last_relay_viewer_session_id);
+		reply.viewer_session_id = htobe64(viewer_session_id);
 	}
 
 	health_code_update();
@@ -1801,6 +1829,94 @@ error_put:
 	return ret;
 }
 
+/*
+ * Send the `len` bytes of `fd` starting at `offset` to the viewer by copying
+ * them through the connection's packet buffer.
+ *
+ * Return 0 on success or else a negative value.
+ */
+static
+int send_packet_data_copy(struct relay_connection *conn, int fd, off_t offset,
+		size_t len)
+{
+	int ret;
+	ssize_t read_len;
+	struct lttng_dynamic_buffer *buffer =
+			&conn->protocol.viewer.packet_buffer;
+
+	ret = lttng_dynamic_buffer_set_size(buffer, len);
+	if (ret) {
+		ERR("Failed to allocate viewer packet buffer of %zu bytes", len);
+		goto end;
+	}
+
+	do {
+		read_len = pread(fd, buffer->data, len, offset);
+	} while (read_len < 0 && errno == EINTR);
+	if (read_len < (ssize_t) len) {
+		PERROR("Failed to read packet data at offset %jd",
+				(intmax_t) offset);
+		ret = -1;
+		goto end;
+	}
+
+	ret = send_response(conn->sock, buffer->data, len) < 0 ? -1 : 0;
+end:
+	return ret;
+}
+
+/*
+ * Send the `len` bytes of `fd` starting at `offset` to the viewer.
+ *
+ * The data is sent straight from the page cache to the socket when
+ * possible and copied through the connection's packet buffer otherwise.
+ *
+ * Return 0 on success or else a negative value.
+ */
+static
+int send_packet_data(struct relay_connection *conn, int fd, off_t offset,
+		size_t len)
+{
+	int ret = 0;
+#ifdef __linux__
+	size_t sent = 0;
+
+	while (sent < len) {
+		ssize_t send_ret;
+
+		send_ret = sendfile(conn->sock->fd, fd, &offset, len - sent);
+		if (send_ret < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			if (sent == 0 && (errno == EINVAL || errno == ENOSYS)) {
+				/* This file can't be sent this way. */
+				goto copy;
+			}
+			PERROR("Failed to send packet data to viewer");
+			ret = -1;
+			goto end;
+		} else if (send_ret == 0) {
+			/*
+			 * The file was truncated (cleared) since its size was
+			 * checked; the promised data can't be sent.
+			 */
+			ERR("Unexpected end of file while sending packet data to viewer");
+			ret = -1;
+			goto end;
+		}
+		sent += send_ret;
+	}
+	goto end;
+copy:
+#endif /* __linux__ */
+	ret = send_packet_data_copy(conn, fd, offset, len);
+#ifdef __linux__
+end:
+#endif /* __linux__ */
+	return ret;
+}
+
 /*
  * Send the next index for a stream
  *
@@ -1809,16 +1925,13 @@ error_put:
 static
 int viewer_get_packet(struct relay_connection *conn)
 {
-	int ret;
-	off_t lseek_ret;
-	char *reply = NULL;
+	int ret, fd = -1;
+	struct stat file_stat;
 	struct lttng_viewer_get_packet get_packet_info;
 	struct lttng_viewer_trace_packet reply_header;
 	struct relay_viewer_stream *vstream = NULL;
-	uint32_t reply_size = sizeof(reply_header);
 	uint32_t packet_data_len = 0;
-	ssize_t read_len;
-	uint64_t stream_id;
+	uint64_t stream_id, offset;
 
 	DBG2("Relay get data packet");
 
@@ -1834,81 +1947,91 @@ int viewer_get_packet(struct relay_connection *conn)
 	/* From this point on, the error label can be reached. */
 	memset(&reply_header, 0, sizeof(reply_header));
 	stream_id = (uint64_t) be64toh(get_packet_info.stream_id);
+	offset = be64toh(get_packet_info.offset);
 
 	vstream = viewer_stream_get_by_id(stream_id);
 	if (!vstream) {
 		DBG("Client requested packet of unknown stream id %" PRIu64,
 				stream_id);
-		reply_header.status = htobe32(LTTNG_VIEWER_GET_PACKET_ERR);
-		goto send_reply_nolock;
-	} else {
-		packet_data_len = be32toh(get_packet_info.len);
-		reply_size += packet_data_len;
+		goto error_nolock;
 	}
+	packet_data_len = be32toh(get_packet_info.len);
 
-	reply = zmalloc(reply_size);
-	if (!reply) {
-		PERROR("packet reply zmalloc");
-		reply_size = sizeof(reply_header);
+	pthread_mutex_lock(&vstream->stream->lock);
+	if (!vstream->stream_file.handle) {
+		ERR("Client requested packet of viewer stream %" PRIu64
+		    " which has no open trace file", stream_id);
 		goto error;
 	}
 
-	pthread_mutex_lock(&vstream->stream->lock);
-	lseek_ret = fs_handle_seek(vstream->stream_file.handle,
-			be64toh(get_packet_info.offset), SEEK_SET);
-	if (lseek_ret < 0) {
-		PERROR("Failed to seek file system handle of viewer stream %" PRIu64
-		       " to offset %" PRIu64,
-				stream_id,
-				(uint64_t) be64toh(get_packet_info.offset));
+	/*
+	 * The fd remains in use until the packet is sent, which prevents
+	 * the fd tracker from suspending it. The viewer stream's file is
+	 * only replaced by the commands of this connection.
+	 */
+	fd = fs_handle_get_fd(vstream->stream_file.handle);
+	if (fd < 0) {
+		ERR("Failed to restore viewer stream file system handle");
+		goto error;
+	}
+
+	/*
+	 * The packet's availability is checked before its header is sent
+	 * since an error can't be reported once the transfer has started.
+	 */
+	ret = fstat(fd, &file_stat);
+	if (ret < 0) {
+		PERROR("Failed to stat trace file of viewer stream %" PRIu64,
+				stream_id);
 		goto error;
 	}
-	read_len = fs_handle_read(vstream->stream_file.handle,
-			reply + sizeof(reply_header), packet_data_len);
-	if (read_len < packet_data_len) {
-		PERROR("Failed to read from file system handle of viewer stream id %" PRIu64
-		       ", offset: %" PRIu64,
-				stream_id,
-				(uint64_t) be64toh(get_packet_info.offset));
+	if (offset + packet_data_len > (uint64_t) file_stat.st_size) {
+		ERR("Client requested packet beyond the end of the trace file of viewer stream id %" PRIu64
+		    ", offset: %" PRIu64 ", length: %" PRIu32,
+				stream_id, offset, packet_data_len);
 		goto error;
 	}
+	pthread_mutex_unlock(&vstream->stream->lock);
+
 	reply_header.status = htobe32(LTTNG_VIEWER_GET_PACKET_OK);
 	reply_header.len = htobe32(packet_data_len);
-	goto send_reply;
 
-error:
-	/* No payload to send on error. */
-	reply_size = sizeof(reply_header);
-	reply_header.status = htobe32(LTTNG_VIEWER_GET_PACKET_ERR);
+	health_code_update();
 
-send_reply:
-	if (vstream) {
-		pthread_mutex_unlock(&vstream->stream->lock);
+	/* The header is sent along with the start of the packet. */
+	ret = conn->sock->ops->sendmsg(conn->sock, &reply_header,
+			sizeof(reply_header), MSG_MORE);
+	if (ret < 0) {
+		PERROR("sendmsg of packet header failed");
+		goto end;
 	}
-send_reply_nolock:
 
+	ret = send_packet_data(conn, fd, (off_t) offset, packet_data_len);
 	health_code_update();
-
-	if (reply) {
-		memcpy(reply, &reply_header, sizeof(reply_header));
-		ret = send_response(conn->sock, reply, reply_size);
-	} else {
-		/* No reply to send. */
-		ret = send_response(conn->sock, &reply_header,
-				reply_size);
+	if (ret < 0) {
+		goto end;
 	}
 
+	DBG("Sent %zu bytes for stream %" PRIu64,
+			sizeof(reply_header) + packet_data_len, stream_id);
+	goto end;
+
+error:
+	pthread_mutex_unlock(&vstream->stream->lock);
+error_nolock:
+	/* No payload to send on error. */
+	reply_header.status = htobe32(LTTNG_VIEWER_GET_PACKET_ERR);
+
+	health_code_update();
+	ret = send_response(conn->sock, &reply_header, sizeof(reply_header));
 	health_code_update();
 	if (ret < 0) {
 		PERROR("sendmsg of packet data failed");
-		goto end_free;
 	}
-
-	DBG("Sent %u bytes for stream %" PRIu64, reply_size, stream_id);
-
-end_free:
-	free(reply);
 end:
+	if (fd >= 0) {
+		fs_handle_put_fd(vstream->stream_file.handle);
+	}
 	if (vstream) {
 		viewer_stream_put(vstream);
 	}
@@ -2388,8 +2511,9 @@ void *thread_worker(void *data)
 	struct lttng_ht_iter iter;
 	struct lttng_viewer_cmd recv_hdr;
 	struct relay_connection *destroy_conn;
+	struct live_worker *worker = data;
 
-	DBG("[thread] Live viewer relay worker started");
+	DBG("[thread] Live viewer relay worker %u started", worker->id);
 
 	rcu_register_thread();
 
@@ -2411,7 +2535,8 @@ void *thread_worker(void *data)
 		goto error_poll_create;
 	}
 
-	ret = lttng_poll_add(&events, live_conn_pipe[0], LPOLLIN | LPOLLRDHUP);
+	ret = lttng_poll_add(&events, worker->conn_pipe[0],
+			LPOLLIN | LPOLLRDHUP);
 	if (ret < 0) {
 		goto error;
 	}
@@ -2459,11 +2584,11 @@ restart:
 			}
 
 			/* Inspect the relay conn pipe for new connection. */
-			if (pollfd == live_conn_pipe[0]) {
+			if (pollfd == worker->conn_pipe[0]) {
 				if (revents & LPOLLIN) {
 					struct relay_connection *conn;
 
-					ret = lttng_read(live_conn_pipe[0],
+					ret = lttng_read(worker->conn_pipe[0],
 							&conn, sizeof(conn));
 					if (ret < 0) {
 						goto error;
@@ -2476,7 +2601,8 @@ restart:
 						goto error;
 					}
 					connection_ht_add(viewer_connections_ht, conn);
-					DBG("Connection socket %d added to poll", conn->sock->fd);
+					DBG("Connection socket %d added to poll of live worker %u",
+							conn->sock->fd, worker->id);
 				} else if (revents & (LPOLLERR | LPOLLHUP | LPOLLRDHUP)) {
 					ERR("Relay live pipe error");
 					goto error;
@@ -2544,11 +2670,11 @@ error_poll_create:
 	lttng_ht_destroy(viewer_connections_ht);
 viewer_connections_ht_error:
 	/* Close relay conn pipes */
-	(void) fd_tracker_util_pipe_close(the_fd_tracker, live_conn_pipe);
+	(void) fd_tracker_util_pipe_close(the_fd_tracker, worker->conn_pipe);
 	if (err) {
 		DBG("Viewer worker thread exited with error");
 	}
-	DBG("Viewer worker thread cleanup complete");
+	DBG("Viewer worker thread %u cleanup complete", worker->id);
 error_testpoint:
 	if (err) {
 		health_error();
@@ -2563,13 +2689,97 @@ error_testpoint:
 }
 
 /*
- * Create the relay command pipe to wake thread_manage_apps.
- * Closed in cleanup().
+ * Create the connection pipe of a live worker thread. Closed by the worker
+ * thread on exit.
+ */
+static int create_conn_pipe(struct live_worker *worker)
+{
+	int ret;
+	char *name = NULL;
+
+	ret = asprintf(&name, "Live connection pipe (worker %u)", worker->id);
+	if (ret < 0) {
+		PERROR("Failed to format live connection pipe name");
+		goto end;
+	}
+
+	ret = fd_tracker_util_pipe_open_cloexec(the_fd_tracker, name,
+			worker->conn_pipe);
+	free(name);
+end:
+	return ret;
+}
+
+/*
+ * Allocate the live worker thread descriptors and their connection pipes.
+ */
+static int create_live_workers(unsigned int worker_count)
+{
+	int ret = 0;
+	unsigned int i;
+
+	live_workers = zmalloc(sizeof(*live_workers) * worker_count);
+	if (!live_workers) {
+		PERROR("Failed to allocate live worker threads");
+		ret = -1;
+		goto end;
+	}
+	live_worker_count = worker_count;
+
+	for (i = 0; i < live_worker_count; i++) {
+		live_workers[i].id = i;
+		live_workers[i].conn_pipe[0] = -1;
+		live_workers[i].conn_pipe[1] = -1;
+	}
+
+	for (i = 0; i < live_worker_count; i++) {
+		ret = create_conn_pipe(&live_workers[i]);
+		if (ret) {
+			goto end;
+		}
+	}
+end:
+	return ret;
+}
+
+/*
+ * Join the launched live worker threads, close the connection pipes of the
+ * workers that were never launched and free the worker descriptors.
  */
-static int create_conn_pipe(void)
+static int join_live_workers(void)
 {
-	return fd_tracker_util_pipe_open_cloexec(the_fd_tracker,
-			"Live connection pipe", live_conn_pipe);
+	int ret, retval = 0;
+	unsigned int i;
+	void *status;
+
+	if (!live_workers) {
+		goto end;
+	}
+
+	for (i = 0; i < launched_live_worker_count; i++) {
+		ret = pthread_join(live_workers[i].thread, &status);
+		if (ret) {
+			errno = ret;
+			PERROR("pthread_join live worker");
+			retval = -1;
+		}
+	}
+
+	for (i = launched_live_worker_count; i < live_worker_count; i++) {
+		if (live_workers[i].conn_pipe[0] == -1) {
+			continue;
+		}
+
+		(void) fd_tracker_util_pipe_close(the_fd_tracker,
+				live_workers[i].conn_pipe);
+	}
+
+	free(live_workers);
+	live_workers = NULL;
+	live_worker_count = 0;
+	launched_live_worker_count = 0;
+end:
+	return retval;
 }
 
 int relayd_live_join(void)
@@ -2584,10 +2794,8 @@ int relayd_live_join(void)
 		retval = -1;
 	}
 
-	ret = pthread_join(live_worker_thread, &status);
+	ret = join_live_workers();
 	if (ret) {
-		errno = ret;
-		PERROR("pthread_join live worker");
 		retval = -1;
 	}
 
@@ -2606,11 +2814,12 @@ int relayd_live_join(void)
 /*
  * main
  */
-int relayd_live_create(struct lttng_uri *uri)
+int relayd_live_create(struct lttng_uri *uri, unsigned int worker_thread_count)
 {
 	int ret = 0, retval = 0;
 	void *status;
 	int is_root;
+	unsigned int i;
 
 	if (!uri) {
 		retval = -1;
@@ -2629,8 +2838,8 @@ int relayd_live_create(struct lttng_uri *uri)
 		}
 	}
 
-	/* Setup the thread apps communication pipe. */
-	if (create_conn_pipe()) {
+	/* Setup the worker threads' communication pipes. */
+	if (create_live_workers(worker_thread_count)) {
 		retval = -1;
 		goto exit_init_data;
 	}
@@ -2654,14 +2863,19 @@ int relayd_live_create(struct lttng_uri *uri)
 		goto exit_dispatcher_thread;
 	}
 
-	/* Setup the worker thread */
-	ret = pthread_create(&live_worker_thread, default_pthread_attr(),
-			thread_worker, NULL);
-	if (ret) {
-		errno = ret;
-		PERROR("pthread_create viewer worker");
-		retval = -1;
-		goto exit_worker_thread;
+	/* Setup the worker threads */
+	DBG("Launching %u live viewer worker thread(s)", live_worker_count);
+	for (i = 0; i < live_worker_count; i++) {
+		ret = pthread_create(&live_workers[i].thread,
+				default_pthread_attr(), thread_worker,
+				&live_workers[i]);
+		if (ret) {
+			errno = ret;
+			PERROR("pthread_create viewer worker");
+			retval = -1;
+			goto exit_worker_thread;
+		}
+		launched_live_worker_count++;
 	}
 
 	/* Setup the listener thread */
@@ -2685,14 +2899,12 @@ int relayd_live_create(struct lttng_uri *uri)
 	 */
 
 exit_listener_thread:
-
-	ret = pthread_join(live_worker_thread, &status);
-	if (ret) {
-		errno = ret;
-		PERROR("pthread_join live worker");
-		retval = -1;
-	}
 exit_worker_thread:
+	if (launched_live_worker_count) {
+		/* Unblock the worker threads that were already launched. */
+		(void) lttng_relay_stop_threads();
+	}
+	(void) join_live_workers();
 
 	ret = pthread_join(live_dispatcher_thread, &status);
 	if (ret) {
@@ -2703,6 +2915,7 @@ exit_worker_thread:
 exit_dispatcher_thread:
 
 exit_init_data:
+	(void) join_live_workers();
 	cleanup_relayd_live();
 
 	return retval;
@@ -11,6 +11,7 @@
  */
 
 #include <limits.h>
+#include <stdbool.h>
 #include <urcu.h>
 #include <urcu/wfcqueue.h>
 
@@ -48,6 +49,7 @@ extern char *opt_output_path;
 extern const char *tracing_group_name;
 extern const char * const config_section_name;
 extern enum relay_group_output_by opt_group_output_by;
+extern bool opt_sparse_padding;
 
 extern int thread_quit_pipe[2];
 
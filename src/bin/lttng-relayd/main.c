@@ -55,6 +55,7 @@
 #include <common/string-utils/format.h>
 #include <common/fd-tracker/fd-tracker.h>
 #include <common/fd-tracker/utils.h>
+#include <common/hashtable/utils.h>
 
 #include "backward-compatibility-group-by.h"
 #include "cmd.h"
@@ -94,6 +95,7 @@ enum relay_connection_status {
 char *opt_output_path, *opt_working_directory;
 static int opt_daemon, opt_background, opt_print_version, opt_allow_clear = 1;
 enum relay_group_output_by opt_group_output_by = RELAYD_GROUP_OUTPUT_BY_UNKNOWN;
+bool opt_sparse_padding;
 
 /*
  * We need to wait for listener and live listener threads, as well as
@@ -126,19 +128,39 @@ const char * const config_section_name = "relayd";
 int thread_quit_pipe[2] = { -1, -1 };
 
 /*
- * This pipe is used to inform the worker thread that a command is queued and
- * ready to be processed.
+ * A worker thread serves a subset of the consumerd/sessiond connections. Each
+ * connection is assigned to a single worker by the dispatcher thread and is
+ * only ever accessed by that worker afterwards.
  */
-static int relay_conn_pipe[2] = { -1, -1 };
+struct relay_worker {
+	unsigned int id;
+	pthread_t thread;
+	/*
+	 * This pipe is used to inform the worker thread that a connection is
+	 * queued and ready to be processed.
+	 */
+	int conn_pipe[2];
+	/*
+	 * Pipe through which the payload of data packets is spliced from the
+	 * data connections' sockets to the streams' files. It is always
+	 * empty between two packet reception operations.
+	 */
+	int splice_pipe[2];
+};
 
 /* Shared between threads */
 static int dispatch_thread_exit;
 
 static pthread_t listener_thread;
 static pthread_t dispatcher_thread;
-static pthread_t worker_thread;
 static pthread_t health_thread;
 
+static struct relay_worker *relay_workers;
+static unsigned int opt_worker_thread_count =
+		DEFAULT_RELAYD_WORKER_THREAD_COUNT;
+static unsigned int opt_live_worker_thread_count =
+		DEFAULT_RELAYD_LIVE_WORKER_THREAD_COUNT;
+
 /*
  * last_relay_stream_id_lock protects last_relay_stream_id increment
  * atomicity on 32-bit architectures.
@@ -182,6 +204,8 @@ static struct option long_options[] = {
 	{ "background", 0, 0, 'b', },
 	{ "group", 1, 0, 'g', },
 	{ "fd-pool-size", 1, 0, '\0', },
+	{ "worker-threads", 1, 0, '\0', },
+	{ "live-worker-threads", 1, 0, '\0', },
 	{ "help", 0, 0, 'h', },
 	{ "output", 1, 0, 'o', },
 	{ "verbose", 0, 0, 'v', },
@@ -191,6 +215,7 @@ static struct option long_options[] = {
 	{ "group-output-by-session", 0, 0, 's', },
 	{ "group-output-by-host", 0, 0, 'p', },
 	{ "disallow-clear", 0, 0, 'x' },
+	{ "sparse-padding", 0, 0, '\0' },
 	{ NULL, 0, 0, 0, },
 };
 
@@ -241,6 +266,40 @@ static int set_option(int opt, const char *arg, const char *optname)
 				goto end;
 			}
 			lttng_opt_fd_pool_size = (unsigned int) v;
+		} else if (!strcmp(optname, "worker-threads")) {
+			unsigned long v;
+
+			errno = 0;
+			v = strtoul(arg, NULL, 0);
+			if (errno != 0 || !isdigit((unsigned char) arg[0])) {
+				ERR("Wrong value in --worker-threads parameter: %s", arg);
+				ret = -1;
+				goto end;
+			}
+			if (v == 0 || v >= UINT_MAX) {
+				ERR("Invalid worker thread count in --worker-threads parameter: %s", arg);
+				ret = -1;
+				goto end;
+			}
+			opt_worker_thread_count = (unsigned int) v;
+		} else if (!strcmp(optname, "live-worker-threads")) {
+			unsigned long v;
+
+			errno = 0;
+			v = strtoul(arg, NULL, 0);
+			if (errno != 0 || !isdigit((unsigned char) arg[0])) {
+				ERR("Wrong value in --live-worker-threads parameter: %s", arg);
+				ret = -1;
+				goto end;
+			}
+			if (v == 0 || v >= UINT_MAX) {
+				ERR("Invalid worker thread count in --live-worker-threads parameter: %s", arg);
+				ret = -1;
+				goto end;
+			}
+			opt_live_worker_thread_count = (unsigned int) v;
+		} else if (!strcmp(optname, "sparse-padding")) {
+			opt_sparse_padding = true;
 		} else {
 			fprintf(stderr, "unknown option %s", optname);
 			if (arg) {
@@ -1073,6 +1132,25 @@ end:
 	return new_sock;
 }
 
+static int set_sock_nonblocking(int fd)
+{
+	int ret;
+
+	ret = fcntl(fd, F_GETFL, 0);
+	if (ret == -1) {
+		PERROR("Failed to get flags of socket %d", fd);
+		goto end;
+	}
+
+	ret = fcntl(fd, F_SETFL, ret | O_NONBLOCK);
+	if (ret == -1) {
+		PERROR("Failed to set socket %d as non-blocking", fd);
+		goto end;
+	}
+end:
+	return ret;
+}
+
 /*
  * This thread manages the listening for new connections on the network
  */
@@ -1206,6 +1284,20 @@ restart:
 					goto error;
 				}
 
+				if (type == RELAY_DATA) {
+					/*
+					 * Data connections are only read when
+					 * data is available. Since splice(2)
+					 * ignores MSG_DONTWAIT, the socket
+					 * itself is made non-blocking.
+					 */
+					ret = set_sock_nonblocking(newsock->fd);
+					if (ret < 0) {
+						lttcomm_destroy_sock(newsock);
+						goto error;
+					}
+				}
+
 				new_conn = connection_create(newsock, type);
 				if (!new_conn) {
 					lttcomm_destroy_sock(newsock);
@@ -1275,6 +1367,24 @@ error_sock_control:
 	return NULL;
 }
 
+/*
+ * Select the worker thread that will own a connection.
+ *
+ * Connections are sharded on their socket's file descriptor so that
+ * the connections of all peers are spread across the worker threads.
+ * Sessions and streams are protected by their own locks, which allows
+ * the control and data connections of a given peer to be served by
+ * different workers.
+ */
+static struct relay_worker *relay_worker_from_connection(
+		const struct relay_connection *conn)
+{
+	const unsigned long key = (unsigned long) conn->sock->fd;
+
+	return &relay_workers[hash_key_ulong((void *) key, lttng_ht_seed) %
+			opt_worker_thread_count];
+}
+
 /*
  * This thread manages the dispatching of the requests to worker threads
  */
@@ -1284,6 +1394,7 @@ static void *relay_thread_dispatcher(void *data)
 	ssize_t ret;
 	struct cds_wfcq_node *node;
 	struct relay_connection *new_conn = NULL;
+	struct relay_worker *worker;
 
 	DBG("[thread] Relay dispatcher started");
 
@@ -1318,7 +1429,9 @@ static void *relay_thread_dispatcher(void *data)
 			}
 			new_conn = caa_container_of(node, struct relay_connection, qnode);
 
-			DBG("Dispatching request waiting on sock %d", new_conn->sock->fd);
+			worker = relay_worker_from_connection(new_conn);
+			DBG("Dispatching request waiting on sock %d to worker %u",
+					new_conn->sock->fd, worker->id);
 
 			/*
 			 * Inform worker thread of the new request. This
@@ -1326,7 +1439,8 @@ static void *relay_thread_dispatcher(void *data)
 			 * the data will be read at some point in time
 			 * or wait to the end of the world :)
 			 */
-			ret = lttng_write(relay_conn_pipe[1], &new_conn, sizeof(new_conn));
+			ret = lttng_write(worker->conn_pipe[1], &new_conn,
+					sizeof(new_conn));
 			if (ret < 0) {
 				PERROR("write connection pipe");
 				connection_put(new_conn);
@@ -2051,6 +2165,49 @@ end:
 	return ret;
 }
 
+/*
+ * Check if the data of a stream is pending up to a given network sequence
+ * number and flag the stream as checked for the ongoing data pending command.
+ *
+ * Return 1 if data is pending, 0 if not.
+ */
+static int stream_data_pending(const struct relay_session *session,
+		struct relay_stream *stream, uint64_t last_net_seq_num)
+{
+	int ret;
+	uint64_t stream_seq;
+
+	pthread_mutex_lock(&stream->lock);
+
+	if (session_streams_have_index(session)) {
+		/*
+		 * Ensure that both the index and stream data have been
+		 * flushed up to the requested point.
+		 */
+		stream_seq = min(stream->prev_data_seq, stream->prev_index_seq);
+	} else {
+		stream_seq = stream->prev_data_seq;
+	}
+	DBG("Data pending for stream id %" PRIu64 ": prev_data_seq %" PRIu64
+			", prev_index_seq %" PRIu64
+			", and last_seq %" PRIu64, stream->stream_handle,
+			stream->prev_data_seq, stream->prev_index_seq,
+			last_net_seq_num);
+
+	/* Avoid wrapping issue */
+	if (((int64_t) (stream_seq - last_net_seq_num)) >= 0) {
+		/* Data has in fact been written and is NOT pending */
+		ret = 0;
+	} else {
+		/* Data still being streamed thus pending */
+		ret = 1;
+	}
+
+	stream->data_pending_check_done = true;
+	pthread_mutex_unlock(&stream->lock);
+	return ret;
+}
+
 /*
  * Check for data pending for a given stream id from the session daemon.
  */
@@ -2064,7 +2221,6 @@ static int relay_data_pending(const struct lttcomm_relayd_hdr *recv_hdr,
 	struct relay_stream *stream;
 	ssize_t send_ret;
 	int ret;
-	uint64_t stream_seq;
 
 	DBG("Data pending command received");
 
@@ -2090,35 +2246,7 @@ static int relay_data_pending(const struct lttcomm_relayd_hdr *recv_hdr,
 		goto end;
 	}
 
-	pthread_mutex_lock(&stream->lock);
-
-	if (session_streams_have_index(session)) {
-		/*
-		 * Ensure that both the index and stream data have been
-		 * flushed up to the requested point.
-		 */
-		stream_seq = min(stream->prev_data_seq, stream->prev_index_seq);
-	} else {
-		stream_seq = stream->prev_data_seq;
-	}
-	DBG("Data pending for stream id %" PRIu64 ": prev_data_seq %" PRIu64
-			", prev_index_seq %" PRIu64
-			", and last_seq %" PRIu64, msg.stream_id,
-			stream->prev_data_seq, stream->prev_index_seq,
-			msg.last_net_seq_num);
-
-	/* Avoid wrapping issue */
-	if (((int64_t) (stream_seq - msg.last_net_seq_num)) >= 0) {
-		/* Data has in fact been written and is NOT pending */
-		ret = 0;
-	} else {
-		/* Data still being streamed thus pending */
-		ret = 1;
-	}
-
-	stream->data_pending_check_done = true;
-	pthread_mutex_unlock(&stream->lock);
-
+	ret = stream_data_pending(session, stream, msg.last_net_seq_num);
 	stream_put(stream);
 end:
 
@@ -2196,6 +2324,94 @@ end_no_session:
 	return ret;
 }
 
+/*
+ * Clear the data_pending_check_done flag of all the streams of a session.
+ */
+static void session_streams_begin_data_pending(uint64_t session_id)
+{
+	struct lttng_ht_iter iter;
+	struct relay_stream *stream;
+
+	/*
+	 * Iterate over all streams to set the begin data pending flag.
+	 * For now, the streams are indexed by stream handle so we have
+	 * to iterate over all streams to find the one associated with
+	 * the right session_id.
+	 */
+	rcu_read_lock();
+	cds_lfht_for_each_entry(relay_streams_ht->ht, &iter.iter, stream,
+			node.node) {
+		if (!stream_get(stream)) {
+			continue;
+		}
+		if (stream->trace->session->id == session_id) {
+			pthread_mutex_lock(&stream->lock);
+			stream->data_pending_check_done = false;
+			pthread_mutex_unlock(&stream->lock);
+			DBG("Set begin data pending flag to stream %" PRIu64,
+					stream->stream_handle);
+		}
+		stream_put(stream);
+	}
+	rcu_read_unlock();
+}
+
+/*
+ * Check if data is in flight for the streams of a session which were not
+ * checked since the beginning of the data pending command, meaning that the
+ * client lost track of them.
+ */
+static bool session_streams_data_inflight(const struct relay_session *session,
+		uint64_t session_id)
+{
+	bool is_data_inflight = false;
+	struct lttng_ht_iter iter;
+	struct relay_stream *stream;
+
+	/*
+	 * Iterate over all streams to see if the begin data pending
+	 * flag is set.
+	 */
+	rcu_read_lock();
+	cds_lfht_for_each_entry(relay_streams_ht->ht, &iter.iter, stream,
+			node.node) {
+		if (!stream_get(stream)) {
+			continue;
+		}
+		if (stream->trace->session->id != session_id) {
+			stream_put(stream);
+			continue;
+		}
+		pthread_mutex_lock(&stream->lock);
+		if (!stream->data_pending_check_done) {
+			uint64_t stream_seq;
+
+			if (session_streams_have_index(session)) {
+				/*
+				 * Ensure that both the index and stream data have been
+				 * flushed up to the requested point.
+				 */
+				stream_seq = min(stream->prev_data_seq, stream->prev_index_seq);
+			} else {
+				stream_seq = stream->prev_data_seq;
+			}
+			if (!stream->closed || !(((int64_t) (stream_seq - stream->last_net_seq_num)) >= 0)) {
+				is_data_inflight = true;
+				DBG("Data is still in flight for stream %" PRIu64,
+						stream->stream_handle);
+				pthread_mutex_unlock(&stream->lock);
+				stream_put(stream);
+				break;
+			}
+		}
+		pthread_mutex_unlock(&stream->lock);
+		stream_put(stream);
+	}
+	rcu_read_unlock();
+
+	return is_data_inflight;
+}
+
 /*
  * Initialize a data pending command. This means that a consumer is about
  * to ask for data pending for each stream it holds. Simply iterate over
@@ -2209,10 +2425,8 @@ static int relay_begin_data_pending(const struct lttcomm_relayd_hdr *recv_hdr,
 {
 	int ret;
 	ssize_t send_ret;
-	struct lttng_ht_iter iter;
 	struct lttcomm_relayd_begin_data_pending msg;
 	struct lttcomm_relayd_generic_reply reply;
-	struct relay_stream *stream;
 
 	assert(recv_hdr);
 	assert(conn);
@@ -2234,28 +2448,7 @@ static int relay_begin_data_pending(const struct lttcomm_relayd_hdr *recv_hdr,
 	memcpy(&msg, payload->data, sizeof(msg));
 	msg.session_id = be64toh(msg.session_id);
 
-	/*
-	 * Iterate over all streams to set the begin data pending flag.
-	 * For now, the streams are indexed by stream handle so we have
-	 * to iterate over all streams to find the one associated with
-	 * the right session_id.
-	 */
-	rcu_read_lock();
-	cds_lfht_for_each_entry(relay_streams_ht->ht, &iter.iter, stream,
-			node.node) {
-		if (!stream_get(stream)) {
-			continue;
-		}
-		if (stream->trace->session->id == msg.session_id) {
-			pthread_mutex_lock(&stream->lock);
-			stream->data_pending_check_done = false;
-			pthread_mutex_unlock(&stream->lock);
-			DBG("Set begin data pending flag to stream %" PRIu64,
-					stream->stream_handle);
-		}
-		stream_put(stream);
-	}
-	rcu_read_unlock();
+	session_streams_begin_data_pending(msg.session_id);
 
 	memset(&reply, 0, sizeof(reply));
 	/* All good, send back reply. */
@@ -2289,11 +2482,9 @@ static int relay_end_data_pending(const struct lttcomm_relayd_hdr *recv_hdr,
 {
 	int ret;
 	ssize_t send_ret;
-	struct lttng_ht_iter iter;
 	struct lttcomm_relayd_end_data_pending msg;
 	struct lttcomm_relayd_generic_reply reply;
-	struct relay_stream *stream;
-	uint32_t is_data_inflight = 0;
+	uint32_t is_data_inflight;
 
 	DBG("End data pending command");
 
@@ -2312,46 +2503,8 @@ static int relay_end_data_pending(const struct lttcomm_relayd_hdr *recv_hdr,
 	memcpy(&msg, payload->data, sizeof(msg));
 	msg.session_id = be64toh(msg.session_id);
 
-	/*
-	 * Iterate over all streams to see if the begin data pending
-	 * flag is set.
-	 */
-	rcu_read_lock();
-	cds_lfht_for_each_entry(relay_streams_ht->ht, &iter.iter, stream,
-			node.node) {
-		if (!stream_get(stream)) {
-			continue;
-		}
-		if (stream->trace->session->id != msg.session_id) {
-			stream_put(stream);
-			continue;
-		}
-		pthread_mutex_lock(&stream->lock);
-		if (!stream->data_pending_check_done) {
-			uint64_t stream_seq;
-
-			if (session_streams_have_index(conn->session)) {
-				/*
-				 * Ensure that both the index and stream data have been
-				 * flushed up to the requested point.
-				 */
-				stream_seq = min(stream->prev_data_seq, stream->prev_index_seq);
-			} else {
-				stream_seq = stream->prev_data_seq;
-			}
-			if (!stream->closed || !(((int64_t) (stream_seq - stream->last_net_seq_num)) >= 0)) {
-				is_data_inflight = 1;
-				DBG("Data is still in flight for stream %" PRIu64,
-						stream->stream_handle);
-				pthread_mutex_unlock(&stream->lock);
-				stream_put(stream);
-				break;
-			}
-		}
-		pthread_mutex_unlock(&stream->lock);
-		stream_put(stream);
-	}
-	rcu_read_unlock();
+	is_data_inflight = session_streams_data_inflight(conn->session,
+			msg.session_id);
 
 	memset(&reply, 0, sizeof(reply));
 	/* All good, send back reply. */
@@ -2370,6 +2523,152 @@ end_no_session:
 	return ret;
 }
 
+/*
+ * Check for data pending for a batch of streams of a session (2.13+).
+ *
+ * This is the equivalent of a begin data pending command, followed by a data
+ * pending command for each data stream and a quiescent control command for
+ * each metadata stream of the batch, and by an end data pending command. A
+ * single reply is sent; its ret_code is 1 if data is pending, 0 if not.
+ */
+static int relay_session_data_pending(const struct lttcomm_relayd_hdr *recv_hdr,
+		struct relay_connection *conn,
+		const struct lttng_buffer_view *payload)
+{
+	int ret = 0;
+	ssize_t send_ret;
+	uint32_t i, stream_count;
+	int32_t is_data_pending = 0;
+	struct lttcomm_relayd_session_data_pending msg;
+	struct lttcomm_relayd_generic_reply reply;
+	const struct lttcomm_relayd_data_pending_stream *streams;
+
+	DBG("Session data pending command received");
+
+	if (!conn->session || !conn->version_check_done) {
+		ERR("Trying to check for data before version check");
+		ret = -1;
+		goto end_no_session;
+	}
+
+	if (payload->size < sizeof(msg)) {
+		ERR("Unexpected payload size in \"relay_session_data_pending\": expected >= %zu bytes, got %zu bytes",
+				sizeof(msg), payload->size);
+		ret = -1;
+		goto end_no_session;
+	}
+	memcpy(&msg, payload->data, sizeof(msg));
+	msg.session_id = be64toh(msg.session_id);
+	stream_count = be32toh(msg.stream_count);
+
+	if ((payload->size - sizeof(msg)) / sizeof(*streams) < stream_count) {
+		ERR("Unexpected payload size in \"relay_session_data_pending\": %zu bytes can't hold %" PRIu32 " streams",
+				payload->size, stream_count);
+		ret = -1;
+		goto end_no_session;
+	}
+	streams = (const struct lttcomm_relayd_data_pending_stream *)
+			(payload->data + sizeof(msg));
+
+	session_streams_begin_data_pending(msg.session_id);
+
+	for (i = 0; i < stream_count; i++) {
+		struct lttcomm_relayd_data_pending_stream stream_info;
+		struct relay_stream *stream;
+
+		/* The payload is not guaranteed to be suitably aligned. */
+		memcpy(&stream_info, &streams[i], sizeof(stream_info));
+		stream_info.stream_id = be64toh(stream_info.stream_id);
+		stream_info.last_net_seq_num =
+				be64toh(stream_info.last_net_seq_num);
+
+		stream = stream_get_by_id(stream_info.stream_id);
+		if (!stream) {
+			if (stream_info.is_metadata) {
+				continue;
+			}
+			ERR("Unknown stream id %" PRIu64 " in session data pending command",
+					stream_info.stream_id);
+			is_data_pending = -1;
+			goto reply;
+		}
+
+		if (stream_info.is_metadata) {
+			pthread_mutex_lock(&stream->lock);
+			stream->data_pending_check_done = true;
+			pthread_mutex_unlock(&stream->lock);
+		} else {
+			is_data_pending = stream_data_pending(conn->session,
+					stream, stream_info.last_net_seq_num);
+		}
+		stream_put(stream);
+		if (is_data_pending) {
+			goto reply;
+		}
+	}
+
+	is_data_pending = session_streams_data_inflight(conn->session,
+			msg.session_id);
+
+reply:
+	memset(&reply, 0, sizeof(reply));
+	reply.ret_code = htobe32(is_data_pending);
+	send_ret = conn->sock->ops->sendmsg(conn->sock, &reply, sizeof(reply), 0);
+	if (send_ret < (ssize_t) sizeof(reply)) {
+		ERR("Failed to send \"session data pending\" command reply (ret = %zd)",
+				send_ret);
+		ret = -1;
+	}
+
+end_no_session:
+	return ret;
+}
+
+/*
+ * Add an index, received in network byte order, to its stream.
+ *
+ * Return 0 on success else a negative value.
+ */
+static int relay_add_index(const struct relay_connection *conn,
+		const struct lttcomm_relayd_index *msg)
+{
+	int ret;
+	struct lttcomm_relayd_index index_info;
+	struct relay_stream *stream;
+
+	index_info.relay_stream_id = be64toh(msg->relay_stream_id);
+	index_info.net_seq_num = be64toh(msg->net_seq_num);
+	index_info.packet_size = be64toh(msg->packet_size);
+	index_info.content_size = be64toh(msg->content_size);
+	index_info.timestamp_begin = be64toh(msg->timestamp_begin);
+	index_info.timestamp_end = be64toh(msg->timestamp_end);
+	index_info.events_discarded = be64toh(msg->events_discarded);
+	index_info.stream_id = be64toh(msg->stream_id);
+
+	if (conn->minor >= 8) {
+		index_info.stream_instance_id =
+				be64toh(msg->stream_instance_id);
+		index_info.packet_seq_num = be64toh(msg->packet_seq_num);
+	} else {
+		index_info.stream_instance_id = -1ULL;
+		index_info.packet_seq_num = -1ULL;
+	}
+
+	stream = stream_get_by_id(index_info.relay_stream_id);
+	if (!stream) {
+		ERR("stream_get_by_id not found");
+		ret = -1;
+		goto end;
+	}
+
+	pthread_mutex_lock(&stream->lock);
+	ret = stream_add_index(stream, &index_info);
+	pthread_mutex_unlock(&stream->lock);
+	stream_put(stream);
+end:
+	return ret;
+}
+
 /*
  * Receive an index for a specific stream.
  *
@@ -2384,7 +2683,6 @@ static int relay_recv_index(const struct lttcomm_relayd_hdr *recv_hdr,
 	struct relay_session *session = conn->session;
 	struct lttcomm_relayd_index index_info;
 	struct lttcomm_relayd_generic_reply reply;
-	struct relay_stream *stream;
 	size_t msg_len;
 
 	assert(conn);
@@ -2406,42 +2704,84 @@ static int relay_recv_index(const struct lttcomm_relayd_hdr *recv_hdr,
 		ret = -1;
 		goto end_no_session;
 	}
+	memset(&index_info, 0, sizeof(index_info));
 	memcpy(&index_info, payload->data, msg_len);
-	index_info.relay_stream_id = be64toh(index_info.relay_stream_id);
-	index_info.net_seq_num = be64toh(index_info.net_seq_num);
-	index_info.packet_size = be64toh(index_info.packet_size);
-	index_info.content_size = be64toh(index_info.content_size);
-	index_info.timestamp_begin = be64toh(index_info.timestamp_begin);
-	index_info.timestamp_end = be64toh(index_info.timestamp_end);
-	index_info.events_discarded = be64toh(index_info.events_discarded);
-	index_info.stream_id = be64toh(index_info.stream_id);
 
-	if (conn->minor >= 8) {
-		index_info.stream_instance_id =
-				be64toh(index_info.stream_instance_id);
-		index_info.packet_seq_num = be64toh(index_info.packet_seq_num);
+	ret = relay_add_index(conn, &index_info);
+
+	memset(&reply, 0, sizeof(reply));
+	if (ret < 0) {
+		reply.ret_code = htobe32(LTTNG_ERR_UNK);
 	} else {
-		index_info.stream_instance_id = -1ULL;
-		index_info.packet_seq_num = -1ULL;
+		reply.ret_code = htobe32(LTTNG_OK);
+	}
+	send_ret = conn->sock->ops->sendmsg(conn->sock, &reply, sizeof(reply), 0);
+	if (send_ret < (ssize_t) sizeof(reply)) {
+		ERR("Failed to send \"recv index\" command reply (ret = %zd)", send_ret);
+		ret = -1;
 	}
 
-	stream = stream_get_by_id(index_info.relay_stream_id);
-	if (!stream) {
-		ERR("stream_get_by_id not found");
+end_no_session:
+	return ret;
+}
+
+/*
+ * Receive a batch of indexes, possibly belonging to different streams.
+ *
+ * A single reply is sent for the whole batch; it reports an error if any of
+ * the indexes could not be added.
+ *
+ * Return 0 on success else a negative value.
+ */
+static int relay_recv_indexes(const struct lttcomm_relayd_hdr *recv_hdr,
+		struct relay_connection *conn,
+		const struct lttng_buffer_view *payload)
+{
+	int ret = 0;
+	ssize_t send_ret;
+	uint32_t i, index_count;
+	struct lttcomm_relayd_send_indexes msg;
+	struct lttcomm_relayd_generic_reply reply;
+	const struct lttcomm_relayd_index *indexes;
+
+	assert(conn);
+
+	DBG("Relay receiving batch of indexes");
+
+	if (!conn->session || !conn->version_check_done) {
+		ERR("Trying to send indexes before version check");
 		ret = -1;
-		goto end;
+		goto end_no_session;
 	}
 
-	pthread_mutex_lock(&stream->lock);
-	ret = stream_add_index(stream, &index_info);
-	pthread_mutex_unlock(&stream->lock);
-	if (ret) {
-		goto end_stream_put;
+	if (payload->size < sizeof(msg)) {
+		ERR("Unexpected payload size in \"relay_recv_indexes\": expected >= %zu bytes, got %zu bytes",
+				sizeof(msg), payload->size);
+		ret = -1;
+		goto end_no_session;
+	}
+	memcpy(&msg, payload->data, sizeof(msg));
+	index_count = be32toh(msg.index_count);
+
+	if ((payload->size - sizeof(msg)) / sizeof(*indexes) < index_count) {
+		ERR("Unexpected payload size in \"relay_recv_indexes\": %zu bytes can't hold %" PRIu32 " indexes",
+				payload->size, index_count);
+		ret = -1;
+		goto end_no_session;
+	}
+	indexes = (const struct lttcomm_relayd_index *)
+			(payload->data + sizeof(msg));
+
+	for (i = 0; i < index_count; i++) {
+		struct lttcomm_relayd_index index_info;
+
+		/* The payload is not guaranteed to be suitably aligned. */
+		memcpy(&index_info, &indexes[i], sizeof(index_info));
+		if (relay_add_index(conn, &index_info)) {
+			ret = -1;
+		}
 	}
 
-end_stream_put:
-	stream_put(stream);
-end:
 	memset(&reply, 0, sizeof(reply));
 	if (ret < 0) {
 		reply.ret_code = htobe32(LTTNG_ERR_UNK);
@@ -2450,7 +2790,7 @@ end:
 	}
 	send_ret = conn->sock->ops->sendmsg(conn->sock, &reply, sizeof(reply), 0);
 	if (send_ret < (ssize_t) sizeof(reply)) {
-		ERR("Failed to send \"recv index\" command reply (ret = %zd)", send_ret);
+		ERR("Failed to send \"recv indexes\" command reply (ret = %zd)", send_ret);
 		ret = -1;
 	}
 
@@ -3261,10 +3601,18 @@ static int relay_process_control_command(struct relay_connection *conn,
 		DBG_CMD("RELAYD_END_DATA_PENDING", conn);
 		ret = relay_end_data_pending(header, conn, payload);
 		break;
+	case RELAYD_SESSION_DATA_PENDING:
+		DBG_CMD("RELAYD_SESSION_DATA_PENDING", conn);
+		ret = relay_session_data_pending(header, conn, payload);
+		break;
 	case RELAYD_SEND_INDEX:
 		DBG_CMD("RELAYD_SEND_INDEX", conn);
 		ret = relay_recv_index(header, conn, payload);
 		break;
+	case RELAYD_SEND_INDEXES:
+		DBG_CMD("RELAYD_SEND_INDEXES", conn);
+		ret = relay_recv_indexes(header, conn, payload);
+		break;
 	case RELAYD_STREAMS_SENT:
 		DBG_CMD("RELAYD_STREAMS_SENT", conn);
 		ret = relay_streams_sent(header, conn, payload);
@@ -3586,7 +3934,7 @@ end:
 }
 
 static enum relay_connection_status relay_process_data_receive_payload(
-		struct relay_connection *conn)
+		struct relay_connection *conn, int *splice_pipe)
 {
 	int ret;
 	enum relay_connection_status status = RELAY_CONNECTION_STATUS_OK;
@@ -3633,8 +3981,23 @@ static enum relay_connection_status relay_process_data_receive_payload(
 		size_t recv_size = min(left_to_receive, chunk_size);
 		struct lttng_buffer_view packet_chunk;
 
-		ret = conn->sock->ops->recvmsg(conn->sock, data_buffer,
-				recv_size, MSG_DONTWAIT);
+		if (splice_pipe) {
+			/*
+			 * The payload is not inspected by the relay daemon;
+			 * move it to the stream's file without copying it.
+			 */
+			ret = stream_splice_from_socket(stream,
+					conn->sock->fd, splice_pipe,
+					recv_size);
+			if (ret < 0 && errno == ENOTSUP) {
+				/* Use the copy path for this stream. */
+				splice_pipe = NULL;
+				continue;
+			}
+		} else {
+			ret = conn->sock->ops->recvmsg(conn->sock, data_buffer,
+					recv_size, MSG_DONTWAIT);
+		}
 		if (ret < 0) {
 			if (errno != EAGAIN && errno != EWOULDBLOCK) {
 				PERROR("Socket %d error", conn->sock->fd);
@@ -3656,15 +4019,17 @@ static enum relay_connection_status relay_process_data_receive_payload(
 			recv_size = ret;
 		}
 
-		packet_chunk = lttng_buffer_view_init(data_buffer,
-				0, recv_size);
-		assert(packet_chunk.data);
+		if (!splice_pipe) {
+			packet_chunk = lttng_buffer_view_init(data_buffer,
+					0, recv_size);
+			assert(packet_chunk.data);
 
-		ret = stream_write(stream, &packet_chunk, 0);
-		if (ret) {
-			ERR("Relay error writing data to file");
-			status = RELAY_CONNECTION_STATUS_ERROR;
-			goto end_stream_unlock;
+			ret = stream_write(stream, &packet_chunk, 0);
+			if (ret) {
+				ERR("Relay error writing data to file");
+				status = RELAY_CONNECTION_STATUS_ERROR;
+				goto end_stream_unlock;
+			}
 		}
 
 		left_to_receive -= recv_size;
@@ -3744,7 +4109,7 @@ end:
  * relay_process_data: Process the data received on the data socket
  */
 static enum relay_connection_status relay_process_data(
-		struct relay_connection *conn)
+		struct relay_connection *conn, int *splice_pipe)
 {
 	enum relay_connection_status status;
 
@@ -3753,7 +4118,8 @@ static enum relay_connection_status relay_process_data(
 		status = relay_process_data_receive_header(conn);
 		break;
 	case DATA_CONNECTION_STATE_RECEIVE_PAYLOAD:
-		status = relay_process_data_receive_payload(conn);
+		status = relay_process_data_receive_payload(conn,
+				splice_pipe);
 		break;
 	default:
 		ERR("Unexpected data connection communication state.");
@@ -3813,8 +4179,9 @@ static void *relay_thread_worker(void *data)
 	struct lttng_ht *relay_connections_ht;
 	struct lttng_ht_iter iter;
 	struct relay_connection *destroy_conn = NULL;
+	struct relay_worker *worker = data;
 
-	DBG("[thread] Relay worker started");
+	DBG("[thread] Relay worker %u started", worker->id);
 
 	rcu_register_thread();
 
@@ -3837,7 +4204,8 @@ static void *relay_thread_worker(void *data)
 		goto error_poll_create;
 	}
 
-	ret = lttng_poll_add(&events, relay_conn_pipe[0], LPOLLIN | LPOLLRDHUP);
+	ret = lttng_poll_add(&events, worker->conn_pipe[0],
+			LPOLLIN | LPOLLRDHUP);
 	if (ret < 0) {
 		goto error;
 	}
@@ -3885,11 +4253,12 @@ restart:
 			}
 
 			/* Inspect the relay conn pipe for new connection */
-			if (pollfd == relay_conn_pipe[0]) {
+			if (pollfd == worker->conn_pipe[0]) {
 				if (revents & LPOLLIN) {
 					struct relay_connection *conn;
 
-					ret = lttng_read(relay_conn_pipe[0], &conn, sizeof(conn));
+					ret = lttng_read(worker->conn_pipe[0],
+							&conn, sizeof(conn));
 					if (ret < 0) {
 						goto error;
 					}
@@ -3901,7 +4270,8 @@ restart:
 						goto error;
 					}
 					connection_ht_add(relay_connections_ht, conn);
-					DBG("Connection socket %d added", conn->sock->fd);
+					DBG("Connection socket %d added to worker %u",
+							conn->sock->fd, worker->id);
 				} else if (revents & (LPOLLERR | LPOLLHUP | LPOLLRDHUP)) {
 					ERR("Relay connection pipe error");
 					goto error;
@@ -4013,7 +4383,7 @@ restart:
 			}
 
 			/* Skip the command pipe. It's handled in the first loop. */
-			if (pollfd == relay_conn_pipe[0]) {
+			if (pollfd == worker->conn_pipe[0]) {
 				continue;
 			}
 
@@ -4030,7 +4400,8 @@ restart:
 			if (revents & LPOLLIN) {
 				enum relay_connection_status status;
 
-				status = relay_process_data(data_conn);
+				status = relay_process_data(data_conn,
+						worker->splice_pipe);
 				/* Connection closed or error. */
 				if (status != RELAY_CONNECTION_STATUS_OK) {
 					/*
@@ -4105,13 +4476,15 @@ error:
 error_poll_create:
 	lttng_ht_destroy(relay_connections_ht);
 relay_connections_ht_error:
-	/* Close relay conn pipes */
+	/* Close relay conn and splice pipes */
+	(void) fd_tracker_util_pipe_close(the_fd_tracker,
+			worker->conn_pipe);
 	(void) fd_tracker_util_pipe_close(the_fd_tracker,
-			relay_conn_pipe);
+			worker->splice_pipe);
 	if (err) {
 		DBG("Thread exited with error");
 	}
-	DBG("Worker thread cleanup complete");
+	DBG("Worker thread %u cleanup complete", worker->id);
 error_testpoint:
 	if (err) {
 		health_error();
@@ -4124,13 +4497,113 @@ error_testpoint:
 }
 
 /*
- * Create the relay command pipe to wake thread_manage_apps.
- * Closed in cleanup().
+ * Create the relay command pipe of a worker thread. Closed by the worker
+ * thread on exit.
  */
-static int create_relay_conn_pipe(void)
+static int create_relay_conn_pipe(struct relay_worker *worker)
 {
-	return fd_tracker_util_pipe_open_cloexec(the_fd_tracker,
-			"Relayd connection pipe", relay_conn_pipe);
+	int ret;
+	char *name = NULL;
+
+	ret = asprintf(&name, "Relayd connection pipe (worker %u)",
+			worker->id);
+	if (ret < 0) {
+		PERROR("Failed to format relay connection pipe name");
+		goto end;
+	}
+
+	ret = fd_tracker_util_pipe_open_cloexec(the_fd_tracker, name,
+			worker->conn_pipe);
+	free(name);
+end:
+	return ret;
+}
+
+/*
+ * Create the splice pipe of a worker thread. Closed by the worker thread on
+ * exit.
+ */
+static int create_relay_splice_pipe(struct relay_worker *worker)
+{
+	int ret;
+	char *name = NULL;
+
+	ret = asprintf(&name, "Relayd splice pipe (worker %u)", worker->id);
+	if (ret < 0) {
+		PERROR("Failed to format relay splice pipe name");
+		goto end;
+	}
+
+	ret = fd_tracker_util_pipe_open_cloexec(the_fd_tracker, name,
+			worker->splice_pipe);
+	free(name);
+end:
+	return ret;
+}
+
+/*
+ * Allocate the worker thread descriptors and their connection pipes.
+ */
+static int create_relay_workers(void)
+{
+	int ret = 0;
+	unsigned int i;
+
+	relay_workers = zmalloc(sizeof(*relay_workers) *
+			opt_worker_thread_count);
+	if (!relay_workers) {
+		PERROR("Failed to allocate relay worker threads");
+		ret = -1;
+		goto end;
+	}
+
+	for (i = 0; i < opt_worker_thread_count; i++) {
+		relay_workers[i].id = i;
+		relay_workers[i].conn_pipe[0] = -1;
+		relay_workers[i].conn_pipe[1] = -1;
+		relay_workers[i].splice_pipe[0] = -1;
+		relay_workers[i].splice_pipe[1] = -1;
+	}
+
+	for (i = 0; i < opt_worker_thread_count; i++) {
+		ret = create_relay_conn_pipe(&relay_workers[i]);
+		if (ret) {
+			goto end;
+		}
+
+		ret = create_relay_splice_pipe(&relay_workers[i]);
+		if (ret) {
+			goto end;
+		}
+	}
+end:
+	return ret;
+}
+
+/*
+ * Close the pipes of the workers that were never launched.
+ */
+static void destroy_relay_workers(unsigned int launched_worker_count)
+{
+	unsigned int i;
+
+	if (!relay_workers) {
+		return;
+	}
+
+	for (i = launched_worker_count; i < opt_worker_thread_count; i++) {
+		if (relay_workers[i].conn_pipe[0] != -1) {
+			(void) fd_tracker_util_pipe_close(the_fd_tracker,
+					relay_workers[i].conn_pipe);
+		}
+		if (relay_workers[i].splice_pipe[0] != -1) {
+			(void) fd_tracker_util_pipe_close(the_fd_tracker,
+					relay_workers[i].splice_pipe);
+		}
+	}
+
+	free(relay_workers);
+	relay_workers = NULL;
 }
 
 static int stdio_open(void *data, int *fds)
@@ -4156,6 +4629,7 @@ int main(int argc, char **argv)
 {
 	bool thread_is_rcu_registered = false;
 	int ret = 0, retval = 0;
+	unsigned int i, launched_worker_count = 0;
 	void *status;
 	char *unlinked_file_directory_path = NULL, *output_path = NULL;
 
@@ -4290,8 +4764,8 @@ int main(int argc, char **argv)
 		goto exit_options;
 	}
 
-	/* Setup the thread apps communication pipe. */
-	if (create_relay_conn_pipe()) {
+	/* Setup the worker threads' communication pipes. */
+	if (create_relay_workers()) {
 		retval = -1;
 		goto exit_options;
 	}
@@ -4350,14 +4824,19 @@ int main(int argc, char **argv)
 		goto exit_dispatcher_thread;
 	}
 
-	/* Setup the worker thread */
-	ret = pthread_create(&worker_thread, default_pthread_attr(),
-			relay_thread_worker, NULL);
-	if (ret) {
-		errno = ret;
-		PERROR("pthread_create worker");
-		retval = -1;
-		goto exit_worker_thread;
+	/* Setup the worker threads */
+	DBG("Launching %u relay worker thread(s)", opt_worker_thread_count);
+	for (i = 0; i < opt_worker_thread_count; i++) {
+		ret = pthread_create(&relay_workers[i].thread,
+				default_pthread_attr(), relay_thread_worker,
+				&relay_workers[i]);
+		if (ret) {
+			errno = ret;
+			PERROR("pthread_create worker");
+			retval = -1;
+			goto exit_worker_thread;
+		}
+		launched_worker_count++;
 	}
 
 	/* Setup the listener thread */
@@ -4370,7 +4849,7 @@ int main(int argc, char **argv)
 		goto exit_listener_thread;
 	}
 
-	ret = relayd_live_create(live_uri);
+	ret = relayd_live_create(live_uri, opt_live_worker_thread_count);
 	if (ret) {
 		ERR("Starting live viewer threads");
 		retval = -1;
@@ -4396,14 +4875,20 @@ exit_live:
 	}
 
 exit_listener_thread:
-	ret = pthread_join(worker_thread, &status);
-	if (ret) {
-		errno = ret;
-		PERROR("pthread_join worker_thread");
-		retval = -1;
+exit_worker_thread:
+	if (retval && launched_worker_count) {
+		/* Unblock the worker threads that were already launched. */
+		(void) lttng_relay_stop_threads();
+	}
+	for (i = 0; i < launched_worker_count; i++) {
+		ret = pthread_join(relay_workers[i].thread, &status);
+		if (ret) {
+			errno = ret;
+			PERROR("pthread_join worker_thread");
+			retval = -1;
+		}
 	}
 
-exit_worker_thread:
 	ret = pthread_join(dispatcher_thread, &status);
 	if (ret) {
 		errno = ret;
@@ -4425,6 +4910,7 @@ exit_options:
 	 * perform lookups in those structures.
 	 */
 	rcu_barrier();
+	destroy_relay_workers(launched_worker_count);
 	relayd_cleanup();
 
 	/* Ensure all prior call_rcu are done. */
@@ -10,6 +10,7 @@
 
 #define _LGPL_SOURCE
 #include <common/common.h>
+#include <common/compat/fcntl.h>
 #include <common/defaults.h>
 #include <common/fs-handle.h>
 #include <common/sessiond-comm/relayd.h>
@@ -1052,6 +1053,47 @@ end:
 	return ret;
 }
 
+static void stream_account_received(struct relay_stream *stream,
+		size_t recv_len)
+{
+	if (!stream->is_metadata) {
+		return;
+	}
+
+	stream->metadata_received += recv_len;
+	if (recv_len) {
+		stream->no_new_metadata_notified = false;
+	}
+}
+
+/*
+ * Extend the stream's file by `padding_len` bytes without writing them.
+ *
+ * Return 0 on success, -1 if the file can't be extended sparsely.
+ */
+static int stream_append_padding_hole(struct relay_stream *stream,
+		size_t padding_len)
+{
+	int fd, ret;
+
+	fd = fs_handle_get_fd(stream->file);
+	if (fd < 0) {
+		ret = -1;
+		goto end;
+	}
+
+	ret = utils_append_hole(fd, padding_len);
+	fs_handle_put_fd(stream->file);
+	if (ret) {
+		PERROR("Failed to extend the file of %sstream %" PRIu64 " sparsely, writing padding instead",
+				stream->is_metadata ? "metadata " : "",
+				stream->stream_handle);
+		stream->sparse_padding_unsupported = true;
+	}
+end:
+	return ret;
+}
+
 /* Note that the packet is not necessarily complete. */
 int stream_write(struct relay_stream *stream,
 		const struct lttng_buffer_view *packet, size_t padding_len)
@@ -1062,8 +1104,6 @@ int stream_write(struct relay_stream *stream,
 	char padding_buffer[FILE_IO_STACK_BUFFER_SIZE];
 
 	ASSERT_LOCKED(stream->lock);
-	memset(padding_buffer, 0,
-			min(sizeof(padding_buffer), padding_to_write));
 
 	if (!stream->file || !stream->trace_chunk) {
 		ERR("Protocol error: received a packet for a stream that doesn't have a current trace chunk: stream_id = %" PRIu64 ", channel_name = %s",
@@ -1083,6 +1123,14 @@ int stream_write(struct relay_stream *stream,
 		}
 	}
 
+	if (padding_to_write > 0 && opt_sparse_padding &&
+			!stream->sparse_padding_unsupported &&
+			!stream_append_padding_hole(stream, padding_to_write)) {
+		padding_to_write = 0;
+	}
+
+	memset(padding_buffer, 0,
+			min(sizeof(padding_buffer), padding_to_write));
 	while (padding_to_write > 0) {
 		const size_t padding_to_write_this_pass =
 				min(padding_to_write, sizeof(padding_buffer));
@@ -1099,16 +1147,8 @@ int stream_write(struct relay_stream *stream,
 		padding_to_write -= padding_to_write_this_pass;
 	}
 
-	if (stream->is_metadata) {
-		size_t recv_len;
-
-		recv_len = packet ? packet->size : 0;
-		recv_len += padding_len;
-		stream->metadata_received += recv_len;
-		if (recv_len) {
-			stream->no_new_metadata_notified = false;
-		}
-	}
+	stream_account_received(stream,
+			(packet ? packet->size : 0) + padding_len);
 
 	DBG("Wrote to %sstream %" PRIu64 ": data_length = %zu, padding_length = %zu",
 			stream->is_metadata ? "metadata " : "",
@@ -1118,6 +1158,176 @@ end:
 	return ret;
 }
 
+/*
+ * Copy the content of the splice pipe to the stream's file when the file
+ * can't be the output of a splice(2) operation.
+ */
+static int stream_write_from_splice_pipe(struct relay_stream *stream,
+		int splice_pipe_read_fd, size_t len)
+{
+	int ret = 0;
+	char copy_buffer[FILE_IO_STACK_BUFFER_SIZE];
+
+	while (len > 0) {
+		ssize_t read_ret, write_ret;
+		const size_t to_copy = min(len, sizeof(copy_buffer));
+
+		read_ret = lttng_read(splice_pipe_read_fd, copy_buffer,
+				to_copy);
+		if (read_ret != to_copy) {
+			PERROR("Failed to read from relay splice pipe");
+			ret = -1;
+			goto end;
+		}
+
+		write_ret = fs_handle_write(stream->file, copy_buffer,
+				to_copy);
+		if (write_ret != to_copy) {
+			PERROR("Failed to write to stream file of %sstream %" PRIu64,
+					stream->is_metadata ? "metadata " : "",
+					stream->stream_handle);
+			ret = -1;
+			goto end;
+		}
+
+		len -= to_copy;
+	}
+end:
+	return ret;
+}
+
+/*
+ * Discard the content of the splice pipe after an error to leave it empty
+ * for the next user.
+ */
+static void splice_pipe_discard(int splice_pipe_read_fd, size_t len)
+{
+	char discard_buffer[FILE_IO_STACK_BUFFER_SIZE];
+
+	while (len > 0) {
+		const ssize_t read_ret = lttng_read(splice_pipe_read_fd,
+				discard_buffer,
+				min(len, sizeof(discard_buffer)));
+
+		if (read_ret <= 0) {
+			PERROR("Failed to empty relay splice pipe");
+			break;
+		}
+
+		len -= read_ret;
+	}
+}
+
+/*
+ * Note that the packet is not necessarily complete.
+ *
+ * Move up to `len` bytes from `sock_fd` to the stream's file without copying
+ * them to user space. The data is spliced from the socket to `splice_pipe`
+ * and from the pipe to the file; the pipe is empty on return.
+ *
+ * Return the number of bytes received (less than `len` if less data was
+ * available on the socket), 0 on orderly shutdown of the socket, or -1 on
+ * error. errno is set to EAGAIN if no data is available on the socket, and
+ * to ENOTSUP if splice(2) can't be used to receive the stream's data, in
+ * which case no data was consumed from the socket.
+ */
+ssize_t stream_splice_from_socket(struct relay_stream *stream, int sock_fd,
+		int *splice_pipe, size_t len)
+{
+	ssize_t ret, spliced;
+	size_t left_to_write;
+	int out_fd;
+
+	ASSERT_LOCKED(stream->lock);
+
+	if (!stream->file || !stream->trace_chunk) {
+		ERR("Protocol error: received a packet for a stream that doesn't have a current trace chunk: stream_id = %" PRIu64 ", channel_name = %s",
+				stream->stream_handle, stream->channel_name);
+		errno = EINVAL;
+		ret = -1;
+		goto end;
+	}
+
+	if (stream->splice_unsupported) {
+		errno = ENOTSUP;
+		ret = -1;
+		goto end;
+	}
+
+	spliced = splice(sock_fd, NULL, splice_pipe[1], NULL, len,
+			SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+	if (spliced < 0) {
+		if (errno == EINVAL || errno == ENOSYS) {
+			DBG("Socket %d can't be spliced, falling back to copies for stream %" PRIu64,
+					sock_fd, stream->stream_handle);
+			stream->splice_unsupported = true;
+			errno = ENOTSUP;
+		}
+		ret = -1;
+		goto end;
+	} else if (spliced == 0) {
+		ret = 0;
+		goto end;
+	}
+
+	out_fd = fs_handle_get_fd(stream->file);
+	if (out_fd < 0) {
+		ERR("Failed to get file descriptor of stream %" PRIu64,
+				stream->stream_handle);
+		splice_pipe_discard(splice_pipe[0], spliced);
+		ret = -1;
+		goto end;
+	}
+
+	left_to_write = spliced;
+	while (left_to_write > 0) {
+		ret = splice(splice_pipe[0], NULL, out_fd, NULL, left_to_write,
+				SPLICE_F_MOVE | SPLICE_F_MORE);
+		if (ret < 0 && errno == EINTR) {
+			continue;
+		} else if (ret < 0 && errno == EINVAL &&
+				left_to_write == spliced) {
+			/*
+			 * The output file does not support splice(2); copy
+			 * the data already in the pipe and don't attempt to
+			 * splice the stream's data again.
+			 */
+			DBG("Stream file of stream %" PRIu64 " can't be spliced, falling back to copies",
+					stream->stream_handle);
+			stream->splice_unsupported = true;
+			fs_handle_put_fd(stream->file);
+			ret = stream_write_from_splice_pipe(stream,
+					splice_pipe[0], spliced);
+			if (ret) {
+				splice_pipe_discard(splice_pipe[0],
+						spliced);
+				goto end;
+			}
+			goto account;
+		} else if (ret <= 0) {
+			PERROR("Failed to splice data to file of %sstream %" PRIu64,
+					stream->is_metadata ? "metadata " : "",
+					stream->stream_handle);
+			fs_handle_put_fd(stream->file);
+			splice_pipe_discard(splice_pipe[0], left_to_write);
+			ret = -1;
+			goto end;
+		}
+
+		left_to_write -= ret;
+	}
+	fs_handle_put_fd(stream->file);
+
+account:
+	stream_account_received(stream, spliced);
+	DBG("Spliced to %sstream %" PRIu64 ": data_length = %zd",
+			stream->is_metadata ? "metadata " : "",
+			stream->stream_handle, spliced);
+	ret = spliced;
+end:
+	return ret;
+}
+
 /*
  * Update index after receiving a packet for a data stream.
  *
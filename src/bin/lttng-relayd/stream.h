@@ -141,6 +141,17 @@ struct relay_stream {
 	/* Indicate if the stream was initialized for a data pending command. */
 	bool data_pending_check_done;
 
+	/*
+	 * The stream's data can't be spliced from the data connection to its
+	 * file; the data is copied through a user space buffer instead.
+	 */
+	bool splice_unsupported;
+	/*
+	 * The stream's file can't be extended sparsely; packet padding is
+	 * written as zeros.
+	 */
+	bool sparse_padding_unsupported;
+
 	/* Is this stream a metadata stream ? */
 	bool is_metadata;
 	/* Amount of metadata received (bytes). */
@@ -199,6 +210,8 @@ int stream_init_packet(struct relay_stream *stream, size_t packet_size,
 		bool *file_rotated);
 int stream_write(struct relay_stream *stream,
 		const struct lttng_buffer_view *packet, size_t padding_len);
+ssize_t stream_splice_from_socket(struct relay_stream *stream, int sock_fd,
+		int *splice_pipe, size_t len);
 /* Called after the reception of a complete data packet. */
 int stream_update_index(struct relay_stream *stream, uint64_t net_seq_num,
 		bool rotate_index, bool *flushed, uint64_t total_size);
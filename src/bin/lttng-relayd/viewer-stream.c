@@ -173,11 +173,10 @@ struct relay_viewer_stream *viewer_stream_create(struct relay_stream *stream,
 	}
 
 	if (seek_t == LTTNG_VIEWER_SEEK_LAST && vstream->index_file) {
-		off_t lseek_ret;
+		int ret;
 
-		lseek_ret = fs_handle_seek(
-				vstream->index_file->file, 0, SEEK_END);
-		if (lseek_ret < 0) {
+		ret = lttng_index_file_seek_end(vstream->index_file);
+		if (ret < 0) {
 			goto error;
 		}
 	}
@@ -20,6 +20,8 @@
 #include "lttng/lttng-error.h"
 #include "lttng/tracker.h"
 #include <common/compat/getenv.h>
+#include <common/compat/time.h>
+#include <common/time.h>
 #include <common/tracker.h>
 #include <common/unix.h>
 #include <common/utils.h>
@@ -43,9 +45,59 @@
 #include "utils.h"
 #include "manage-consumer.h"
 #include "clear.h"
+#include "data-pending-thread.h"
 
 static bool is_root;
 
+/* Client command received by the client thread, waiting to be processed. */
+struct client_command {
+	int sock;
+	/* Return `sock` to the client thread once the command is processed. */
+	bool keep_connection;
+	struct lttcomm_session_msg lsm;
+	lttng_sock_cred creds;
+	struct cds_list_head node;
+};
+
+/*
+ * Queue of client commands processed, in order of reception, by a set of
+ * worker threads.
+ */
+struct client_command_queue {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	/* struct client_command, protected by lock. */
+	struct cds_list_head commands;
+	/* Protected by lock. */
+	bool quit;
+	/*
+	 * The command completion handlers are run by the thread processing the
+	 * state-changing commands.
+	 */
+	bool run_completion_handlers;
+	/* Write end of the client thread's kept connection pipe. */
+	int kept_connection_fd;
+	unsigned int thread_count;
+	pthread_t *threads;
+};
+
+/* Persistent client connection waiting, in the poll set, for a command. */
+struct idle_client_connection {
+	int sock;
+	/* Monotonic time at which the connection became idle. */
+	uint64_t idle_since_ms;
+	struct cds_list_head node;
+};
+
+/*
+ * Idle persistent client connections of the client thread, from the least to
+ * the most recently used.
+ */
+struct idle_client_connections {
+	struct cds_list_head list;
+	unsigned int count;
+};
+
 static struct thread_state {
 	sem_t ready;
 	bool running;
@@ -752,6 +804,223 @@ end:
 	return ret;
 }
 
+/*
+ * Receive the exclusions, filter expression and filter bytecode of an event
+ * to enable from the client.
+ *
+ * Return LTTNG_OK on success, the items being owned by the caller, else an
+ * lttng_error_code.
+ */
+static int receive_event_filter_and_exclusions(int sock, int *sock_error,
+		uint32_t exclusion_count, uint32_t expression_len,
+		uint32_t bytecode_len, struct lttng_event_exclusion **_exclusion,
+		char **_filter_expression,
+		struct lttng_filter_bytecode **_bytecode)
+{
+	int ret;
+	struct lttng_event_exclusion *exclusion = NULL;
+	struct lttng_filter_bytecode *bytecode = NULL;
+	char *filter_expression = NULL;
+
+	/* Handle exclusion events and receive it from the client. */
+	if (exclusion_count > 0) {
+		size_t count = exclusion_count;
+
+		exclusion = zmalloc(sizeof(struct lttng_event_exclusion) +
+				(count * LTTNG_SYMBOL_NAME_LEN));
+		if (!exclusion) {
+			ret = LTTNG_ERR_EXCLUSION_NOMEM;
+			goto error;
+		}
+
+		DBG("Receiving var len exclusion event list from client ...");
+		exclusion->count = count;
+		ret = lttcomm_recv_unix_sock(sock, exclusion->names,
+				count * LTTNG_SYMBOL_NAME_LEN);
+		if (ret <= 0) {
+			DBG("Nothing recv() from client var len data... continuing");
+			*sock_error = 1;
+			ret = LTTNG_ERR_EXCLUSION_INVAL;
+			goto error;
+		}
+	}
+
+	/* Get filter expression from client. */
+	if (expression_len > 0) {
+		if (expression_len > LTTNG_FILTER_MAX_LEN) {
+			ret = LTTNG_ERR_FILTER_INVAL;
+			goto error;
+		}
+
+		filter_expression = zmalloc(expression_len);
+		if (!filter_expression) {
+			ret = LTTNG_ERR_FILTER_NOMEM;
+			goto error;
+		}
+
+		/* Receive var. len. data */
+		DBG("Receiving var len filter's expression from client ...");
+		ret = lttcomm_recv_unix_sock(sock, filter_expression,
+			expression_len);
+		if (ret <= 0) {
+			DBG("Nothing recv() from client var len data... continuing");
+			*sock_error = 1;
+			ret = LTTNG_ERR_FILTER_INVAL;
+			goto error;
+		}
+	}
+
+	/* Handle filter and get bytecode from client. */
+	if (bytecode_len > 0) {
+		if (bytecode_len > LTTNG_FILTER_MAX_LEN) {
+			ret = LTTNG_ERR_FILTER_INVAL;
+			goto error;
+		}
+
+		bytecode = zmalloc(bytecode_len);
+		if (!bytecode) {
+			ret = LTTNG_ERR_FILTER_NOMEM;
+			goto error;
+		}
+
+		/* Receive var. len. data */
+		DBG("Receiving var len filter's bytecode from client ...");
+		ret = lttcomm_recv_unix_sock(sock, bytecode, bytecode_len);
+		if (ret <= 0) {
+			DBG("Nothing recv() from client var len data... continuing");
+			*sock_error = 1;
+			ret = LTTNG_ERR_FILTER_INVAL;
+			goto error;
+		}
+
+		if ((bytecode->len + sizeof(*bytecode)) != bytecode_len) {
+			ret = LTTNG_ERR_FILTER_INVAL;
+			goto error;
+		}
+	}
+
+	*_exclusion = exclusion;
+	*_filter_expression = filter_expression;
+	*_bytecode = bytecode;
+	return LTTNG_OK;
+
+error:
+	free(exclusion);
+	free(filter_expression);
+	free(bytecode);
+	return ret;
+}
+
+/*
+ * Receive the events of a LTTNG_ENABLE_EVENTS command and enable them. The
+ * reply's payload holds the lttng_error_code of each event as an int32_t.
+ *
+ * Return an lttng_error_code.
+ */
+static int receive_and_enable_events(struct command_ctx *cmd_ctx, int sock,
+		int *sock_error)
+{
+	int ret;
+	uint32_t i;
+	const uint32_t event_count = cmd_ctx->lsm.u.enable_events.event_count;
+	struct cmd_enable_events_entry *entries = NULL;
+	int32_t *ret_codes = NULL;
+
+	if (event_count == 0) {
+		ret = LTTNG_ERR_INVALID;
+		goto end;
+	}
+
+	entries = zmalloc(event_count * sizeof(*entries));
+	ret_codes = zmalloc(event_count * sizeof(*ret_codes));
+	if (!entries || !ret_codes) {
+		ret = LTTNG_ERR_NOMEM;
+		goto end;
+	}
+
+	DBG("Receiving %" PRIu32 " events to enable from client ...",
+			event_count);
+	for (i = 0; i < event_count; i++) {
+		struct lttcomm_enable_events_event event_msg;
+
+		ret = lttcomm_recv_unix_sock(sock, &event_msg, sizeof(event_msg));
+		if (ret <= 0) {
+			DBG("Nothing recv() from client var len data... continuing");
+			*sock_error = 1;
+			ret = LTTNG_ERR_INVALID;
+			goto end;
+		}
+
+		ret = receive_event_filter_and_exclusions(sock, sock_error,
+				event_msg.exclusion_count,
+				event_msg.expression_len,
+				event_msg.bytecode_len,
+				&entries[i].exclusion,
+				&entries[i].filter_expression,
+				&entries[i].filter);
+		if (ret != LTTNG_OK) {
+			goto end;
+		}
+
+		entries[i].event = lttng_event_copy(
+				ALIGNED_CONST_PTR(event_msg.event));
+		if (!entries[i].event) {
+			ret = LTTNG_ERR_NOMEM;
+			goto end;
+		}
+	}
+
+	ret = cmd_enable_events(cmd_ctx->session,
+			ALIGNED_CONST_PTR(cmd_ctx->lsm.domain),
+			cmd_ctx->lsm.u.enable_events.channel_name,
+			entries, event_count, ret_codes, kernel_poll_pipe[1]);
+	if (ret != LTTNG_OK) {
+		goto end;
+	}
+
+	ret = setup_lttng_msg_no_cmd_header(cmd_ctx, ret_codes,
+			event_count * sizeof(*ret_codes));
+	if (ret < 0) {
+		ret = LTTNG_ERR_NOMEM;
+		goto end;
+	}
+
+	ret = LTTNG_OK;
+end:
+	if (entries) {
+		for (i = 0; i < event_count; i++) {
+			lttng_event_destroy(entries[i].event);
+			free(entries[i].filter_expression);
+			free(entries[i].filter);
+			free(entries[i].exclusion);
+		}
+	}
+	free(entries);
+	free(ret_codes);
+	return ret;
+}
+
+/*
+ * Queries don't alter the state of the session daemon nor of the sessions.
+ * They are processed holding their session's lock, but not the session list
+ * lock, and may be processed concurrently with the other commands.
+ */
+static bool is_query_command(enum lttcomm_sessiond_command cmd_type)
+{
+	switch (cmd_type) {
+	case LTTNG_LIST_SESSIONS:
+	case LTTNG_LIST_DOMAINS:
+	case LTTNG_LIST_CHANNELS:
+	case LTTNG_LIST_EVENTS:
+	case LTTNG_SNAPSHOT_LIST_OUTPUT:
+	case LTTNG_ROTATION_GET_INFO:
+	case LTTNG_SESSION_LIST_ROTATION_SCHEDULES:
+		return true;
+	default:
+		return false;
+	}
+}
+
 /*
  * Process the command requested by the lttng client within the command
  * context structure. This function make sure that the return structure (llm)
@@ -771,6 +1040,7 @@ static int process_client_msg(struct command_ctx *cmd_ctx, int *sock,
 	int ret = LTTNG_OK;
 	int need_tracing_session = 1;
 	int need_domain;
+	const bool query = is_query_command(cmd_ctx->lsm.cmd_type);
 
 	DBG("Processing client command %d", cmd_ctx->lsm.cmd_type);
 
@@ -786,6 +1056,7 @@ static int process_client_msg(struct command_ctx *cmd_ctx, int *sock,
 	case LTTNG_START_TRACE:
 	case LTTNG_STOP_TRACE:
 	case LTTNG_DATA_PENDING:
+	case LTTNG_WAIT_DATA_PENDING:
 	case LTTNG_SNAPSHOT_ADD_OUTPUT:
 	case LTTNG_SNAPSHOT_DEL_OUTPUT:
 	case LTTNG_SNAPSHOT_LIST_OUTPUT:
@@ -801,6 +1072,7 @@ static int process_client_msg(struct command_ctx *cmd_ctx, int *sock,
 	case LTTNG_ROTATION_SET_SCHEDULE:
 	case LTTNG_SESSION_LIST_ROTATION_SCHEDULES:
 	case LTTNG_CLEAR_SESSION:
+	case LTTNG_PERSISTENT_CONNECTION:
 		need_domain = 0;
 		break;
 	default:
@@ -847,6 +1119,7 @@ static int process_client_msg(struct command_ctx *cmd_ctx, int *sock,
 	case LTTNG_DATA_PENDING:
 	case LTTNG_ROTATE_SESSION:
 	case LTTNG_ROTATION_GET_INFO:
+	case LTTNG_ENABLE_EVENTS:
 		break;
 	default:
 		/* Setup lttng message with no payload */
@@ -867,12 +1140,30 @@ static int process_client_msg(struct command_ctx *cmd_ctx, int *sock,
 	case LTTNG_SAVE_SESSION:
 	case LTTNG_REGISTER_TRIGGER:
 	case LTTNG_UNREGISTER_TRIGGER:
+	case LTTNG_PERSISTENT_CONNECTION:
 		need_tracing_session = 0;
 		break;
 	default:
 		DBG("Getting session %s by name", cmd_ctx->lsm.session.name);
+		if (query) {
+			cmd_ctx->session = session_find_by_name_no_list_lock(
+					cmd_ctx->lsm.session.name);
+			if (cmd_ctx->session == NULL) {
+				ret = LTTNG_ERR_SESS_NOT_FOUND;
+				goto error;
+			}
+
+			session_lock(cmd_ctx->session);
+			/* The session may have been destroyed since its lookup. */
+			if (cmd_ctx->session->destroyed) {
+				ret = LTTNG_ERR_SESS_NOT_FOUND;
+				goto error;
+			}
+			break;
+		}
+
 		/*
-		 * We keep the session list lock across _all_ commands
+		 * We keep the session list lock across _all_ other commands
 		 * for now, because the per-session lock does not
 		 * handle teardown properly.
 		 */
@@ -925,6 +1216,18 @@ static int process_client_msg(struct command_ctx *cmd_ctx, int *sock,
 		goto skip_domain;
 	}
 
+	/*
+	 * Queries don't create the domain's session nor launch its consumer
+	 * daemon.
+	 */
+	if (query) {
+		if (cmd_ctx->lsm.domain.type == LTTNG_DOMAIN_KERNEL && !is_root) {
+			ret = LTTNG_ERR_NEED_ROOT_SESSIOND;
+			goto error;
+		}
+		goto skip_domain;
+	}
+
 	/*
 	 * Check domain type for specific "pre-action".
 	 */
@@ -1122,7 +1425,7 @@ skip_domain:
 	 * Send relayd information to consumer as soon as we have a domain and a
 	 * session defined.
 	 */
-	if (cmd_ctx->session && need_domain) {
+	if (cmd_ctx->session && need_domain && !query) {
 		/*
 		 * Setup relayd if not done yet. If the relayd information was already
 		 * sent to the consumer, this call will gracefully return.
@@ -1462,101 +1765,13 @@ error_add_context:
 		struct lttng_filter_bytecode *bytecode = NULL;
 		char *filter_expression = NULL;
 
-		/* Handle exclusion events and receive it from the client. */
-		if (cmd_ctx->lsm.u.enable.exclusion_count > 0) {
-			size_t count = cmd_ctx->lsm.u.enable.exclusion_count;
-
-			exclusion = zmalloc(sizeof(struct lttng_event_exclusion) +
-					(count * LTTNG_SYMBOL_NAME_LEN));
-			if (!exclusion) {
-				ret = LTTNG_ERR_EXCLUSION_NOMEM;
-				goto error;
-			}
-
-			DBG("Receiving var len exclusion event list from client ...");
-			exclusion->count = count;
-			ret = lttcomm_recv_unix_sock(*sock, exclusion->names,
-					count * LTTNG_SYMBOL_NAME_LEN);
-			if (ret <= 0) {
-				DBG("Nothing recv() from client var len data... continuing");
-				*sock_error = 1;
-				free(exclusion);
-				ret = LTTNG_ERR_EXCLUSION_INVAL;
-				goto error;
-			}
-		}
-
-		/* Get filter expression from client. */
-		if (cmd_ctx->lsm.u.enable.expression_len > 0) {
-			size_t expression_len =
-				cmd_ctx->lsm.u.enable.expression_len;
-
-			if (expression_len > LTTNG_FILTER_MAX_LEN) {
-				ret = LTTNG_ERR_FILTER_INVAL;
-				free(exclusion);
-				goto error;
-			}
-
-			filter_expression = zmalloc(expression_len);
-			if (!filter_expression) {
-				free(exclusion);
-				ret = LTTNG_ERR_FILTER_NOMEM;
-				goto error;
-			}
-
-			/* Receive var. len. data */
-			DBG("Receiving var len filter's expression from client ...");
-			ret = lttcomm_recv_unix_sock(*sock, filter_expression,
-				expression_len);
-			if (ret <= 0) {
-				DBG("Nothing recv() from client var len data... continuing");
-				*sock_error = 1;
-				free(filter_expression);
-				free(exclusion);
-				ret = LTTNG_ERR_FILTER_INVAL;
-				goto error;
-			}
-		}
-
-		/* Handle filter and get bytecode from client. */
-		if (cmd_ctx->lsm.u.enable.bytecode_len > 0) {
-			size_t bytecode_len = cmd_ctx->lsm.u.enable.bytecode_len;
-
-			if (bytecode_len > LTTNG_FILTER_MAX_LEN) {
-				ret = LTTNG_ERR_FILTER_INVAL;
-				free(filter_expression);
-				free(exclusion);
-				goto error;
-			}
-
-			bytecode = zmalloc(bytecode_len);
-			if (!bytecode) {
-				free(filter_expression);
-				free(exclusion);
-				ret = LTTNG_ERR_FILTER_NOMEM;
-				goto error;
-			}
-
-			/* Receive var. len. data */
-			DBG("Receiving var len filter's bytecode from client ...");
-			ret = lttcomm_recv_unix_sock(*sock, bytecode, bytecode_len);
-			if (ret <= 0) {
-				DBG("Nothing recv() from client var len data... continuing");
-				*sock_error = 1;
-				free(filter_expression);
-				free(bytecode);
-				free(exclusion);
-				ret = LTTNG_ERR_FILTER_INVAL;
-				goto error;
-			}
-
-			if ((bytecode->len + sizeof(*bytecode)) != bytecode_len) {
-				free(filter_expression);
-				free(bytecode);
-				free(exclusion);
-				ret = LTTNG_ERR_FILTER_INVAL;
-				goto error;
-			}
+		ret = receive_event_filter_and_exclusions(*sock, sock_error,
+				cmd_ctx->lsm.u.enable.exclusion_count,
+				cmd_ctx->lsm.u.enable.expression_len,
+				cmd_ctx->lsm.u.enable.bytecode_len,
+				&exclusion, &filter_expression, &bytecode);
+		if (ret != LTTNG_OK) {
+			goto error;
 		}
 
 		ev = lttng_event_copy(ALIGNED_CONST_PTR(cmd_ctx->lsm.u.enable.event));
@@ -1592,6 +1807,11 @@ error_add_context:
 		lttng_event_destroy(ev);
 		break;
 	}
+	case LTTNG_ENABLE_EVENTS:
+	{
+		ret = receive_and_enable_events(cmd_ctx, *sock, sock_error);
+		break;
+	}
 	case LTTNG_LIST_TRACEPOINTS:
 	{
 		struct lttng_event *events;
@@ -1924,6 +2144,32 @@ error_add_context:
 		ret = LTTNG_OK;
 		break;
 	}
+	case LTTNG_WAIT_DATA_PENDING:
+	{
+		int pending_ret;
+
+		pending_ret = cmd_data_pending(cmd_ctx->session);
+		if (pending_ret == 1) {
+			/*
+			 * The data pending thread replies to the client once
+			 * the session's data is available.
+			 */
+			if (data_pending_thread_add_waiter(cmd_ctx->session,
+					*sock)) {
+				ret = LTTNG_ERR_NOMEM;
+				goto error;
+			}
+			*sock = -1;
+			ret = LTTNG_OK;
+		} else if (pending_ret == 0) {
+			ret = LTTNG_OK;
+		} else if (pending_ret < 0) {
+			ret = LTTNG_ERR_UNK;
+		} else {
+			ret = pending_ret;
+		}
+		break;
+	}
 	case LTTNG_SNAPSHOT_ADD_OUTPUT:
 	{
 		uint32_t snapshot_id;
@@ -2185,6 +2431,10 @@ error_add_context:
 		ret = cmd_clear_session(cmd_ctx->session, sock);
 		break;
 	}
+	case LTTNG_PERSISTENT_CONNECTION:
+		/* The connection is kept by process_client_command(). */
+		ret = LTTNG_OK;
+		break;
 	default:
 		ret = LTTNG_ERR_UND;
 		break;
@@ -2202,10 +2452,14 @@ error:
 setup_error:
 	if (cmd_ctx->session) {
 		session_unlock(cmd_ctx->session);
-		session_put(cmd_ctx->session);
+		if (query) {
+			session_put_no_list_lock(cmd_ctx->session);
+		} else {
+			session_put(cmd_ctx->session);
+		}
 		cmd_ctx->session = NULL;
 	}
-	if (need_tracing_session) {
+	if (need_tracing_session && !query) {
 		session_unlock_list();
 	}
 init_setup_error:
@@ -2213,74 +2467,600 @@ init_setup_error:
 	return ret;
 }
 
-static int create_client_sock(void)
+/*
+ * Process a client command, received on `sock`, and send its reply.
+ *
+ * When `keep_connection` is set and the command succeeds, `sock` is returned
+ * to receive the client's next command. Otherwise, `sock` is closed and -1 is
+ * returned.
+ */
+static int process_client_command(struct command_ctx *cmd_ctx, int sock,
+		bool run_completion_handler, bool keep_connection)
 {
-	int ret, client_sock;
-	const mode_t old_umask = umask(0);
-
-	/* Create client tool unix socket */
-	client_sock = lttcomm_create_unix_sock(config.client_unix_sock_path.value);
-	if (client_sock < 0) {
-		ERR("Create unix sock failed: %s", config.client_unix_sock_path.value);
-		ret = -1;
-		goto end;
-	}
+	int ret, sock_error;
+	int kept_sock = -1;
 
-	/* Set the cloexec flag */
-	ret = utils_set_fd_cloexec(client_sock);
-	if (ret < 0) {
-		ERR("Unable to set CLOEXEC flag to the client Unix socket (fd: %d). "
-				"Continuing but note that the consumer daemon will have a "
-				"reference to this socket on exec()", client_sock);
-	}
+	cmd_ctx->session = NULL;
+	lttng_payload_clear(&cmd_ctx->reply_payload);
+	cmd_ctx->lttng_msg_size = 0;
 
-	/* File permission MUST be 660 */
-	ret = chmod(config.client_unix_sock_path.value, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP);
+	rcu_thread_online();
+	/*
+	 * This function dispatch the work to the kernel or userspace tracer
+	 * libs and fill the lttcomm_lttng_msg data structure of all the needed
+	 * informations for the client. The command context struct contains
+	 * everything this function may needs.
+	 */
+	ret = process_client_msg(cmd_ctx, &sock, &sock_error);
+	rcu_thread_offline();
 	if (ret < 0) {
-		ERR("Set file permissions failed: %s",
-				config.client_unix_sock_path.value);
-		PERROR("chmod");
-		(void) lttcomm_close_unix_sock(client_sock);
-		ret = -1;
+		/*
+		 * TODO: Inform client somehow of the fatal error. At
+		 * this point, ret < 0 means that a zmalloc failed
+		 * (ENOMEM). Error detected but still accept
+		 * command, unless a socket error has been
+		 * detected.
+		 */
 		goto end;
 	}
-	DBG("Created client socket (fd = %i)", client_sock);
-	ret = client_sock;
-end:
-	umask(old_umask);
-	return ret;
-}
 
-static void cleanup_client_thread(void *data)
-{
-	struct lttng_pipe *quit_pipe = data;
+	if (run_completion_handler) {
+		const struct cmd_completion_handler *cmd_completion_handler =
+				cmd_pop_completion_handler();
 
-	lttng_pipe_destroy(quit_pipe);
-}
+		if (cmd_completion_handler) {
+			enum lttng_error_code completion_code;
+
+			completion_code = cmd_completion_handler->run(
+					cmd_completion_handler->data);
+			if (completion_code != LTTNG_OK) {
+				/*
+				 * Replace the command's reply by an error reply
+				 * so that the client is not left without an
+				 * answer.
+				 */
+				ret = setup_empty_lttng_msg(cmd_ctx);
+				if (ret) {
+					goto end;
+				}
+
+				((struct lttcomm_lttng_msg *) cmd_ctx->reply_payload.buffer.data)->ret_code =
+						completion_code;
+			}
+		}
+	}
+
+	health_code_update();
+
+	if (sock >= 0) {
+		struct lttng_payload_view view =
+				lttng_payload_view_from_payload(
+						&cmd_ctx->reply_payload,
+						0, -1);
+		struct lttcomm_lttng_msg *llm = (typeof(
+				llm)) cmd_ctx->reply_payload.buffer.data;
+
+		assert(cmd_ctx->reply_payload.buffer.size >= sizeof(llm));
+		assert(cmd_ctx->lttng_msg_size == cmd_ctx->reply_payload.buffer.size);
+
+		llm->fd_count = lttng_payload_view_get_fd_handle_count(&view);
+
+		DBG("Sending response (size: %d, retcode: %s (%d))",
+				cmd_ctx->lttng_msg_size,
+				lttng_strerror(-llm->ret_code),
+				llm->ret_code);
+		ret = send_unix_sock(sock, &view);
+		if (ret < 0) {
+			ERR("Failed to send data back to client");
+		} else if (keep_connection && !sock_error &&
+				llm->ret_code == LTTNG_OK) {
+			/*
+			 * A failed command may not have received all of its
+			 * data; the connection is only kept after a success.
+			 */
+			kept_sock = sock;
+			sock = -1;
+		}
+	}
+
+end:
+	/* End of transmission */
+	if (sock >= 0) {
+		ret = close(sock);
+		if (ret) {
+			PERROR("close");
+		}
+	}
+
+	health_code_update();
+	return kept_sock;
+}
+
+/*
+ * Hand a kept connection back to the client thread through its kept
+ * connection pipe.
+ */
+static void return_kept_connection(int kept_connection_fd, int sock)
+{
+	ssize_t ret;
+
+	ret = lttng_write(kept_connection_fd, &sock, sizeof(sock));
+	if (ret != sizeof(sock)) {
+		PERROR("Failed to return client connection to the client thread");
+		if (close(sock)) {
+			PERROR("close");
+		}
+	}
+}
+
+static void *thread_process_client_commands(void *data)
+{
+	struct client_command_queue *queue = data;
+	struct command_ctx cmd_ctx = {};
+
+	DBG("[thread] Client command processing started");
+
+	rcu_register_thread();
+	health_register(health_sessiond, HEALTH_SESSIOND_TYPE_CMD);
+	lttng_payload_init(&cmd_ctx.reply_payload);
+
+	while (true) {
+		int sock;
+		struct client_command *command;
+
+		pthread_mutex_lock(&queue->lock);
+		health_poll_entry();
+		while (!queue->quit && cds_list_empty(&queue->commands)) {
+			pthread_cond_wait(&queue->cond, &queue->lock);
+		}
+		health_poll_exit();
+		if (queue->quit) {
+			pthread_mutex_unlock(&queue->lock);
+			break;
+		}
+
+		command = cds_list_first_entry(&queue->commands,
+				struct client_command, node);
+		cds_list_del(&command->node);
+		pthread_mutex_unlock(&queue->lock);
+
+		cmd_ctx.lsm = command->lsm;
+		cmd_ctx.creds = command->creds;
+		sock = process_client_command(&cmd_ctx, command->sock,
+				queue->run_completion_handlers,
+				command->keep_connection);
+		if (sock >= 0) {
+			return_kept_connection(queue->kept_connection_fd, sock);
+		}
+		free(command);
+	}
+
+	DBG("Client command processing thread dying");
+	lttng_payload_reset(&cmd_ctx.reply_payload);
+	health_unregister(health_sessiond);
+	rcu_unregister_thread();
+	return NULL;
+}
+
+/*
+ * Queue the command received on `sock` for its processing by one of the
+ * queue's threads, which then owns `sock`.
+ *
+ * Return 0 on success, a negative value on error.
+ */
+static int client_command_queue_push(struct client_command_queue *queue,
+		int sock, bool keep_connection, const struct command_ctx *cmd_ctx)
+{
+	struct client_command *command;
+
+	command = zmalloc(sizeof(*command));
+	if (!command) {
+		PERROR("zmalloc client command");
+		return -1;
+	}
+
+	command->sock = sock;
+	command->keep_connection = keep_connection;
+	command->lsm = cmd_ctx->lsm;
+	command->creds = cmd_ctx->creds;
+
+	pthread_mutex_lock(&queue->lock);
+	cds_list_add_tail(&command->node, &queue->commands);
+	pthread_cond_signal(&queue->cond);
+	pthread_mutex_unlock(&queue->lock);
+	return 0;
+}
+
+/*
+ * Join the threads of the queue and close the sockets of the commands that
+ * were not processed.
+ */
+static void client_command_queue_fini(struct client_command_queue *queue)
+{
+	unsigned int i;
+	struct client_command *command, *tmp;
+
+	pthread_mutex_lock(&queue->lock);
+	queue->quit = true;
+	pthread_cond_broadcast(&queue->cond);
+	pthread_mutex_unlock(&queue->lock);
+
+	for (i = 0; i < queue->thread_count; i++) {
+		int ret = pthread_join(queue->threads[i], NULL);
+
+		if (ret) {
+			errno = ret;
+			PERROR("Failed to join client command processing thread");
+		}
+	}
+	free(queue->threads);
+	queue->threads = NULL;
+	queue->thread_count = 0;
+
+	cds_list_for_each_entry_safe(command, tmp, &queue->commands, node) {
+		cds_list_del(&command->node);
+		if (close(command->sock)) {
+			PERROR("close");
+		}
+		free(command);
+	}
+
+	pthread_cond_destroy(&queue->cond);
+	pthread_mutex_destroy(&queue->lock);
+}
+
+/*
+ * Launch the `thread_count` threads processing the commands of the queue.
+ *
+ * Return 0 on success, a negative value on error.
+ */
+static int client_command_queue_init(struct client_command_queue *queue,
+		unsigned int thread_count, bool run_completion_handlers,
+		int kept_connection_fd)
+{
+	int ret;
+	unsigned int i;
+
+	pthread_mutex_init(&queue->lock, NULL);
+	pthread_cond_init(&queue->cond, NULL);
+	CDS_INIT_LIST_HEAD(&queue->commands);
+	queue->quit = false;
+	queue->run_completion_handlers = run_completion_handlers;
+	queue->kept_connection_fd = kept_connection_fd;
+	queue->thread_count = 0;
+	queue->threads = zmalloc(thread_count * sizeof(*queue->threads));
+	if (!queue->threads) {
+		PERROR("zmalloc client command threads");
+		ret = -1;
+		goto error;
+	}
+
+	for (i = 0; i < thread_count; i++) {
+		ret = pthread_create(&queue->threads[i], default_pthread_attr(),
+				thread_process_client_commands, queue);
+		if (ret) {
+			errno = ret;
+			PERROR("Failed to launch client command processing thread");
+			ret = -1;
+			goto error;
+		}
+		queue->thread_count++;
+	}
+
+	return 0;
+error:
+	client_command_queue_fini(queue);
+	return ret;
+}
+
+static int create_client_sock(void)
+{
+	int ret, client_sock;
+	const mode_t old_umask = umask(0);
+
+	/* Create client tool unix socket */
+	client_sock = lttcomm_create_unix_sock(config.client_unix_sock_path.value);
+	if (client_sock < 0) {
+		ERR("Create unix sock failed: %s", config.client_unix_sock_path.value);
+		ret = -1;
+		goto end;
+	}
+
+	/* Set the cloexec flag */
+	ret = utils_set_fd_cloexec(client_sock);
+	if (ret < 0) {
+		ERR("Unable to set CLOEXEC flag to the client Unix socket (fd: %d). "
+				"Continuing but note that the consumer daemon will have a "
+				"reference to this socket on exec()", client_sock);
+	}
+
+	/* File permission MUST be 660 */
+	ret = chmod(config.client_unix_sock_path.value, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP);
+	if (ret < 0) {
+		ERR("Set file permissions failed: %s",
+				config.client_unix_sock_path.value);
+		PERROR("chmod");
+		(void) lttcomm_close_unix_sock(client_sock);
+		ret = -1;
+		goto end;
+	}
+	DBG("Created client socket (fd = %i)", client_sock);
+	ret = client_sock;
+end:
+	umask(old_umask);
+	return ret;
+}
+
+static void cleanup_client_thread(void *data)
+{
+	struct lttng_pipe *quit_pipe = data;
+
+	lttng_pipe_destroy(quit_pipe);
+}
 
 static void thread_init_cleanup(void *data)
 {
 	set_thread_status(false);
 }
 
+static uint64_t monotonic_now_ms(void)
+{
+	int ret;
+	struct timespec ts;
+
+	ret = lttng_clock_gettime(CLOCK_MONOTONIC, &ts);
+	if (ret < 0) {
+		PERROR("clock_gettime");
+		return 0;
+	}
+	return (uint64_t) ts.tv_sec * MSEC_PER_SEC + ts.tv_nsec / NSEC_PER_MSEC;
+}
+
+static void close_idle_client_connection(
+		struct idle_client_connections *connections,
+		struct lttng_poll_event *events,
+		struct idle_client_connection *connection)
+{
+	int ret;
+
+	(void) lttng_poll_del(events, connection->sock);
+	ret = close(connection->sock);
+	if (ret) {
+		PERROR("close");
+	}
+	cds_list_del(&connection->node);
+	connections->count--;
+	free(connection);
+}
+
+/*
+ * Add a persistent client connection to the poll set until its next command.
+ *
+ * The connection is closed, rather than kept, when the maximal number of idle
+ * connections is reached; the client then reconnects for its next command.
+ *
+ * Return 0 on success or -1 on error, in which case the connection is closed.
+ */
+static int add_idle_client_connection(
+		struct idle_client_connections *connections,
+		struct lttng_poll_event *events, int sock)
+{
+	int ret;
+	struct idle_client_connection *connection = NULL;
+
+	if (connections->count >= DEFAULT_CLIENT_MAX_IDLE_CONNECTIONS) {
+		DBG("Closing persistent client connection: maximal number of idle connections reached (fd = %d)",
+				sock);
+		ret = 0;
+		goto error_close;
+	}
+
+	connection = zmalloc(sizeof(*connection));
+	if (!connection) {
+		PERROR("Failed to allocate idle client connection");
+		ret = -1;
+		goto error_close;
+	}
+
+	ret = lttng_poll_add(events, sock, LPOLLIN);
+	if (ret < 0) {
+		ERR("Failed to add persistent client connection to the poll set");
+		ret = -1;
+		goto error_close;
+	}
+
+	connection->sock = sock;
+	connection->idle_since_ms = monotonic_now_ms();
+	cds_list_add_tail(&connection->node, &connections->list);
+	connections->count++;
+	return 0;
+
+error_close:
+	free(connection);
+	if (close(sock)) {
+		PERROR("close");
+	}
+	return ret;
+}
+
+/*
+ * Remove the persistent client connection `sock`, which has a command to
+ * receive, from the poll set and the idle connections.
+ */
+static int take_idle_client_connection(
+		struct idle_client_connections *connections,
+		struct lttng_poll_event *events, int sock)
+{
+	struct idle_client_connection *connection;
+
+	cds_list_for_each_entry(connection, &connections->list, node) {
+		if (connection->sock != sock) {
+			continue;
+		}
+
+		cds_list_del(&connection->node);
+		connections->count--;
+		free(connection);
+		return lttng_poll_del(events, sock);
+	}
+
+	ERR("Unknown persistent client connection (fd = %d)", sock);
+	return -1;
+}
+
+/*
+ * Close the persistent client connections that have been idle for
+ * DEFAULT_CLIENT_IDLE_CONNECTION_TIMEOUT_MS or more.
+ *
+ * Return the poll timeout, in ms, until the next idle connection expires or
+ * -1 if there is none.
+ */
+static int close_expired_idle_client_connections(
+		struct idle_client_connections *connections,
+		struct lttng_poll_event *events)
+{
+	const uint64_t now_ms = monotonic_now_ms();
+	struct idle_client_connection *connection, *tmp;
+
+	cds_list_for_each_entry_safe(connection, tmp, &connections->list,
+			node) {
+		const uint64_t idle_ms = now_ms - connection->idle_since_ms;
+
+		if (idle_ms < DEFAULT_CLIENT_IDLE_CONNECTION_TIMEOUT_MS) {
+			/* The following connections became idle later. */
+			return DEFAULT_CLIENT_IDLE_CONNECTION_TIMEOUT_MS -
+					idle_ms;
+		}
+
+		DBG("Closing idle persistent client connection (fd = %d)",
+				connection->sock);
+		close_idle_client_connection(connections, events, connection);
+	}
+
+	return -1;
+}
+
+static void fini_idle_client_connections(
+		struct idle_client_connections *connections,
+		struct lttng_poll_event *events)
+{
+	struct idle_client_connection *connection, *tmp;
+
+	cds_list_for_each_entry_safe(connection, tmp, &connections->list,
+			node) {
+		close_idle_client_connection(connections, events, connection);
+	}
+}
+
+/*
+ * Receive and dispatch the next command of a client connection. Persistent
+ * connections are added back to the poll set once their command is processed.
+ */
+static int handle_client_connection(int sock, bool persistent,
+		struct command_ctx *cmd_ctx, struct lttng_poll_event *events,
+		struct idle_client_connections *idle_connections,
+		struct client_command_queue *command_queue,
+		struct client_command_queue *query_queue, bool queues_launched)
+{
+	int ret;
+	bool keep_connection;
+
+	cmd_ctx->creds = (lttng_sock_cred) {
+		.uid = UINT32_MAX,
+		.gid = UINT32_MAX,
+	};
+
+	/*
+	 * Data is received from the lttng client. The struct
+	 * lttcomm_session_msg (lsm) contains the command and data request of
+	 * the client.
+	 */
+	DBG("Receiving data from client ...");
+	ret = lttcomm_recv_creds_unix_sock(sock, &cmd_ctx->lsm,
+			sizeof(struct lttcomm_session_msg), &cmd_ctx->creds);
+	if (ret != sizeof(struct lttcomm_session_msg)) {
+		if (persistent) {
+			DBG("Client closed persistent connection (fd = %d)", sock);
+		} else {
+			DBG("Incomplete recv() from client... continuing");
+		}
+		ret = close(sock);
+		if (ret) {
+			PERROR("close");
+		}
+		ret = 0;
+		goto end;
+	}
+
+	health_code_update();
+
+	// TODO: Validate cmd_ctx including sanity check for
+	// security purpose.
+
+	keep_connection = persistent ||
+			cmd_ctx->lsm.cmd_type == LTTNG_PERSISTENT_CONNECTION;
+	if (queues_launched) {
+		struct client_command_queue *queue =
+				is_query_command(cmd_ctx->lsm.cmd_type) ?
+						query_queue :
+						command_queue;
+
+		ret = client_command_queue_push(queue, sock, keep_connection,
+				cmd_ctx);
+		if (ret) {
+			ret = close(sock);
+			if (ret) {
+				PERROR("close");
+			}
+		}
+		ret = 0;
+		goto end;
+	}
+
+	sock = process_client_command(cmd_ctx, sock, true, keep_connection);
+	if (sock >= 0) {
+		ret = add_idle_client_connection(idle_connections, events,
+				sock);
+		if (ret) {
+			goto end;
+		}
+	}
+	ret = 0;
+end:
+	return ret;
+}
+
 /*
  * This thread manage all clients request using the unix client socket for
  * communication.
+ *
+ * The client connections are closed once their command is processed, except
+ * for the persistent connections (see LTTNG_PERSISTENT_CONNECTION). Those are
+ * added back to the poll set, through the kept connection pipe when their
+ * command is processed by another thread, and their commands are received in
+ * order. The number of idle persistent connections is capped and those idle
+ * for too long are closed.
  */
 static void *thread_manage_clients(void *data)
 {
 	int sock = -1, ret, i, pollfd, err = -1;
-	int sock_error;
 	uint32_t revents, nb_fd;
 	struct lttng_poll_event events;
 	const int client_sock = thread_state.client_sock;
 	struct lttng_pipe *quit_pipe = data;
 	const int thread_quit_pipe_fd = lttng_pipe_get_readfd(quit_pipe);
+	struct lttng_pipe *kept_connection_pipe = NULL;
+	int kept_connection_pipe_fd;
 	struct command_ctx cmd_ctx = {};
+	struct client_command_queue command_queue = {}, query_queue = {};
+	bool queues_launched = false;
+	struct idle_client_connections idle_connections = {};
+	int poll_timeout;
 
 	DBG("[thread] Manage client started");
 
 	lttng_payload_init(&cmd_ctx.reply_payload);
+	CDS_INIT_LIST_HEAD(&idle_connections.list);
 
 	is_root = (getuid() == 0);
 
@@ -2297,11 +3077,18 @@ static void *thread_manage_clients(void *data)
 		goto error_listen;
 	}
 
+	kept_connection_pipe = lttng_pipe_open(FD_CLOEXEC);
+	if (!kept_connection_pipe) {
+		goto error_listen;
+	}
+	kept_connection_pipe_fd = lttng_pipe_get_readfd(kept_connection_pipe);
+
 	/*
-	 * Pass 2 as size here for the thread quit pipe and client_sock. Nothing
-	 * more will be added to this poll set.
+	 * Pass 3 as size here for the thread quit pipe, client_sock and the
+	 * kept connection pipe. The persistent client connections are added
+	 * to this poll set as they are established.
 	 */
-	ret = lttng_poll_create(&events, 2, LTTNG_CLOEXEC);
+	ret = lttng_poll_create(&events, 3, LTTNG_CLOEXEC);
 	if (ret < 0) {
 		goto error_create_poll;
 	}
@@ -2318,6 +3105,12 @@ static void *thread_manage_clients(void *data)
 		goto error;
 	}
 
+	ret = lttng_poll_add(&events, kept_connection_pipe_fd,
+			LPOLLIN | LPOLLERR);
+	if (ret < 0) {
+		goto error;
+	}
+
 	/* Set state as running. */
 	set_thread_status(true);
 	pthread_cleanup_pop(0);
@@ -2333,23 +3126,43 @@ static void *thread_manage_clients(void *data)
 
 	health_code_update();
 
-	while (1) {
-		const struct cmd_completion_handler *cmd_completion_handler;
+	if (config.client_query_thread_count > 0) {
+		const int kept_connection_write_fd =
+				lttng_pipe_get_writefd(kept_connection_pipe);
 
-		cmd_ctx.creds = (lttng_sock_cred) {
-			.uid = UINT32_MAX,
-			.gid = UINT32_MAX,
-		};
-		cmd_ctx.session = NULL;
-		lttng_payload_clear(&cmd_ctx.reply_payload);
-		cmd_ctx.lttng_msg_size = 0;
+		/*
+		 * The state-changing commands are processed, one at a time, by
+		 * a dedicated thread, while the queries are processed
+		 * concurrently by their own threads. This thread only receives
+		 * the commands.
+		 */
+		ret = client_command_queue_init(&command_queue, 1, true,
+				kept_connection_write_fd);
+		if (ret) {
+			goto error;
+		}
+		ret = client_command_queue_init(&query_queue,
+				config.client_query_thread_count, false,
+				kept_connection_write_fd);
+		if (ret) {
+			client_command_queue_fini(&command_queue);
+			goto error;
+		}
+		queues_launched = true;
+	}
 
+	while (1) {
 		DBG("Accepting client command ...");
 
-		/* Inifinite blocking call, waiting for transmission */
+		/*
+		 * Blocking call, waiting for transmission or for the next idle
+		 * persistent connection to expire.
+		 */
+		poll_timeout = close_expired_idle_client_connections(
+				&idle_connections, &events);
 	restart:
 		health_poll_entry();
-		ret = lttng_poll_wait(&events, -1);
+		ret = lttng_poll_wait(&events, poll_timeout);
 		health_poll_exit();
 		if (ret < 0) {
 			/*
@@ -2364,6 +3177,8 @@ static void *thread_manage_clients(void *data)
 		nb_fd = ret;
 
 		for (i = 0; i < nb_fd; i++) {
+			bool persistent = false;
+
 			revents = LTTNG_POLL_GETEV(&events, i);
 			pollfd = LTTNG_POLL_GETFD(&events, i);
 
@@ -2372,10 +3187,61 @@ static void *thread_manage_clients(void *data)
 			if (pollfd == thread_quit_pipe_fd) {
 				err = 0;
 				goto exit;
+			} else if (pollfd == kept_connection_pipe_fd) {
+				ssize_t size_ret;
+
+				if (!(revents & LPOLLIN)) {
+					ERR("Kept connection pipe poll error");
+					goto error;
+				}
+
+				size_ret = lttng_pipe_read(kept_connection_pipe,
+						&sock, sizeof(sock));
+				if (size_ret != sizeof(sock)) {
+					PERROR("Failed to read kept client connection");
+					sock = -1;
+					goto error;
+				}
+
+				ret = add_idle_client_connection(
+						&idle_connections, &events,
+						sock);
+				sock = -1;
+				if (ret) {
+					goto error;
+				}
+				continue;
+			} else if (pollfd != client_sock) {
+				/* Next command of a persistent connection. */
+				ret = take_idle_client_connection(
+						&idle_connections, &events,
+						pollfd);
+				if (ret < 0) {
+					goto error;
+				}
+				sock = pollfd;
+				persistent = true;
 			} else {
 				/* Event on the registration socket */
 				if (revents & LPOLLIN) {
-					continue;
+					DBG("Wait for client response");
+
+					sock = lttcomm_accept_unix_sock(client_sock);
+					if (sock < 0) {
+						goto error;
+					}
+
+					/*
+					 * Set the CLOEXEC flag. Return code is useless because either way, the
+					 * show must go on.
+					 */
+					(void) utils_set_fd_cloexec(sock);
+
+					/* Set socket option for credentials retrieval */
+					ret = lttcomm_setsockopt_creds_unix_sock(sock);
+					if (ret < 0) {
+						goto error;
+					}
 				} else if (revents & (LPOLLERR | LPOLLHUP | LPOLLRDHUP)) {
 					ERR("Client socket poll error");
 					goto error;
@@ -2384,126 +3250,20 @@ static void *thread_manage_clients(void *data)
 					goto error;
 				}
 			}
-		}
-
-		DBG("Wait for client response");
-
-		health_code_update();
-
-		sock = lttcomm_accept_unix_sock(client_sock);
-		if (sock < 0) {
-			goto error;
-		}
-
-		/*
-		 * Set the CLOEXEC flag. Return code is useless because either way, the
-		 * show must go on.
-		 */
-		(void) utils_set_fd_cloexec(sock);
-
-		/* Set socket option for credentials retrieval */
-		ret = lttcomm_setsockopt_creds_unix_sock(sock);
-		if (ret < 0) {
-			goto error;
-		}
-
-		health_code_update();
-
-		/*
-		 * Data is received from the lttng client. The struct
-		 * lttcomm_session_msg (lsm) contains the command and data request of
-		 * the client.
-		 */
-		DBG("Receiving data from client ...");
-		ret = lttcomm_recv_creds_unix_sock(sock, &cmd_ctx.lsm,
-				sizeof(struct lttcomm_session_msg), &cmd_ctx.creds);
-		if (ret != sizeof(struct lttcomm_session_msg)) {
-			DBG("Incomplete recv() from client... continuing");
-			ret = close(sock);
-			if (ret) {
-				PERROR("close");
-			}
-			sock = -1;
-			continue;
-		}
-
-		health_code_update();
 
-		// TODO: Validate cmd_ctx including sanity check for
-		// security purpose.
+			health_code_update();
 
-		rcu_thread_online();
-		/*
-		 * This function dispatch the work to the kernel or userspace tracer
-		 * libs and fill the lttcomm_lttng_msg data structure of all the needed
-		 * informations for the client. The command context struct contains
-		 * everything this function may needs.
-		 */
-		ret = process_client_msg(&cmd_ctx, &sock, &sock_error);
-		rcu_thread_offline();
-		if (ret < 0) {
-			if (sock >= 0) {
-				ret = close(sock);
-				if (ret) {
-					PERROR("close");
-				}
-			}
+			ret = handle_client_connection(sock, persistent,
+					&cmd_ctx, &events, &idle_connections,
+					&command_queue, &query_queue,
+					queues_launched);
 			sock = -1;
-			/*
-			 * TODO: Inform client somehow of the fatal error. At
-			 * this point, ret < 0 means that a zmalloc failed
-			 * (ENOMEM). Error detected but still accept
-			 * command, unless a socket error has been
-			 * detected.
-			 */
-			continue;
-		}
-
-		cmd_completion_handler = cmd_pop_completion_handler();
-		if (cmd_completion_handler) {
-			enum lttng_error_code completion_code;
-
-			completion_code = cmd_completion_handler->run(
-					cmd_completion_handler->data);
-			if (completion_code != LTTNG_OK) {
-				continue;
-			}
-		}
-
-		health_code_update();
-
-		if (sock >= 0) {
-			struct lttng_payload_view view =
-					lttng_payload_view_from_payload(
-							&cmd_ctx.reply_payload,
-							0, -1);
-			struct lttcomm_lttng_msg *llm = (typeof(
-					llm)) cmd_ctx.reply_payload.buffer.data;
-
-			assert(cmd_ctx.reply_payload.buffer.size >=
-			       sizeof(llm));
-			assert(cmd_ctx.lttng_msg_size == cmd_ctx.reply_payload.buffer.size);
-
-			llm->fd_count = lttng_payload_view_get_fd_handle_count(&view);
-
-			DBG("Sending response (size: %d, retcode: %s (%d))",
-					cmd_ctx.lttng_msg_size,
-					lttng_strerror(-llm->ret_code),
-					llm->ret_code);
-			ret = send_unix_sock(sock, &view);
-			if (ret < 0) {
-				ERR("Failed to send data back to client");
-			}
-
-			/* End of transmission */
-			ret = close(sock);
 			if (ret) {
-				PERROR("close");
+				goto error;
 			}
-		}
-		sock = -1;
 
-		health_code_update();
+			health_code_update();
+		}
 	}
 
 exit:
@@ -2515,10 +3275,17 @@ error:
 		}
 	}
 
+	if (queues_launched) {
+		client_command_queue_fini(&query_queue);
+		client_command_queue_fini(&command_queue);
+	}
+
+	fini_idle_client_connections(&idle_connections, &events);
 	lttng_poll_clean(&events);
 
-error_listen:
 error_create_poll:
+	lttng_pipe_destroy(kept_connection_pipe);
+error_listen:
 	unlink(config.client_unix_sock_path.value);
 	ret = close(client_sock);
 	if (ret) {
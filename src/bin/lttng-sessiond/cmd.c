@@ -2060,7 +2060,8 @@ static int _cmd_enable_event(struct ltt_session *session,
 		char *filter_expression,
 		struct lttng_filter_bytecode *filter,
 		struct lttng_event_exclusion *exclusion,
-		int wpipe, bool internal_event)
+		int wpipe, bool internal_event,
+		struct lttng_dynamic_pointer_array *created_uevents)
 {
 	int ret = 0, channel_created = 0;
 	struct lttng_channel *attr = NULL;
@@ -2298,7 +2299,7 @@ static int _cmd_enable_event(struct ltt_session *session,
 		/* At this point, the session and channel exist on the tracer */
 		ret = event_ust_enable_tracepoint(usess, uchan, event,
 				filter_expression, filter, exclusion,
-				internal_event);
+				internal_event, created_uevents);
 		/* We have passed ownership */
 		filter_expression = NULL;
 		filter = NULL;
@@ -2461,7 +2462,111 @@ int cmd_enable_event(struct ltt_session *session,
 		int wpipe)
 {
 	return _cmd_enable_event(session, domain, channel_name, event,
-			filter_expression, filter, exclusion, wpipe, false);
+			filter_expression, filter, exclusion, wpipe, false,
+			NULL);
+}
+
+/*
+ * Command LTTNG_ENABLE_EVENTS processed by the client thread.
+ *
+ * Each event is enabled as by cmd_enable_event() and its result is set in
+ * `ret_codes`. The UST events created by the command are then created on the
+ * registered applications in a single pass over them, rather than in one pass
+ * per event. As with a single event, the events created by the command are
+ * destroyed if they can't be created on the applications.
+ *
+ * We own the filters, exclusions, and filter expressions of the entries.
+ *
+ * Return LTTNG_OK once the result of each event is set, else an
+ * lttng_error_code if the command itself is invalid.
+ */
+int cmd_enable_events(struct ltt_session *session,
+		const struct lttng_domain *domain, char *channel_name,
+		struct cmd_enable_events_entry *entries, size_t entry_count,
+		int32_t *ret_codes, int wpipe)
+{
+	int ret;
+	size_t i;
+	struct lttng_dynamic_pointer_array created_uevents;
+
+	lttng_dynamic_pointer_array_init(&created_uevents, NULL);
+
+	if (entry_count == 0) {
+		ret = LTTNG_ERR_INVALID;
+		goto end;
+	}
+
+	switch (domain->type) {
+	case LTTNG_DOMAIN_KERNEL:
+	case LTTNG_DOMAIN_UST:
+	case LTTNG_DOMAIN_JUL:
+	case LTTNG_DOMAIN_LOG4J:
+	case LTTNG_DOMAIN_PYTHON:
+		break;
+	default:
+		ret = LTTNG_ERR_UNKNOWN_DOMAIN;
+		goto end;
+	}
+
+	for (i = 0; i < entry_count; i++) {
+		/* Userspace probes must be enabled one by one. */
+		if (entries[i].event->type == LTTNG_EVENT_USERSPACE_PROBE) {
+			ret = LTTNG_ERR_INVALID;
+			goto end;
+		}
+	}
+
+	for (i = 0; i < entry_count; i++) {
+		const size_t created_count = lttng_dynamic_pointer_array_get_count(
+				&created_uevents);
+
+		ret_codes[i] = _cmd_enable_event(session, domain, channel_name,
+				entries[i].event, entries[i].filter_expression,
+				entries[i].filter, entries[i].exclusion, wpipe,
+				false,
+				domain->type == LTTNG_DOMAIN_UST ?
+						&created_uevents : NULL);
+		/* We have passed ownership */
+		entries[i].filter_expression = NULL;
+		entries[i].filter = NULL;
+		entries[i].exclusion = NULL;
+		entries[i].batch_created = lttng_dynamic_pointer_array_get_count(
+				&created_uevents) != created_count;
+	}
+
+	if (lttng_dynamic_pointer_array_get_count(&created_uevents) > 0) {
+		struct ltt_ust_session *usess = session->ust_session;
+		struct ltt_ust_channel *uchan;
+
+		rcu_read_lock();
+		uchan = trace_ust_find_channel_by_name(
+				usess->domain_global.channels, channel_name);
+		/* The events were just added to this channel. */
+		assert(uchan);
+		ret = ust_app_create_events_glb(usess, uchan, &created_uevents);
+		if (ret < 0) {
+			const size_t created_count =
+					lttng_dynamic_pointer_array_get_count(
+							&created_uevents);
+
+			for (i = 0; i < created_count; i++) {
+				trace_ust_delete_event(uchan->events,
+						lttng_dynamic_pointer_array_get_pointer(
+								&created_uevents, i));
+			}
+			for (i = 0; i < entry_count; i++) {
+				if (entries[i].batch_created) {
+					ret_codes[i] = LTTNG_ERR_UST_ENABLE_FAIL;
+				}
+			}
+		}
+		rcu_read_unlock();
+	}
+
+	ret = LTTNG_OK;
+end:
+	lttng_dynamic_pointer_array_reset(&created_uevents);
+	return ret;
 }
 
 /*
@@ -2478,7 +2583,7 @@ static int cmd_enable_event_internal(struct ltt_session *session,
 		int wpipe)
 {
 	return _cmd_enable_event(session, domain, channel_name, event,
-			filter_expression, filter, exclusion, wpipe, true);
+			filter_expression, filter, exclusion, wpipe, true, NULL);
 }
 
 /*
@@ -3006,6 +3111,12 @@ enum lttng_error_code cmd_create_session_from_descriptor(
 		goto end;
 	}
 
+	/*
+	 * The new session can be found by the queries that don't hold the
+	 * session list lock; hold its lock until it is initialized.
+	 */
+	session_lock(new_session);
+
 	if (!session_name) {
 		ret = lttng_session_descriptor_set_session_name(descriptor,
 				new_session->name);
@@ -3055,11 +3166,14 @@ enum lttng_error_code cmd_create_session_from_descriptor(
 	new_session->consumer->enabled = 1;
 	ret_code = LTTNG_OK;
 end:
-	/* Release reference provided by the session_create function. */
-	session_put(new_session);
-	if (ret_code != LTTNG_OK && new_session) {
-		/* Release the global reference on error. */
-		session_destroy(new_session);
+	if (new_session) {
+		if (ret_code != LTTNG_OK) {
+			/* Release the global reference on error. */
+			session_destroy(new_session);
+		}
+		session_unlock(new_session);
+		/* Release reference provided by the session_create function. */
+		session_put(new_session);
 	}
 	session_unlock_list();
 	return ret_code;
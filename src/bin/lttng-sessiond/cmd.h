@@ -94,6 +94,21 @@ int cmd_enable_event(struct ltt_session *session, const struct lttng_domain *dom
 		struct lttng_event_exclusion *exclusion,
 		int wpipe);
 
+/* Event of a LTTNG_ENABLE_EVENTS command. */
+struct cmd_enable_events_entry {
+	struct lttng_event *event;
+	/* Owned by the entry until passed to cmd_enable_events(). */
+	char *filter_expression;
+	struct lttng_filter_bytecode *filter;
+	struct lttng_event_exclusion *exclusion;
+	/* Set when the event is created on the applications in batch. */
+	bool batch_created;
+};
+int cmd_enable_events(struct ltt_session *session,
+		const struct lttng_domain *domain, char *channel_name,
+		struct cmd_enable_events_entry *entries, size_t entry_count,
+		int32_t *ret_codes, int wpipe);
+
 /* Trace session action commands */
 int cmd_start_trace(struct ltt_session *session);
 int cmd_stop_trace(struct ltt_session *session);
@@ -0,0 +1,371 @@
+/*
+ * Copyright (C) 2021 EfficiOS Inc.
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+#define _LGPL_SOURCE
+#include <inttypes.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <urcu/list.h>
+
+#include <common/common.h>
+#include <common/defaults.h>
+#include <common/time.h>
+#include <common/compat/time.h>
+#include <common/sessiond-comm/sessiond-comm.h>
+
+#include "cmd.h"
+#include "data-pending-thread.h"
+#include "health-sessiond.h"
+#include "lttng-sessiond.h"
+#include "thread.h"
+
+#define THREAD_NAME "Data pending"
+
+/*
+ * Client waiting for the data of a session to be available.
+ *
+ * The data availability of the session is checked with an exponential
+ * back-off, from DEFAULT_DATA_PENDING_WAIT_MIN_INTERVAL_US up to
+ * DEFAULT_DATA_AVAILABILITY_WAIT_TIME_US, since the consumer daemons don't
+ * report when they are done extracting a session's data.
+ */
+struct data_pending_waiter {
+	/* Reference to the session being waited for. */
+	struct ltt_session *session;
+	int sock;
+	uint64_t interval_us;
+	/* Next check, in CLOCK_MONOTONIC nanoseconds. */
+	uint64_t next_check_ns;
+	struct cds_list_head node;
+};
+
+static struct {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	/* struct data_pending_waiter nodes. */
+	struct cds_list_head waiters;
+	/* Set to check all the waiters without delay. */
+	bool wake;
+	bool quit;
+} data_pending = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.waiters = CDS_LIST_HEAD_INIT(data_pending.waiters),
+};
+
+static
+uint64_t now_ns(void)
+{
+	int ret;
+	struct timespec ts;
+
+	ret = lttng_clock_gettime(CLOCK_MONOTONIC, &ts);
+	if (ret < 0) {
+		PERROR("clock_gettime");
+		return 0;
+	}
+	return (uint64_t) ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+/*
+ * Close a waiter's client socket and release its reference to the session.
+ */
+static
+void waiter_destroy(struct data_pending_waiter *waiter)
+{
+	int ret;
+
+	ret = close(waiter->sock);
+	if (ret) {
+		PERROR("Failed to close client socket of data pending waiter");
+	}
+
+	session_lock_list();
+	session_put(waiter->session);
+	session_unlock_list();
+	free(waiter);
+}
+
+/*
+ * Send the final reply to a waiting client and release the waiter.
+ */
+static
+void waiter_reply(struct data_pending_waiter *waiter,
+		enum lttng_error_code ret_code)
+{
+	ssize_t comm_ret;
+	const struct lttcomm_lttng_msg llm = {
+		.cmd_type = LTTNG_WAIT_DATA_PENDING,
+		.ret_code = ret_code,
+		.pid = UINT32_MAX,
+	};
+
+	DBG("Replying to client waiting for the data of session \"%s\" (ret code: %s)",
+			waiter->session->name, lttng_strerror(-ret_code));
+
+	comm_ret = lttcomm_send_unix_sock(waiter->sock, &llm, sizeof(llm));
+	if (comm_ret != (ssize_t) sizeof(llm)) {
+		ERR("Failed to send data pending wait reply to client");
+	}
+
+	waiter_destroy(waiter);
+}
+
+/*
+ * A client stops waiting by closing its connection, e.g. when its wait times
+ * out. Clients send nothing once waiting, so any readable data is unexpected.
+ */
+static
+bool waiter_client_hung_up(struct data_pending_waiter *waiter)
+{
+	char c;
+	ssize_t ret;
+
+	ret = recv(waiter->sock, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+	return ret == 0 || (ret < 0 && errno != EAGAIN &&
+			errno != EWOULDBLOCK && errno != EINTR);
+}
+
+/*
+ * Check whether the data of a waiter's session is still pending.
+ *
+ * Return true if the client is still waiting, false if it was replied to or
+ * hung up.
+ */
+static
+bool waiter_check(struct data_pending_waiter *waiter)
+{
+	int ret;
+	enum lttng_error_code ret_code;
+
+	if (waiter_client_hung_up(waiter)) {
+		DBG("Client stopped waiting for the data of session \"%s\"",
+				waiter->session->name);
+		waiter_destroy(waiter);
+		return false;
+	}
+
+	session_lock_list();
+	session_lock(waiter->session);
+	if (waiter->session->destroyed) {
+		ret = LTTNG_ERR_SESS_NOT_FOUND;
+	} else {
+		ret = cmd_data_pending(waiter->session);
+	}
+	session_unlock(waiter->session);
+	session_unlock_list();
+
+	if (ret == 1) {
+		return true;
+	}
+
+	if (ret == 0) {
+		ret_code = LTTNG_OK;
+	} else if (ret < 0) {
+		ret_code = LTTNG_ERR_UNK;
+	} else {
+		ret_code = (enum lttng_error_code) ret;
+	}
+	waiter_reply(waiter, ret_code);
+	return false;
+}
+
+/*
+ * Must be called with the data pending lock held.
+ */
+static
+void wait_next_check(void)
+{
+	uint64_t next_check_ns = UINT64_MAX;
+	struct data_pending_waiter *waiter;
+	struct timespec deadline;
+
+	health_poll_entry();
+	if (cds_list_empty(&data_pending.waiters)) {
+		pthread_cond_wait(&data_pending.cond, &data_pending.lock);
+		goto end;
+	}
+
+	cds_list_for_each_entry(waiter, &data_pending.waiters, node) {
+		if (waiter->next_check_ns < next_check_ns) {
+			next_check_ns = waiter->next_check_ns;
+		}
+	}
+
+	deadline.tv_sec = next_check_ns / NSEC_PER_SEC;
+	deadline.tv_nsec = next_check_ns % NSEC_PER_SEC;
+	(void) pthread_cond_timedwait(&data_pending.cond, &data_pending.lock,
+			&deadline);
+end:
+	health_poll_exit();
+}
+
+static
+void *thread_data_pending(void *data)
+{
+	DBG("[thread] Data pending started");
+
+	rcu_register_thread();
+	health_register(health_sessiond, HEALTH_SESSIOND_TYPE_CMD);
+
+	pthread_mutex_lock(&data_pending.lock);
+	while (!data_pending.quit) {
+		struct data_pending_waiter *waiter, *tmp;
+		const bool wake = data_pending.wake;
+		const uint64_t now = now_ns();
+		CDS_LIST_HEAD(due);
+		CDS_LIST_HEAD(still_waiting);
+
+		health_code_update();
+
+		/* Collect the waiters due for a check. */
+		data_pending.wake = false;
+		cds_list_for_each_entry_safe(waiter, tmp, &data_pending.waiters,
+				node) {
+			if (wake || waiter->next_check_ns <= now) {
+				cds_list_del(&waiter->node);
+				cds_list_add_tail(&waiter->node, &due);
+			}
+		}
+
+		if (cds_list_empty(&due)) {
+			wait_next_check();
+			continue;
+		}
+
+		/* Check without the lock held; clients can keep being added. */
+		pthread_mutex_unlock(&data_pending.lock);
+		cds_list_for_each_entry_safe(waiter, tmp, &due, node) {
+			cds_list_del(&waiter->node);
+			if (!waiter_check(waiter)) {
+				continue;
+			}
+
+			waiter->interval_us = min_t(uint64_t,
+					waiter->interval_us * 2,
+					DEFAULT_DATA_AVAILABILITY_WAIT_TIME_US);
+			waiter->next_check_ns = now_ns() +
+					waiter->interval_us * NSEC_PER_USEC;
+			cds_list_add_tail(&waiter->node, &still_waiting);
+		}
+		health_code_update();
+		pthread_mutex_lock(&data_pending.lock);
+		cds_list_splice(&still_waiting, &data_pending.waiters);
+	}
+	pthread_mutex_unlock(&data_pending.lock);
+
+	DBG("Data pending thread dying");
+	health_unregister(health_sessiond);
+	rcu_unregister_thread();
+	return NULL;
+}
+
+static
+bool shutdown_data_pending_thread(void *data)
+{
+	pthread_mutex_lock(&data_pending.lock);
+	data_pending.quit = true;
+	pthread_cond_signal(&data_pending.cond);
+	pthread_mutex_unlock(&data_pending.lock);
+	return true;
+}
+
+static
+void cleanup_data_pending_thread(void *data)
+{
+	struct data_pending_waiter *waiter, *tmp;
+
+	/* Clients still waiting get no reply. */
+	cds_list_for_each_entry_safe(waiter, tmp, &data_pending.waiters, node) {
+		cds_list_del(&waiter->node);
+		waiter_destroy(waiter);
+	}
+	pthread_cond_destroy(&data_pending.cond);
+}
+
+bool launch_data_pending_thread(void)
+{
+	int ret;
+	pthread_condattr_t attr;
+	struct lttng_thread *thread;
+
+	ret = pthread_condattr_init(&attr);
+	if (ret) {
+		errno = ret;
+		PERROR("pthread_condattr_init");
+		goto error;
+	}
+	ret = pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	if (ret) {
+		errno = ret;
+		PERROR("pthread_condattr_setclock");
+		pthread_condattr_destroy(&attr);
+		goto error;
+	}
+	ret = pthread_cond_init(&data_pending.cond, &attr);
+	pthread_condattr_destroy(&attr);
+	if (ret) {
+		errno = ret;
+		PERROR("pthread_cond_init");
+		goto error;
+	}
+
+	thread = lttng_thread_create(THREAD_NAME,
+			thread_data_pending,
+			shutdown_data_pending_thread,
+			cleanup_data_pending_thread,
+			NULL);
+	if (!thread) {
+		pthread_cond_destroy(&data_pending.cond);
+		goto error;
+	}
+	lttng_thread_put(thread);
+	return true;
+error:
+	return false;
+}
+
+int data_pending_thread_add_waiter(struct ltt_session *session, int sock)
+{
+	int ret = 0;
+	struct data_pending_waiter *waiter;
+
+	waiter = zmalloc(sizeof(*waiter));
+	if (!waiter) {
+		PERROR("zmalloc data pending waiter");
+		ret = -1;
+		goto end;
+	}
+
+	if (!session_get(session)) {
+		free(waiter);
+		ret = -1;
+		goto end;
+	}
+	waiter->session = session;
+	waiter->sock = sock;
+	waiter->interval_us = DEFAULT_DATA_PENDING_WAIT_MIN_INTERVAL_US;
+	waiter->next_check_ns = now_ns() +
+			waiter->interval_us * NSEC_PER_USEC;
+
+	DBG("Client waiting for the data of session \"%s\" to be available",
+			session->name);
+	pthread_mutex_lock(&data_pending.lock);
+	cds_list_add_tail(&waiter->node, &data_pending.waiters);
+	pthread_cond_signal(&data_pending.cond);
+	pthread_mutex_unlock(&data_pending.lock);
+end:
+	return ret;
+}
+
+void data_pending_thread_wake(void)
+{
+	pthread_mutex_lock(&data_pending.lock);
+	data_pending.wake = true;
+	pthread_cond_signal(&data_pending.cond);
+	pthread_mutex_unlock(&data_pending.lock);
+}
@@ -0,0 +1,33 @@
+/*
+ * Copyright (C) 2021 EfficiOS Inc.
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+#ifndef LTTNG_SESSIOND_DATA_PENDING_THREAD_H
+#define LTTNG_SESSIOND_DATA_PENDING_THREAD_H
+
+#include <stdbool.h>
+
+#include "session.h"
+
+bool launch_data_pending_thread(void);
+
+/*
+ * Hand over a client waiting for the data of a session to be available to
+ * the data pending thread. The thread replies to the client on `sock` once
+ * the session has no data pending and owns `sock` on success. The wait is
+ * cancelled, without a reply, when the client closes its end of `sock`.
+ *
+ * Return 0 on success, a negative value on error.
+ */
+int data_pending_thread_add_waiter(struct ltt_session *session, int sock);
+
+/*
+ * Wake the data pending thread for it to check the sessions being waited
+ * for without delay, e.g. when a session's rotation completes.
+ */
+void data_pending_thread_wake(void);
+
+#endif /* LTTNG_SESSIOND_DATA_PENDING_THREAD_H */
@@ -145,13 +145,19 @@ end:
 /*
  * Enable UST tracepoint event for a channel from a UST session.
  * We own filter_expression, filter, and exclusion.
+ *
+ * When `created_uevents` is not NULL, an event created while the session is
+ * active is not created on the registered applications; it is added to
+ * `created_uevents` for the caller to create it along with the other events
+ * of its batch (see ust_app_create_events_glb()).
  */
 int event_ust_enable_tracepoint(struct ltt_ust_session *usess,
 		struct ltt_ust_channel *uchan, struct lttng_event *event,
 		char *filter_expression,
 		struct lttng_filter_bytecode *filter,
 		struct lttng_event_exclusion *exclusion,
-		bool internal_event)
+		bool internal_event,
+		struct lttng_dynamic_pointer_array *created_uevents)
 {
 	int ret = LTTNG_OK, to_create = 0;
 	struct ltt_ust_event *uevent;
@@ -187,6 +193,15 @@ int event_ust_enable_tracepoint(struct ltt_ust_session *usess,
 		goto end;
 	}
 
+	if (to_create && created_uevents && usess->active) {
+		/* Done before adding the event to the channel to ease cleanup. */
+		if (lttng_dynamic_pointer_array_add_pointer(created_uevents,
+				uevent)) {
+			ret = LTTNG_ERR_NOMEM;
+			goto error;
+		}
+	}
+
 	uevent->enabled = 1;
 	if (to_create) {
 		/* Add ltt ust event to channel */
@@ -197,6 +212,14 @@ int event_ust_enable_tracepoint(struct ltt_ust_session *usess,
 		goto end;
 	}
 
+	if (to_create && created_uevents) {
+		/* Created on the applications by the caller. */
+		DBG("Event UST %s created in channel %s", uevent->attr.name,
+				uchan->name);
+		ret = LTTNG_OK;
+		goto end;
+	}
+
 	if (to_create) {
 		/* Create event on all UST registered apps for session */
 		ret = ust_app_create_event_glb(usess, uchan, uevent);
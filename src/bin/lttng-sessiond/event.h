@@ -8,6 +8,8 @@
 #ifndef _LTT_EVENT_H
 #define _LTT_EVENT_H
 
+#include <common/dynamic-array.h>
+
 #include "trace-kernel.h"
 
 struct agent;
@@ -24,7 +26,8 @@ int event_ust_enable_tracepoint(struct ltt_ust_session *usess,
 		char *filter_expression,
 		struct lttng_filter_bytecode *filter,
 		struct lttng_event_exclusion *exclusion,
-		bool internal_event);
+		bool internal_event,
+		struct lttng_dynamic_pointer_array *created_uevents);
 int event_ust_disable_tracepoint(struct ltt_ust_session *usess,
 		struct ltt_ust_channel *uchan, const char *event_name);
 
@@ -64,6 +64,7 @@
 #include "notification-thread.h"
 #include "notification-thread-commands.h"
 #include "rotation-thread.h"
+#include "data-pending-thread.h"
 #include "agent.h"
 #include "ht-cleanup.h"
 #include "sessiond-config.h"
@@ -1674,6 +1675,12 @@ int main(int argc, char **argv)
 		goto stop_threads;
 	}
 
+	/* Create thread replying to clients waiting for data availability. */
+	if (!launch_data_pending_thread()) {
+		retval = -1;
+		goto stop_threads;
+	}
+
 	/* Create thread to manage the client socket */
 	client_thread = launch_client_thread();
 	if (!client_thread) {
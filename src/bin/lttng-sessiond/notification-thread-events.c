@@ -3926,12 +3926,18 @@ end:
 	return ret;
 }
 
-int handle_notification_thread_channel_sample(
-		struct notification_thread_state *state, int pipe,
+/*
+ * Update the state of a channel from its latest sample and evaluate the
+ * conditions of the triggers associated with the channel.
+ *
+ * Must be called with the RCU read lock held.
+ */
+static
+int handle_channel_sample(struct notification_thread_state *state,
+		const struct lttcomm_consumer_channel_monitor_msg *sample_msg,
 		enum lttng_domain_type domain)
 {
 	int ret = 0;
-	struct lttcomm_consumer_channel_monitor_msg sample_msg;
 	struct channel_info *channel_info;
 	struct cds_lfht_node *node;
 	struct cds_lfht_iter iter;
@@ -3942,26 +3948,11 @@ int handle_notification_thread_channel_sample(
 	uint64_t previous_session_consumed_total, latest_session_consumed_total;
 	struct lttng_credentials channel_creds;
 
-	/*
-	 * The monitoring pipe only holds messages smaller than PIPE_BUF,
-	 * ensuring that read/write of sampling messages are atomic.
-	 */
-	ret = lttng_read(pipe, &sample_msg, sizeof(sample_msg));
-	if (ret != sizeof(sample_msg)) {
-		ERR("[notification-thread] Failed to read from monitoring pipe (fd = %i)",
-				pipe);
-		ret = -1;
-		goto end;
-	}
-
-	ret = 0;
-	latest_sample.key.key = sample_msg.key;
+	latest_sample.key.key = sample_msg->key;
 	latest_sample.key.domain = domain;
-	latest_sample.highest_usage = sample_msg.highest;
-	latest_sample.lowest_usage = sample_msg.lowest;
-	latest_sample.channel_total_consumed = sample_msg.total_consumed;
-
-	rcu_read_lock();
+	latest_sample.highest_usage = sample_msg->highest;
+	latest_sample.lowest_usage = sample_msg->lowest;
+	latest_sample.channel_total_consumed = sample_msg->total_consumed;
 
 	/* Retrieve the channel's informations */
 	cds_lfht_lookup(state->channels_ht,
@@ -3981,7 +3972,7 @@ int handle_notification_thread_channel_sample(
 				latest_sample.key.key,
 				domain == LTTNG_DOMAIN_KERNEL ? "kernel" :
 					"user space");
-		goto end_unlock;
+		goto end;
 	}
 	channel_info = caa_container_of(node, struct channel_info,
 			channels_ht_node);
@@ -4031,7 +4022,7 @@ int handle_notification_thread_channel_sample(
 		stored_sample = zmalloc(sizeof(*stored_sample));
 		if (!stored_sample) {
 			ret = -1;
-			goto end_unlock;
+			goto end;
 		}
 
 		memcpy(stored_sample, &latest_sample, sizeof(*stored_sample));
@@ -4056,7 +4047,7 @@ int handle_notification_thread_channel_sample(
 			&iter);
 	node = cds_lfht_iter_get_node(&iter);
 	if (caa_likely(!node)) {
-		goto end_unlock;
+		goto end;
 	}
 
 	channel_creds = (typeof(channel_creds)) {
@@ -4139,7 +4130,61 @@ put_list:
 			break;
 		}
 	}
-end_unlock:
+end:
+	return ret;
+}
+
+int handle_notification_thread_channel_sample(
+		struct notification_thread_state *state, int pipe,
+		enum lttng_domain_type domain)
+{
+	int ret = 0;
+	uint32_t i;
+	struct lttcomm_consumer_channel_monitor_batch_msg batch_msg;
+	struct lttcomm_consumer_channel_monitor_msg
+			samples[LTTCOMM_CONSUMER_CHANNEL_MONITOR_BATCH_MAX_SAMPLES];
+	size_t samples_size;
+
+	/*
+	 * The monitoring pipe only holds messages smaller than PIPE_BUF,
+	 * ensuring that read/write of sampling batches are atomic.
+	 */
+	ret = lttng_read(pipe, &batch_msg, sizeof(batch_msg));
+	if (ret != sizeof(batch_msg)) {
+		ERR("[notification-thread] Failed to read from monitoring pipe (fd = %i)",
+				pipe);
+		ret = -1;
+		goto end;
+	}
+
+	if (batch_msg.sample_count >
+			LTTCOMM_CONSUMER_CHANNEL_MONITOR_BATCH_MAX_SAMPLES) {
+		ERR("[notification-thread] Invalid channel sample batch size received from monitoring pipe (fd = %i, sample count = %" PRIu32 ")",
+				pipe, batch_msg.sample_count);
+		ret = -1;
+		goto end;
+	}
+
+	samples_size = batch_msg.sample_count * sizeof(samples[0]);
+	ret = lttng_read(pipe, samples, samples_size);
+	if (ret != samples_size) {
+		ERR("[notification-thread] Failed to read from monitoring pipe (fd = %i)",
+				pipe);
+		ret = -1;
+		goto end;
+	}
+
+	ret = 0;
+	rcu_read_lock();
+	for (i = 0; i < batch_msg.sample_count; i++) {
+		/* A sample that can't be handled doesn't affect the others. */
+		const int sample_ret = handle_channel_sample(state, &samples[i],
+				domain);
+
+		if (sample_ret && !ret) {
+			ret = sample_ret;
+		}
+	}
 	rcu_read_unlock();
 end:
 	return ret;
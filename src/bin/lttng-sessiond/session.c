@@ -30,6 +30,7 @@
 #include "trace-ust.h"
 #include "timer.h"
 #include "cmd.h"
+#include "data-pending-thread.h"
 
 struct ltt_session_destroy_notifier_element {
 	ltt_session_destroy_notifier notifier;
@@ -58,6 +59,7 @@ struct ltt_session_clear_notifier_element {
 static struct ltt_session_list ltt_session_list = {
 	.head = CDS_LIST_HEAD_INIT(ltt_session_list.head),
 	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.membership_lock = PTHREAD_MUTEX_INITIALIZER,
 	.removal_cond = PTHREAD_COND_INITIALIZER,
 	.next_uuid = 0,
 };
@@ -67,6 +69,8 @@ static const char *forbidden_name_chars = "/";
 
 /* Global hash table to keep the sessions, indexed by id. */
 static struct lttng_ht *ltt_sessions_ht_by_id = NULL;
+/* Global hash table of the sessions that are not destroyed, indexed by name. */
+static struct lttng_ht *ltt_sessions_ht_by_name = NULL;
 
 /*
  * Validate the session name for forbidden characters.
@@ -111,7 +115,9 @@ static uint64_t add_session_list(struct ltt_session *ls)
 {
 	assert(ls);
 
+	pthread_mutex_lock(&ltt_session_list.membership_lock);
 	cds_list_add(&ls->list, &ltt_session_list.head);
+	pthread_mutex_unlock(&ltt_session_list.membership_lock);
 	return ltt_session_list.next_uuid++;
 }
 
@@ -124,7 +130,9 @@ static void del_session_list(struct ltt_session *ls)
 {
 	assert(ls);
 
+	pthread_mutex_lock(&ltt_session_list.membership_lock);
 	cds_list_del(&ls->list);
+	pthread_mutex_unlock(&ltt_session_list.membership_lock);
 }
 
 /*
@@ -293,9 +301,9 @@ end:
 }
 
 /*
- * Allocate the ltt_sessions_ht_by_id HT.
+ * Allocate the ltt_sessions_ht_by_id and ltt_sessions_ht_by_name HTs.
  *
- * The session list lock must be held.
+ * The session list and membership locks must be held.
  */
 static int ltt_sessions_ht_alloc(void)
 {
@@ -308,14 +316,24 @@ static int ltt_sessions_ht_alloc(void)
 		ERR("Failed to allocate ltt_sessions_ht_by_id");
 		goto end;
 	}
+
+	DBG("Allocating ltt_sessions_ht_by_name");
+	ltt_sessions_ht_by_name = lttng_ht_new(0, LTTNG_HT_TYPE_STRING);
+	if (!ltt_sessions_ht_by_name) {
+		ret = -1;
+		ERR("Failed to allocate ltt_sessions_ht_by_name");
+		ht_cleanup_push(ltt_sessions_ht_by_id);
+		ltt_sessions_ht_by_id = NULL;
+		goto end;
+	}
 end:
 	return ret;
 }
 
 /*
- * Destroy the ltt_sessions_ht_by_id HT.
+ * Destroy the ltt_sessions_ht_by_id and ltt_sessions_ht_by_name HTs.
  *
- * The session list lock must be held.
+ * The session list and membership locks must be held.
  */
 static void ltt_sessions_ht_destroy(void)
 {
@@ -324,11 +342,13 @@ static void ltt_sessions_ht_destroy(void)
 	}
 	ht_cleanup_push(ltt_sessions_ht_by_id);
 	ltt_sessions_ht_by_id = NULL;
+	ht_cleanup_push(ltt_sessions_ht_by_name);
+	ltt_sessions_ht_by_name = NULL;
 }
 
 /*
- * Add a ltt_session to the ltt_sessions_ht_by_id.
- * If unallocated, the ltt_sessions_ht_by_id HT is allocated.
+ * Add a ltt_session to the ltt_sessions_ht_by_id and ltt_sessions_ht_by_name.
+ * If unallocated, the HTs are allocated.
  * The session list lock must be held.
  */
 static void add_session_ht(struct ltt_session *ls)
@@ -337,6 +357,7 @@ static void add_session_ht(struct ltt_session *ls)
 
 	assert(ls);
 
+	pthread_mutex_lock(&ltt_session_list.membership_lock);
 	if (!ltt_sessions_ht_by_id) {
 		ret = ltt_sessions_ht_alloc();
 		if (ret) {
@@ -346,8 +367,11 @@ static void add_session_ht(struct ltt_session *ls)
 	}
 	lttng_ht_node_init_u64(&ls->node, ls->id);
 	lttng_ht_add_unique_u64(ltt_sessions_ht_by_id, &ls->node);
+	lttng_ht_node_init_str(&ls->node_by_name, ls->name);
+	lttng_ht_add_unique_str(ltt_sessions_ht_by_name, &ls->node_by_name);
 
 end:
+	pthread_mutex_unlock(&ltt_session_list.membership_lock);
 	return;
 }
 
@@ -371,8 +395,26 @@ end:
 }
 
 /*
- * Remove a ltt_session from the ltt_sessions_ht_by_id.
- * If empty, the ltt_sessions_ht_by_id HT is freed.
+ * Remove a ltt_session from the ltt_sessions_ht_by_name.
+ * The session list and membership locks must be held.
+ */
+static void del_session_name_ht(struct ltt_session *ls)
+{
+	struct lttng_ht_iter iter;
+	int ret;
+
+	assert(ls);
+	assert(ltt_sessions_ht_by_name);
+
+	iter.iter.node = &ls->node_by_name.node;
+	ret = lttng_ht_del(ltt_sessions_ht_by_name, &iter);
+	assert(!ret);
+}
+
+/*
+ * Remove a ltt_session from the ltt_sessions_ht_by_id and, unless it was
+ * destroyed, from the ltt_sessions_ht_by_name.
+ * If empty, the HTs are freed.
  * The session list lock must be held.
  */
 static void del_session_ht(struct ltt_session *ls)
@@ -383,14 +425,20 @@ static void del_session_ht(struct ltt_session *ls)
 	assert(ls);
 	assert(ltt_sessions_ht_by_id);
 
+	pthread_mutex_lock(&ltt_session_list.membership_lock);
 	iter.iter.node = &ls->node.node;
 	ret = lttng_ht_del(ltt_sessions_ht_by_id, &iter);
 	assert(!ret);
 
+	if (!ls->destroyed) {
+		del_session_name_ht(ls);
+	}
+
 	if (ltt_sessions_ht_empty()) {
 		DBG("Empty ltt_sessions_ht_by_id, destroying it");
 		ltt_sessions_ht_destroy();
 	}
+	pthread_mutex_unlock(&ltt_session_list.membership_lock);
 }
 
 /*
@@ -1019,6 +1067,36 @@ void session_put(struct ltt_session *session)
 	urcu_ref_put(&session->ref, session_release);
 }
 
+/*
+ * Release a reference to a session without holding the session list lock.
+ *
+ * The session list lock is only acquired when the last reference is released,
+ * as the session is then removed from the session list.
+ */
+void session_put_no_list_lock(struct ltt_session *session)
+{
+	long refcount;
+
+	if (!session) {
+		return;
+	}
+
+	refcount = uatomic_read(&session->ref.refcount);
+	while (refcount > 1) {
+		const long old_refcount = uatomic_cmpxchg(&session->ref.refcount,
+				refcount, refcount - 1);
+
+		if (old_refcount == refcount) {
+			return;
+		}
+		refcount = old_refcount;
+	}
+
+	session_lock_list();
+	session_put(session);
+	session_unlock_list();
+}
+
 /*
  * Destroy a session.
  *
@@ -1033,7 +1111,15 @@ void session_put(struct ltt_session *session)
 void session_destroy(struct ltt_session *session)
 {
 	assert(!session->destroyed);
-	session->destroyed = true;
+	pthread_mutex_lock(&ltt_session_list.membership_lock);
+	if (session->published) {
+		/* The session's name can be reused from now on. */
+		del_session_name_ht(session);
+	}
+	CMM_STORE_SHARED(session->destroyed, true);
+	pthread_mutex_unlock(&ltt_session_list.membership_lock);
+	/* Release the references held by clients waiting for its data. */
+	data_pending_thread_wake();
 	session_put(session);
 }
 
@@ -1061,6 +1147,38 @@ int session_add_clear_notifier(struct ltt_session *session,
 			&element);
 }
 
+/*
+ * Look up a session that is not destroyed by name.
+ *
+ * Must be called with the session list lock or membership lock held.
+ */
+static struct ltt_session *find_session_by_name(const char *name)
+{
+	struct lttng_ht_node_str *node;
+	struct lttng_ht_iter iter;
+	struct ltt_session *session = NULL;
+
+	DBG2("Trying to find session by name %s", name);
+
+	/* A name that is too long can't match any session. */
+	if (!ltt_sessions_ht_by_name || strnlen(name, NAME_MAX) == NAME_MAX) {
+		goto end;
+	}
+
+	rcu_read_lock();
+	lttng_ht_lookup(ltt_sessions_ht_by_name, name, &iter);
+	node = lttng_ht_iter_get_node_str(&iter);
+	if (node) {
+		struct ltt_session *candidate = caa_container_of(node,
+				struct ltt_session, node_by_name);
+
+		session = session_get(candidate) ? candidate : NULL;
+	}
+	rcu_read_unlock();
+end:
+	return session;
+}
+
 /*
  * Return a ltt_session structure ptr that matches name. If no session found,
  * NULL is returned. This must be called with the session list lock held using
@@ -1069,23 +1187,31 @@ int session_add_clear_notifier(struct ltt_session *session,
  */
 struct ltt_session *session_find_by_name(const char *name)
 {
-	struct ltt_session *iter;
-
 	assert(name);
 	ASSERT_LOCKED(ltt_session_list.lock);
 
-	DBG2("Trying to find session by name %s", name);
+	return find_session_by_name(name);
+}
 
-	cds_list_for_each_entry(iter, &ltt_session_list.head, list) {
-		if (!strncmp(iter->name, name, NAME_MAX) &&
-				!iter->destroyed) {
-			goto found;
-		}
-	}
+/*
+ * Same as session_find_by_name(), but must be called without the session list
+ * lock held: the search is not blocked by the commands holding that lock.
+ *
+ * The reference to the session must be released using
+ * session_put_no_list_lock(). As the session may be destroyed concurrently,
+ * the caller must check its "destroyed" flag once its lock is acquired.
+ */
+struct ltt_session *session_find_by_name_no_list_lock(const char *name)
+{
+	struct ltt_session *session;
 
-	return NULL;
-found:
-	return session_get(iter) ? iter : NULL;
+	assert(name);
+
+	pthread_mutex_lock(&ltt_session_list.membership_lock);
+	session = find_session_by_name(name);
+	pthread_mutex_unlock(&ltt_session_list.membership_lock);
+
+	return session;
 }
 
 /*
@@ -1329,6 +1455,8 @@ int session_reset_rotation_state(struct ltt_session *session,
 	ASSERT_LOCKED(session->lock);
 
 	session->rotation_state = result;
+	/* The session's data may have become available. */
+	data_pending_thread_wake();
 	if (session->rotation_pending_check_timer_enabled) {
 		ret = timer_session_rotation_pending_check_stop(session);
 	}
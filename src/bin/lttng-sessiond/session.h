@@ -44,6 +44,13 @@ struct ltt_session_list {
 	 * iterate or/and do any actions on that list.
 	 */
 	pthread_mutex_t lock;
+	/*
+	 * Protects the additions to and removals from the list and the session
+	 * hash tables, which are performed with both locks held. Held alone, it
+	 * allows sessions to be looked up while `lock` is held by another thread
+	 * for the duration of a command. Nests inside `lock`.
+	 */
+	pthread_mutex_t membership_lock;
 	/*
 	 * This condition variable is signaled on every removal from
 	 * the session list.
@@ -145,6 +152,11 @@ struct ltt_session {
 	 * Node in ltt_sessions_ht_by_id.
 	 */
 	struct lttng_ht_node_u64 node;
+	/*
+	 * Node in ltt_sessions_ht_by_name, which only contains the sessions
+	 * that are not destroyed.
+	 */
+	struct lttng_ht_node_str node_by_name;
 	/*
 	 * Timer to check periodically if a relay and/or consumer has completed
 	 * the last rotation.
@@ -223,6 +235,7 @@ void session_notify_clear(struct ltt_session *session);
 
 bool session_get(struct ltt_session *session);
 void session_put(struct ltt_session *session);
+void session_put_no_list_lock(struct ltt_session *session);
 
 enum consumer_dst_type session_get_consumer_destination_type(
 		const struct ltt_session *session);
@@ -235,6 +248,7 @@ struct lttng_trace_archive_location *session_get_trace_archive_location(
 		const struct ltt_session *session);
 
 struct ltt_session *session_find_by_name(const char *name);
+struct ltt_session *session_find_by_name_no_list_lock(const char *name);
 struct ltt_session *session_find_by_id(uint64_t id);
 
 struct ltt_session_list *session_get_list(void);
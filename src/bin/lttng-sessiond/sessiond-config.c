@@ -25,6 +25,8 @@ struct sessiond_config sessiond_config_build_defaults = {
 
 	.agent_tcp_port = 			{ .begin = DEFAULT_AGENT_TCP_PORT_RANGE_BEGIN, .end = DEFAULT_AGENT_TCP_PORT_RANGE_END },
 	.app_socket_timeout = 			DEFAULT_APP_SOCKET_RW_TIMEOUT,
+	.app_update_thread_count =		DEFAULT_APP_UPDATE_THREAD_COUNT,
+	.client_query_thread_count =		DEFAULT_CLIENT_QUERY_THREAD_COUNT,
 
 	.no_kernel = 				false,
 	.background = 				false,
@@ -116,6 +118,41 @@ int sessiond_config_apply_env_config(struct sessiond_config *config)
 		config->app_socket_timeout = int_val;
 	}
 
+	env_value = getenv(DEFAULT_APP_UPDATE_THREAD_COUNT_ENV);
+	if (env_value) {
+		char *endptr;
+		unsigned long count;
+
+		errno = 0;
+		count = strtoul(env_value, &endptr, 0);
+		if (errno != 0 || *endptr != '\0' || count == 0 ||
+				count > UINT_MAX) {
+			ERR("Invalid value \"%s\" used for \"%s\" environment variable",
+					env_value, DEFAULT_APP_UPDATE_THREAD_COUNT_ENV);
+			ret = -1;
+			goto end;
+		}
+
+		config->app_update_thread_count = (unsigned int) count;
+	}
+
+	env_value = getenv(DEFAULT_CLIENT_QUERY_THREAD_COUNT_ENV);
+	if (env_value) {
+		char *endptr;
+		unsigned long count;
+
+		errno = 0;
+		count = strtoul(env_value, &endptr, 0);
+		if (errno != 0 || *endptr != '\0' || count > UINT_MAX) {
+			ERR("Invalid value \"%s\" used for \"%s\" environment variable",
+					env_value, DEFAULT_CLIENT_QUERY_THREAD_COUNT_ENV);
+			ret = -1;
+			goto end;
+		}
+
+		config->client_query_thread_count = (unsigned int) count;
+	}
+
 	env_value = lttng_secure_getenv("LTTNG_CONSUMERD32_BIN");
 	if (env_value) {
 		config_string_set_static(&config->consumerd32_bin_path,
@@ -512,6 +549,8 @@ void sessiond_config_log(struct sessiond_config *config)
 				config->agent_tcp_port.end);
 	}
 	DBG_NO_LOC("\tapplication socket timeout:    %i", config->app_socket_timeout);
+	DBG_NO_LOC("\tapplication update threads:    %u", config->app_update_thread_count);
+	DBG_NO_LOC("\tclient query threads:          %u", config->client_query_thread_count);
 	DBG_NO_LOC("\tno-kernel:                     %s", config->no_kernel ? "True" : "False");
 	DBG_NO_LOC("\tbackground:                    %s", config->background ? "True" : "False");
 	DBG_NO_LOC("\tdaemonize:                     %s", config->daemonize ? "True" : "False");
@@ -31,6 +31,10 @@ struct sessiond_config {
 	struct config_int_range agent_tcp_port;
 	/* Socket timeout for receiving and sending (in seconds). */
 	int app_socket_timeout;
+	/* Maximal number of threads updating the applications concurrently. */
+	unsigned int app_update_thread_count;
+	/* Number of threads processing the client queries concurrently. */
+	unsigned int client_query_thread_count;
 
 	bool quiet;
 	bool no_kernel;
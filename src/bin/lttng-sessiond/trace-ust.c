@@ -298,6 +298,7 @@ struct ltt_ust_session *trace_ust_create_session(uint64_t session_id)
 	lus->buffer_type_changed = 0;
 	/* Init it in case it get used after allocation. */
 	CDS_INIT_LIST_HEAD(&lus->buffer_reg_uid_list);
+	pthread_mutex_init(&lus->buffer_reg_uid_lock, NULL);
 
 	/* Alloc UST global domain channels' HT */
 	lus->domain_global.channels = lttng_ht_new(0, LTTNG_HT_TYPE_STRING);
@@ -331,6 +332,7 @@ error:
 	process_attr_tracker_destroy(lus->tracker_vgid);
 	ht_cleanup_push(lus->domain_global.channels);
 	ht_cleanup_push(lus->agents);
+	pthread_mutex_destroy(&lus->buffer_reg_uid_lock);
 	free(lus);
 error_alloc:
 	return NULL;
@@ -1275,6 +1277,27 @@ static void destroy_event_rcu(struct rcu_head *head)
 	trace_ust_destroy_event(event);
 }
 
+/*
+ * Remove an event from the events hashtable of its channel and destroy it
+ * once no RCU reader can see it.
+ *
+ * RCU read side lock must be acquired before calling this function.
+ */
+void trace_ust_delete_event(struct lttng_ht *events,
+		struct ltt_ust_event *event)
+{
+	int ret;
+	struct lttng_ht_iter iter;
+
+	assert(events);
+	assert(event);
+
+	iter.iter.node = &event->node.node;
+	ret = lttng_ht_del(events, &iter);
+	assert(!ret);
+	call_rcu(&event->node.head, destroy_event_rcu);
+}
+
 /*
  * Cleanup UST events hashtable.
  */
@@ -1436,5 +1459,6 @@ void trace_ust_destroy_session(struct ltt_ust_session *session)
 void trace_ust_free_session(struct ltt_ust_session *session)
 {
 	consumer_output_put(session->consumer);
+	pthread_mutex_destroy(&session->buffer_reg_uid_lock);
 	free(session);
 }
@@ -10,6 +10,7 @@
 #define _LTT_TRACE_UST_H
 
 #include <limits.h>
+#include <pthread.h>
 #include <urcu/list.h>
 
 #include <common/defaults.h>
@@ -110,6 +111,11 @@ struct ltt_ust_session {
 	int buffer_type_changed;
 	/* For per UID buffer, every buffer reg object is kept of this session */
 	struct cds_list_head buffer_reg_uid_list;
+	/*
+	 * Protects the creation of the per UID buffer registries and of their
+	 * channels when applications are updated concurrently.
+	 */
+	pthread_mutex_t buffer_reg_uid_lock;
 	/* Next channel ID available for a newly registered channel. */
 	uint64_t next_channel_id;
 	/* Once this value reaches UINT32_MAX, no more id can be allocated. */
@@ -215,6 +221,8 @@ void trace_ust_delete_channel(struct lttng_ht *ht,
 void trace_ust_destroy_session(struct ltt_ust_session *session);
 void trace_ust_destroy_channel(struct ltt_ust_channel *channel);
 void trace_ust_destroy_event(struct ltt_ust_event *event);
+void trace_ust_delete_event(struct lttng_ht *events,
+		struct ltt_ust_event *event);
 void trace_ust_destroy_context(struct ltt_ust_context *ctx);
 void trace_ust_free_session(struct ltt_ust_session *session);
 
@@ -291,6 +299,12 @@ void trace_ust_destroy_event(struct ltt_ust_event *event)
 {
 }
 
+static inline
+void trace_ust_delete_event(struct lttng_ht *events,
+		struct ltt_ust_event *event)
+{
+}
+
 static inline
 void trace_ust_free_session(struct ltt_ust_session *session)
 {
@@ -20,6 +20,8 @@
 
 #include <common/compat/errno.h>
 #include <common/common.h>
+#include <common/dynamic-array.h>
+#include <common/hashtable/utils.h>
 #include <common/sessiond-comm/sessiond-comm.h>
 
 #include "buffer-registry.h"
@@ -285,6 +287,149 @@ void delete_ust_app_ctx(int sock, struct ust_app_ctx *ua_ctx,
 	free(ua_ctx);
 }
 
+/*
+ * Filter bytecodes and event exclusions shared by the ust_app_event objects
+ * of all applications.
+ *
+ * The same event rules are applied to every application of a session: rather
+ * than copying the filter and the exclusions of an event for every
+ * application, and once again when they are sent to it, the ust_app_event
+ * objects reference a single, immutable, copy of these payloads. Payloads are
+ * reference counted and indexed by content.
+ *
+ * The lock protects the reference counts and the updates of the hash table.
+ * The hash table is allocated on first use and lives as long as the session
+ * daemon.
+ */
+struct ust_app_shared_payload {
+	struct cds_lfht_node node;
+	struct rcu_head rcu_head;
+	/* Protected by the shared payloads' lock. */
+	unsigned int refcount;
+	size_t len;
+	/* Aligned to satisfy the alignment requirements of any payload. */
+	uint64_t data[];
+};
+
+struct ust_app_shared_payload_key {
+	const void *data;
+	size_t len;
+};
+
+static struct {
+	pthread_mutex_t lock;
+	struct cds_lfht *ht;
+} shared_payloads = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static
+int match_shared_payload(struct cds_lfht_node *node, const void *_key)
+{
+	const struct ust_app_shared_payload_key *key = _key;
+	const struct ust_app_shared_payload *payload = caa_container_of(node,
+			struct ust_app_shared_payload, node);
+
+	return payload->len == key->len &&
+			memcmp(payload->data, key->data, key->len) == 0;
+}
+
+static
+void free_shared_payload_rcu(struct rcu_head *head)
+{
+	struct ust_app_shared_payload *payload = caa_container_of(head,
+			struct ust_app_shared_payload, rcu_head);
+
+	free(payload);
+}
+
+/*
+ * Get a reference to the shared copy of the `len` bytes of `data`, creating
+ * it if needed.
+ *
+ * The shared copy must not be modified and must be released using
+ * put_shared_payload().
+ *
+ * Return the shared copy or NULL on error.
+ */
+static
+void *get_shared_payload(const void *data, size_t len)
+{
+	struct ust_app_shared_payload *payload = NULL;
+	struct cds_lfht_node *node;
+	struct cds_lfht_iter iter;
+	const struct ust_app_shared_payload_key key = {
+		.data = data,
+		.len = len,
+	};
+	const unsigned long hash = hash_key_bytes(data, len, lttng_ht_seed);
+
+	pthread_mutex_lock(&shared_payloads.lock);
+	if (!shared_payloads.ht) {
+		shared_payloads.ht = cds_lfht_new(DEFAULT_HT_SIZE, 1, 0,
+				CDS_LFHT_AUTO_RESIZE | CDS_LFHT_ACCOUNTING, NULL);
+		if (!shared_payloads.ht) {
+			ERR("Failed to allocate shared payloads hash table");
+			goto end;
+		}
+	}
+
+	rcu_read_lock();
+	cds_lfht_lookup(shared_payloads.ht, hash, match_shared_payload, &key,
+			&iter);
+	node = cds_lfht_iter_get_node(&iter);
+	if (node) {
+		payload = caa_container_of(node, struct ust_app_shared_payload,
+				node);
+		payload->refcount++;
+		goto end_unlock_rcu;
+	}
+
+	payload = zmalloc(sizeof(*payload) + len);
+	if (!payload) {
+		PERROR("zmalloc shared payload");
+		goto end_unlock_rcu;
+	}
+
+	cds_lfht_node_init(&payload->node);
+	payload->refcount = 1;
+	payload->len = len;
+	memcpy(payload->data, data, len);
+	cds_lfht_add(shared_payloads.ht, hash, &payload->node);
+end_unlock_rcu:
+	rcu_read_unlock();
+end:
+	pthread_mutex_unlock(&shared_payloads.lock);
+	return payload ? payload->data : NULL;
+}
+
+/*
+ * Release a reference obtained through get_shared_payload(). NULL is a no-op.
+ */
+static
+void put_shared_payload(void *data)
+{
+	struct ust_app_shared_payload *payload;
+
+	if (!data) {
+		return;
+	}
+
+	payload = caa_container_of(data, struct ust_app_shared_payload, data);
+	pthread_mutex_lock(&shared_payloads.lock);
+	assert(payload->refcount > 0);
+	if (--payload->refcount == 0) {
+		int ret;
+
+		rcu_read_lock();
+		ret = cds_lfht_del(shared_payloads.ht, &payload->node);
+		assert(!ret);
+		rcu_read_unlock();
+		call_rcu(&payload->rcu_head, free_shared_payload_rcu);
+	}
+	pthread_mutex_unlock(&shared_payloads.lock);
+}
+
 /*
  * Delete ust app event safely. RCU read lock must be held before calling
  * this function.
@@ -297,9 +442,8 @@ void delete_ust_app_event(int sock, struct ust_app_event *ua_event,
 
 	assert(ua_event);
 
-	free(ua_event->filter);
-	if (ua_event->exclusion != NULL)
-		free(ua_event->exclusion);
+	put_shared_payload(ua_event->filter);
+	put_shared_payload(ua_event->exclusion);
 	if (ua_event->obj != NULL) {
 		pthread_mutex_lock(&app->sock_lock);
 		ret = ustctl_release_object(sock, ua_event->obj);
@@ -1165,53 +1309,6 @@ error:
 	return NULL;
 }
 
-/*
- * Allocate a filter and copy the given original filter.
- *
- * Return allocated filter or NULL on error.
- */
-static struct lttng_filter_bytecode *copy_filter_bytecode(
-		struct lttng_filter_bytecode *orig_f)
-{
-	struct lttng_filter_bytecode *filter = NULL;
-
-	/* Copy filter bytecode */
-	filter = zmalloc(sizeof(*filter) + orig_f->len);
-	if (!filter) {
-		PERROR("zmalloc alloc filter bytecode");
-		goto error;
-	}
-
-	memcpy(filter, orig_f, sizeof(*filter) + orig_f->len);
-
-error:
-	return filter;
-}
-
-/*
- * Create a liblttng-ust filter bytecode from given bytecode.
- *
- * Return allocated filter or NULL on error.
- */
-static struct lttng_ust_filter_bytecode *create_ust_bytecode_from_bytecode(
-		struct lttng_filter_bytecode *orig_f)
-{
-	struct lttng_ust_filter_bytecode *filter = NULL;
-
-	/* Copy filter bytecode */
-	filter = zmalloc(sizeof(*filter) + orig_f->len);
-	if (!filter) {
-		PERROR("zmalloc alloc ust filter bytecode");
-		goto error;
-	}
-
-	assert(sizeof(struct lttng_filter_bytecode) ==
-			sizeof(struct lttng_ust_filter_bytecode));
-	memcpy(filter, orig_f, sizeof(*filter) + orig_f->len);
-error:
-	return filter;
-}
-
 /*
  * Find an ust_app using the sock and return it. RCU read side lock must be
  * held before calling this helper function.
@@ -1348,7 +1445,6 @@ int set_ust_event_filter(struct ust_app_event *ua_event,
 		struct ust_app *app)
 {
 	int ret;
-	struct lttng_ust_filter_bytecode *ust_bytecode = NULL;
 
 	health_code_update();
 
@@ -1357,13 +1453,15 @@ int set_ust_event_filter(struct ust_app_event *ua_event,
 		goto error;
 	}
 
-	ust_bytecode = create_ust_bytecode_from_bytecode(ua_event->filter);
-	if (!ust_bytecode) {
-		ret = -LTTNG_ERR_NOMEM;
-		goto error;
-	}
+	/*
+	 * lttng_filter_bytecode and lttng_ust_filter_bytecode have the same
+	 * layout. The shared filter is sent as-is.
+	 */
+	assert(sizeof(struct lttng_filter_bytecode) ==
+			sizeof(struct lttng_ust_filter_bytecode));
 	pthread_mutex_lock(&app->sock_lock);
-	ret = ustctl_set_filter(app->sock, ust_bytecode,
+	ret = ustctl_set_filter(app->sock,
+			(struct lttng_ust_filter_bytecode *) ua_event->filter,
 			ua_event->obj);
 	pthread_mutex_unlock(&app->sock_lock);
 	if (ret < 0) {
@@ -1386,31 +1484,9 @@ int set_ust_event_filter(struct ust_app_event *ua_event,
 
 error:
 	health_code_update();
-	free(ust_bytecode);
 	return ret;
 }
 
-static
-struct lttng_ust_event_exclusion *create_ust_exclusion_from_exclusion(
-		struct lttng_event_exclusion *exclusion)
-{
-	struct lttng_ust_event_exclusion *ust_exclusion = NULL;
-	size_t exclusion_alloc_size = sizeof(struct lttng_ust_event_exclusion) +
-		LTTNG_UST_SYM_NAME_LEN * exclusion->count;
-
-	ust_exclusion = zmalloc(exclusion_alloc_size);
-	if (!ust_exclusion) {
-		PERROR("malloc");
-		goto end;
-	}
-
-	assert(sizeof(struct lttng_event_exclusion) ==
-			sizeof(struct lttng_ust_event_exclusion));
-	memcpy(ust_exclusion, exclusion, exclusion_alloc_size);
-end:
-	return ust_exclusion;
-}
-
 /*
  * Set event exclusions on the tracer.
  */
@@ -1419,7 +1495,6 @@ int set_ust_event_exclusion(struct ust_app_event *ua_event,
 		struct ust_app *app)
 {
 	int ret;
-	struct lttng_ust_event_exclusion *ust_exclusion = NULL;
 
 	health_code_update();
 
@@ -1428,14 +1503,16 @@ int set_ust_event_exclusion(struct ust_app_event *ua_event,
 		goto error;
 	}
 
-	ust_exclusion = create_ust_exclusion_from_exclusion(
-			ua_event->exclusion);
-	if (!ust_exclusion) {
-		ret = -LTTNG_ERR_NOMEM;
-		goto error;
-	}
+	/*
+	 * lttng_event_exclusion and lttng_ust_event_exclusion have the same
+	 * layout. The shared exclusions are sent as-is.
+	 */
+	assert(sizeof(struct lttng_event_exclusion) ==
+			sizeof(struct lttng_ust_event_exclusion));
 	pthread_mutex_lock(&app->sock_lock);
-	ret = ustctl_set_exclusion(app->sock, ust_exclusion, ua_event->obj);
+	ret = ustctl_set_exclusion(app->sock,
+			(struct lttng_ust_event_exclusion *) ua_event->exclusion,
+			ua_event->obj);
 	pthread_mutex_unlock(&app->sock_lock);
 	if (ret < 0) {
 		if (ret != -EPIPE && ret != -LTTNG_UST_ERR_EXITING) {
@@ -1457,7 +1534,6 @@ int set_ust_event_exclusion(struct ust_app_event *ua_event,
 
 error:
 	health_code_update();
-	free(ust_exclusion);
 	return ret;
 }
 
@@ -1764,8 +1840,6 @@ error:
 static void shadow_copy_event(struct ust_app_event *ua_event,
 		struct ltt_ust_event *uevent)
 {
-	size_t exclusion_alloc_size;
-
 	strncpy(ua_event->name, uevent->attr.name, sizeof(ua_event->name));
 	ua_event->name[sizeof(ua_event->name) - 1] = '\0';
 
@@ -1774,23 +1848,18 @@ static void shadow_copy_event(struct ust_app_event *ua_event,
 	/* Copy event attributes */
 	memcpy(&ua_event->attr, &uevent->attr, sizeof(ua_event->attr));
 
-	/* Copy filter bytecode */
+	/* Reference the shared filter bytecode */
 	if (uevent->filter) {
-		ua_event->filter = copy_filter_bytecode(uevent->filter);
+		ua_event->filter = get_shared_payload(uevent->filter,
+				sizeof(*uevent->filter) + uevent->filter->len);
 		/* Filter might be NULL here in case of ENONEM. */
 	}
 
-	/* Copy exclusion data */
+	/* Reference the shared exclusion data */
 	if (uevent->exclusion) {
-		exclusion_alloc_size = sizeof(struct lttng_event_exclusion) +
-				LTTNG_UST_SYM_NAME_LEN * uevent->exclusion->count;
-		ua_event->exclusion = zmalloc(exclusion_alloc_size);
-		if (ua_event->exclusion == NULL) {
-			PERROR("malloc");
-		} else {
-			memcpy(ua_event->exclusion, uevent->exclusion,
-					exclusion_alloc_size);
-		}
+		ua_event->exclusion = get_shared_payload(uevent->exclusion,
+				sizeof(struct lttng_event_exclusion) +
+				LTTNG_UST_SYM_NAME_LEN * uevent->exclusion->count);
 	}
 }
 
@@ -2041,6 +2110,7 @@ static int setup_buffer_reg_uid(struct ltt_ust_session *usess,
 	assert(app);
 
 	rcu_read_lock();
+	pthread_mutex_lock(&usess->buffer_reg_uid_lock);
 
 	reg_uid = buffer_reg_uid_find(usess->id, app->bits_per_long, app->uid);
 	if (!reg_uid) {
@@ -2088,6 +2158,7 @@ end:
 		*regp = reg_uid;
 	}
 error:
+	pthread_mutex_unlock(&usess->buffer_reg_uid_lock);
 	rcu_read_unlock();
 	return ret;
 }
@@ -2826,6 +2897,11 @@ static int create_channel_per_uid(struct ust_app *app,
 	 */
 	assert(reg_uid);
 
+	/*
+	 * The channel's buffers are shared by the applications of the same
+	 * user, which may be updated concurrently.
+	 */
+	pthread_mutex_lock(&usess->buffer_reg_uid_lock);
 	reg_chan = buffer_reg_channel_find(ua_chan->tracing_channel_id,
 			reg_uid);
 	if (reg_chan) {
@@ -2837,7 +2913,7 @@ static int create_channel_per_uid(struct ust_app *app,
 	if (ret < 0) {
 		ERR("Error creating the UST channel \"%s\" registry instance",
 				ua_chan->name);
-		goto error;
+		goto error_unlock;
 	}
 
 	session = session_find_by_id(ua_sess->tracing_id);
@@ -2864,7 +2940,7 @@ static int create_channel_per_uid(struct ust_app *app,
 				ua_chan->tracing_channel_id, false);
 		buffer_reg_channel_remove(reg_uid->registry, reg_chan);
 		buffer_reg_channel_destroy(reg_chan, LTTNG_DOMAIN_UST);
-		goto error;
+		goto error_unlock;
 	}
 
 	/*
@@ -2874,7 +2950,7 @@ static int create_channel_per_uid(struct ust_app *app,
 			ua_chan, reg_chan, app);
 	if (ret < 0) {
 		ERR("Error setting up UST channel \"%s\"", ua_chan->name);
-		goto error;
+		goto error_unlock;
 	}
 
 	/* Notify the notification subsystem of the channel's creation. */
@@ -2896,20 +2972,24 @@ static int create_channel_per_uid(struct ust_app *app,
 	if (notification_ret != LTTNG_OK) {
 		ret = - (int) notification_ret;
 		ERR("Failed to add channel to notification thread");
-		goto error;
+		goto error_unlock;
 	}
 
 send_channel:
+	pthread_mutex_unlock(&usess->buffer_reg_uid_lock);
+
 	/* Send buffers to the application. */
 	ret = send_channel_uid_to_ust(reg_chan, app, ua_sess, ua_chan);
 	if (ret < 0) {
 		if (ret != -ENOTCONN) {
 			ERR("Error sending channel to application");
 		}
-		goto error;
 	}
+	goto end;
 
-error:
+error_unlock:
+	pthread_mutex_unlock(&usess->buffer_reg_uid_lock);
+end:
 	if (session) {
 		session_put(session);
 	}
@@ -4316,6 +4396,86 @@ int ust_app_create_event_glb(struct ltt_ust_session *usess,
 	return ret;
 }
 
+/*
+ * Create a batch of UST events, already added to a channel, on all the
+ * registered applications. The applications are iterated over once and each
+ * application's session is locked once for the whole batch.
+ */
+int ust_app_create_events_glb(struct ltt_ust_session *usess,
+		struct ltt_ust_channel *uchan,
+		const struct lttng_dynamic_pointer_array *uevents)
+{
+	int ret = 0;
+	size_t i;
+	const size_t uevent_count =
+			lttng_dynamic_pointer_array_get_count(uevents);
+	struct lttng_ht_iter iter, uiter;
+	struct lttng_ht_node_str *ua_chan_node;
+	struct ust_app *app;
+	struct ust_app_session *ua_sess;
+	struct ust_app_channel *ua_chan;
+
+	assert(usess->active);
+	DBG("UST app creating %zu events for all apps for session id %" PRIu64,
+			uevent_count, usess->id);
+
+	rcu_read_lock();
+
+	/* For all registered applications */
+	cds_lfht_for_each_entry(ust_app_ht->ht, &iter.iter, app, pid_n.node) {
+		if (!app->compatible) {
+			/*
+			 * TODO: In time, we should notice the caller of this error by
+			 * telling him that this is a version error.
+			 */
+			continue;
+		}
+		ua_sess = lookup_session_by_app(usess, app);
+		if (!ua_sess) {
+			/* The application has problem or is probably dead. */
+			continue;
+		}
+
+		pthread_mutex_lock(&ua_sess->lock);
+
+		if (ua_sess->deleted) {
+			pthread_mutex_unlock(&ua_sess->lock);
+			continue;
+		}
+
+		/* Lookup channel in the ust app session */
+		lttng_ht_lookup(ua_sess->channels, (void *)uchan->name, &uiter);
+		ua_chan_node = lttng_ht_iter_get_node_str(&uiter);
+		/* If the channel is not found, there is a code flow error */
+		assert(ua_chan_node);
+
+		ua_chan = caa_container_of(ua_chan_node, struct ust_app_channel, node);
+
+		for (i = 0; i < uevent_count; i++) {
+			struct ltt_ust_event *uevent =
+					lttng_dynamic_pointer_array_get_pointer(
+							uevents, i);
+
+			ret = create_ust_app_event(ua_sess, ua_chan, uevent, app);
+			if (ret == -LTTNG_UST_ERR_EXIST) {
+				DBG2("UST app event %s already exist on app PID %d",
+						uevent->attr.name, app->pid);
+				ret = 0;
+			} else if (ret < 0) {
+				break;
+			}
+		}
+		pthread_mutex_unlock(&ua_sess->lock);
+		if (ret < 0) {
+			/* Possible value at this point: -ENOMEM. If so, we stop! */
+			break;
+		}
+	}
+
+	rcu_read_unlock();
+	return ret;
+}
+
 /*
  * Start tracing for a specific UST session and app.
  *
@@ -4850,6 +5010,125 @@ end:
 	return 0;
 }
 
+/*
+ * A thread updating the tracing configuration of a subset of the registered
+ * applications. Each application is updated by a single thread.
+ */
+struct app_update_thread {
+	pthread_t thread;
+	bool launched;
+	struct ltt_ust_session *usess;
+	/* Applications to update (struct ust_app *). */
+	struct lttng_dynamic_pointer_array apps;
+};
+
+static void update_apps(struct ltt_ust_session *usess,
+		const struct lttng_dynamic_pointer_array *apps)
+{
+	size_t i;
+	const size_t count = lttng_dynamic_pointer_array_get_count(apps);
+
+	rcu_read_lock();
+	for (i = 0; i < count; i++) {
+		ust_app_global_update(usess,
+				lttng_dynamic_pointer_array_get_pointer(apps, i));
+	}
+	rcu_read_unlock();
+}
+
+static void *thread_update_apps(void *data)
+{
+	struct app_update_thread *thread = data;
+
+	rcu_register_thread();
+	update_apps(thread->usess, &thread->apps);
+	rcu_unregister_thread();
+	return NULL;
+}
+
+/*
+ * Update the tracing configuration of all registered applications for the
+ * session, using up to config.app_update_thread_count threads.
+ *
+ * The caller's RCU read-side critical section keeps the applications alive
+ * until all threads are joined, and the session lock held by the caller is
+ * relied upon by the update of each application.
+ *
+ * Called with session lock held.
+ * Called with RCU read-side lock held.
+ */
+static void global_update_all_apps(struct ltt_ust_session *usess)
+{
+	unsigned int i, thread_count = config.app_update_thread_count;
+	unsigned long app_index = 0;
+	struct app_update_thread *threads = NULL;
+	struct lttng_ht_iter iter;
+	struct ust_app *app;
+
+	if (thread_count > 1) {
+		thread_count = min_t(unsigned long, thread_count,
+				lttng_ht_get_count(ust_app_ht));
+	}
+	if (thread_count > 1) {
+		threads = zmalloc(thread_count * sizeof(*threads));
+		if (!threads) {
+			PERROR("Failed to allocate application update threads");
+		}
+	}
+	if (!threads) {
+		cds_lfht_for_each_entry(ust_app_ht->ht, &iter.iter, app,
+				pid_n.node) {
+			ust_app_global_update(usess, app);
+		}
+		return;
+	}
+
+	for (i = 0; i < thread_count; i++) {
+		threads[i].usess = usess;
+		lttng_dynamic_pointer_array_init(&threads[i].apps, NULL);
+	}
+
+	/* Spread the applications between the threads. */
+	cds_lfht_for_each_entry(ust_app_ht->ht, &iter.iter, app, pid_n.node) {
+		struct app_update_thread *thread =
+				&threads[app_index++ % thread_count];
+
+		if (lttng_dynamic_pointer_array_add_pointer(
+				&thread->apps, app)) {
+			ERR("Failed to queue the update of application pid %d, updating it synchronously",
+					app->pid);
+			ust_app_global_update(usess, app);
+		}
+	}
+
+	for (i = 0; i < thread_count; i++) {
+		int ret;
+
+		ret = pthread_create(&threads[i].thread, default_pthread_attr(),
+				thread_update_apps, &threads[i]);
+		if (ret) {
+			errno = ret;
+			PERROR("Failed to launch application update thread, updating its applications synchronously");
+			update_apps(usess, &threads[i].apps);
+			continue;
+		}
+		threads[i].launched = true;
+	}
+
+	for (i = 0; i < thread_count; i++) {
+		if (threads[i].launched) {
+			int ret = pthread_join(threads[i].thread, NULL);
+
+			if (ret) {
+				errno = ret;
+				PERROR("Failed to join application update thread");
+			}
+		}
+		lttng_dynamic_pointer_array_reset(&threads[i].apps);
+	}
+	free(threads);
+}
+
 /*
  * Start tracing for the UST session.
  */
@@ -4876,9 +5155,7 @@ int ust_app_start_trace_all(struct ltt_ust_session *usess)
 	 */
 	(void) ust_app_clear_quiescent_session(usess);
 
-	cds_lfht_for_each_entry(ust_app_ht->ht, &iter.iter, app, pid_n.node) {
-		ust_app_global_update(usess, app);
-	}
+	global_update_all_apps(usess);
 
 	rcu_read_unlock();
 
@@ -5148,13 +5425,8 @@ void ust_app_global_update(struct ltt_ust_session *usess, struct ust_app *app)
  */
 void ust_app_global_update_all(struct ltt_ust_session *usess)
 {
-	struct lttng_ht_iter iter;
-	struct ust_app *app;
-
 	rcu_read_lock();
-	cds_lfht_for_each_entry(ust_app_ht->ht, &iter.iter, app, pid_n.node) {
-		ust_app_global_update(usess, app);
-	}
+	global_update_all_apps(usess);
 	rcu_read_unlock();
 }
 
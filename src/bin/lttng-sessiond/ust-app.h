@@ -12,6 +12,7 @@
 #include <stdint.h>
 
 #include <common/uuid.h>
+#include <common/dynamic-array.h>
 
 #include "trace-ust.h"
 #include "ust-registry.h"
@@ -108,6 +109,7 @@ struct ust_app_event {
 	struct lttng_ust_event attr;
 	char name[LTTNG_UST_SYM_NAME_LEN];
 	struct lttng_ht_node_str node;
+	/* Shared with the other applications' events; must not be modified. */
 	struct lttng_filter_bytecode *filter;
 	struct lttng_event_exclusion *exclusion;
 };
@@ -307,6 +309,9 @@ int ust_app_list_events(struct lttng_event **events);
 int ust_app_list_event_fields(struct lttng_event_field **fields);
 int ust_app_create_event_glb(struct ltt_ust_session *usess,
 		struct ltt_ust_channel *uchan, struct ltt_ust_event *uevent);
+int ust_app_create_events_glb(struct ltt_ust_session *usess,
+		struct ltt_ust_channel *uchan,
+		const struct lttng_dynamic_pointer_array *uevents);
 int ust_app_disable_channel_glb(struct ltt_ust_session *usess,
 		struct ltt_ust_channel *uchan);
 int ust_app_enable_channel_glb(struct ltt_ust_session *usess,
@@ -462,6 +467,13 @@ int ust_app_create_event_glb(struct ltt_ust_session *usess,
 	return 0;
 }
 static inline
+int ust_app_create_events_glb(struct ltt_ust_session *usess,
+		struct ltt_ust_channel *uchan,
+		const struct lttng_dynamic_pointer_array *uevents)
+{
+	return 0;
+}
+static inline
 int ust_app_disable_event_glb(struct ltt_ust_session *usess,
 		struct ltt_ust_channel *uchan, struct ltt_ust_event *uevent)
 {
@@ -63,6 +63,8 @@ static int destroy_session(struct lttng_session *session)
 	enum lttng_error_code ret_code;
 	struct lttng_destruction_handle *handle = NULL;
 	enum lttng_destruction_handle_status status;
+	struct lttng_data_pending_handle *data_pending_handle = NULL;
+	enum lttng_data_pending_handle_status data_pending_status;
 	bool newline_needed = false, printed_destroy_msg = false;
 	enum lttng_rotation_state rotation_state;
 	char *stats_str = NULL;
@@ -74,32 +76,58 @@ static int destroy_session(struct lttng_session *session)
 
 	session_was_already_stopped = ret == -LTTNG_ERR_TRACE_ALREADY_STOPPED;
 	if (!opt_no_wait) {
-		do {
-			ret = lttng_data_pending(session->name);
-			if (ret < 0) {
-				/* Return the data available call error. */
-				goto error;
-			}
+		ret_code = lttng_wait_data_pending_ext(session->name,
+				&data_pending_handle);
+		if (ret_code != LTTNG_OK) {
+			ret = -ret_code;
+			goto error;
+		}
 
-			/*
-			 * Data sleep time before retrying (in usec). Don't
-			 * sleep if the call returned value indicates
-			 * availability.
-			 */
-			if (ret) {
+		do {
+			data_pending_status =
+					lttng_data_pending_handle_wait_for_completion(
+						data_pending_handle,
+						DEFAULT_DATA_AVAILABILITY_WAIT_TIME_US /
+								USEC_PER_MSEC);
+			switch (data_pending_status) {
+			case LTTNG_DATA_PENDING_HANDLE_STATUS_TIMEOUT:
 				if (!printed_destroy_msg) {
 					_MSG("Destroying session %s",
 							session->name);
 					newline_needed = true;
 					printed_destroy_msg = true;
-					fflush(stdout);
 				}
-
-				usleep(DEFAULT_DATA_AVAILABILITY_WAIT_TIME_US);
 				_MSG(".");
 				fflush(stdout);
+				break;
+			case LTTNG_DATA_PENDING_HANDLE_STATUS_COMPLETED:
+				break;
+			default:
+				ERR("%sFailed to wait for the data availability of session \"%s\"",
+						newline_needed ? "\n" : "",
+						session->name);
+				newline_needed = false;
+				ret = -1;
+				goto error;
 			}
-		} while (ret != 0);
+		} while (data_pending_status ==
+				LTTNG_DATA_PENDING_HANDLE_STATUS_TIMEOUT);
+
+		data_pending_status = lttng_data_pending_handle_get_result(
+				data_pending_handle, &ret_code);
+		if (data_pending_status != LTTNG_DATA_PENDING_HANDLE_STATUS_OK) {
+			ERR("%sFailed to get the data availability of session \"%s\"",
+					newline_needed ? "\n" : "",
+					session->name);
+			newline_needed = false;
+			ret = -1;
+			goto error;
+		}
+		if (ret_code != LTTNG_OK) {
+			/* Return the data available call error. */
+			ret = -ret_code;
+			goto error;
+		}
 	}
 
 	if (!session_was_already_stopped) {
@@ -226,6 +254,7 @@ error:
 		MSG("");
 	}
 	lttng_destruction_handle_destroy(handle);
+	lttng_data_pending_handle_destroy(data_pending_handle);
 	free(session_name);
 	free(stats_str);
 	return ret;
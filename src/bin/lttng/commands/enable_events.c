@@ -957,6 +957,305 @@ static void warn_on_truncated_exclusion_names(char * const *exclusion_list,
 	}
 }
 
+/*
+ * Set up `ev` to enable the event named `event_name` according to the command
+ * line options. The exclusion list of the event replaces `*exclusion_list`.
+ * Warnings about truncated exclusion names are only printed when `warn` is
+ * set.
+ *
+ * Return CMD_SUCCESS on success, else the command's error code.
+ */
+static int init_event(struct lttng_event *ev, char *event_name,
+		const char *channel_name, char ***exclusion_list, int *warn)
+{
+	int ret = CMD_SUCCESS;
+
+	/* Copy name and type of the event */
+	strncpy(ev->name, event_name, LTTNG_SYMBOL_NAME_LEN);
+	ev->name[LTTNG_SYMBOL_NAME_LEN - 1] = '\0';
+	ev->type = opt_event_type;
+
+	/* Kernel tracer action */
+	if (opt_kernel) {
+		DBG("Enabling kernel event %s for channel %s",
+				event_name,
+				print_channel_name(channel_name));
+
+		switch (opt_event_type) {
+		case LTTNG_EVENT_ALL:	/* Enable tracepoints and syscalls */
+			/* If event name differs from *, select tracepoint. */
+			if (strcmp(ev->name, "*")) {
+				ev->type = LTTNG_EVENT_TRACEPOINT;
+			}
+			break;
+		case LTTNG_EVENT_TRACEPOINT:
+			break;
+		case LTTNG_EVENT_PROBE:
+			ret = parse_probe_opts(ev, opt_probe);
+			if (ret) {
+				ERR("Unable to parse probe options");
+				ret = CMD_ERROR;
+				goto end;
+			}
+			break;
+		case LTTNG_EVENT_USERSPACE_PROBE:
+			ret = parse_userspace_probe_opts(ev, opt_userspace_probe);
+			if (ret) {
+				switch (ret) {
+				case CMD_UNSUPPORTED:
+					/*
+					 * Error message describing
+					 * what is not supported was
+					 * printed in the function.
+					 */
+					break;
+				case CMD_ERROR:
+				default:
+					ERR("Unable to parse userspace probe options");
+					break;
+				}
+				goto end;
+			}
+			break;
+		case LTTNG_EVENT_FUNCTION:
+			ret = parse_probe_opts(ev, opt_function);
+			if (ret) {
+				ERR("Unable to parse function probe options");
+				ret = CMD_ERROR;
+				goto end;
+			}
+			break;
+		case LTTNG_EVENT_SYSCALL:
+			ev->type = LTTNG_EVENT_SYSCALL;
+			break;
+		default:
+			ret = CMD_UNDEFINED;
+			goto end;
+		}
+
+		/* kernel loglevels not implemented */
+		ev->loglevel_type = LTTNG_EVENT_LOGLEVEL_ALL;
+	} else if (opt_userspace) {		/* User-space tracer action */
+		DBG("Enabling UST event %s for channel %s, loglevel %s", event_name,
+				print_channel_name(channel_name), opt_loglevel ? : "<all>");
+
+		switch (opt_event_type) {
+		case LTTNG_EVENT_ALL:	/* Default behavior is tracepoint */
+			/* Fall-through */
+		case LTTNG_EVENT_TRACEPOINT:
+			/* Copy name and type of the event */
+			ev->type = LTTNG_EVENT_TRACEPOINT;
+			strncpy(ev->name, event_name, LTTNG_SYMBOL_NAME_LEN);
+			ev->name[LTTNG_SYMBOL_NAME_LEN - 1] = '\0';
+			break;
+		case LTTNG_EVENT_PROBE:
+		case LTTNG_EVENT_FUNCTION:
+		case LTTNG_EVENT_SYSCALL:
+		case LTTNG_EVENT_USERSPACE_PROBE:
+		default:
+			ERR("Event type not available for user-space tracing");
+			ret = CMD_UNSUPPORTED;
+			goto end;
+		}
+
+		if (opt_exclude) {
+			ev->exclusion = 1;
+			if (opt_event_type != LTTNG_EVENT_ALL && opt_event_type != LTTNG_EVENT_TRACEPOINT) {
+				ERR("Exclusion option can only be used with tracepoint events");
+				ret = CMD_ERROR;
+				goto end;
+			}
+			/* Free previously allocated items */
+			strutils_free_null_terminated_array_of_strings(
+				*exclusion_list);
+			*exclusion_list = NULL;
+			ret = create_exclusion_list_and_validate(
+				event_name, opt_exclude,
+				exclusion_list);
+			if (ret) {
+				ret = CMD_ERROR;
+				goto end;
+			}
+
+			if (warn) {
+				warn_on_truncated_exclusion_names(
+					*exclusion_list, warn);
+			}
+		}
+
+		ev->loglevel_type = opt_loglevel_type;
+		if (opt_loglevel) {
+			ev->loglevel = loglevel_str_to_value(opt_loglevel);
+			if (ev->loglevel == -1) {
+				ERR("Unknown loglevel %s", opt_loglevel);
+				ret = -LTTNG_ERR_INVALID;
+				goto end;
+			}
+		} else {
+			ev->loglevel = -1;
+		}
+	} else if (opt_jul || opt_log4j || opt_python) {
+		if (opt_event_type != LTTNG_EVENT_ALL &&
+				opt_event_type != LTTNG_EVENT_TRACEPOINT) {
+			ERR("Event type not supported for domain.");
+			ret = CMD_UNSUPPORTED;
+			goto end;
+		}
+
+		ev->loglevel_type = opt_loglevel_type;
+		if (opt_loglevel) {
+			if (opt_jul) {
+				ev->loglevel = loglevel_jul_str_to_value(opt_loglevel);
+			} else if (opt_log4j) {
+				ev->loglevel = loglevel_log4j_str_to_value(opt_loglevel);
+			} else if (opt_python) {
+				ev->loglevel = loglevel_python_str_to_value(opt_loglevel);
+			}
+			if (ev->loglevel == -1) {
+				ERR("Unknown loglevel %s", opt_loglevel);
+				ret = -LTTNG_ERR_INVALID;
+				goto end;
+			}
+		} else {
+			if (opt_jul) {
+				ev->loglevel = LTTNG_LOGLEVEL_JUL_ALL;
+			} else if (opt_log4j) {
+				ev->loglevel = LTTNG_LOGLEVEL_LOG4J_ALL;
+			} else if (opt_python) {
+				ev->loglevel = LTTNG_LOGLEVEL_PYTHON_DEBUG;
+			}
+		}
+		ev->type = LTTNG_EVENT_TRACEPOINT;
+		strncpy(ev->name, event_name, LTTNG_SYMBOL_NAME_LEN);
+		ev->name[LTTNG_SYMBOL_NAME_LEN - 1] = '\0';
+	} else {
+		assert(0);
+	}
+
+end:
+	return ret;
+}
+
+/*
+ * Set up an event for each name of the event list, stopping at the first one
+ * that can't be set up. The event names point into opt_event_list.
+ *
+ * The events set up before a failure are returned, to be enabled, along with
+ * the error code of the event that couldn't be set up.
+ */
+static int init_events(const char *channel_name, char ***exclusion_list,
+		int *warn, struct lttng_event ***events, char ***event_names,
+		unsigned int *event_count)
+{
+	int ret = CMD_SUCCESS;
+	char *event_name;
+
+	event_name = strtok(opt_event_list, ",");
+	while (event_name != NULL) {
+		struct lttng_event *ev, **new_events;
+		char **new_event_names;
+
+		new_events = realloc(*events,
+				(*event_count + 1) * sizeof(**events));
+		if (!new_events) {
+			PERROR("realloc events");
+			ret = CMD_ERROR;
+			goto end;
+		}
+		*events = new_events;
+
+		new_event_names = realloc(*event_names,
+				(*event_count + 1) * sizeof(**event_names));
+		if (!new_event_names) {
+			PERROR("realloc event names");
+			ret = CMD_ERROR;
+			goto end;
+		}
+		*event_names = new_event_names;
+
+		ev = lttng_event_create();
+		if (!ev) {
+			ret = CMD_ERROR;
+			goto end;
+		}
+
+		ret = init_event(ev, event_name, channel_name, exclusion_list,
+				warn);
+		if (ret) {
+			lttng_event_destroy(ev);
+			goto end;
+		}
+		if (opt_filter) {
+			ev->filter = 1;
+		}
+
+		(*events)[*event_count] = ev;
+		(*event_names)[*event_count] = event_name;
+		(*event_count)++;
+
+		event_name = strtok(NULL, ",");
+	}
+
+end:
+	return ret;
+}
+
+/*
+ * Enable all the events of the event list with a single request to the session
+ * daemon. The result of each event, in the order of the list, is returned to
+ * be reported as if the events had been enabled one by one.
+ *
+ * Return NULL if the events must be enabled one by one, e.g. when the session
+ * daemon doesn't support the request.
+ */
+static int *enable_events_bulk(struct lttng_event * const *events,
+		unsigned int event_count, const char *channel_name,
+		char **exclusion_list)
+{
+	int ret;
+	unsigned int i;
+	struct lttng_event *bulk_events = NULL;
+	int *ret_codes = NULL;
+
+	/* Userspace probes are enabled one by one. */
+	if (opt_kernel && opt_event_type == LTTNG_EVENT_USERSPACE_PROBE) {
+		goto end;
+	}
+
+	if (event_count < 2) {
+		goto end;
+	}
+
+	bulk_events = zmalloc(event_count * sizeof(*bulk_events));
+	if (!bulk_events) {
+		PERROR("zmalloc events");
+		goto end;
+	}
+	for (i = 0; i < event_count; i++) {
+		bulk_events[i] = *events[i];
+	}
+
+	ret_codes = zmalloc(event_count * sizeof(*ret_codes));
+	if (!ret_codes) {
+		PERROR("zmalloc event return codes");
+		goto end;
+	}
+
+	ret = lttng_enable_events_with_exclusions(handle, bulk_events,
+			event_count, channel_name, opt_filter,
+			exclusion_list ? strutils_array_of_strings_len(exclusion_list) : 0,
+			exclusion_list, ret_codes);
+	if (ret < 0) {
+		DBG("Failed to enable the events in a single request (%s), enabling them one by one",
+				lttng_strerror(ret));
+		free(ret_codes);
+		ret_codes = NULL;
+	}
+end:
+	free(bulk_events);
+	return ret_codes;
+}
+
 /*
  * Enabling event using the lttng API.
  * Note: in case of error only the last error code will be return.
@@ -969,6 +1268,11 @@ static int enable_events(char *session_name)
 	struct lttng_event *ev;
 	struct lttng_domain dom;
 	char **exclusion_list = NULL;
+	int *bulk_ret_codes = NULL;
+	struct lttng_event **events = NULL;
+	char **event_names = NULL;
+	unsigned int event_count = 0, event_index;
+	int init_ret;
 
 	memset(&dom, 0, sizeof(dom));
 
@@ -1324,177 +1628,30 @@ static int enable_events(char *session_name)
 		goto end;
 	}
 
-	/* Strip event list */
-	event_name = strtok(opt_event_list, ",");
-	while (event_name != NULL) {
-		/* Copy name and type of the event */
-		strncpy(ev->name, event_name, LTTNG_SYMBOL_NAME_LEN);
-		ev->name[LTTNG_SYMBOL_NAME_LEN - 1] = '\0';
-		ev->type = opt_event_type;
-
-		/* Kernel tracer action */
-		if (opt_kernel) {
-			DBG("Enabling kernel event %s for channel %s",
-					event_name,
-					print_channel_name(channel_name));
-
-			switch (opt_event_type) {
-			case LTTNG_EVENT_ALL:	/* Enable tracepoints and syscalls */
-				/* If event name differs from *, select tracepoint. */
-				if (strcmp(ev->name, "*")) {
-					ev->type = LTTNG_EVENT_TRACEPOINT;
-				}
-				break;
-			case LTTNG_EVENT_TRACEPOINT:
-				break;
-			case LTTNG_EVENT_PROBE:
-				ret = parse_probe_opts(ev, opt_probe);
-				if (ret) {
-					ERR("Unable to parse probe options");
-					ret = CMD_ERROR;
-					goto error;
-				}
-				break;
-			case LTTNG_EVENT_USERSPACE_PROBE:
-				ret = parse_userspace_probe_opts(ev, opt_userspace_probe);
-				if (ret) {
-					switch (ret) {
-					case CMD_UNSUPPORTED:
-						/*
-						 * Error message describing
-						 * what is not supported was
-						 * printed in the function.
-						 */
-						break;
-					case CMD_ERROR:
-					default:
-						ERR("Unable to parse userspace probe options");
-						break;
-					}
-					goto error;
-				}
-				break;
-			case LTTNG_EVENT_FUNCTION:
-				ret = parse_probe_opts(ev, opt_function);
-				if (ret) {
-					ERR("Unable to parse function probe options");
-					ret = CMD_ERROR;
-					goto error;
-				}
-				break;
-			case LTTNG_EVENT_SYSCALL:
-				ev->type = LTTNG_EVENT_SYSCALL;
-				break;
-			default:
-				ret = CMD_UNDEFINED;
-				goto error;
-			}
-
-			/* kernel loglevels not implemented */
-			ev->loglevel_type = LTTNG_EVENT_LOGLEVEL_ALL;
-		} else if (opt_userspace) {		/* User-space tracer action */
-			DBG("Enabling UST event %s for channel %s, loglevel %s", event_name,
-					print_channel_name(channel_name), opt_loglevel ? : "<all>");
-
-			switch (opt_event_type) {
-			case LTTNG_EVENT_ALL:	/* Default behavior is tracepoint */
-				/* Fall-through */
-			case LTTNG_EVENT_TRACEPOINT:
-				/* Copy name and type of the event */
-				ev->type = LTTNG_EVENT_TRACEPOINT;
-				strncpy(ev->name, event_name, LTTNG_SYMBOL_NAME_LEN);
-				ev->name[LTTNG_SYMBOL_NAME_LEN - 1] = '\0';
-				break;
-			case LTTNG_EVENT_PROBE:
-			case LTTNG_EVENT_FUNCTION:
-			case LTTNG_EVENT_SYSCALL:
-			case LTTNG_EVENT_USERSPACE_PROBE:
-			default:
-				ERR("Event type not available for user-space tracing");
-				ret = CMD_UNSUPPORTED;
-				goto error;
-			}
-
-			if (opt_exclude) {
-				ev->exclusion = 1;
-				if (opt_event_type != LTTNG_EVENT_ALL && opt_event_type != LTTNG_EVENT_TRACEPOINT) {
-					ERR("Exclusion option can only be used with tracepoint events");
-					ret = CMD_ERROR;
-					goto error;
-				}
-				/* Free previously allocated items */
-				strutils_free_null_terminated_array_of_strings(
-					exclusion_list);
-				exclusion_list = NULL;
-				ret = create_exclusion_list_and_validate(
-					event_name, opt_exclude,
-					&exclusion_list);
-				if (ret) {
-					ret = CMD_ERROR;
-					goto error;
-				}
-
-				warn_on_truncated_exclusion_names(
-					exclusion_list, &warn);
-			}
+	/*
+	 * The events are set up once, up to the first one that can't be, and
+	 * the ones set up are enabled before reporting its error.
+	 */
+	init_ret = init_events(channel_name, &exclusion_list, &warn, &events,
+			&event_names, &event_count);
+	bulk_ret_codes = enable_events_bulk(events, event_count, channel_name,
+			exclusion_list);
 
-			ev->loglevel_type = opt_loglevel_type;
-			if (opt_loglevel) {
-				ev->loglevel = loglevel_str_to_value(opt_loglevel);
-				if (ev->loglevel == -1) {
-					ERR("Unknown loglevel %s", opt_loglevel);
-					ret = -LTTNG_ERR_INVALID;
-					goto error;
-				}
-			} else {
-				ev->loglevel = -1;
-			}
-		} else if (opt_jul || opt_log4j || opt_python) {
-			if (opt_event_type != LTTNG_EVENT_ALL &&
-					opt_event_type != LTTNG_EVENT_TRACEPOINT) {
-				ERR("Event type not supported for domain.");
-				ret = CMD_UNSUPPORTED;
-				goto error;
-			}
+	for (event_index = 0; event_index < event_count; event_index++) {
+		struct lttng_event *event = events[event_index];
 
-			ev->loglevel_type = opt_loglevel_type;
-			if (opt_loglevel) {
-				if (opt_jul) {
-					ev->loglevel = loglevel_jul_str_to_value(opt_loglevel);
-				} else if (opt_log4j) {
-					ev->loglevel = loglevel_log4j_str_to_value(opt_loglevel);
-				} else if (opt_python) {
-					ev->loglevel = loglevel_python_str_to_value(opt_loglevel);
-				}
-				if (ev->loglevel == -1) {
-					ERR("Unknown loglevel %s", opt_loglevel);
-					ret = -LTTNG_ERR_INVALID;
-					goto error;
-				}
-			} else {
-				if (opt_jul) {
-					ev->loglevel = LTTNG_LOGLEVEL_JUL_ALL;
-				} else if (opt_log4j) {
-					ev->loglevel = LTTNG_LOGLEVEL_LOG4J_ALL;
-				} else if (opt_python) {
-					ev->loglevel = LTTNG_LOGLEVEL_PYTHON_DEBUG;
-				}
-			}
-			ev->type = LTTNG_EVENT_TRACEPOINT;
-			strncpy(ev->name, event_name, LTTNG_SYMBOL_NAME_LEN);
-			ev->name[LTTNG_SYMBOL_NAME_LEN - 1] = '\0';
-		} else {
-			assert(0);
-		}
+		event_name = event_names[event_index];
 
 		if (!opt_filter) {
 			char *exclusion_string;
 
-			command_ret = lttng_enable_event_with_exclusions(handle,
-					ev, channel_name,
-					NULL,
-					exclusion_list ? strutils_array_of_strings_len(exclusion_list) : 0,
-					exclusion_list);
+			command_ret = bulk_ret_codes ?
+					bulk_ret_codes[event_index] :
+					lttng_enable_event_with_exclusions(handle,
+						event, channel_name,
+						NULL,
+						exclusion_list ? strutils_array_of_strings_len(exclusion_list) : 0,
+						exclusion_list);
 			exclusion_string = print_exclusions(exclusion_list);
 			if (!exclusion_string) {
 				PERROR("Cannot allocate exclusion_string");
@@ -1573,12 +1730,13 @@ static int enable_events(char *session_name)
 			char *exclusion_string;
 
 			/* Filter present */
-			ev->filter = 1;
-
-			command_ret = lttng_enable_event_with_exclusions(handle, ev, channel_name,
-					opt_filter,
-					exclusion_list ? strutils_array_of_strings_len(exclusion_list) : 0,
-					exclusion_list);
+			command_ret = bulk_ret_codes ?
+					bulk_ret_codes[event_index] :
+					lttng_enable_event_with_exclusions(handle,
+						event, channel_name,
+						opt_filter,
+						exclusion_list ? strutils_array_of_strings_len(exclusion_list) : 0,
+						exclusion_list);
 			exclusion_string = print_exclusions(exclusion_list);
 			if (!exclusion_string) {
 				PERROR("Cannot allocate exclusion_string");
@@ -1598,7 +1756,7 @@ static int enable_events(char *session_name)
 				case LTTNG_ERR_TRACE_ALREADY_STARTED:
 				{
 					const char *msg = "The command tried to enable an event in a new domain for a session that has already been started once.";
-					ERR("Event %s%s: %s (channel %s, session %s, filter \'%s\')", ev->name,
+					ERR("Event %s%s: %s (channel %s, session %s, filter \'%s\')", event->name,
 							exclusion_string,
 							msg,
 							print_channel_name(channel_name),
@@ -1607,7 +1765,7 @@ static int enable_events(char *session_name)
 					break;
 				}
 				default:
-					ERR("Event %s%s: %s (channel %s, session %s, filter \'%s\')", ev->name,
+					ERR("Event %s%s: %s (channel %s, session %s, filter \'%s\')", event->name,
 							exclusion_string,
 							lttng_strerror(command_ret),
 							command_ret == -LTTNG_ERR_NEED_CHANNEL_NAME
@@ -1630,12 +1788,12 @@ static int enable_events(char *session_name)
 		if (lttng_opt_mi) {
 			if (command_ret) {
 				success = 0;
-				ev->enabled = 0;
+				event->enabled = 0;
 			} else {
-				ev->enabled = 1;
+				event->enabled = 1;
 			}
 
-			ret = mi_lttng_event(writer, ev, 1, handle->domain.type);
+			ret = mi_lttng_event(writer, event, 1, handle->domain.type);
 			if (ret) {
 				ret = CMD_ERROR;
 				goto error;
@@ -1664,12 +1822,15 @@ static int enable_events(char *session_name)
 			}
 		}
 
-		/* Next event */
-		event_name = strtok(NULL, ",");
 		/* Reset warn, error and success */
 		success = 1;
 	}
 
+	if (init_ret) {
+		ret = init_ret;
+		goto error;
+	}
+
 end:
 	/* Close Mi */
 	if (lttng_opt_mi) {
@@ -1689,6 +1850,12 @@ error:
 	}
 	lttng_destroy_handle(handle);
 	strutils_free_null_terminated_array_of_strings(exclusion_list);
+	free(bulk_ret_codes);
+	for (event_index = 0; event_index < event_count; event_index++) {
+		lttng_event_destroy(events[event_index]);
+	}
+	free(events);
+	free(event_names);
 
 	/* Overwrite ret with error_holder if there was an actual error with
 	 * enabling an event.
@@ -79,6 +79,60 @@ end:
 	return ret;
 }
 
+/*
+ * Wait for the data of a session to be available, showing progress while it
+ * is pending.
+ *
+ * Return 0 once the data is available, else a negative lttng error code.
+ */
+static int wait_data_pending(const char *session_name)
+{
+	int ret;
+	enum lttng_error_code ret_code;
+	enum lttng_data_pending_handle_status status;
+	struct lttng_data_pending_handle *handle = NULL;
+
+	ret_code = lttng_wait_data_pending_ext(session_name, &handle);
+	if (ret_code != LTTNG_OK) {
+		ret = -ret_code;
+		goto end;
+	}
+
+	_MSG("Waiting for data availability");
+	fflush(stdout);
+	do {
+		status = lttng_data_pending_handle_wait_for_completion(handle,
+				DEFAULT_DATA_AVAILABILITY_WAIT_TIME_US /
+						USEC_PER_MSEC);
+		switch (status) {
+		case LTTNG_DATA_PENDING_HANDLE_STATUS_TIMEOUT:
+			_MSG(".");
+			fflush(stdout);
+			break;
+		case LTTNG_DATA_PENDING_HANDLE_STATUS_COMPLETED:
+			break;
+		default:
+			ERR("\nFailed to wait for the data availability of session \"%s\"",
+					session_name);
+			ret = -LTTNG_ERR_FATAL;
+			goto end;
+		}
+	} while (status == LTTNG_DATA_PENDING_HANDLE_STATUS_TIMEOUT);
+	MSG("");
+
+	status = lttng_data_pending_handle_get_result(handle, &ret_code);
+	if (status != LTTNG_DATA_PENDING_HANDLE_STATUS_OK) {
+		ERR("Failed to get the data availability of session \"%s\"",
+				session_name);
+		ret = -LTTNG_ERR_FATAL;
+		goto end;
+	}
+	ret = ret_code == LTTNG_OK ? 0 : -ret_code;
+end:
+	lttng_data_pending_handle_destroy(handle);
+	return ret;
+}
+
 /*
  * Start tracing for all trace of the session.
  */
@@ -111,26 +165,11 @@ static int stop_tracing(void)
 	}
 
 	if (!opt_no_wait) {
-		_MSG("Waiting for data availability");
-		fflush(stdout);
-		do {
-			ret = lttng_data_pending(session_name);
-			if (ret < 0) {
-				/* Return the data available call error. */
-				goto free_name;
-			}
-
-			/*
-			 * Data sleep time before retrying (in usec). Don't sleep if the call
-			 * returned value indicates availability.
-			 */
-			if (ret) {
-				usleep(DEFAULT_DATA_AVAILABILITY_WAIT_TIME_US);
-				_MSG(".");
-				fflush(stdout);
-			}
-		} while (ret != 0);
-		MSG("");
+		ret = wait_data_pending(session_name);
+		if (ret < 0) {
+			/* Return the data available call error. */
+			goto free_name;
+		}
 	}
 
 	ret = CMD_SUCCESS;
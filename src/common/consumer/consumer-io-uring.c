@@ -0,0 +1,449 @@
+/*
+ * Copyright (C) 2021 EfficiOS Inc.
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+#include "consumer-io-uring.h"
+
+#ifdef HAVE_IO_URING
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <urcu/arch.h>
+#include <urcu/system.h>
+
+#include <common/common.h>
+#include <common/compat/fcntl.h>
+#include <common/macros.h>
+
+/* Tags the completion of a write; the other operations are tagged with 0. */
+#define IO_URING_WRITE_TAG	1
+
+/*
+ * Number of submission queue entries used by consumer_io_uring_write() and
+ * consumer_io_uring_release_range() respectively.
+ */
+#define IO_URING_WRITE_SQE_COUNT	2
+#define IO_URING_RELEASE_SQE_COUNT	2
+
+struct consumer_io_uring {
+	int fd;
+	struct {
+		unsigned int *head;
+		unsigned int *tail;
+		unsigned int *ring_mask;
+		unsigned int *ring_entries;
+		unsigned int *array;
+		struct io_uring_sqe *sqes;
+		/* Tail of the queued entries, published on submission. */
+		unsigned int local_tail;
+		/* Entries queued since the last submission. */
+		unsigned int queued;
+	} sq;
+	struct {
+		unsigned int *head;
+		unsigned int *tail;
+		unsigned int *ring_mask;
+		struct io_uring_cqe *cqes;
+		unsigned int entries;
+	} cq;
+	/* Submitted operations for which no completion was reaped yet. */
+	unsigned int inflight;
+	/* Result of the last write, valid once write_done is set. */
+	int write_res;
+	bool write_done;
+	struct {
+		void *sq_ring;
+		size_t sq_ring_size;
+		void *cq_ring;
+		size_t cq_ring_size;
+		void *sqes;
+		size_t sqes_size;
+	} map;
+};
+
+static int sys_io_uring_setup(unsigned int entries,
+		struct io_uring_params *params)
+{
+	return (int) syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int sys_io_uring_enter(int fd, unsigned int to_submit,
+		unsigned int min_complete, unsigned int flags)
+{
+	return (int) syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+			flags, NULL, 0);
+}
+
+static void io_uring_unmap(struct consumer_io_uring *ring)
+{
+	if (ring->map.sqes) {
+		(void) munmap(ring->map.sqes, ring->map.sqes_size);
+	}
+	if (ring->map.cq_ring && ring->map.cq_ring != ring->map.sq_ring) {
+		(void) munmap(ring->map.cq_ring, ring->map.cq_ring_size);
+	}
+	if (ring->map.sq_ring) {
+		(void) munmap(ring->map.sq_ring, ring->map.sq_ring_size);
+	}
+}
+
+static int io_uring_map(struct consumer_io_uring *ring,
+		const struct io_uring_params *params)
+{
+	int ret;
+	void *ptr;
+
+	ring->map.sq_ring_size = params->sq_off.array +
+			params->sq_entries * sizeof(unsigned int);
+	ring->map.cq_ring_size = params->cq_off.cqes +
+			params->cq_entries * sizeof(struct io_uring_cqe);
+	if (params->features & IORING_FEAT_SINGLE_MMAP) {
+		ring->map.sq_ring_size = max_t(size_t, ring->map.sq_ring_size,
+				ring->map.cq_ring_size);
+		ring->map.cq_ring_size = ring->map.sq_ring_size;
+	}
+
+	ptr = mmap(NULL, ring->map.sq_ring_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+	if (ptr == MAP_FAILED) {
+		PERROR("Failed to map io_uring submission queue");
+		ret = -1;
+		goto end;
+	}
+	ring->map.sq_ring = ptr;
+
+	if (params->features & IORING_FEAT_SINGLE_MMAP) {
+		ptr = ring->map.sq_ring;
+	} else {
+		ptr = mmap(NULL, ring->map.cq_ring_size, PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_POPULATE, ring->fd,
+				IORING_OFF_CQ_RING);
+		if (ptr == MAP_FAILED) {
+			PERROR("Failed to map io_uring completion queue");
+			ret = -1;
+			goto end;
+		}
+	}
+	ring->map.cq_ring = ptr;
+
+	ring->map.sqes_size = params->sq_entries * sizeof(struct io_uring_sqe);
+	ptr = mmap(NULL, ring->map.sqes_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+	if (ptr == MAP_FAILED) {
+		PERROR("Failed to map io_uring submission queue entries");
+		ret = -1;
+		goto end;
+	}
+	ring->map.sqes = ptr;
+
+	ring->sq.head = (void *) ((char *) ring->map.sq_ring +
+			params->sq_off.head);
+	ring->sq.tail = (void *) ((char *) ring->map.sq_ring +
+			params->sq_off.tail);
+	ring->sq.ring_mask = (void *) ((char *) ring->map.sq_ring +
+			params->sq_off.ring_mask);
+	ring->sq.ring_entries = (void *) ((char *) ring->map.sq_ring +
+			params->sq_off.ring_entries);
+	ring->sq.array = (void *) ((char *) ring->map.sq_ring +
+			params->sq_off.array);
+	ring->sq.sqes = ring->map.sqes;
+	ring->sq.local_tail = *ring->sq.tail;
+
+	ring->cq.head = (void *) ((char *) ring->map.cq_ring +
+			params->cq_off.head);
+	ring->cq.tail = (void *) ((char *) ring->map.cq_ring +
+			params->cq_off.tail);
+	ring->cq.ring_mask = (void *) ((char *) ring->map.cq_ring +
+			params->cq_off.ring_mask);
+	ring->cq.cqes = (void *) ((char *) ring->map.cq_ring +
+			params->cq_off.cqes);
+	ring->cq.entries = params->cq_entries;
+	ret = 0;
+end:
+	return ret;
+}
+
+LTTNG_HIDDEN
+struct consumer_io_uring *consumer_io_uring_create(unsigned int entries)
+{
+	int ret;
+	struct io_uring_params params;
+	struct consumer_io_uring *ring;
+
+	ring = zmalloc(sizeof(*ring));
+	if (!ring) {
+		PERROR("Failed to allocate io_uring");
+		goto error;
+	}
+
+	memset(&params, 0, sizeof(params));
+	ring->fd = sys_io_uring_setup(entries, &params);
+	if (ring->fd < 0) {
+		PERROR("Failed to set up io_uring");
+		goto error;
+	}
+
+	/*
+	 * Writes are issued at the current position of the trace files,
+	 * which is only supported since Linux 5.6.
+	 */
+	if (!(params.features & IORING_FEAT_RW_CUR_POS)) {
+		DBG("io_uring writes at the current file position are not supported");
+		goto error;
+	}
+
+	ret = io_uring_map(ring, &params);
+	if (ret) {
+		goto error;
+	}
+
+	DBG("Created io_uring: fd = %d, sq entries = %u, cq entries = %u",
+			ring->fd, params.sq_entries, params.cq_entries);
+	return ring;
+
+error:
+	if (ring) {
+		io_uring_unmap(ring);
+		if (ring->fd >= 0) {
+			ret = close(ring->fd);
+			if (ret) {
+				PERROR("Failed to close io_uring");
+			}
+		}
+	}
+	free(ring);
+	return NULL;
+}
+
+/*
+ * Reap the available completions.
+ */
+static void io_uring_reap(struct consumer_io_uring *ring)
+{
+	unsigned int head, tail;
+
+	head = *ring->cq.head;
+	tail = CMM_LOAD_SHARED(*ring->cq.tail);
+	/* Read the completions after the tail. */
+	cmm_smp_rmb();
+
+	for (; head != tail; head++) {
+		const struct io_uring_cqe *cqe =
+				&ring->cq.cqes[head & *ring->cq.ring_mask];
+
+		if (cqe->user_data == IO_URING_WRITE_TAG) {
+			ring->write_res = cqe->res;
+			ring->write_done = true;
+		} else if (cqe->res < 0 && cqe->res != -ECANCELED) {
+			DBG("io_uring page cache release request failed: %s",
+					strerror(-cqe->res));
+		}
+		ring->inflight--;
+	}
+
+	/* Release the completion slots once they were read. */
+	cmm_smp_mb();
+	CMM_STORE_SHARED(*ring->cq.head, head);
+}
+
+/*
+ * Publish the queued requests to the kernel and submit them. Wait for at
+ * least `min_complete` completions, then reap the available completions.
+ */
+static int io_uring_submit_and_wait(struct consumer_io_uring *ring,
+		unsigned int min_complete)
+{
+	int ret;
+	unsigned int to_submit;
+
+	/* Publish the entries before the tail. */
+	cmm_smp_wmb();
+	CMM_STORE_SHARED(*ring->sq.tail, ring->sq.local_tail);
+
+	to_submit = ring->sq.queued;
+	do {
+		ret = sys_io_uring_enter(ring->fd, to_submit, min_complete,
+				min_complete ? IORING_ENTER_GETEVENTS : 0);
+		if (ret >= 0) {
+			ring->sq.queued -= ret;
+			ring->inflight += ret;
+			to_submit -= ret;
+		}
+	} while (ret < 0 && errno == EINTR);
+	if (ret < 0) {
+		PERROR("io_uring_enter");
+		goto end;
+	}
+
+	io_uring_reap(ring);
+	ret = 0;
+end:
+	return ret;
+}
+
+/*
+ * Make room for `count` submission queue entries, ensuring the completion
+ * queue can't overflow.
+ */
+static int io_uring_reserve(struct consumer_io_uring *ring, unsigned int count)
+{
+	int ret = 0;
+
+	while (ring->sq.local_tail + count -
+				CMM_LOAD_SHARED(*ring->sq.head) >
+				*ring->sq.ring_entries ||
+			ring->inflight + ring->sq.queued + count >
+				ring->cq.entries) {
+		ret = io_uring_submit_and_wait(ring, ring->inflight ? 1 : 0);
+		if (ret) {
+			break;
+		}
+	}
+
+	return ret;
+}
+
+static struct io_uring_sqe *io_uring_queue_sqe(struct consumer_io_uring *ring,
+		uint8_t opcode, int fd, uint64_t offset, uint64_t user_data)
+{
+	const unsigned int index = ring->sq.local_tail & *ring->sq.ring_mask;
+	struct io_uring_sqe *sqe = &ring->sq.sqes[index];
+
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = opcode;
+	sqe->fd = fd;
+	sqe->off = offset;
+	sqe->user_data = user_data;
+	ring->sq.array[index] = index;
+	ring->sq.local_tail++;
+	ring->sq.queued++;
+	return sqe;
+}
+
+LTTNG_HIDDEN
+ssize_t consumer_io_uring_write(struct consumer_io_uring *ring, int fd,
+		const void *buf, size_t len, off_t offset)
+{
+	int ret;
+	ssize_t written = 0;
+	struct io_uring_sqe *sqe;
+
+	ret = io_uring_reserve(ring, IO_URING_WRITE_SQE_COUNT);
+	if (ret) {
+		goto error;
+	}
+
+	/* Write at the current file position... */
+	sqe = io_uring_queue_sqe(ring, IORING_OP_WRITE, fd, (uint64_t) -1,
+			IO_URING_WRITE_TAG);
+	sqe->addr = (uint64_t) (uintptr_t) buf;
+	sqe->len = len;
+	sqe->flags = IOSQE_IO_LINK;
+	/* ... then start the writeout asynchronously. */
+	sqe = io_uring_queue_sqe(ring, IORING_OP_SYNC_FILE_RANGE, fd, offset,
+			0);
+	sqe->len = len;
+	sqe->sync_range_flags = SYNC_FILE_RANGE_WRITE;
+
+	ring->write_done = false;
+	while (!ring->write_done) {
+		ret = io_uring_submit_and_wait(ring, 1);
+		if (ret) {
+			goto error;
+		}
+	}
+
+	if (ring->write_res < 0) {
+		errno = -ring->write_res;
+		return ring->write_res;
+	}
+	written = ring->write_res;
+
+	/*
+	 * The writeout was cancelled on a short write. Complete the write
+	 * synchronously.
+	 */
+	if (written < len) {
+		ssize_t write_ret;
+
+		write_ret = lttng_write(fd, (const char *) buf + written,
+				len - written);
+		if (write_ret < 0) {
+			return written ? written : -errno;
+		}
+		written += write_ret;
+	}
+
+	return written;
+
+error:
+	return -errno;
+}
+
+LTTNG_HIDDEN
+void consumer_io_uring_release_range(struct consumer_io_uring *ring, int fd,
+		off_t offset, off_t len)
+{
+	struct io_uring_sqe *sqe;
+
+	if (io_uring_reserve(ring, IO_URING_RELEASE_SQE_COUNT)) {
+		return;
+	}
+
+	/* Wait for the writeout of the range... */
+	sqe = io_uring_queue_sqe(ring, IORING_OP_SYNC_FILE_RANGE, fd, offset, 0);
+	sqe->len = len;
+	sqe->sync_range_flags = SYNC_FILE_RANGE_WAIT_BEFORE |
+			SYNC_FILE_RANGE_WRITE |
+			SYNC_FILE_RANGE_WAIT_AFTER;
+	sqe->flags = IOSQE_IO_LINK;
+	/*
+	 * ... then hint the kernel that the range won't be re-accessed in a
+	 * near future. See lttng_consumer_sync_trace_file().
+	 */
+	sqe = io_uring_queue_sqe(ring, IORING_OP_FADVISE, fd, offset, 0);
+	sqe->len = len;
+	sqe->fadvise_advice = POSIX_FADV_DONTNEED;
+}
+
+LTTNG_HIDDEN
+void consumer_io_uring_submit(struct consumer_io_uring *ring)
+{
+	if (!ring->sq.queued && !ring->inflight) {
+		return;
+	}
+
+	(void) io_uring_submit_and_wait(ring, 0);
+}
+
+LTTNG_HIDDEN
+void consumer_io_uring_destroy(struct consumer_io_uring *ring)
+{
+	int ret;
+
+	if (!ring) {
+		return;
+	}
+
+	while (ring->sq.queued || ring->inflight) {
+		if (io_uring_submit_and_wait(ring, ring->inflight ? 1 : 0)) {
+			break;
+		}
+	}
+
+	io_uring_unmap(ring);
+	ret = close(ring->fd);
+	if (ret) {
+		PERROR("Failed to close io_uring");
+	}
+	free(ring);
+}
+
+#endif /* HAVE_IO_URING */
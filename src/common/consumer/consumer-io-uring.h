@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2021 EfficiOS Inc.
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+#ifndef CONSUMER_IO_URING_H
+#define CONSUMER_IO_URING_H
+
+#include <common/compat/errno.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+/*
+ * io_uring instance used by a data thread to write the packets of its local
+ * streams to their trace files.
+ *
+ * The write of a packet is submitted along with the writeout of the pages it
+ * dirtied and with the page cache release requests queued since the last
+ * submission (possibly for other streams), in a single system call. Only the
+ * completion of the write itself is waited for: its sub-buffer can't be
+ * returned to the tracer before then. The writeout, wait and page cache
+ * release operations complete asynchronously and are reaped in batches.
+ *
+ * An instance is only used by the thread owning it.
+ */
+struct consumer_io_uring;
+
+#ifdef HAVE_IO_URING
+
+/*
+ * Create an io_uring with a submission queue of at least `entries` entries.
+ *
+ * Return NULL if io_uring is not supported by the kernel.
+ */
+struct consumer_io_uring *consumer_io_uring_create(unsigned int entries);
+
+/* Wait for the completion of all in-flight operations and destroy the ring. */
+void consumer_io_uring_destroy(struct consumer_io_uring *ring);
+
+/*
+ * Write `len` bytes of `buf` at the current position of `fd`, which is
+ * `offset`, and start the writeout of the written range.
+ *
+ * Returns once the data is written to `fd`, along with the number of bytes
+ * written, or a negative errno value on error (and errno is set).
+ */
+ssize_t consumer_io_uring_write(struct consumer_io_uring *ring, int fd,
+		const void *buf, size_t len, off_t offset);
+
+/*
+ * Queue a wait for the writeout of the range [offset, offset + len) of `fd`
+ * followed by the release of the range's pages from the page cache.
+ *
+ * The request is submitted along with the next write or when the ring is
+ * explicitly submitted. As these are hints limiting the amount of page cache
+ * used, their outcome is ignored.
+ */
+void consumer_io_uring_release_range(struct consumer_io_uring *ring, int fd,
+		off_t offset, off_t len);
+
+/*
+ * Submit the queued requests and reap the completed ones without waiting.
+ * Called before the owning thread blocks.
+ */
+void consumer_io_uring_submit(struct consumer_io_uring *ring);
+
+#else /* HAVE_IO_URING */
+
+static inline
+struct consumer_io_uring *consumer_io_uring_create(unsigned int entries)
+{
+	return NULL;
+}
+
+static inline
+void consumer_io_uring_destroy(struct consumer_io_uring *ring)
+{
+}
+
+static inline
+ssize_t consumer_io_uring_write(struct consumer_io_uring *ring, int fd,
+		const void *buf, size_t len, off_t offset)
+{
+	errno = ENOSYS;
+	return -ENOSYS;
+}
+
+static inline
+void consumer_io_uring_release_range(struct consumer_io_uring *ring, int fd,
+		off_t offset, off_t len)
+{
+}
+
+static inline
+void consumer_io_uring_submit(struct consumer_io_uring *ring)
+{
+}
+
+#endif /* HAVE_IO_URING */
+
+#endif /* CONSUMER_IO_URING_H */
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2021 EfficiOS Inc.
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+#define _LGPL_SOURCE
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <urcu.h>
+#include <urcu/uatomic.h>
+
+#include <bin/lttng-consumerd/health-consumerd.h>
+#include <common/common.h>
+#include <common/consumer/consumer.h>
+
+#include "consumer-snapshot.h"
+
+struct snapshot_copy {
+	struct consumer_snapshot_stream *streams;
+	size_t stream_count;
+	consumer_snapshot_copy_stream_cb copy_stream;
+	void *data;
+	/* Index of the next stream to copy. */
+	unsigned long next_stream;
+	/* Error of the first failed copy. */
+	int ret;
+};
+
+static void copy_streams(struct snapshot_copy *copy)
+{
+	while (!uatomic_read(&copy->ret)) {
+		int ret;
+		const unsigned long i =
+				uatomic_add_return(&copy->next_stream, 1) - 1;
+
+		if (i >= copy->stream_count) {
+			break;
+		}
+
+		ret = copy->copy_stream(&copy->streams[i], copy->data);
+		if (ret) {
+			(void) uatomic_cmpxchg(&copy->ret, 0, ret);
+		}
+	}
+}
+
+static void *thread_snapshot_copy(void *data)
+{
+	struct snapshot_copy *copy = data;
+
+	rcu_register_thread();
+	rcu_read_lock();
+	copy_streams(copy);
+	rcu_read_unlock();
+	rcu_unregister_thread();
+	return NULL;
+}
+
+int consumer_snapshot_copy_streams(struct consumer_snapshot_stream *streams,
+		size_t stream_count, consumer_snapshot_copy_stream_cb copy_stream,
+		void *data)
+{
+	int ret;
+	size_t i, thread_count;
+	pthread_t *threads = NULL;
+	struct snapshot_copy copy = {
+		.streams = streams,
+		.stream_count = stream_count,
+		.copy_stream = copy_stream,
+		.data = data,
+	};
+
+	/* The calling thread copies streams too. */
+	thread_count = min_t(size_t, consumer_data.snapshot_thread_count,
+			stream_count);
+	if (thread_count > 1) {
+		threads = zmalloc(sizeof(*threads) * (thread_count - 1));
+		if (!threads) {
+			PERROR("zmalloc snapshot copy threads");
+			thread_count = 1;
+		}
+	}
+
+	for (i = 0; i + 1 < thread_count; i++) {
+		ret = pthread_create(&threads[i], NULL, thread_snapshot_copy,
+				&copy);
+		if (ret) {
+			errno = ret;
+			PERROR("Failed to create snapshot copy thread, copying with %zu threads",
+					i + 1);
+			break;
+		}
+	}
+	thread_count = i + 1;
+
+	DBG("Copying %zu snapshot streams with %zu threads", stream_count,
+			thread_count);
+	copy_streams(&copy);
+
+	health_poll_entry();
+	for (i = 0; i + 1 < thread_count; i++) {
+		ret = pthread_join(threads[i], NULL);
+		if (ret) {
+			errno = ret;
+			PERROR("pthread_join snapshot copy thread");
+		}
+	}
+	health_poll_exit();
+	free(threads);
+
+	return copy.ret;
+}
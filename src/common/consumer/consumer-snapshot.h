@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2021 EfficiOS Inc.
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+#ifndef CONSUMER_SNAPSHOT_H
+#define CONSUMER_SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct lttng_consumer_stream;
+
+/*
+ * Stream of a channel being recorded in a snapshot.
+ */
+struct consumer_snapshot_stream {
+	struct lttng_consumer_stream *stream;
+	/* Positions sampled when the snapshot of the stream was taken. */
+	unsigned long consumed_pos;
+	unsigned long produced_pos;
+	/* Sub-buffers overwritten before they could be copied. */
+	uint64_t lost_packets;
+};
+
+/*
+ * Copy the sub-buffers of a stream between its sampled positions to its
+ * output. Called without the stream lock being acquired by the calling thread;
+ * the thread recording the snapshot holds it for the whole copy.
+ *
+ * Return 0 on success, < 0 on error.
+ */
+typedef int (*consumer_snapshot_copy_stream_cb)(
+		struct consumer_snapshot_stream *snapshot_stream, void *data);
+
+/*
+ * Copy the streams of a snapshot concurrently on up to
+ * consumer_data.snapshot_thread_count threads, the calling thread included.
+ * Each thread copies the next stream not yet copied until all the streams are
+ * copied or a copy fails.
+ *
+ * The positions of all the streams must be sampled beforehand so that the
+ * snapshot covers the same time window for all the streams.
+ *
+ * Return 0 on success, else the error of the first failed copy.
+ */
+int consumer_snapshot_copy_streams(struct consumer_snapshot_stream *streams,
+		size_t stream_count, consumer_snapshot_copy_stream_cb copy_stream,
+		void *data);
+
+#endif /* CONSUMER_SNAPSHOT_H */
@@ -213,6 +213,55 @@ static ssize_t consumer_stream_consume_splice(
 	return written_bytes;
 }
 
+/*
+ * Queue the index of a network stream to be sent to its relayd as part of a
+ * batch. Falls back to sending the index immediately when the relayd does
+ * not support index batches.
+ *
+ * Return 0 on success or else a negative value.
+ */
+static int consumer_stream_queue_relayd_index(
+		struct lttng_consumer_stream *stream,
+		struct ctf_packet_index *index)
+{
+	int ret;
+	struct consumer_relayd_sock_pair *relayd;
+	struct lttcomm_relayd_index msg;
+
+	rcu_read_lock();
+	relayd = consumer_find_relayd(stream->net_seq_idx);
+	if (!relayd) {
+		ERR("Stream %" PRIu64 " relayd ID %" PRIu64 " unknown. Can't write index.",
+				stream->key, stream->net_seq_idx);
+		ret = -1;
+		goto end;
+	}
+
+	if (!relayd_supports_index_batching(&relayd->control_sock)) {
+		ret = consumer_stream_write_index(stream, index);
+		goto end;
+	}
+
+	relayd_init_index_msg(&relayd->control_sock, &msg, index,
+			stream->relayd_stream_id, stream->next_net_seq_num - 1);
+
+	pthread_mutex_lock(&relayd->ctrl_sock_mutex);
+	ret = consumer_relayd_queue_index(relayd, &msg);
+	if (ret < 0) {
+		/*
+		 * Communication error with lttng-relayd,
+		 * perform cleanup now
+		 */
+		ERR("Relayd send indexes failed. Cleaning up relayd %" PRIu64 ".", relayd->net_seq_idx);
+		lttng_consumer_cleanup_relayd(relayd);
+		ret = -1;
+	}
+	pthread_mutex_unlock(&relayd->ctrl_sock_mutex);
+end:
+	rcu_read_unlock();
+	return ret;
+}
+
 static int consumer_stream_send_index(
 		struct lttng_consumer_stream *stream,
 		const struct stream_subbuffer *subbuffer,
@@ -231,7 +280,16 @@ static int consumer_stream_send_index(
 	}
 
 	ctf_packet_index_populate(&index, packet_offset, subbuffer);
-	return consumer_stream_write_index(stream, &index);
+
+	/*
+	 * The indexes of live streams are sent immediately for the viewers to
+	 * see the packets as soon as they are received by the relayd.
+	 */
+	if (stream->net_seq_idx == (uint64_t) -1ULL || stream->chan->is_live) {
+		return consumer_stream_write_index(stream, &index);
+	}
+
+	return consumer_stream_queue_relayd_index(stream, &index);
 }
 
 /*
@@ -785,9 +843,12 @@ void consumer_stream_relayd_close(struct lttng_consumer_stream *stream,
 
 	/* Closing streams requires to lock the control socket. */
 	pthread_mutex_lock(&relayd->ctrl_sock_mutex);
-	ret = relayd_send_close_stream(&relayd->control_sock,
-			stream->relayd_stream_id,
-			stream->next_net_seq_num - 1);
+	ret = consumer_relayd_sync_indexes(relayd);
+	if (!ret) {
+		ret = relayd_send_close_stream(&relayd->control_sock,
+				stream->relayd_stream_id,
+				stream->next_net_seq_num - 1);
+	}
 	pthread_mutex_unlock(&relayd->ctrl_sock_mutex);
 	if (ret < 0) {
 		ERR("Relayd send close stream failed. Cleaning up relayd %" PRIu64 ".", relayd->net_seq_idx);
@@ -1042,9 +1103,6 @@ void consumer_stream_destroy(struct lttng_consumer_stream *stream,
 			/* Update channel's refcount of the stream. */
 			free_chan = unref_channel(stream);
 
-			/* Indicates that the consumer data state MUST be updated after this. */
-			consumer_data.need_update = 1;
-
 			pthread_mutex_unlock(&stream->lock);
 			pthread_mutex_unlock(&stream->chan->lock);
 			pthread_mutex_unlock(&consumer_data.lock);
@@ -1089,8 +1147,12 @@ int consumer_stream_write_index(struct lttng_consumer_stream *stream,
 		relayd = consumer_find_relayd(stream->net_seq_idx);
 		if (relayd) {
 			pthread_mutex_lock(&relayd->ctrl_sock_mutex);
-			ret = relayd_send_index(&relayd->control_sock, element,
-				stream->relayd_stream_id, stream->next_net_seq_num - 1);
+			ret = consumer_relayd_sync_indexes(relayd);
+			if (!ret) {
+				ret = relayd_send_index(&relayd->control_sock,
+						element, stream->relayd_stream_id,
+						stream->next_net_seq_num - 1);
+			}
 			if (ret < 0) {
 				/*
 				 * Communication error with lttng-relayd,
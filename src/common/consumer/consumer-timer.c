@@ -9,11 +9,14 @@
 #define _LGPL_SOURCE
 #include <assert.h>
 #include <inttypes.h>
-#include <signal.h>
+#include <sys/timerfd.h>
 
 #include <bin/lttng-consumerd/health-consumerd.h>
 #include <common/common.h>
 #include <common/compat/endian.h>
+#include <common/compat/poll.h>
+#include <common/time.h>
+#include <common/utils.h>
 #include <common/kernel-ctl/kernel-ctl.h>
 #include <common/kernel-consumer/kernel-consumer.h>
 #include <common/consumer/consumer-stream.h>
@@ -28,48 +31,78 @@ typedef int (*get_produced_cb)(struct lttng_consumer_stream *stream,
 		unsigned long *produced);
 typedef int (*flush_index_cb)(struct lttng_consumer_stream *stream);
 
-static struct timer_signal_data timer_signal = {
-	.tid = 0,
-	.setup_done = 0,
-	.qs_done = 0,
-	.lock = PTHREAD_MUTEX_INITIALIZER,
+enum consumer_timer_type {
+	CONSUMER_TIMER_SWITCH,
+	CONSUMER_TIMER_LIVE,
+	CONSUMER_TIMER_MONITOR,
 };
 
 /*
- * Set custom signal mask to current thread.
+ * Timers of the same type sharing the same period. They expire together and
+ * are processed as a batch by the timer thread.
  */
-static void setmask(sigset_t *mask)
-{
-	int ret;
+struct consumer_timer_group {
+	enum consumer_timer_type type;
+	uint64_t period_ns;
+	/* Next expiration, in CLOCK_MONOTONIC nanoseconds. */
+	uint64_t deadline_ns;
+	/* struct consumer_channel_timer nodes. */
+	struct cds_list_head timers;
+	/* Expired timers of the batch being processed, not yet run. */
+	struct cds_list_head expired;
+	/* Set while the timer thread processes the group's batch. */
+	bool processing;
+	/* Node in the deadline-ordered group list. */
+	struct cds_list_head node;
+};
 
-	ret = sigemptyset(mask);
-	if (ret) {
-		PERROR("sigemptyset");
-	}
-	ret = sigaddset(mask, LTTNG_CONSUMER_SIG_SWITCH);
-	if (ret) {
-		PERROR("sigaddset switch");
-	}
-	ret = sigaddset(mask, LTTNG_CONSUMER_SIG_TEARDOWN);
-	if (ret) {
-		PERROR("sigaddset teardown");
-	}
-	ret = sigaddset(mask, LTTNG_CONSUMER_SIG_LIVE);
-	if (ret) {
-		PERROR("sigaddset live");
-	}
-	ret = sigaddset(mask, LTTNG_CONSUMER_SIG_MONITOR);
-	if (ret) {
-		PERROR("sigaddset monitor");
-	}
-	ret = sigaddset(mask, LTTNG_CONSUMER_SIG_EXIT);
-	if (ret) {
-		PERROR("sigaddset exit");
-	}
-}
+/*
+ * The channel timers are multiplexed on a single timerfd, armed for the
+ * earliest deadline of the groups, and are all run by the timer thread.
+ *
+ * The lock protects the group list and the timers' group membership. It is
+ * released while a timer runs; `running` then points to the timer and `cond`
+ * is signaled once it is done so that stopping a timer can wait for its
+ * completion.
+ */
+static struct {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	/* struct consumer_timer_group nodes, ordered by deadline. */
+	struct cds_list_head groups;
+	struct consumer_channel_timer *running;
+	int timer_fd;
+	int quit_pipe[2];
+} timers = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER,
+	.groups = CDS_LIST_HEAD_INIT(timers.groups),
+	.timer_fd = -1,
+	.quit_pipe = { -1, -1 },
+};
 
 static int channel_monitor_pipe = -1;
 
+/*
+ * Samples of the monitor timer group being run, sent as one message once the
+ * group is processed. Only used by the timer thread.
+ */
+static struct {
+	struct lttcomm_consumer_channel_monitor_batch_msg header;
+	struct lttcomm_consumer_channel_monitor_msg
+			samples[LTTCOMM_CONSUMER_CHANNEL_MONITOR_BATCH_MAX_SAMPLES];
+} LTTNG_PACKED monitor_batch;
+/* Number of batches dropped since the start of the consumer. */
+static uint64_t monitor_batch_drop_count;
+
+/*
+ * Number of monitor periods after which an unchanged sample is sent anyway.
+ * The session daemon drops the samples of the channels the notification
+ * thread doesn't know about yet, such as the first samples of a channel
+ * being created.
+ */
+#define MONITOR_SAMPLE_RESEND_PERIOD_COUNT	10
+
 /*
  * Execute action on a timer switch.
  *
@@ -78,12 +111,10 @@ static int channel_monitor_pipe = -1;
  * deadlocks.
  */
 static void metadata_switch_timer(struct lttng_consumer_local_data *ctx,
-		siginfo_t *si)
+		struct lttng_consumer_channel *channel)
 {
 	int ret;
-	struct lttng_consumer_channel *channel;
 
-	channel = si->si_value.sival_ptr;
 	assert(channel);
 
 	if (channel->switch_timer_error) {
@@ -265,10 +296,9 @@ end:
  * Execute action on a live timer
  */
 static void live_timer(struct lttng_consumer_local_data *ctx,
-		siginfo_t *si)
+		struct lttng_consumer_channel *channel)
 {
 	int ret;
-	struct lttng_consumer_channel *channel;
 	struct lttng_consumer_stream *stream;
 	struct lttng_ht_iter iter;
 	const struct lttng_ht *ht = consumer_data.stream_per_chan_id_ht;
@@ -277,7 +307,6 @@ static void live_timer(struct lttng_consumer_local_data *ctx,
 					consumer_flush_kernel_index :
 					consumer_flush_ust_index;
 
-	channel = si->si_value.sival_ptr;
 	assert(channel);
 
 	if (channel->switch_timer_error) {
@@ -305,74 +334,103 @@ error:
 }
 
 static
-void consumer_timer_signal_thread_qs(unsigned int signr)
+uint64_t timer_now_ns(void)
 {
-	sigset_t pending_set;
 	int ret;
+	struct timespec ts;
 
-	/*
-	 * We need to be the only thread interacting with the thread
-	 * that manages signals for teardown synchronization.
-	 */
-	pthread_mutex_lock(&timer_signal.lock);
+	ret = lttng_clock_gettime(CLOCK_MONOTONIC, &ts);
+	if (ret < 0) {
+		PERROR("clock_gettime");
+		return 0;
+	}
+	return (uint64_t) ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
 
-	/* Ensure we don't have any signal queued for this channel. */
-	for (;;) {
-		ret = sigemptyset(&pending_set);
-		if (ret == -1) {
-			PERROR("sigemptyset");
-		}
-		ret = sigpending(&pending_set);
-		if (ret == -1) {
-			PERROR("sigpending");
-		}
-		if (!sigismember(&pending_set, signr)) {
-			break;
-		}
-		caa_cpu_relax();
+/*
+ * Arm the timerfd for the earliest deadline, or disarm it if no timer is
+ * running.
+ *
+ * Must be called with the timers lock held.
+ */
+static
+void timer_fd_arm(void)
+{
+	int ret;
+	struct itimerspec its = {};
+
+	if (!cds_list_empty(&timers.groups)) {
+		const struct consumer_timer_group *first = cds_list_first_entry(
+				&timers.groups, struct consumer_timer_group, node);
+
+		its.it_value.tv_sec = first->deadline_ns / NSEC_PER_SEC;
+		its.it_value.tv_nsec = first->deadline_ns % NSEC_PER_SEC;
 	}
 
-	/*
-	 * From this point, no new signal handler will be fired that would try to
-	 * access "chan". However, we still need to wait for any currently
-	 * executing handler to complete.
-	 */
-	cmm_smp_mb();
-	CMM_STORE_SHARED(timer_signal.qs_done, 0);
-	cmm_smp_mb();
+	ret = timerfd_settime(timers.timer_fd, TFD_TIMER_ABSTIME, &its, NULL);
+	if (ret) {
+		PERROR("timerfd_settime");
+	}
+}
 
-	/*
-	 * Kill with LTTNG_CONSUMER_SIG_TEARDOWN, so signal management thread wakes
-	 * up.
-	 */
-	kill(getpid(), LTTNG_CONSUMER_SIG_TEARDOWN);
+/*
+ * Insert a group in the group list according to its deadline.
+ *
+ * Must be called with the timers lock held.
+ */
+static
+void timer_group_enqueue(struct consumer_timer_group *group)
+{
+	struct consumer_timer_group *pos;
+
+	cds_list_for_each_entry(pos, &timers.groups, node) {
+		if (pos->deadline_ns > group->deadline_ns) {
+			/* Insert before pos. */
+			cds_list_add_tail(&group->node, &pos->node);
+			return;
+		}
+	}
+	cds_list_add_tail(&group->node, &timers.groups);
+}
 
-	while (!CMM_LOAD_SHARED(timer_signal.qs_done)) {
-		caa_cpu_relax();
+/*
+ * Free a group once its last timer is stopped, unless the timer thread is
+ * processing it, in which case the timer thread frees it.
+ *
+ * Must be called with the timers lock held.
+ */
+static
+void timer_group_put_if_empty(struct consumer_timer_group *group)
+{
+	if (group->processing || !cds_list_empty(&group->timers) ||
+			!cds_list_empty(&group->expired)) {
+		return;
 	}
-	cmm_smp_mb();
 
-	pthread_mutex_unlock(&timer_signal.lock);
+	cds_list_del(&group->node);
+	free(group);
 }
 
 /*
- * Start a timer channel timer which will fire at a given interval
- * (timer_interval_us)and fire a given signal (signal).
+ * Start a channel timer which will fire at a given interval
+ * (timer_interval_us).
+ *
+ * The timer joins the group of the timers of the same type and period, if
+ * any, and fires along with them. Its first expiration can thus occur before
+ * a full interval has elapsed.
  *
  * Returns a negative value on error, 0 if a timer was created, and
  * a positive value if no timer was created (not an error).
  */
 static
-int consumer_channel_timer_start(timer_t *timer_id,
-		struct lttng_consumer_channel *channel,
-		unsigned int timer_interval_us, int signal)
+int consumer_channel_timer_start(struct consumer_channel_timer *timer,
+		enum consumer_timer_type type, unsigned int timer_interval_us)
 {
-	int ret = 0, delete_ret;
-	struct sigevent sev;
-	struct itimerspec its;
+	int ret = 0;
+	const uint64_t period_ns = (uint64_t) timer_interval_us * NSEC_PER_USEC;
+	struct consumer_timer_group *group;
 
-	assert(channel);
-	assert(channel->key);
+	assert(!timer->group);
 
 	if (timer_interval_us == 0) {
 		/* No creation needed; not an error. */
@@ -380,50 +438,61 @@ int consumer_channel_timer_start(timer_t *timer_id,
 		goto end;
 	}
 
-	sev.sigev_notify = SIGEV_SIGNAL;
-	sev.sigev_signo = signal;
-	sev.sigev_value.sival_ptr = channel;
-	ret = timer_create(CLOCKID, &sev, timer_id);
-	if (ret == -1) {
-		PERROR("timer_create");
-		goto end;
+	pthread_mutex_lock(&timers.lock);
+	cds_list_for_each_entry(group, &timers.groups, node) {
+		if (group->type == type && group->period_ns == period_ns) {
+			goto add_timer;
+		}
 	}
 
-	its.it_value.tv_sec = timer_interval_us / 1000000;
-	its.it_value.tv_nsec = (timer_interval_us % 1000000) * 1000;
-	its.it_interval.tv_sec = its.it_value.tv_sec;
-	its.it_interval.tv_nsec = its.it_value.tv_nsec;
-
-	ret = timer_settime(*timer_id, 0, &its, NULL);
-	if (ret == -1) {
-		PERROR("timer_settime");
-		goto error_destroy_timer;
+	group = zmalloc(sizeof(*group));
+	if (!group) {
+		PERROR("zmalloc channel timer group");
+		ret = -1;
+		goto end_unlock;
 	}
+	group->type = type;
+	group->period_ns = period_ns;
+	group->deadline_ns = timer_now_ns() + period_ns;
+	CDS_INIT_LIST_HEAD(&group->timers);
+	CDS_INIT_LIST_HEAD(&group->expired);
+	timer_group_enqueue(group);
+	timer_fd_arm();
+
+add_timer:
+	cds_list_add_tail(&timer->node, &group->timers);
+	timer->group = group;
+end_unlock:
+	pthread_mutex_unlock(&timers.lock);
 end:
 	return ret;
-error_destroy_timer:
-	delete_ret = timer_delete(*timer_id);
-	if (delete_ret == -1) {
-		PERROR("timer_delete");
-	}
-	goto end;
 }
 
+/*
+ * Stop a channel timer. Once this returns, the timer is not running and will
+ * not run again.
+ *
+ * Beware: must never be called from the timer's own handler since it waits
+ * for the handler's completion.
+ */
 static
-int consumer_channel_timer_stop(timer_t *timer_id, int signal)
+void consumer_channel_timer_stop(struct consumer_channel_timer *timer)
 {
-	int ret = 0;
-
-	ret = timer_delete(*timer_id);
-	if (ret == -1) {
-		PERROR("timer_delete");
-		goto end;
+	struct consumer_timer_group *group;
+
+	pthread_mutex_lock(&timers.lock);
+	group = timer->group;
+	if (group) {
+		cds_list_del(&timer->node);
+		timer->group = NULL;
+		timer_group_put_if_empty(group);
+		timer_fd_arm();
 	}
 
-	consumer_timer_signal_thread_qs(signal);
-	*timer_id = 0;
-end:
-	return ret;
+	while (timers.running == timer) {
+		pthread_cond_wait(&timers.cond, &timers.lock);
+	}
+	pthread_mutex_unlock(&timers.lock);
 }
 
 /*
@@ -437,8 +506,8 @@ void consumer_timer_switch_start(struct lttng_consumer_channel *channel,
 	assert(channel);
 	assert(channel->key);
 
-	ret = consumer_channel_timer_start(&channel->switch_timer, channel,
-			switch_timer_interval_us, LTTNG_CONSUMER_SIG_SWITCH);
+	ret = consumer_channel_timer_start(&channel->switch_timer,
+			CONSUMER_TIMER_SWITCH, switch_timer_interval_us);
 
 	channel->switch_timer_enabled = !!(ret == 0);
 }
@@ -448,16 +517,9 @@ void consumer_timer_switch_start(struct lttng_consumer_channel *channel,
  */
 void consumer_timer_switch_stop(struct lttng_consumer_channel *channel)
 {
-	int ret;
-
 	assert(channel);
 
-	ret = consumer_channel_timer_stop(&channel->switch_timer,
-			LTTNG_CONSUMER_SIG_SWITCH);
-	if (ret == -1) {
-		ERR("Failed to stop switch timer");
-	}
-
+	consumer_channel_timer_stop(&channel->switch_timer);
 	channel->switch_timer_enabled = 0;
 }
 
@@ -472,8 +534,8 @@ void consumer_timer_live_start(struct lttng_consumer_channel *channel,
 	assert(channel);
 	assert(channel->key);
 
-	ret = consumer_channel_timer_start(&channel->live_timer, channel,
-			live_timer_interval_us, LTTNG_CONSUMER_SIG_LIVE);
+	ret = consumer_channel_timer_start(&channel->live_timer,
+			CONSUMER_TIMER_LIVE, live_timer_interval_us);
 
 	channel->live_timer_enabled = !!(ret == 0);
 }
@@ -483,16 +545,9 @@ void consumer_timer_live_start(struct lttng_consumer_channel *channel,
  */
 void consumer_timer_live_stop(struct lttng_consumer_channel *channel)
 {
-	int ret;
-
 	assert(channel);
 
-	ret = consumer_channel_timer_stop(&channel->live_timer,
-			LTTNG_CONSUMER_SIG_LIVE);
-	if (ret == -1) {
-		ERR("Failed to stop live timer");
-	}
-
+	consumer_channel_timer_stop(&channel->live_timer);
 	channel->live_timer_enabled = 0;
 }
 
@@ -511,8 +566,8 @@ int consumer_timer_monitor_start(struct lttng_consumer_channel *channel,
 	assert(channel->key);
 	assert(!channel->monitor_timer_enabled);
 
-	ret = consumer_channel_timer_start(&channel->monitor_timer, channel,
-			monitor_timer_interval_us, LTTNG_CONSUMER_SIG_MONITOR);
+	ret = consumer_channel_timer_start(&channel->monitor_timer,
+			CONSUMER_TIMER_MONITOR, monitor_timer_interval_us);
 	channel->monitor_timer_enabled = !!(ret == 0);
 	return ret;
 }
@@ -522,38 +577,67 @@ int consumer_timer_monitor_start(struct lttng_consumer_channel *channel,
  */
 int consumer_timer_monitor_stop(struct lttng_consumer_channel *channel)
 {
-	int ret;
-
 	assert(channel);
 	assert(channel->monitor_timer_enabled);
 
-	ret = consumer_channel_timer_stop(&channel->monitor_timer,
-			LTTNG_CONSUMER_SIG_MONITOR);
-	if (ret == -1) {
-		ERR("Failed to stop live timer");
+	consumer_channel_timer_stop(&channel->monitor_timer);
+	channel->monitor_timer_enabled = 0;
+	return 0;
+}
+
+/*
+ * Create the timerfd and quit pipe of the timer thread. It must be called
+ * from the consumer main before creating the threads.
+ */
+int consumer_timer_init(void)
+{
+	int ret;
+
+	timers.timer_fd = timerfd_create(CLOCK_MONOTONIC,
+			TFD_NONBLOCK | TFD_CLOEXEC);
+	if (timers.timer_fd < 0) {
+		PERROR("timerfd_create");
+		ret = -1;
 		goto end;
 	}
 
-	channel->monitor_timer_enabled = 0;
+	ret = utils_create_pipe_cloexec(timers.quit_pipe);
+	if (ret < 0) {
+		goto end;
+	}
+	ret = 0;
 end:
 	return ret;
 }
 
 /*
- * Block the RT signals for the entire process. It must be called from the
- * consumer main before creating the threads
+ * Close the timer thread's timerfd and quit pipe once it is joined.
  */
-int consumer_signal_init(void)
+void consumer_timer_fini(void)
 {
 	int ret;
-	sigset_t mask;
 
-	/* Block signal for entire process, so only our thread processes it. */
-	setmask(&mask);
-	ret = pthread_sigmask(SIG_BLOCK, &mask, NULL);
-	if (ret) {
-		errno = ret;
-		PERROR("pthread_sigmask");
+	if (timers.timer_fd >= 0) {
+		ret = close(timers.timer_fd);
+		if (ret) {
+			PERROR("close timerfd");
+		}
+		timers.timer_fd = -1;
+	}
+	utils_close_pipe(timers.quit_pipe);
+}
+
+/*
+ * Ask the timer thread to exit.
+ */
+int consumer_timer_thread_quit(void)
+{
+	ssize_t ret;
+	const char dummy = 'q';
+
+	ret = lttng_write(timers.quit_pipe[1], &dummy, sizeof(dummy));
+	if (ret != sizeof(dummy)) {
+		PERROR("write timer thread quit pipe");
 		return -1;
 	}
 	return 0;
@@ -635,7 +719,52 @@ end:
 }
 
 /*
- * Execute action on a monitor timer.
+ * Send the pending monitoring samples to the session daemon as one batch.
+ *
+ * Only called by the timer thread.
+ */
+static
+void monitor_batch_flush(void)
+{
+	ssize_t ret;
+	const int channel_monitor_pipe =
+			consumer_timer_thread_get_channel_monitor_pipe();
+	const size_t len = sizeof(monitor_batch.header) +
+			monitor_batch.header.sample_count *
+					sizeof(monitor_batch.samples[0]);
+
+	if (monitor_batch.header.sample_count == 0) {
+		return;
+	}
+
+	/*
+	 * Writes performed here are assumed to be atomic which is only
+	 * guaranteed for sizes < than PIPE_BUF.
+	 */
+	assert(len <= PIPE_BUF);
+
+	do {
+		ret = write(channel_monitor_pipe, &monitor_batch, len);
+	} while (ret == -1 && errno == EINTR);
+	if (ret == -1) {
+		if (errno == EAGAIN) {
+			/* Not an error, the samples are merely dropped. */
+			DBG("Channel monitor pipe is full; dropping %" PRIu32 " samples",
+					monitor_batch.header.sample_count);
+		} else {
+			PERROR("write to the channel monitor pipe");
+		}
+		monitor_batch_drop_count++;
+	} else {
+		DBG("Sent %" PRIu32 " channel monitoring samples",
+				monitor_batch.header.sample_count);
+	}
+	monitor_batch.header.sample_count = 0;
+}
+
+/*
+ * Execute action on a monitor timer: add the channel's sample to the pending
+ * batch unless it is unchanged since the last one sent.
  */
 static
 void monitor_timer(struct lttng_consumer_channel *channel)
@@ -683,27 +812,37 @@ void monitor_timer(struct lttng_consumer_channel *channel)
 	msg.total_consumed = total_consumed;
 
 	/*
-	 * Writes performed here are assumed to be atomic which is only
-	 * guaranteed for sizes < than PIPE_BUF.
+	 * An unchanged sample can't change the evaluation of the conditions;
+	 * it is omitted unless a batch was dropped since it was last sent or
+	 * it was omitted for MONITOR_SAMPLE_RESEND_PERIOD_COUNT periods.
 	 */
-	assert(sizeof(msg) <= PIPE_BUF);
+	if (channel->last_monitor_sample.sent &&
+			channel->last_monitor_sample.drop_count ==
+					monitor_batch_drop_count &&
+			channel->last_monitor_sample.highest == highest &&
+			channel->last_monitor_sample.lowest == lowest &&
+			channel->last_monitor_sample.total_consumed ==
+					total_consumed &&
+			++channel->last_monitor_sample.omitted_count <
+					MONITOR_SAMPLE_RESEND_PERIOD_COUNT) {
+		return;
+	}
 
-	do {
-		ret = write(channel_monitor_pipe, &msg, sizeof(msg));
-	} while (ret == -1 && errno == EINTR);
-	if (ret == -1) {
-		if (errno == EAGAIN) {
-			/* Not an error, the sample is merely dropped. */
-			DBG("Channel monitor pipe is full; dropping sample for channel key = %"PRIu64,
-					channel->key);
-		} else {
-			PERROR("write to the channel monitor pipe");
-		}
-	} else {
-		DBG("Sent channel monitoring sample for channel key %" PRIu64
-				", (highest = %" PRIu64 ", lowest = %"PRIu64")",
-				channel->key, msg.highest, msg.lowest);
+	if (monitor_batch.header.sample_count ==
+			LTTCOMM_CONSUMER_CHANNEL_MONITOR_BATCH_MAX_SAMPLES) {
+		monitor_batch_flush();
 	}
+	monitor_batch.samples[monitor_batch.header.sample_count++] = msg;
+
+	channel->last_monitor_sample.sent = true;
+	channel->last_monitor_sample.omitted_count = 0;
+	channel->last_monitor_sample.drop_count = monitor_batch_drop_count;
+	channel->last_monitor_sample.highest = highest;
+	channel->last_monitor_sample.lowest = lowest;
+	channel->last_monitor_sample.total_consumed = total_consumed;
+	DBG("Queued channel monitoring sample for channel key %" PRIu64
+			", (highest = %" PRIu64 ", lowest = %"PRIu64")",
+			channel->key, msg.highest, msg.lowest);
 }
 
 int consumer_timer_thread_get_channel_monitor_pipe(void)
@@ -725,75 +864,168 @@ end:
 	return ret;
 }
 
+static
+void run_timer(struct lttng_consumer_local_data *ctx,
+		enum consumer_timer_type type, struct consumer_channel_timer *timer)
+{
+	switch (type) {
+	case CONSUMER_TIMER_SWITCH:
+		metadata_switch_timer(ctx, caa_container_of(timer,
+				struct lttng_consumer_channel, switch_timer));
+		break;
+	case CONSUMER_TIMER_LIVE:
+		live_timer(ctx, caa_container_of(timer,
+				struct lttng_consumer_channel, live_timer));
+		break;
+	case CONSUMER_TIMER_MONITOR:
+		monitor_timer(caa_container_of(timer,
+				struct lttng_consumer_channel, monitor_timer));
+		break;
+	default:
+		abort();
+	}
+}
+
 /*
- * This thread is the sighandler for signals LTTNG_CONSUMER_SIG_SWITCH,
- * LTTNG_CONSUMER_SIG_TEARDOWN, LTTNG_CONSUMER_SIG_LIVE, and
- * LTTNG_CONSUMER_SIG_MONITOR, LTTNG_CONSUMER_SIG_EXIT.
+ * Run the timers of all the groups that reached their deadline, one group at
+ * a time, and re-arm the timerfd for the next deadline.
+ *
+ * Periods missed while the thread was busy are skipped rather than run
+ * back-to-back.
+ */
+static
+void process_expired_timers(struct lttng_consumer_local_data *ctx)
+{
+	const uint64_t now = timer_now_ns();
+
+	pthread_mutex_lock(&timers.lock);
+	while (!cds_list_empty(&timers.groups)) {
+		struct consumer_timer_group *group = cds_list_first_entry(
+				&timers.groups, struct consumer_timer_group, node);
+
+		if (group->deadline_ns > now) {
+			break;
+		}
+
+		do {
+			group->deadline_ns += group->period_ns;
+		} while (group->deadline_ns <= now);
+		cds_list_del(&group->node);
+		timer_group_enqueue(group);
+
+		cds_list_splice(&group->timers, &group->expired);
+		CDS_INIT_LIST_HEAD(&group->timers);
+		group->processing = true;
+
+		while (!cds_list_empty(&group->expired)) {
+			struct consumer_channel_timer *timer = cds_list_first_entry(
+					&group->expired, struct consumer_channel_timer,
+					node);
+
+			cds_list_del(&timer->node);
+			cds_list_add_tail(&timer->node, &group->timers);
+			timers.running = timer;
+			pthread_mutex_unlock(&timers.lock);
+
+			run_timer(ctx, group->type, timer);
+
+			pthread_mutex_lock(&timers.lock);
+			timers.running = NULL;
+			pthread_cond_broadcast(&timers.cond);
+		}
+
+		if (group->type == CONSUMER_TIMER_MONITOR) {
+			monitor_batch_flush();
+		}
+		group->processing = false;
+		timer_group_put_if_empty(group);
+	}
+	timer_fd_arm();
+	pthread_mutex_unlock(&timers.lock);
+}
+
+/*
+ * This thread runs the channels' switch, live and monitor timers when the
+ * timerfd expires, until the quit pipe is written to.
  */
 void *consumer_timer_thread(void *data)
 {
-	int signr;
-	sigset_t mask;
-	siginfo_t info;
+	int ret, i, nb_fd;
+	uint32_t revents;
+	struct lttng_poll_event events;
 	struct lttng_consumer_local_data *ctx = data;
 
 	rcu_register_thread();
 
 	health_register(health_consumerd, HEALTH_CONSUMERD_TYPE_METADATA_TIMER);
 
+	lttng_poll_init(&events);
+
 	if (testpoint(consumerd_thread_metadata_timer)) {
 		goto error_testpoint;
 	}
 
 	health_code_update();
 
-	/* Only self thread will receive signal mask. */
-	setmask(&mask);
-	CMM_STORE_SHARED(timer_signal.tid, pthread_self());
+	ret = lttng_poll_create(&events, 2, LTTNG_CLOEXEC);
+	if (ret < 0) {
+		ERR("Timer thread poll set creation failed");
+		goto error;
+	}
+	ret = lttng_poll_add(&events, timers.quit_pipe[0], LPOLLIN | LPOLLERR);
+	if (ret < 0) {
+		goto error;
+	}
+	ret = lttng_poll_add(&events, timers.timer_fd, LPOLLIN);
+	if (ret < 0) {
+		goto error;
+	}
 
 	while (1) {
 		health_code_update();
 
 		health_poll_entry();
-		signr = sigwaitinfo(&mask, &info);
+		ret = lttng_poll_wait(&events, -1);
 		health_poll_exit();
+		if (ret < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			PERROR("Timer thread poll wait");
+			goto error;
+		}
 
-		/*
-		 * NOTE: cascading conditions are used instead of a switch case
-		 * since the use of SIGRTMIN in the definition of the signals'
-		 * values prevents the reduction to an integer constant.
-		 */
-		if (signr == -1) {
-			if (errno != EINTR) {
-				PERROR("sigwaitinfo");
+		nb_fd = ret;
+		for (i = 0; i < nb_fd; i++) {
+			const int pollfd = LTTNG_POLL_GETFD(&events, i);
+
+			revents = LTTNG_POLL_GETEV(&events, i);
+			if (pollfd == timers.quit_pipe[0]) {
+				assert(CMM_LOAD_SHARED(consumer_quit));
+				DBG("Timer thread quit pipe activity");
+				goto end;
+			} else if (pollfd == timers.timer_fd) {
+				uint64_t expirations;
+
+				if (!(revents & LPOLLIN)) {
+					ERR("Timer thread timerfd poll error");
+					goto error;
+				}
+
+				/* Empty the timerfd; the deadlines drive expirations. */
+				(void) lttng_read(timers.timer_fd, &expirations,
+						sizeof(expirations));
+				process_expired_timers(ctx);
 			}
-			continue;
-		} else if (signr == LTTNG_CONSUMER_SIG_SWITCH) {
-			metadata_switch_timer(ctx, &info);
-		} else if (signr == LTTNG_CONSUMER_SIG_TEARDOWN) {
-			cmm_smp_mb();
-			CMM_STORE_SHARED(timer_signal.qs_done, 1);
-			cmm_smp_mb();
-			DBG("Signal timer metadata thread teardown");
-		} else if (signr == LTTNG_CONSUMER_SIG_LIVE) {
-			live_timer(ctx, &info);
-		} else if (signr == LTTNG_CONSUMER_SIG_MONITOR) {
-			struct lttng_consumer_channel *channel;
-
-			channel = info.si_value.sival_ptr;
-			monitor_timer(channel);
-		} else if (signr == LTTNG_CONSUMER_SIG_EXIT) {
-			assert(CMM_LOAD_SHARED(consumer_quit));
-			goto end;
-		} else {
-			ERR("Unexpected signal %d\n", info.si_signo);
 		}
 	}
 
+error:
 error_testpoint:
-	/* Only reached in testpoint error */
+	/* Only reached on error */
 	health_error();
 end:
+	lttng_poll_clean(&events);
 	health_unregister(health_consumerd);
 	rcu_unregister_thread();
 	return NULL;
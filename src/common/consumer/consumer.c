@@ -38,6 +38,7 @@
 #include <common/consumer/consumer.h>
 #include <common/consumer/consumer-stream.h>
 #include <common/consumer/consumer-testpoint.h>
+#include <common/consumer/consumer-io-uring.h>
 #include <common/align.h>
 #include <common/consumer/consumer-metadata-cache.h>
 #include <common/trace-chunk.h>
@@ -47,7 +48,6 @@
 
 struct lttng_consumer_global_data consumer_data = {
 	.stream_count = 0,
-	.need_update = 1,
 	.type = LTTNG_CONSUMER_UNKNOWN,
 };
 
@@ -110,6 +110,41 @@ static void notify_thread_lttng_pipe(struct lttng_pipe *pipe)
 	(void) lttng_pipe_write(pipe, &null_stream, sizeof(null_stream));
 }
 
+/*
+ * Return the pipe through which a data stream is handed to the data thread
+ * consuming it.
+ *
+ * The streams are partitioned according to their channel. Consuming a
+ * sub-buffer requires the channel lock; spreading the streams of a channel
+ * over multiple threads would only have them wait for each other.
+ */
+struct lttng_pipe *lttng_consumer_get_data_stream_pipe(
+		struct lttng_consumer_local_data *ctx,
+		const struct lttng_consumer_stream *stream)
+{
+	unsigned int thread_index;
+
+	assert(ctx);
+	assert(stream);
+	assert(!stream->metadata_flag);
+
+	thread_index = (unsigned int) (stream->chan->key %
+			ctx->data_thread_count);
+	return ctx->data_threads[thread_index].data_pipe;
+}
+
+/*
+ * Notify every data thread that the consumer state has changed.
+ */
+static void notify_data_threads(struct lttng_consumer_local_data *ctx)
+{
+	unsigned int i;
+
+	for (i = 0; i < ctx->data_thread_count; i++) {
+		notify_thread_lttng_pipe(ctx->data_threads[i].data_pipe);
+	}
+}
+
 static void notify_health_quit_pipe(int *pipe)
 {
 	ssize_t ret;
@@ -333,7 +368,9 @@ static void free_relayd_rcu(struct rcu_head *head)
 	(void) relayd_close(&relayd->control_sock);
 	(void) relayd_close(&relayd->data_sock);
 
+	lttng_dynamic_array_reset(&relayd->pending_indexes);
 	pthread_mutex_destroy(&relayd->ctrl_sock_mutex);
+	pthread_mutex_destroy(&relayd->data_sock_mutex);
 	free(relayd);
 }
 
@@ -513,7 +550,7 @@ void lttng_consumer_cleanup_relayd(struct consumer_relayd_sock_pair *relayd)
 	 * memory barrier ordering the updates of the end point status from the
 	 * read of this status which happens AFTER receiving this notify.
 	 */
-	notify_thread_lttng_pipe(relayd->ctx->consumer_data_pipe);
+	notify_data_threads(relayd->ctx);
 	notify_thread_lttng_pipe(relayd->ctx->consumer_metadata_pipe);
 }
 
@@ -617,7 +654,6 @@ void consumer_add_data_stream(struct lttng_consumer_stream *stream)
 
 	/* Update consumer data once the node is inserted. */
 	consumer_data.stream_count++;
-	consumer_data.need_update = 1;
 
 	rcu_read_unlock();
 	pthread_mutex_unlock(&stream->lock);
@@ -676,11 +712,170 @@ static struct consumer_relayd_sock_pair *consumer_allocate_relayd_sock_pair(
 	obj->data_sock.sock.fd = -1;
 	lttng_ht_node_init_u64(&obj->node, obj->net_seq_idx);
 	pthread_mutex_init(&obj->ctrl_sock_mutex, NULL);
+	pthread_mutex_init(&obj->data_sock_mutex, NULL);
+	lttng_dynamic_array_init(&obj->pending_indexes,
+			sizeof(struct lttcomm_relayd_index), NULL);
 
 error:
 	return obj;
 }
 
+/*
+ * Send the indexes queued on a relayd as a single batch. The reply of the
+ * relayd is not awaited.
+ *
+ * The relayd's control socket mutex MUST be held.
+ *
+ * Return 0 on success, < 0 on error.
+ */
+static int relayd_send_pending_indexes(
+		struct consumer_relayd_sock_pair *relayd)
+{
+	int ret;
+	const size_t index_count =
+			lttng_dynamic_array_get_count(&relayd->pending_indexes);
+
+	if (index_count == 0) {
+		ret = 0;
+		goto end;
+	}
+
+	ret = relayd_send_indexes(&relayd->control_sock,
+			lttng_dynamic_array_get_element(&relayd->pending_indexes, 0),
+			(uint32_t) index_count);
+	lttng_dynamic_array_clear(&relayd->pending_indexes);
+	if (ret < 0) {
+		goto end;
+	}
+
+	relayd->unacked_index_batches++;
+end:
+	return ret;
+}
+
+/*
+ * Receive the replies to the index batches sent to a relayd until at most
+ * `max_unacked_batches` remain unacknowledged.
+ *
+ * The relayd's control socket mutex MUST be held.
+ *
+ * Return 0 on success, < 0 on error.
+ */
+static int relayd_recv_index_acks(struct consumer_relayd_sock_pair *relayd,
+		unsigned int max_unacked_batches)
+{
+	int ret = 0;
+
+	while (relayd->unacked_index_batches > max_unacked_batches) {
+		relayd->unacked_index_batches--;
+		ret = relayd_recv_indexes_reply(&relayd->control_sock);
+		if (ret < 0) {
+			break;
+		}
+	}
+
+	return ret;
+}
+
+/*
+ * Queue an index, prepared with relayd_init_index_msg(), to be sent to a
+ * relayd as part of a batch.
+ *
+ * The batch is sent once it is full. Up to
+ * DEFAULT_NETWORK_RELAYD_INDEX_BATCH_WINDOW batches may be in flight before
+ * waiting on the replies of the relayd.
+ *
+ * The relayd's control socket mutex MUST be held.
+ *
+ * Return 0 on success, < 0 on error in which case the caller is expected to
+ * clean up the relayd.
+ */
+int consumer_relayd_queue_index(struct consumer_relayd_sock_pair *relayd,
+		const struct lttcomm_relayd_index *index)
+{
+	int ret;
+
+	assert(relayd);
+	assert(index);
+
+	ret = lttng_dynamic_array_add_element(&relayd->pending_indexes, index);
+	if (ret) {
+		ERR("Failed to queue index for relayd %" PRIu64,
+				relayd->net_seq_idx);
+		ret = -1;
+		goto end;
+	}
+
+	if (lttng_dynamic_array_get_count(&relayd->pending_indexes) <
+			DEFAULT_NETWORK_RELAYD_INDEX_BATCH_SIZE) {
+		ret = 0;
+		goto end;
+	}
+
+	ret = relayd_send_pending_indexes(relayd);
+	if (ret < 0) {
+		goto end;
+	}
+
+	ret = relayd_recv_index_acks(relayd,
+			DEFAULT_NETWORK_RELAYD_INDEX_BATCH_WINDOW);
+end:
+	return ret;
+}
+
+/*
+ * Send the indexes queued on a relayd and wait for the relayd to acknowledge
+ * all the index batches sent. This must be done before sending any command
+ * that expects a reply on the control socket of the relayd.
+ *
+ * The relayd's control socket mutex MUST be held.
+ *
+ * Return 0 on success, < 0 on error in which case the caller is expected to
+ * clean up the relayd.
+ */
+int consumer_relayd_sync_indexes(struct consumer_relayd_sock_pair *relayd)
+{
+	int ret;
+
+	assert(relayd);
+
+	ret = relayd_send_pending_indexes(relayd);
+	if (ret < 0) {
+		goto end;
+	}
+
+	ret = relayd_recv_index_acks(relayd, 0);
+end:
+	return ret;
+}
+
+/*
+ * Send the indexes queued on every relayd without waiting for their replies.
+ *
+ * This is done before the data thread waits for data so that queued indexes
+ * don't linger while the streams are idle.
+ */
+void consumer_flush_relayd_indexes(void)
+{
+	int ret;
+	struct lttng_ht_iter iter;
+	struct consumer_relayd_sock_pair *relayd;
+
+	rcu_read_lock();
+	cds_lfht_for_each_entry(consumer_data.relayd_ht->ht, &iter.iter, relayd,
+			node.node) {
+		pthread_mutex_lock(&relayd->ctrl_sock_mutex);
+		ret = relayd_send_pending_indexes(relayd);
+		if (ret < 0) {
+			ERR("Relayd send indexes failed. Cleaning up relayd %" PRIu64 ".",
+					relayd->net_seq_idx);
+			lttng_consumer_cleanup_relayd(relayd);
+		}
+		pthread_mutex_unlock(&relayd->ctrl_sock_mutex);
+	}
+	rcu_read_unlock();
+}
+
 /*
  * Find a relayd socket pair in the global consumer data.
  *
@@ -731,11 +926,15 @@ int consumer_send_relayd_stream(struct lttng_consumer_stream *stream,
 	if (relayd != NULL) {
 		/* Add stream on the relayd */
 		pthread_mutex_lock(&relayd->ctrl_sock_mutex);
-		ret = relayd_add_stream(&relayd->control_sock, stream->name,
-				get_consumer_domain(), path, &stream->relayd_stream_id,
-				stream->chan->tracefile_size,
-				stream->chan->tracefile_count,
-				stream->trace_chunk);
+		ret = consumer_relayd_sync_indexes(relayd);
+		if (!ret) {
+			ret = relayd_add_stream(&relayd->control_sock,
+					stream->name, get_consumer_domain(),
+					path, &stream->relayd_stream_id,
+					stream->chan->tracefile_size,
+					stream->chan->tracefile_count,
+					stream->trace_chunk);
+		}
 		pthread_mutex_unlock(&relayd->ctrl_sock_mutex);
 		if (ret < 0) {
 			ERR("Relayd add stream failed. Cleaning up relayd %" PRIu64".", relayd->net_seq_idx);
@@ -778,7 +977,10 @@ int consumer_send_relayd_streams_sent(uint64_t net_seq_idx)
 	if (relayd != NULL) {
 		/* Add stream on the relayd */
 		pthread_mutex_lock(&relayd->ctrl_sock_mutex);
-		ret = relayd_streams_sent(&relayd->control_sock);
+		ret = consumer_relayd_sync_indexes(relayd);
+		if (!ret) {
+			ret = relayd_streams_sent(&relayd->control_sock);
+		}
 		pthread_mutex_unlock(&relayd->ctrl_sock_mutex);
 		if (ret < 0) {
 			ERR("Relayd streams sent failed. Cleaning up relayd %" PRIu64".", relayd->net_seq_idx);
@@ -816,6 +1018,32 @@ void close_relayd_stream(struct lttng_consumer_stream *stream)
 	rcu_read_unlock();
 }
 
+/*
+ * Set the data header of the next packet of a data stream sent to the relayd.
+ */
+static void init_relayd_data_hdr(struct lttng_consumer_stream *stream,
+		size_t data_size, unsigned long padding,
+		struct lttcomm_relayd_data_hdr *data_hdr)
+{
+	/* Reset data header */
+	memset(data_hdr, 0, sizeof(*data_hdr));
+
+	/* Set header with stream information */
+	data_hdr->stream_id = htobe64(stream->relayd_stream_id);
+	data_hdr->data_size = htobe32(data_size);
+	data_hdr->padding_size = htobe32(padding);
+
+	/*
+	 * Note that net_seq_num below is assigned with the *current* value of
+	 * next_net_seq_num and only after that the next_net_seq_num will be
+	 * increment. This is why when issuing a command on the relayd using
+	 * this next value, 1 should always be substracted in order to compare
+	 * the last seen sequence number on the relayd side to the last sent.
+	 */
+	data_hdr->net_seq_num = htobe64(stream->next_net_seq_num);
+	/* Other fields are zeroed previously */
+}
+
 /*
  * Handle stream for relayd transmission if the stream applies for network
  * streaming where the net sequence index is set.
@@ -833,9 +1061,6 @@ static int write_relayd_stream_header(struct lttng_consumer_stream *stream,
 	assert(stream);
 	assert(relayd);
 
-	/* Reset data header */
-	memset(&data_hdr, 0, sizeof(data_hdr));
-
 	if (stream->metadata_flag) {
 		/* Caller MUST acquire the relayd control socket lock */
 		ret = relayd_send_metadata(&relayd->control_sock, data_size);
@@ -846,21 +1071,7 @@ static int write_relayd_stream_header(struct lttng_consumer_stream *stream,
 		/* Metadata are always sent on the control socket. */
 		outfd = relayd->control_sock.sock.fd;
 	} else {
-		/* Set header with stream information */
-		data_hdr.stream_id = htobe64(stream->relayd_stream_id);
-		data_hdr.data_size = htobe32(data_size);
-		data_hdr.padding_size = htobe32(padding);
-
-		/*
-		 * Note that net_seq_num below is assigned with the *current* value of
-		 * next_net_seq_num and only after that the next_net_seq_num will be
-		 * increment. This is why when issuing a command on the relayd using
-		 * this next value, 1 should always be substracted in order to compare
-		 * the last seen sequence number on the relayd side to the last sent.
-		 */
-		data_hdr.net_seq_num = htobe64(stream->next_net_seq_num);
-		/* Other fields are zeroed previously */
-
+		init_relayd_data_hdr(stream, data_size, padding, &data_hdr);
 		ret = relayd_send_data_hdr(&relayd->data_sock, &data_hdr,
 				sizeof(data_hdr));
 		if (ret < 0) {
@@ -877,6 +1088,39 @@ error:
 	return outfd;
 }
 
+/*
+ * Send a packet of a stream to the relayd. The packet's header(s) and payload
+ * are gathered in a single message.
+ *
+ * The caller must hold the relayd control socket lock for a metadata stream
+ * and the relayd data socket lock for a data stream.
+ *
+ * Return 0 on success or else a negative errno value.
+ */
+static int write_relayd_packet(struct lttng_consumer_stream *stream,
+		const void *payload, size_t payload_len, unsigned long padding,
+		struct consumer_relayd_sock_pair *relayd)
+{
+	int ret;
+	struct lttcomm_relayd_data_hdr data_hdr;
+
+	if (stream->metadata_flag) {
+		/* Metadata are always sent on the control socket. */
+		ret = relayd_send_metadata_packet(&relayd->control_sock,
+				stream->relayd_stream_id, padding, payload,
+				payload_len);
+	} else {
+		init_relayd_data_hdr(stream, payload_len, padding, &data_hdr);
+		ret = relayd_send_data_packet(&relayd->data_sock, &data_hdr,
+				payload, payload_len);
+		if (ret == 0) {
+			++stream->next_net_seq_num;
+		}
+	}
+
+	return ret;
+}
+
 /*
  * Trigger a dump of the metadata content. Following/during the succesful
  * completion of this call, the metadata poll thread will start receiving
@@ -1117,67 +1361,101 @@ int consumer_add_channel(struct lttng_consumer_channel *channel,
 }
 
 /*
- * Allocate the pollfd structure and the local view of the out fds to avoid
- * doing a lookup in the linked list and concurrency issues when writing is
- * needed. Called with consumer_data.lock held.
+ * Data streams monitored by the data thread. Only accessed by that thread.
+ */
+struct data_stream_poll_set {
+	struct lttng_consumer_data_thread *thread;
+	struct lttng_poll_event events;
+	/* Monitored streams indexed by wait fd. */
+	struct lttng_ht *streams_by_wait_fd;
+	/*
+	 * Streams to consume during the current iteration of the data thread:
+	 * streams for which events were caught on the wait fd and streams that
+	 * must be consumed regardless of their wait fd (has_data or
+	 * hangup_flush_done is set).
+	 */
+	struct cds_list_head ready_streams;
+};
+
+/*
+ * Add a data stream to the streams monitored by the data thread.
  *
- * Returns the number of fds in the structures.
+ * Return 0 on success else a negative value.
  */
-static int update_poll_array(struct lttng_consumer_local_data *ctx,
-		struct pollfd **pollfd, struct lttng_consumer_stream **local_stream,
-		struct lttng_ht *ht, int *nb_inactive_fd)
+static int data_stream_poll_set_add(struct data_stream_poll_set *set,
+		struct lttng_consumer_stream *stream)
 {
-	int i = 0;
-	struct lttng_ht_iter iter;
-	struct lttng_consumer_stream *stream;
+	int ret;
 
-	assert(ctx);
-	assert(ht);
-	assert(pollfd);
-	assert(local_stream);
+	DBG("Adding data stream %d to poll set", stream->wait_fd);
+
+	ret = lttng_poll_add(&set->events, stream->wait_fd,
+			LPOLLIN | LPOLLPRI);
+	if (ret < 0) {
+		ERR("Failed to add data stream %" PRIu64 " to poll set",
+				stream->key);
+		goto end;
+	}
 
-	DBG("Updating poll fd array");
-	*nb_inactive_fd = 0;
+	CDS_INIT_LIST_HEAD(&stream->ready_node);
+	stream->poll_revents = 0;
+	stream->io_uring = set->thread->io_uring;
+	lttng_ht_node_init_u64(&stream->node_wait_fd, stream->wait_fd);
 	rcu_read_lock();
-	cds_lfht_for_each_entry(ht->ht, &iter.iter, stream, node.node) {
-		/*
-		 * Only active streams with an active end point can be added to the
-		 * poll set and local stream storage of the thread.
-		 *
-		 * There is a potential race here for endpoint_status to be updated
-		 * just after the check. However, this is OK since the stream(s) will
-		 * be deleted once the thread is notified that the end point state has
-		 * changed where this function will be called back again.
-		 *
-		 * We track the number of inactive FDs because they still need to be
-		 * closed by the polling thread after a wakeup on the data_pipe or
-		 * metadata_pipe.
-		 */
-		if (stream->endpoint_status == CONSUMER_ENDPOINT_INACTIVE) {
-			(*nb_inactive_fd)++;
-			continue;
-		}
+	lttng_ht_add_unique_u64(set->streams_by_wait_fd, &stream->node_wait_fd);
+	rcu_read_unlock();
+end:
+	return ret;
+}
+
+/*
+ * Remove a data stream from the streams monitored by the data thread and
+ * delete it.
+ */
+static void data_stream_poll_set_del(struct data_stream_poll_set *set,
+		struct lttng_consumer_stream *stream)
+{
+	struct lttng_ht_iter iter;
+
+	cds_list_del(&stream->ready_node);
+	(void) lttng_poll_del(&set->events, stream->wait_fd);
+	rcu_read_lock();
+	iter.iter.node = &stream->node_wait_fd.node;
+	(void) lttng_ht_del(set->streams_by_wait_fd, &iter);
+	rcu_read_unlock();
+
+	consumer_del_stream(stream, data_ht);
+
+	if (CMM_LOAD_SHARED(consumer_quit)) {
 		/*
-		 * This clobbers way too much the debug output. Uncomment that if you
-		 * need it for debugging purposes.
+		 * The data threads exit once every data stream is deleted;
+		 * wake them up to test it.
 		 */
-		(*pollfd)[i].fd = stream->wait_fd;
-		(*pollfd)[i].events = POLLIN | POLLPRI;
-		local_stream[i] = stream;
-		i++;
+		notify_data_threads(set->thread->ctx);
 	}
-	rcu_read_unlock();
+}
 
-	/*
-	 * Insert the consumer_data_pipe at the end of the array and don't
-	 * increment i so nb_fd is the number of real FD.
-	 */
-	(*pollfd)[i].fd = lttng_pipe_get_readfd(ctx->consumer_data_pipe);
-	(*pollfd)[i].events = POLLIN | POLLPRI;
+/*
+ * Look up a monitored data stream by wait fd.
+ *
+ * RCU read side lock must be held across this call and while using the
+ * returned object.
+ */
+static struct lttng_consumer_stream *data_stream_poll_set_find(
+		struct data_stream_poll_set *set, int wait_fd)
+{
+	struct lttng_ht_iter iter;
+	struct lttng_ht_node_u64 *node;
+	uint64_t key = (uint64_t) wait_fd;
+
+	lttng_ht_lookup(set->streams_by_wait_fd, &key, &iter);
+	node = lttng_ht_iter_get_node_u64(&iter);
+	if (!node) {
+		return NULL;
+	}
 
-	(*pollfd)[i + 1].fd = lttng_pipe_get_readfd(ctx->consumer_wakeup_pipe);
-	(*pollfd)[i + 1].events = POLLIN | POLLPRI;
-	return i;
+	return caa_container_of(node, struct lttng_consumer_stream,
+			node_wait_fd);
 }
 
 /*
@@ -1379,9 +1657,11 @@ struct lttng_consumer_local_data *lttng_consumer_create(
 			struct lttng_consumer_local_data *ctx, bool locked_by_caller),
 		int (*recv_channel)(struct lttng_consumer_channel *channel),
 		int (*recv_stream)(struct lttng_consumer_stream *stream),
-		int (*update_stream)(uint64_t stream_key, uint32_t state))
+		int (*update_stream)(uint64_t stream_key, uint32_t state),
+		unsigned int data_thread_count)
 {
 	int ret;
+	unsigned int i;
 	struct lttng_consumer_local_data *ctx;
 
 	assert(consumer_data.type == LTTNG_CONSUMER_UNKNOWN ||
@@ -1403,15 +1683,23 @@ struct lttng_consumer_local_data *lttng_consumer_create(
 	ctx->on_recv_stream = recv_stream;
 	ctx->on_update_stream = update_stream;
 
-	ctx->consumer_data_pipe = lttng_pipe_open(0);
-	if (!ctx->consumer_data_pipe) {
-		goto error_poll_pipe;
+	assert(data_thread_count > 0);
+	ctx->data_threads = zmalloc(data_thread_count *
+			sizeof(*ctx->data_threads));
+	if (!ctx->data_threads) {
+		PERROR("allocating data threads");
+		goto error_data_threads;
 	}
 
-	ctx->consumer_wakeup_pipe = lttng_pipe_open(0);
-	if (!ctx->consumer_wakeup_pipe) {
-		goto error_wakeup_pipe;
+	for (i = 0; i < data_thread_count; i++) {
+		ctx->data_threads[i].ctx = ctx;
+		ctx->data_threads[i].data_pipe = lttng_pipe_open(0);
+		if (!ctx->data_threads[i].data_pipe) {
+			goto error_poll_pipe;
+		}
+		ctx->data_thread_count++;
 	}
+	ctx->running_data_thread_count = data_thread_count;
 
 	ret = pipe(ctx->consumer_should_quit);
 	if (ret < 0) {
@@ -1439,10 +1727,12 @@ error_metadata_pipe:
 error_channel_pipe:
 	utils_close_pipe(ctx->consumer_should_quit);
 error_quit_pipe:
-	lttng_pipe_destroy(ctx->consumer_wakeup_pipe);
-error_wakeup_pipe:
-	lttng_pipe_destroy(ctx->consumer_data_pipe);
 error_poll_pipe:
+	for (i = 0; i < ctx->data_thread_count; i++) {
+		lttng_pipe_destroy(ctx->data_threads[i].data_pipe);
+	}
+	free(ctx->data_threads);
+error_data_threads:
 	free(ctx);
 error:
 	return NULL;
@@ -1505,6 +1795,7 @@ static void destroy_metadata_stream_ht(struct lttng_ht *ht)
 void lttng_consumer_destroy(struct lttng_consumer_local_data *ctx)
 {
 	int ret;
+	unsigned int i;
 
 	DBG("Consumer destroying it. Closing everything.");
 
@@ -1524,9 +1815,11 @@ void lttng_consumer_destroy(struct lttng_consumer_local_data *ctx)
 		PERROR("close");
 	}
 	utils_close_pipe(ctx->consumer_channel_pipe);
-	lttng_pipe_destroy(ctx->consumer_data_pipe);
+	for (i = 0; i < ctx->data_thread_count; i++) {
+		lttng_pipe_destroy(ctx->data_threads[i].data_pipe);
+	}
+	free(ctx->data_threads);
 	lttng_pipe_destroy(ctx->consumer_metadata_pipe);
-	lttng_pipe_destroy(ctx->consumer_wakeup_pipe);
 	utils_close_pipe(ctx->consumer_should_quit);
 
 	unlink(ctx->consumer_command_sock_path);
@@ -1571,6 +1864,78 @@ end:
 	return (int) ret;
 }
 
+/*
+ * Write `len` bytes of `data` at the current position, `offset`, of a local
+ * trace file.
+ *
+ * With io_uring, returns once the data is written; the sub-buffer can then be
+ * released by the caller. The writeout of the data is completed
+ * asynchronously.
+ *
+ * Returns the number of bytes written, or a negative value on error.
+ */
+static ssize_t write_local_data(struct lttng_consumer_stream *stream, int fd,
+		const void *data, size_t len, off_t offset)
+{
+	if (stream->io_uring) {
+		return consumer_io_uring_write(stream->io_uring, fd, data, len,
+				offset);
+	}
+
+	/*
+	 * This call guarantee that len or less is returned. It's impossible to
+	 * receive a ret value that is bigger than len.
+	 */
+	return lttng_write(fd, data, len);
+}
+
+/*
+ * Write a packet to a local trace file.
+ *
+ * When sparse padding is enabled, only the packet's content is written and the
+ * file is extended by the size of its padding. The padding is written if the
+ * file can't be extended.
+ *
+ * Returns the number of bytes of the padded packet written, or a negative value
+ * on error.
+ */
+static ssize_t write_local_packet(struct lttng_consumer_stream *stream, int fd,
+		const struct lttng_buffer_view *buffer, unsigned long padding)
+{
+	ssize_t ret, padding_ret;
+	size_t content_len = buffer->size;
+
+	if (consumer_data.sparse_padding && padding > 0 &&
+			!stream->sparse_padding_unsupported) {
+		content_len -= padding;
+	}
+
+	ret = write_local_data(stream, fd, buffer->data, content_len,
+			stream->out_fd_offset);
+	if (ret < 0 || (size_t) ret != content_len ||
+			content_len == buffer->size) {
+		goto end;
+	}
+
+	if (!utils_append_hole(fd, padding)) {
+		ret = buffer->size;
+		goto end;
+	}
+
+	PERROR("Failed to extend the trace file of stream %" PRIu64 " sparsely, writing padding instead",
+			stream->key);
+	stream->sparse_padding_unsupported = true;
+	padding_ret = write_local_data(stream, fd, buffer->data + content_len,
+			padding, stream->out_fd_offset + content_len);
+	if (padding_ret < 0) {
+		ret = padding_ret;
+		goto end;
+	}
+	ret += padding_ret;
+end:
+	return ret;
+}
+
 /*
  * Mmap the ring buffer, read it and write the data to the tracefile. This is a
  * core function for writing trace buffers to either the local filesystem or
@@ -1612,8 +1977,6 @@ ssize_t lttng_consumer_on_read_subbuffer_mmap(
 
 	/* Handle stream on the relayd if the output is on the network */
 	if (relayd) {
-		unsigned long netlen = subbuf_content_size;
-
 		/*
 		 * Lock the control socket for the complete duration of the function
 		 * since from this point on we will use the socket.
@@ -1622,36 +1985,32 @@ ssize_t lttng_consumer_on_read_subbuffer_mmap(
 			/* Metadata requires the control socket. */
 			pthread_mutex_lock(&relayd->ctrl_sock_mutex);
 			if (stream->reset_metadata_flag) {
-				ret = relayd_reset_metadata(&relayd->control_sock,
-						stream->relayd_stream_id,
-						stream->metadata_version);
+				ret = consumer_relayd_sync_indexes(relayd);
+				if (!ret) {
+					ret = relayd_reset_metadata(
+							&relayd->control_sock,
+							stream->relayd_stream_id,
+							stream->metadata_version);
+				}
 				if (ret < 0) {
 					relayd_hang_up = 1;
 					goto write_error;
 				}
 				stream->reset_metadata_flag = 0;
 			}
-			netlen += sizeof(struct lttcomm_relayd_metadata_payload);
-		}
-
-		ret = write_relayd_stream_header(stream, netlen, padding, relayd);
-		if (ret < 0) {
-			relayd_hang_up = 1;
-			goto write_error;
-		}
-		/* Use the returned socket. */
-		outfd = ret;
-
-		/* Write metadata stream id before payload */
-		if (stream->metadata_flag) {
-			ret = write_relayd_metadata_id(outfd, stream, padding);
-			if (ret < 0) {
-				relayd_hang_up = 1;
-				goto write_error;
-			}
+		} else {
+			pthread_mutex_lock(&relayd->data_sock_mutex);
 		}
 
+		/* The header(s) and payload are sent in a single message. */
 		write_len = subbuf_content_size;
+		ret = write_relayd_packet(stream, buffer->data, write_len,
+				padding, relayd);
+		if (!ret) {
+			ret = write_len;
+		} else {
+			errno = -ret;
+		}
 	} else {
 		/* No streaming; we have to write the full padding. */
 		if (stream->metadata_flag && stream->reset_metadata_flag) {
@@ -1678,13 +2037,18 @@ ssize_t lttng_consumer_on_read_subbuffer_mmap(
 		}
 		stream->tracefile_size_current += buffer->size;
 		write_len = buffer->size;
-	}
 
-	/*
-	 * This call guarantee that len or less is returned. It's impossible to
-	 * receive a ret value that is bigger than len.
-	 */
-	ret = lttng_write(outfd, buffer->data, write_len);
+		if (stream->io_uring && orig_offset >= stream->max_sb_size) {
+			/*
+			 * The page cache release of the previous sub-buffer is
+			 * submitted along with the write of the packet.
+			 */
+			consumer_io_uring_release_range(stream->io_uring,
+					outfd, orig_offset - stream->max_sb_size,
+					stream->max_sb_size);
+		}
+		ret = write_local_packet(stream, outfd, buffer, padding);
+	}
 	DBG("Consumer mmap write() ret %zd (len %zu)", ret, write_len);
 	if (ret < 0 || ((size_t) ret != write_len)) {
 		/*
@@ -1715,7 +2079,10 @@ ssize_t lttng_consumer_on_read_subbuffer_mmap(
 	stream->output_written += ret;
 
 	/* This call is useless on a socket so better save a syscall. */
-	if (!relayd) {
+	if (!relayd && stream->io_uring) {
+		/* The writeout was submitted along with the write. */
+		stream->out_fd_offset += write_len;
+	} else if (!relayd) {
 		/* This won't block, but will start writeout asynchronously */
 		lttng_sync_file_range(outfd, stream->out_fd_offset, write_len,
 				SYNC_FILE_RANGE_WRITE);
@@ -1734,9 +2101,11 @@ write_error:
 	}
 
 end:
-	/* Unlock only if ctrl socket used */
+	/* Unlock the socket used */
 	if (relayd && stream->metadata_flag) {
 		pthread_mutex_unlock(&relayd->ctrl_sock_mutex);
+	} else if (relayd) {
+		pthread_mutex_unlock(&relayd->data_sock_mutex);
 	}
 
 	rcu_read_unlock();
@@ -1802,9 +2171,13 @@ ssize_t lttng_consumer_on_read_subbuffer_splice(
 			pthread_mutex_lock(&relayd->ctrl_sock_mutex);
 
 			if (stream->reset_metadata_flag) {
-				ret = relayd_reset_metadata(&relayd->control_sock,
-						stream->relayd_stream_id,
-						stream->metadata_version);
+				ret = consumer_relayd_sync_indexes(relayd);
+				if (!ret) {
+					ret = relayd_reset_metadata(
+							&relayd->control_sock,
+							stream->relayd_stream_id,
+							stream->metadata_version);
+				}
 				if (ret < 0) {
 					relayd_hang_up = 1;
 					goto write_error;
@@ -1820,6 +2193,8 @@ ssize_t lttng_consumer_on_read_subbuffer_splice(
 			}
 
 			total_len += sizeof(struct lttcomm_relayd_metadata_payload);
+		} else {
+			pthread_mutex_lock(&relayd->data_sock_mutex);
 		}
 
 		ret = write_relayd_stream_header(stream, total_len, padding, relayd);
@@ -1956,6 +2331,8 @@ splice_error:
 end:
 	if (relayd && stream->metadata_flag) {
 		pthread_mutex_unlock(&relayd->ctrl_sock_mutex);
+	} else if (relayd) {
+		pthread_mutex_unlock(&relayd->data_sock_mutex);
 	}
 
 	rcu_read_unlock();
@@ -2228,21 +2605,29 @@ void consumer_add_metadata_stream(struct lttng_consumer_stream *stream)
 /*
  * Delete data stream that are flagged for deletion (endpoint_status).
  */
-static void validate_endpoint_status_data_stream(void)
+static void validate_endpoint_status_data_stream(
+		struct data_stream_poll_set *set)
 {
 	struct lttng_ht_iter iter;
 	struct lttng_consumer_stream *stream;
 
 	DBG("Consumer delete flagged data stream");
 
+	assert(set);
+
+	/*
+	 * Streams that are not monitored yet are validated when they are
+	 * received by the data thread.
+	 */
 	rcu_read_lock();
-	cds_lfht_for_each_entry(data_ht->ht, &iter.iter, stream, node.node) {
+	cds_lfht_for_each_entry(set->streams_by_wait_fd->ht, &iter.iter, stream,
+			node_wait_fd.node) {
 		/* Validate delete flag of the stream */
 		if (stream->endpoint_status == CONSUMER_ENDPOINT_ACTIVE) {
 			continue;
 		}
 		/* Delete it right now */
-		consumer_del_stream(stream, data_ht);
+		data_stream_poll_set_del(set, stream);
 	}
 	rcu_read_unlock();
 }
@@ -2499,17 +2884,13 @@ error_testpoint:
  */
 void *consumer_thread_data_poll(void *data)
 {
-	int num_rdy, num_hup, high_prio, ret, i, err = -1;
-	struct pollfd *pollfd = NULL;
-	/* local view of the streams */
-	struct lttng_consumer_stream **local_stream = NULL, *new_stream = NULL;
-	/* local view of consumer_data.fds_count */
-	int nb_fd = 0;
-	/* 2 for the consumer_data_pipe and wake up pipe */
-	const int nb_pipes_fd = 2;
-	/* Number of FDs with CONSUMER_ENDPOINT_INACTIVE but still open. */
-	int nb_inactive_fd = 0;
-	struct lttng_consumer_local_data *ctx = data;
+	int ret, i, pollfd, err = -1;
+	bool high_prio;
+	uint32_t revents, nb_fd;
+	struct lttng_consumer_data_thread *thread = data;
+	struct lttng_consumer_local_data *ctx = thread->ctx;
+	struct data_stream_poll_set set = { .thread = thread };
+	struct lttng_consumer_stream *stream, *tmp_stream;
 	ssize_t len;
 
 	rcu_register_thread();
@@ -2522,88 +2903,79 @@ void *consumer_thread_data_poll(void *data)
 
 	health_code_update();
 
-	local_stream = zmalloc(sizeof(struct lttng_consumer_stream *));
-	if (local_stream == NULL) {
-		PERROR("local_stream malloc");
+	CDS_INIT_LIST_HEAD(&set.ready_streams);
+	lttng_poll_init(&set.events);
+
+	set.streams_by_wait_fd = lttng_ht_new(0, LTTNG_HT_TYPE_U64);
+	if (!set.streams_by_wait_fd) {
 		goto end;
 	}
 
-	while (1) {
-		health_code_update();
+	/* Size is set to 1 for the data pipe */
+	ret = lttng_poll_create(&set.events, 1, LTTNG_CLOEXEC);
+	if (ret < 0) {
+		ERR("Poll set creation failed");
+		goto end;
+	}
 
-		high_prio = 0;
-		num_hup = 0;
+	ret = lttng_poll_add(&set.events,
+			lttng_pipe_get_readfd(thread->data_pipe),
+			LPOLLIN | LPOLLPRI);
+	if (ret < 0) {
+		goto end;
+	}
 
-		/*
-		 * the fds set has been updated, we need to update our
-		 * local array as well
-		 */
-		pthread_mutex_lock(&consumer_data.lock);
-		if (consumer_data.need_update) {
-			free(pollfd);
-			pollfd = NULL;
+	if (ctx->io_uring_entries) {
+		thread->io_uring = consumer_io_uring_create(
+				ctx->io_uring_entries);
+		if (!thread->io_uring) {
+			WARN("Failed to create io_uring output engine, falling back to synchronous writes");
+		}
+	}
 
-			free(local_stream);
-			local_stream = NULL;
+	while (1) {
+		bool data_pipe_ready = false;
 
-			/* Allocate for all fds */
-			pollfd = zmalloc((consumer_data.stream_count + nb_pipes_fd) * sizeof(struct pollfd));
-			if (pollfd == NULL) {
-				PERROR("pollfd malloc");
-				pthread_mutex_unlock(&consumer_data.lock);
-				goto end;
-			}
+		health_code_update();
 
-			local_stream = zmalloc((consumer_data.stream_count + nb_pipes_fd) *
-					sizeof(struct lttng_consumer_stream *));
-			if (local_stream == NULL) {
-				PERROR("local_stream malloc");
-				pthread_mutex_unlock(&consumer_data.lock);
-				goto end;
-			}
-			ret = update_poll_array(ctx, &pollfd, local_stream,
-					data_ht, &nb_inactive_fd);
-			if (ret < 0) {
-				ERR("Error in allocating pollfd or local_outfds");
-				lttng_consumer_send_error(ctx, LTTCOMM_CONSUMERD_POLL_ERROR);
-				pthread_mutex_unlock(&consumer_data.lock);
-				goto end;
-			}
-			nb_fd = ret;
-			consumer_data.need_update = 0;
-		}
-		pthread_mutex_unlock(&consumer_data.lock);
+		high_prio = false;
 
-		/* No FDs and consumer_quit, consumer_cleanup the thread */
-		if (nb_fd == 0 && nb_inactive_fd == 0 &&
+		/* No streams and consumer_quit, consumer_cleanup the thread */
+		pthread_mutex_lock(&consumer_data.lock);
+		if (consumer_data.stream_count == 0 &&
 				CMM_LOAD_SHARED(consumer_quit) == 1) {
+			pthread_mutex_unlock(&consumer_data.lock);
 			err = 0;	/* All is OK */
 			goto end;
 		}
-		/* poll on the array of fds */
+		pthread_mutex_unlock(&consumer_data.lock);
+
 	restart:
-		DBG("polling on %d fd", nb_fd + nb_pipes_fd);
+		DBG("polling on %u fd", LTTNG_POLL_GETNB(&set.events));
 		if (testpoint(consumerd_thread_data_poll)) {
 			goto end;
 		}
 		health_poll_entry();
-		num_rdy = poll(pollfd, nb_fd + nb_pipes_fd, -1);
-		health_poll_exit();
-		DBG("poll num_rdy : %d", num_rdy);
-		if (num_rdy == -1) {
+		ret = lttng_poll_wait(&set.events, 0);
+		if (ret == 0 && cds_list_empty(&set.ready_streams)) {
 			/*
-			 * Restart interrupted system call.
+			 * No stream is ready; send the indexes queued while
+			 * consuming before waiting for more data.
 			 */
-			if (errno == EINTR) {
-				goto restart;
+			consumer_flush_relayd_indexes();
+			if (thread->io_uring) {
+				consumer_io_uring_submit(thread->io_uring);
 			}
+			ret = lttng_poll_wait(&set.events, -1);
+		}
+		health_poll_exit();
+		DBG("poll num_rdy : %d", ret);
+		if (ret < 0) {
 			PERROR("Poll error");
 			lttng_consumer_send_error(ctx, LTTCOMM_CONSUMERD_POLL_ERROR);
 			goto end;
-		} else if (num_rdy == 0) {
-			DBG("Polling thread timed out");
-			goto end;
 		}
+		nb_fd = ret;
 
 		if (caa_unlikely(data_consumption_paused)) {
 			DBG("Data consumption paused, sleeping...");
@@ -2612,20 +2984,60 @@ void *consumer_thread_data_poll(void *data)
 		}
 
 		/*
-		 * If the consumer_data_pipe triggered poll go directly to the
-		 * beginning of the loop to update the array. We want to prioritize
-		 * array update over low-priority reads.
+		 * Only the streams for which events were caught, along with those
+		 * already known to have data to consume, are visited.
 		 */
-		if (pollfd[nb_fd].revents & (POLLIN | POLLPRI)) {
+		rcu_read_lock();
+		for (i = 0; i < nb_fd; i++) {
+			health_code_update();
+
+			revents = LTTNG_POLL_GETEV(&set.events, i);
+			pollfd = LTTNG_POLL_GETFD(&set.events, i);
+
+			if (pollfd == lttng_pipe_get_readfd(thread->data_pipe)) {
+				if (revents & (LPOLLIN | LPOLLPRI)) {
+					data_pipe_ready = true;
+				}
+				continue;
+			}
+
+			stream = data_stream_poll_set_find(&set, pollfd);
+			if (!stream) {
+				ERR("Unknown data stream wait fd %d", pollfd);
+				continue;
+			}
+
+			/*
+			 * Streams of an inactive end point are deleted once the
+			 * thread is notified that the end point state has changed.
+			 */
+			if (stream->endpoint_status == CONSUMER_ENDPOINT_INACTIVE) {
+				continue;
+			}
+
+			stream->poll_revents = revents;
+			if (cds_list_empty(&stream->ready_node)) {
+				cds_list_add_tail(&stream->ready_node,
+						&set.ready_streams);
+			}
+		}
+		rcu_read_unlock();
+
+		/*
+		 * If the data pipe triggered poll, handle the new stream first. We
+		 * want to prioritize poll set updates over low-priority reads.
+		 */
+		if (data_pipe_ready) {
 			ssize_t pipe_readlen;
+			struct lttng_consumer_stream *new_stream;
 
-			DBG("consumer_data_pipe wake up");
-			pipe_readlen = lttng_pipe_read(ctx->consumer_data_pipe,
+			DBG("Data thread pipe wake up");
+			pipe_readlen = lttng_pipe_read(thread->data_pipe,
 					&new_stream, sizeof(new_stream));
 			if (pipe_readlen < sizeof(new_stream)) {
 				PERROR("Consumer data pipe");
 				/* Continue so we can at least handle the current stream(s). */
-				continue;
+				goto next;
 			}
 
 			/*
@@ -2634,46 +3046,39 @@ void *consumer_thread_data_poll(void *data)
 			 * waking us up to test it.
 			 */
 			if (new_stream == NULL) {
-				validate_endpoint_status_data_stream();
-				continue;
+				validate_endpoint_status_data_stream(&set);
+				goto next;
 			}
 
-			/* Continue to update the local streams and handle prio ones */
-			continue;
-		}
-
-		/* Handle wakeup pipe. */
-		if (pollfd[nb_fd + 1].revents & (POLLIN | POLLPRI)) {
-			char dummy;
-			ssize_t pipe_readlen;
+			if (new_stream->endpoint_status == CONSUMER_ENDPOINT_INACTIVE) {
+				consumer_del_stream(new_stream, data_ht);
+				goto next;
+			}
 
-			pipe_readlen = lttng_pipe_read(ctx->consumer_wakeup_pipe, &dummy,
-					sizeof(dummy));
-			if (pipe_readlen < 0) {
-				PERROR("Consumer data wakeup pipe");
+			ret = data_stream_poll_set_add(&set, new_stream);
+			if (ret < 0) {
+				consumer_del_stream(new_stream, data_ht);
 			}
-			/* We've been awakened to handle stream(s). */
-			ctx->has_wakeup = 0;
+
+			/* Continue to update the poll set and handle prio ones */
+			goto next;
 		}
 
 		/* Take care of high priority channels first. */
-		for (i = 0; i < nb_fd; i++) {
+		cds_list_for_each_entry_safe(stream, tmp_stream,
+				&set.ready_streams, ready_node) {
 			health_code_update();
 
-			if (local_stream[i] == NULL) {
-				continue;
-			}
-			if (pollfd[i].revents & POLLPRI) {
-				DBG("Urgent read on fd %d", pollfd[i].fd);
-				high_prio = 1;
-				len = ctx->on_buffer_ready(local_stream[i], ctx, false);
+			if (stream->poll_revents & LPOLLPRI) {
+				DBG("Urgent read on fd %d", stream->wait_fd);
+				high_prio = true;
+				len = ctx->on_buffer_ready(stream, ctx, false);
 				/* it's ok to have an unavailable sub-buffer */
 				if (len < 0 && len != -EAGAIN && len != -ENODATA) {
 					/* Clean the stream and free it. */
-					consumer_del_stream(local_stream[i], data_ht);
-					local_stream[i] = NULL;
+					data_stream_poll_set_del(&set, stream);
 				} else if (len > 0) {
-					local_stream[i]->data_read = 1;
+					stream->data_read = 1;
 				}
 			}
 		}
@@ -2683,78 +3088,73 @@ void *consumer_thread_data_poll(void *data)
 		 * for more high prio data.
 		 */
 		if (high_prio) {
-			continue;
+			goto next;
 		}
 
 		/* Take care of low priority channels. */
-		for (i = 0; i < nb_fd; i++) {
+		cds_list_for_each_entry_safe(stream, tmp_stream,
+				&set.ready_streams, ready_node) {
 			health_code_update();
 
-			if (local_stream[i] == NULL) {
-				continue;
-			}
-			if ((pollfd[i].revents & POLLIN) ||
-					local_stream[i]->hangup_flush_done ||
-					local_stream[i]->has_data) {
-				DBG("Normal read on fd %d", pollfd[i].fd);
-				len = ctx->on_buffer_ready(local_stream[i], ctx, false);
+			if ((stream->poll_revents & LPOLLIN) ||
+					stream->hangup_flush_done ||
+					stream->has_data) {
+				DBG("Normal read on fd %d", stream->wait_fd);
+				len = ctx->on_buffer_ready(stream, ctx, false);
 				/* it's ok to have an unavailable sub-buffer */
 				if (len < 0 && len != -EAGAIN && len != -ENODATA) {
 					/* Clean the stream and free it. */
-					consumer_del_stream(local_stream[i], data_ht);
-					local_stream[i] = NULL;
+					data_stream_poll_set_del(&set, stream);
 				} else if (len > 0) {
-					local_stream[i]->data_read = 1;
+					stream->data_read = 1;
 				}
 			}
 		}
 
 		/* Handle hangup and errors */
-		for (i = 0; i < nb_fd; i++) {
+		cds_list_for_each_entry_safe(stream, tmp_stream,
+				&set.ready_streams, ready_node) {
 			health_code_update();
 
-			if (local_stream[i] == NULL) {
-				continue;
-			}
-			if (!local_stream[i]->hangup_flush_done
-					&& (pollfd[i].revents & (POLLHUP | POLLERR | POLLNVAL))
+			if (!stream->hangup_flush_done
+					&& (stream->poll_revents & (LPOLLHUP | LPOLLERR))
 					&& (consumer_data.type == LTTNG_CONSUMER32_UST
 						|| consumer_data.type == LTTNG_CONSUMER64_UST)) {
 				DBG("fd %d is hup|err|nval. Attempting flush and read.",
-						pollfd[i].fd);
-				lttng_ustconsumer_on_stream_hangup(local_stream[i]);
+						stream->wait_fd);
+				lttng_ustconsumer_on_stream_hangup(stream);
 				/* Attempt read again, for the data we just flushed. */
-				local_stream[i]->data_read = 1;
+				stream->data_read = 1;
 			}
 			/*
 			 * If the poll flag is HUP/ERR/NVAL and we have
 			 * read no data in this pass, we can remove the
 			 * stream from its hash table.
 			 */
-			if ((pollfd[i].revents & POLLHUP)) {
-				DBG("Polling fd %d tells it has hung up.", pollfd[i].fd);
-				if (!local_stream[i]->data_read) {
-					consumer_del_stream(local_stream[i], data_ht);
-					local_stream[i] = NULL;
-					num_hup++;
+			if ((stream->poll_revents & LPOLLHUP)) {
+				DBG("Polling fd %d tells it has hung up.", stream->wait_fd);
+				if (!stream->data_read) {
+					data_stream_poll_set_del(&set, stream);
 				}
-			} else if (pollfd[i].revents & POLLERR) {
-				ERR("Error returned in polling fd %d.", pollfd[i].fd);
-				if (!local_stream[i]->data_read) {
-					consumer_del_stream(local_stream[i], data_ht);
-					local_stream[i] = NULL;
-					num_hup++;
-				}
-			} else if (pollfd[i].revents & POLLNVAL) {
-				ERR("Polling fd %d tells fd is not open.", pollfd[i].fd);
-				if (!local_stream[i]->data_read) {
-					consumer_del_stream(local_stream[i], data_ht);
-					local_stream[i] = NULL;
-					num_hup++;
+			} else if (stream->poll_revents & LPOLLERR) {
+				ERR("Error returned in polling fd %d.", stream->wait_fd);
+				if (!stream->data_read) {
+					data_stream_poll_set_del(&set, stream);
 				}
 			}
-			if (local_stream[i] != NULL) {
-				local_stream[i]->data_read = 0;
+		}
+
+	next:
+		/*
+		 * Only keep the streams which must be consumed regardless of
+		 * the events on their wait fd.
+		 */
+		cds_list_for_each_entry_safe(stream, tmp_stream,
+				&set.ready_streams, ready_node) {
+			stream->data_read = 0;
+			stream->poll_revents = 0;
+			if (!stream->hangup_flush_done && !stream->has_data) {
+				cds_list_del_init(&stream->ready_node);
 			}
 		}
 	}
@@ -2762,18 +3162,37 @@ void *consumer_thread_data_poll(void *data)
 	err = 0;
 end:
 	DBG("polling thread exiting");
-	free(pollfd);
-	free(local_stream);
+	lttng_poll_clean(&set.events);
+	if (set.streams_by_wait_fd) {
+		struct lttng_ht_iter iter;
+
+		/*
+		 * The streams themselves are deleted along with the data stream
+		 * hash table.
+		 */
+		rcu_read_lock();
+		cds_lfht_for_each_entry(set.streams_by_wait_fd->ht, &iter.iter,
+				stream, node_wait_fd.node) {
+			stream->io_uring = NULL;
+			(void) lttng_ht_del(set.streams_by_wait_fd, &iter);
+		}
+		rcu_read_unlock();
+		lttng_ht_destroy(set.streams_by_wait_fd);
+	}
+	consumer_io_uring_destroy(thread->io_uring);
+	thread->io_uring = NULL;
 
 	/*
-	 * Close the write side of the pipe so epoll_wait() in
-	 * consumer_thread_metadata_poll can catch it. The thread is monitoring the
-	 * read side of the pipe. If we close them both, epoll_wait strangely does
-	 * not return and could create a endless wait period if the pipe is the
-	 * only tracked fd in the poll set. The thread will take care of closing
-	 * the read side.
+	 * Once the last data thread exits, close the write side of the pipe so
+	 * epoll_wait() in consumer_thread_metadata_poll can catch it. The thread
+	 * is monitoring the read side of the pipe. If we close them both,
+	 * epoll_wait strangely does not return and could create a endless wait
+	 * period if the pipe is the only tracked fd in the poll set. The thread
+	 * will take care of closing the read side.
 	 */
-	(void) lttng_pipe_write_close(ctx->consumer_metadata_pipe);
+	if (uatomic_sub_return(&ctx->running_data_thread_count, 1) == 0) {
+		(void) lttng_pipe_write_close(ctx->consumer_metadata_pipe);
+	}
 
 error_testpoint:
 	if (err) {
@@ -3279,7 +3698,7 @@ end:
 	 * Notify the data poll thread to poll back again and test the
 	 * consumer_quit state that we just set so to quit gracefully.
 	 */
-	notify_thread_lttng_pipe(ctx->consumer_data_pipe);
+	notify_data_threads(ctx);
 
 	notify_channel_pipe(ctx, NULL, -1, CONSUMER_CHANNEL_QUIT);
 
@@ -3735,9 +4154,16 @@ int consumer_data_pending(uint64_t id)
 	struct lttng_consumer_stream *stream;
 	struct consumer_relayd_sock_pair *relayd = NULL;
 	int (*data_pending)(struct lttng_consumer_stream *);
+	struct lttng_dynamic_array relayd_streams;
+	unsigned int is_data_pending = 0;
+	size_t i, stream_count;
 
 	DBG("Consumer data pending command on session id %" PRIu64, id);
 
+	/* struct lttcomm_relayd_data_pending_stream in host byte order. */
+	lttng_dynamic_array_init(&relayd_streams,
+			sizeof(struct lttcomm_relayd_data_pending_stream), NULL);
+
 	rcu_read_lock();
 	pthread_mutex_lock(&consumer_data.lock);
 
@@ -3757,6 +4183,13 @@ int consumer_data_pending(uint64_t id)
 	/* Ease our life a bit */
 	ht = consumer_data.stream_list_ht;
 
+	/*
+	 * The relayd object is freed through call_rcu() and can thus be used
+	 * once the consumer data lock is released as long as the RCU read-side
+	 * lock is held.
+	 */
+	relayd = find_relayd_by_session_id(id);
+
 	cds_lfht_for_each_entry_duplicate(ht->ht,
 			ht->hash_fct(&id, lttng_ht_seed),
 			ht->match_fct, &id,
@@ -3775,65 +4208,115 @@ int consumer_data_pending(uint64_t id)
 			ret = data_pending(stream);
 			if (ret == 1) {
 				pthread_mutex_unlock(&stream->lock);
+				pthread_mutex_unlock(&consumer_data.lock);
 				goto data_pending;
 			}
 		}
 
+		if (relayd) {
+			const struct lttcomm_relayd_data_pending_stream relayd_stream = {
+				.stream_id = stream->relayd_stream_id,
+				.last_net_seq_num = stream->next_net_seq_num - 1,
+				.is_metadata = !!stream->metadata_flag,
+			};
+
+			ret = lttng_dynamic_array_add_element(&relayd_streams,
+					&relayd_stream);
+			if (ret) {
+				ERR("Failed to add stream to relayd data pending check");
+				pthread_mutex_unlock(&stream->lock);
+				pthread_mutex_unlock(&consumer_data.lock);
+				goto data_not_pending;
+			}
+		}
+
 		pthread_mutex_unlock(&stream->lock);
 	}
 
-	relayd = find_relayd_by_session_id(id);
-	if (relayd) {
-		unsigned int is_data_inflight = 0;
+	/*
+	 * The streams to check were copied; don't hold the consumer data lock
+	 * during the exchanges with the relayd.
+	 */
+	pthread_mutex_unlock(&consumer_data.lock);
 
-		/* Send init command for data pending. */
-		pthread_mutex_lock(&relayd->ctrl_sock_mutex);
-		ret = relayd_begin_data_pending(&relayd->control_sock,
-				relayd->relayd_session_id);
-		if (ret < 0) {
-			pthread_mutex_unlock(&relayd->ctrl_sock_mutex);
-			/* Communication error thus the relayd so no data pending. */
-			goto data_not_pending;
-		}
+	if (!relayd) {
+		goto data_not_pending;
+	}
 
-		cds_lfht_for_each_entry_duplicate(ht->ht,
-				ht->hash_fct(&id, lttng_ht_seed),
-				ht->match_fct, &id,
-				&iter.iter, stream, node_session_id.node) {
-			if (stream->metadata_flag) {
-				ret = relayd_quiescent_control(&relayd->control_sock,
-						stream->relayd_stream_id);
-			} else {
-				ret = relayd_data_pending(&relayd->control_sock,
-						stream->relayd_stream_id,
-						stream->next_net_seq_num - 1);
-			}
+	stream_count = lttng_dynamic_array_get_count(&relayd_streams);
 
-			if (ret == 1) {
-				pthread_mutex_unlock(&relayd->ctrl_sock_mutex);
-				goto data_pending;
-			} else if (ret < 0) {
-				ERR("Relayd data pending failed. Cleaning up relayd %" PRIu64".", relayd->net_seq_idx);
-				lttng_consumer_cleanup_relayd(relayd);
-				pthread_mutex_unlock(&relayd->ctrl_sock_mutex);
-				goto data_not_pending;
-			}
-		}
+	/* Send init command for data pending. */
+	pthread_mutex_lock(&relayd->ctrl_sock_mutex);
+	ret = consumer_relayd_sync_indexes(relayd);
+	if (ret < 0) {
+		pthread_mutex_unlock(&relayd->ctrl_sock_mutex);
+		/* Communication error thus the relayd so no data pending. */
+		goto data_not_pending;
+	}
 
-		/* Send end command for data pending. */
-		ret = relayd_end_data_pending(&relayd->control_sock,
-				relayd->relayd_session_id, &is_data_inflight);
+	if (relayd_supports_session_data_pending(&relayd->control_sock)) {
+		/* Check all the streams of the session in a single command. */
+		ret = relayd_session_data_pending(&relayd->control_sock,
+				relayd->relayd_session_id,
+				(const struct lttcomm_relayd_data_pending_stream *)
+						relayd_streams.buffer.data,
+				stream_count, &is_data_pending);
 		pthread_mutex_unlock(&relayd->ctrl_sock_mutex);
 		if (ret < 0) {
-			ERR("Relayd end data pending failed. Cleaning up relayd %" PRIu64".", relayd->net_seq_idx);
+			ERR("Relayd session data pending failed. Cleaning up relayd %" PRIu64".", relayd->net_seq_idx);
 			lttng_consumer_cleanup_relayd(relayd);
 			goto data_not_pending;
 		}
-		if (is_data_inflight) {
+		goto end_relayd;
+	}
+
+	ret = relayd_begin_data_pending(&relayd->control_sock,
+			relayd->relayd_session_id);
+	if (ret < 0) {
+		pthread_mutex_unlock(&relayd->ctrl_sock_mutex);
+		/* Communication error thus the relayd so no data pending. */
+		goto data_not_pending;
+	}
+
+	for (i = 0; i < stream_count; i++) {
+		const struct lttcomm_relayd_data_pending_stream *relayd_stream =
+				lttng_dynamic_array_get_element(&relayd_streams, i);
+
+		if (relayd_stream->is_metadata) {
+			ret = relayd_quiescent_control(&relayd->control_sock,
+					relayd_stream->stream_id);
+		} else {
+			ret = relayd_data_pending(&relayd->control_sock,
+					relayd_stream->stream_id,
+					relayd_stream->last_net_seq_num);
+		}
+
+		if (ret == 1) {
+			pthread_mutex_unlock(&relayd->ctrl_sock_mutex);
 			goto data_pending;
+		} else if (ret < 0) {
+			ERR("Relayd data pending failed. Cleaning up relayd %" PRIu64".", relayd->net_seq_idx);
+			lttng_consumer_cleanup_relayd(relayd);
+			pthread_mutex_unlock(&relayd->ctrl_sock_mutex);
+			goto data_not_pending;
 		}
 	}
 
+	/* Send end command for data pending. */
+	ret = relayd_end_data_pending(&relayd->control_sock,
+			relayd->relayd_session_id, &is_data_pending);
+	pthread_mutex_unlock(&relayd->ctrl_sock_mutex);
+	if (ret < 0) {
+		ERR("Relayd end data pending failed. Cleaning up relayd %" PRIu64".", relayd->net_seq_idx);
+		lttng_consumer_cleanup_relayd(relayd);
+		goto data_not_pending;
+	}
+
+end_relayd:
+	if (is_data_pending) {
+		goto data_pending;
+	}
+
 	/*
 	 * Finding _no_ node in the hash table and no inflight data means that the
 	 * stream(s) have been removed thus data is guaranteed to be available for
@@ -3842,14 +4325,14 @@ int consumer_data_pending(uint64_t id)
 
 data_not_pending:
 	/* Data is available to be read by a viewer. */
-	pthread_mutex_unlock(&consumer_data.lock);
 	rcu_read_unlock();
+	lttng_dynamic_array_reset(&relayd_streams);
 	return 0;
 
 data_pending:
 	/* Data is still being extracted from buffers. */
-	pthread_mutex_unlock(&consumer_data.lock);
 	rcu_read_unlock();
+	lttng_dynamic_array_reset(&relayd_streams);
 	return 1;
 }
 
@@ -4254,11 +4737,16 @@ int lttng_consumer_rotate_channel(struct lttng_consumer_channel *channel,
 		}
 
 		pthread_mutex_lock(&relayd->ctrl_sock_mutex);
-		ret = relayd_rotate_streams(&relayd->control_sock, stream_count,
-				rotating_to_new_chunk ? &next_chunk_id : NULL,
-				(const struct relayd_stream_rotation_position *)
-						stream_rotation_positions.buffer
-								.data);
+		ret = consumer_relayd_sync_indexes(relayd);
+		if (!ret) {
+			ret = relayd_rotate_streams(&relayd->control_sock,
+					stream_count,
+					rotating_to_new_chunk ?
+							&next_chunk_id : NULL,
+					(const struct relayd_stream_rotation_position *)
+							stream_rotation_positions.buffer
+									.data);
+		}
 		pthread_mutex_unlock(&relayd->ctrl_sock_mutex);
 		if (ret < 0) {
 			ERR("Relayd rotate stream failed. Cleaning up relayd %" PRIu64,
@@ -4831,8 +5319,12 @@ enum lttcomm_return_code lttng_consumer_create_trace_chunk(
 		relayd = consumer_find_relayd(*relayd_id);
 		if (relayd) {
 			pthread_mutex_lock(&relayd->ctrl_sock_mutex);
-			ret = relayd_create_trace_chunk(
-					&relayd->control_sock, published_chunk);
+			ret = consumer_relayd_sync_indexes(relayd);
+			if (!ret) {
+				ret = relayd_create_trace_chunk(
+						&relayd->control_sock,
+						published_chunk);
+			}
 			pthread_mutex_unlock(&relayd->ctrl_sock_mutex);
 		} else {
 			ERR("Failed to find relay daemon socket: relayd_id = %" PRIu64, *relayd_id);
@@ -4967,9 +5459,12 @@ enum lttcomm_return_code lttng_consumer_close_trace_chunk(
 		relayd = consumer_find_relayd(*relayd_id);
 		if (relayd) {
 			pthread_mutex_lock(&relayd->ctrl_sock_mutex);
-			ret = relayd_close_trace_chunk(
-					&relayd->control_sock, chunk,
-					path);
+			ret = consumer_relayd_sync_indexes(relayd);
+			if (!ret) {
+				ret = relayd_close_trace_chunk(
+						&relayd->control_sock, chunk,
+						path);
+			}
 			pthread_mutex_unlock(&relayd->ctrl_sock_mutex);
 		} else {
 			ERR("Failed to find relay daemon socket: relayd_id = %" PRIu64,
@@ -5050,8 +5545,11 @@ enum lttcomm_return_code lttng_consumer_trace_chunk_exists(
 	}
 	DBG("Looking up existence of trace chunk on relay daemon");
 	pthread_mutex_lock(&relayd->ctrl_sock_mutex);
-	ret = relayd_trace_chunk_exists(&relayd->control_sock, chunk_id,
-			&chunk_exists_remote);
+	ret = consumer_relayd_sync_indexes(relayd);
+	if (!ret) {
+		ret = relayd_trace_chunk_exists(&relayd->control_sock,
+				chunk_id, &chunk_exists_remote);
+	}
 	pthread_mutex_unlock(&relayd->ctrl_sock_mutex);
 	if (ret < 0) {
 		ERR("Failed to look-up the existence of trace chunk on relay daemon");
@@ -30,6 +30,8 @@
 #include <common/dynamic-array.h>
 
 struct lttng_consumer_local_data;
+struct consumer_io_uring;
+struct lttcomm_relayd_index;
 
 /* Commands for consumer */
 enum lttng_consumer_command {
@@ -105,6 +107,18 @@ struct stream_list {
 
 /* Stub. */
 struct consumer_metadata_cache;
+struct consumer_timer_group;
+
+/*
+ * Periodic channel timer run by the consumer timer thread. The timers of all
+ * channels sharing a type and period are grouped and expire together.
+ */
+struct consumer_channel_timer {
+	/* Node in the group's timer list. Protected by the timers lock. */
+	struct cds_list_head node;
+	/* Group of the timer, NULL when the timer is stopped. */
+	struct consumer_timer_group *group;
+};
 
 struct lttng_consumer_channel {
 	/* Is the channel published in the channel hash tables? */
@@ -186,19 +200,31 @@ struct lttng_consumer_channel {
 
 	/* For UST metadata periodical flush */
 	int switch_timer_enabled;
-	timer_t switch_timer;
+	struct consumer_channel_timer switch_timer;
 	int switch_timer_error;
 
 	/* For the live mode */
 	int live_timer_enabled;
-	timer_t live_timer;
+	struct consumer_channel_timer live_timer;
 	int live_timer_error;
 	/* Channel is part of a live session ? */
 	bool is_live;
 
 	/* For channel monitoring timer. */
 	int monitor_timer_enabled;
-	timer_t monitor_timer;
+	struct consumer_channel_timer monitor_timer;
+	/*
+	 * Last sample sent by the monitor timer, used to omit unchanged
+	 * samples. Only accessed by the timer thread.
+	 */
+	struct {
+		bool sent;
+		/* Batch drop count when the sample was sent. */
+		uint64_t drop_count;
+		/* Monitor periods since the sample was sent. */
+		unsigned int omitted_count;
+		uint64_t highest, lowest, total_consumed;
+	} last_monitor_sample;
 
 	/* On-disk circular buffer */
 	uint64_t tracefile_size;
@@ -409,6 +435,25 @@ struct lttng_consumer_stream {
 	struct lttng_ht_node_u64 node_channel_id;
 	/* HT node used in consumer_data.stream_list_ht */
 	struct lttng_ht_node_u64 node_session_id;
+	/*
+	 * HT node used by the data thread to look up a stream by wait fd and
+	 * node of its list of streams to consume. Only accessed by the data
+	 * thread.
+	 */
+	struct lttng_ht_node_u64 node_wait_fd;
+	struct cds_list_head ready_node;
+	/* Poll events of the wait fd caught by the data thread. */
+	uint32_t poll_revents;
+	/*
+	 * io_uring of the data thread writing the stream's packets to its
+	 * trace file. NULL when the packets are written synchronously.
+	 */
+	struct consumer_io_uring *io_uring;
+	/*
+	 * The stream's trace file can't be extended sparsely; packet padding
+	 * is written.
+	 */
+	bool sparse_padding_unsupported;
 	/* Pointer to associated channel. */
 	struct lttng_consumer_channel *chan;
 	/*
@@ -676,19 +721,46 @@ struct consumer_relayd_sock_pair {
 	struct lttcomm_relayd_sock control_sock;
 
 	/*
-	 * We don't need a mutex at this point since we only splice or write single
-	 * large chunk of data with a header appended at the begining. Moreover,
-	 * this socket is for now only used in a single thread.
+	 * Mutex protecting the data socket. The data streams of a relayd may be
+	 * consumed by different data threads; the header and the payload of a
+	 * packet must not be interleaved with those of another packet.
+	 *
+	 * This is nested INSIDE the stream lock.
 	 */
+	pthread_mutex_t data_sock_mutex;
 	struct lttcomm_relayd_sock data_sock;
 	struct lttng_ht_node_u64 node;
 
+	/*
+	 * Indexes (struct lttcomm_relayd_index) waiting to be sent to the
+	 * relayd as a single batch and number of batches sent for which the
+	 * relayd's reply has not been received yet.
+	 *
+	 * Protected by the control socket mutex.
+	 */
+	struct lttng_dynamic_array pending_indexes;
+	unsigned int unacked_index_batches;
+
 	/* Session id on both sides for the sockets. */
 	uint64_t relayd_session_id;
 	uint64_t sessiond_session_id;
 	struct lttng_consumer_local_data *ctx;
 };
 
+/*
+ * Data stream poll thread. The data streams are partitioned between the data
+ * threads according to their channel; a stream is only consumed by the thread
+ * to which it was handed.
+ */
+struct lttng_consumer_data_thread {
+	pthread_t thread;
+	/* Data stream poll thread pipe. To transfer data stream to the thread */
+	struct lttng_pipe *data_pipe;
+	struct lttng_consumer_local_data *ctx;
+	/* Output engine of the local data streams, NULL if unused. */
+	struct consumer_io_uring *io_uring;
+};
+
 /*
  * UST consumer local data to the program. One or more instance per
  * process.
@@ -753,20 +825,16 @@ struct lttng_consumer_local_data {
 	char *consumer_command_sock_path;
 	/* communication with splice */
 	int consumer_channel_pipe[2];
-	/* Data stream poll thread pipe. To transfer data stream to the thread */
-	struct lttng_pipe *consumer_data_pipe;
-
+	/* Data stream poll threads. */
+	struct lttng_consumer_data_thread *data_threads;
+	unsigned int data_thread_count;
+	/* Number of data threads which have not exited yet. */
+	int running_data_thread_count;
 	/*
-	 * Data thread use that pipe to catch wakeup from read subbuffer that
-	 * detects that there is still data to be read for the stream encountered.
-	 * Before doing so, the stream is flagged to indicate that there is still
-	 * data to be read.
-	 *
-	 * Both pipes (read/write) are owned and used inside the data thread.
+	 * Submission queue size of the io_uring of each data thread. The
+	 * data threads write the packets synchronously when set to 0.
 	 */
-	struct lttng_pipe *consumer_wakeup_pipe;
-	/* Indicate if the wakeup thread has been notified. */
-	unsigned int has_wakeup:1;
+	unsigned int io_uring_entries;
 
 	/* to let the signal handler wake up the fd receiver thread */
 	int consumer_should_quit[2];
@@ -804,11 +872,6 @@ struct lttng_consumer_global_data {
 	struct lttng_ht *channel_ht;
 	/* Channel hash table indexed by session id. */
 	struct lttng_ht *channels_by_session_id_ht;
-	/*
-	 * Flag specifying if the local array of FDs needs update in the
-	 * poll function. Protected by consumer_data.lock.
-	 */
-	unsigned int need_update;
 	enum lttng_consumer_type type;
 
 	/*
@@ -835,6 +898,19 @@ struct lttng_consumer_global_data {
 	 * Trace chunk registry indexed by (session_id, chunk_id).
 	 */
 	struct lttng_trace_chunk_registry *chunk_registry;
+
+	/*
+	 * The padding of the packets written to local trace files is left as
+	 * a hole. Set before the data threads are launched.
+	 */
+	bool sparse_padding;
+
+	/*
+	 * Number of threads copying the streams of a channel to record a
+	 * snapshot. The positions of all the streams of the channel are
+	 * sampled before the copy starts when greater than 1.
+	 */
+	unsigned int snapshot_thread_count;
 };
 
 /*
@@ -971,8 +1047,12 @@ struct lttng_consumer_local_data *lttng_consumer_create(
 			bool locked_by_caller),
 		int (*recv_channel)(struct lttng_consumer_channel *channel),
 		int (*recv_stream)(struct lttng_consumer_stream *stream),
-		int (*update_stream)(uint64_t sessiond_key, uint32_t state));
+		int (*update_stream)(uint64_t sessiond_key, uint32_t state),
+		unsigned int data_thread_count);
 void lttng_consumer_destroy(struct lttng_consumer_local_data *ctx);
+struct lttng_pipe *lttng_consumer_get_data_stream_pipe(
+		struct lttng_consumer_local_data *ctx,
+		const struct lttng_consumer_stream *stream);
 ssize_t lttng_consumer_on_read_subbuffer_mmap(
 		struct lttng_consumer_stream *stream,
 		const struct lttng_buffer_view *buffer,
@@ -1046,6 +1126,10 @@ enum lttcomm_return_code lttng_consumer_trace_chunk_exists(
 		const uint64_t *relayd_id, uint64_t session_id,
 		uint64_t chunk_id);
 void lttng_consumer_cleanup_relayd(struct consumer_relayd_sock_pair *relayd);
+int consumer_relayd_queue_index(struct consumer_relayd_sock_pair *relayd,
+		const struct lttcomm_relayd_index *index);
+int consumer_relayd_sync_indexes(struct consumer_relayd_sock_pair *relayd);
+void consumer_flush_relayd_indexes(void);
 enum lttcomm_return_code lttng_consumer_init_command(
 		struct lttng_consumer_local_data *ctx,
 		const lttng_uuid sessiond_uuid);
@@ -79,6 +79,30 @@
 #define DEFAULT_USTCONSUMERD32_CMD_SOCK_PATH    DEFAULT_USTCONSUMERD32_PATH "/command"
 #define DEFAULT_USTCONSUMERD32_ERR_SOCK_PATH    DEFAULT_USTCONSUMERD32_PATH "/error"
 
+/* Number of data stream consumption threads of a consumer daemon. */
+#define DEFAULT_CONSUMERD_DATA_THREAD_COUNT     1
+#define DEFAULT_CONSUMERD_DATA_THREAD_COUNT_ENV "LTTNG_CONSUMERD_DATA_THREADS"
+
+/*
+ * Submission queue size of the io_uring used by each data thread of a consumer
+ * daemon to write the trace files. 0 disables the io_uring output engine.
+ */
+#define DEFAULT_CONSUMERD_IO_URING_ENTRIES      0
+#define DEFAULT_CONSUMERD_IO_URING_ENTRIES_ENV  "LTTNG_CONSUMERD_IO_URING_ENTRIES"
+
+/*
+ * Set to 1 to extend the local trace files instead of writing the padding of
+ * the packets.
+ */
+#define DEFAULT_CONSUMERD_SPARSE_PADDING_ENV    "LTTNG_CONSUMERD_SPARSE_PADDING"
+
+/*
+ * Number of threads copying the streams of a channel concurrently when
+ * recording a snapshot.
+ */
+#define DEFAULT_CONSUMERD_SNAPSHOT_THREAD_COUNT     1
+#define DEFAULT_CONSUMERD_SNAPSHOT_THREAD_COUNT_ENV "LTTNG_CONSUMERD_SNAPSHOT_THREADS"
+
 /* Relayd path */
 #define DEFAULT_RELAYD_RUNDIR			"%s"
 #define DEFAULT_RELAYD_PATH			DEFAULT_RELAYD_RUNDIR "/relayd"
@@ -98,6 +122,15 @@
  */
 #define DEFAULT_RELAYD_FD_POOL_SIZE_RESERVE	10
 
+/*
+ * Number of worker threads serving the consumerd/sessiond control and data
+ * connections of the relay daemon.
+ */
+#define DEFAULT_RELAYD_WORKER_THREAD_COUNT	1
+
+/* Number of worker threads serving the live viewer connections. */
+#define DEFAULT_RELAYD_LIVE_WORKER_THREAD_COUNT	1
+
 /* Default lttng run directory */
 #define DEFAULT_LTTNG_HOME_ENV_VAR              "LTTNG_HOME"
 #define DEFAULT_LTTNG_FALLBACK_HOME_ENV_VAR	"HOME"
@@ -292,6 +325,13 @@
  */
 #define DEFAULT_DATA_AVAILABILITY_WAIT_TIME_US 200000  /* usec */
 
+/*
+ * Initial period between the checks of the data availability of a session
+ * made by the session daemon on behalf of a client waiting for it. The period
+ * doubles after every check, up to DEFAULT_DATA_AVAILABILITY_WAIT_TIME_US.
+ */
+#define DEFAULT_DATA_PENDING_WAIT_MIN_INTERVAL_US 10000  /* usec */
+
 /*
  * Wait period before retrying the lttng_consumer_flushed_cache when
  * the consumer receives metadata.
@@ -309,12 +349,46 @@
 
 #define DEFAULT_NETWORK_RELAYD_CTRL_MAX_PAYLOAD_SIZE CONFIG_DEFAULT_NETWORK_RELAYD_CTRL_MAX_PAYLOAD_SIZE
 
+/*
+ * Maximal number of packet indexes sent to a relay daemon in a single
+ * RELAYD_SEND_INDEXES command.
+ */
+#define DEFAULT_NETWORK_RELAYD_INDEX_BATCH_SIZE	128
+
+/*
+ * Maximal number of RELAYD_SEND_INDEXES commands that can be in flight,
+ * that is, for which the relay daemon's reply was not received yet.
+ */
+#define DEFAULT_NETWORK_RELAYD_INDEX_BATCH_WINDOW	8
+
 /*
  * Default receiving and sending timeout for an application socket.
  */
 #define DEFAULT_APP_SOCKET_RW_TIMEOUT       CONFIG_DEFAULT_APP_SOCKET_RW_TIMEOUT
 #define DEFAULT_APP_SOCKET_TIMEOUT_ENV      "LTTNG_APP_SOCKET_TIMEOUT"
 
+/*
+ * Maximal number of threads used by the session daemon to update the tracing
+ * configuration of the registered applications concurrently.
+ */
+#define DEFAULT_APP_UPDATE_THREAD_COUNT     1
+#define DEFAULT_APP_UPDATE_THREAD_COUNT_ENV "LTTNG_APP_UPDATE_THREADS"
+
+/*
+ * Number of threads used by the session daemon to process the read-only
+ * client commands (queries) concurrently. With 0, all client commands are
+ * processed by the client thread.
+ */
+#define DEFAULT_CLIENT_QUERY_THREAD_COUNT     0
+#define DEFAULT_CLIENT_QUERY_THREAD_COUNT_ENV "LTTNG_CLIENT_QUERY_THREADS"
+
+/*
+ * Maximal number of idle persistent client connections kept open by the
+ * session daemon, and time after which an idle one is closed.
+ */
+#define DEFAULT_CLIENT_MAX_IDLE_CONNECTIONS       64
+#define DEFAULT_CLIENT_IDLE_CONNECTION_TIMEOUT_MS 60000
+
 #define DEFAULT_UST_STREAM_FD_NUM			2 /* Number of fd per UST stream. */
 
 #define DEFAULT_SNAPSHOT_NAME				"snapshot"
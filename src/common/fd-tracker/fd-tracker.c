@@ -8,6 +8,7 @@
 #include <urcu.h>
 #include <urcu/list.h>
 #include <urcu/rculfhash.h>
+#include <urcu/uatomic.h>
 
 #include <fcntl.h>
 #include <inttypes.h>
@@ -59,17 +60,21 @@ struct fd_tracker {
 	} count;
 	unsigned int capacity;
 	struct {
-		uint64_t uses;
+		/* Updated atomically as it is not protected by the lock. */
+		unsigned long uses;
 		uint64_t misses;
 		/* Failures to suspend or restore fs handles. */
 		uint64_t errors;
 	} stats;
 	/*
-	 * The head of the active_handles list is always the least recently
-	 * used active handle. When an handle is used, it is removed from the
-	 * list and added to the end. When a file has to be suspended, the
-	 * first element in the list is "popped", suspended, and added to the
-	 * list of suspended handles.
+	 * The active_handles list approximates an LRU list using the
+	 * "second chance" (clock) algorithm. Using an active handle only sets
+	 * its `referenced` flag, which does not require the tracker's lock.
+	 *
+	 * When a file has to be suspended, the list is scanned from its head.
+	 * A referenced handle gets its flag cleared and is moved to the end of
+	 * the list. The first unreferenced handle that is not in use is
+	 * suspended and added to the list of suspended handles.
 	 */
 	struct cds_list_head active_handles;
 	struct cds_list_head suspended_handles;
@@ -108,6 +113,11 @@ struct fs_handle_tracked {
 	/* inode number of the file at the time of the handle's creation. */
 	uint64_t ino;
 	bool in_use;
+	/*
+	 * Set when the handle's fd is acquired and cleared by the tracker when
+	 * it looks for a handle to suspend. Accessed without locking.
+	 */
+	bool referenced;
 	/* Offset to which the file should be restored. */
 	off_t offset;
 	struct cds_list_head handles_list_node;
@@ -416,7 +426,8 @@ void fd_tracker_log(struct fd_tracker *tracker)
 	pthread_mutex_lock(&tracker->lock);
 	DBG_NO_LOC("File descriptor tracker");
 	DBG_NO_LOC("  Stats:");
-	DBG_NO_LOC("    uses:            %" PRIu64, tracker->stats.uses);
+	DBG_NO_LOC("    uses:            %lu",
+			uatomic_read(&tracker->stats.uses));
 	DBG_NO_LOC("    misses:          %" PRIu64, tracker->stats.misses);
 	DBG_NO_LOC("    errors:          %" PRIu64, tracker->stats.errors);
 	DBG_NO_LOC("  Tracked:           %u", TRACKED_COUNT(tracker));
@@ -587,12 +598,25 @@ static int fd_tracker_suspend_handles(
 		struct fd_tracker *tracker, unsigned int count)
 {
 	unsigned int left_to_close = count;
-	unsigned int attempts_left = tracker->count.suspendable.active;
-	struct fs_handle_tracked *handle, *tmp;
+	/* Referenced handles are visited a second time. */
+	unsigned int attempts_left = tracker->count.suspendable.active * 2;
 
-	cds_list_for_each_entry_safe(handle, tmp, &tracker->active_handles,
-			handles_list_node) {
+	while (left_to_close > 0 && attempts_left > 0 &&
+			!cds_list_empty(&tracker->active_handles)) {
 		int ret;
+		struct fs_handle_tracked *handle = cds_list_first_entry(
+				&tracker->active_handles,
+				struct fs_handle_tracked, handles_list_node);
+
+		attempts_left--;
+		if (CMM_LOAD_SHARED(handle->referenced)) {
+			/* Give the handle a second chance. */
+			CMM_STORE_SHARED(handle->referenced, false);
+			cds_list_del(&handle->handles_list_node);
+			cds_list_add_tail(&handle->handles_list_node,
+					&tracker->active_handles);
+			continue;
+		}
 
 		fd_tracker_untrack(tracker, handle);
 		ret = fs_handle_tracked_suspend(handle);
@@ -600,11 +624,6 @@ static int fd_tracker_suspend_handles(
 		if (!ret) {
 			left_to_close--;
 		}
-		attempts_left--;
-
-		if (left_to_close == 0 || attempts_left == 0) {
-			break;
-		}
 	}
 	return left_to_close ? -EMFILE : 0;
 }
@@ -827,39 +846,50 @@ static int fs_handle_tracked_get_fd(struct fs_handle *_handle)
 	struct fs_handle_tracked *handle =
 			container_of(_handle, struct fs_handle_tracked, parent);
 
+	uatomic_inc(&handle->tracker->stats.uses);
+
 	/*
-	 * TODO This should be optimized as it is a fairly hot path.
-	 * The fd-tracker's lock should only be taken when a fs_handle is
-	 * restored (slow path). On the fast path (fs_handle is active),
-	 * the only effect on the fd_tracker is marking the handle as the
-	 * most recently used. Currently, it is done by a call to the
-	 * track/untrack helpers, but it should be done atomically.
-	 *
-	 * Note that the lock's nesting order must still be respected here.
-	 * The handle's lock nests inside the tracker's lock.
+	 * Fast path: the handle is active. Its fd can only be closed by
+	 * a suspension, which can't happen while the handle's lock is held
+	 * nor once it is marked as in use. Marking the handle as recently used
+	 * only sets its `referenced` flag, which doesn't require the tracker's
+	 * lock.
 	 */
-	pthread_mutex_lock(&handle->tracker->lock);
 	pthread_mutex_lock(&handle->lock);
 	assert(!handle->in_use);
+	if (handle->fd >= 0) {
+		ret = handle->fd;
+		CMM_STORE_SHARED(handle->referenced, true);
+		handle->in_use = true;
+		pthread_mutex_unlock(&handle->lock);
+		goto end;
+	}
+	pthread_mutex_unlock(&handle->lock);
 
-	handle->tracker->stats.uses++;
+	/*
+	 * Slow path: the handle must be restored. The handle's lock nests
+	 * inside the tracker's lock; the handle's state must be checked again
+	 * as it may have been restored in the meantime.
+	 */
+	pthread_mutex_lock(&handle->tracker->lock);
+	pthread_mutex_lock(&handle->lock);
+	assert(!handle->in_use);
 	if (handle->fd >= 0) {
 		ret = handle->fd;
-		/* Mark as most recently used. */
-		fd_tracker_untrack(handle->tracker, handle);
-		fd_tracker_track(handle->tracker, handle);
 	} else {
 		handle->tracker->stats.misses++;
 		ret = fd_tracker_restore_handle(handle->tracker, handle);
 		if (ret < 0) {
 			handle->tracker->stats.errors++;
-			goto end;
+			goto end_unlock;
 		}
 	}
+	CMM_STORE_SHARED(handle->referenced, true);
 	handle->in_use = true;
-end:
+end_unlock:
 	pthread_mutex_unlock(&handle->lock);
 	pthread_mutex_unlock(&handle->tracker->lock);
+end:
 	return ret;
 }
 
@@ -490,6 +490,15 @@ unsigned long hash_key_str(const void *key, unsigned long seed)
 	return hashlittle(key, strlen((const char *) key), seed);
 }
 
+/*
+ * Hash function for an arbitrary sequence of bytes.
+ */
+LTTNG_HIDDEN
+unsigned long hash_key_bytes(const void *key, size_t len, unsigned long seed)
+{
+	return hashlittle(key, len, seed);
+}
+
 /*
  * Hash function for two uint64_t.
  */
@@ -9,6 +9,7 @@
 
 #define _LGPL_SOURCE
 #include <assert.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <fcntl.h>
@@ -18,12 +19,19 @@
 #include <common/defaults.h>
 #include <common/compat/endian.h>
 #include <common/utils.h>
+#include <common/align.h>
 
 #include "index.h"
 
 #define WRITE_FILE_FLAGS	(O_WRONLY | O_CREAT | O_TRUNC)
 #define READ_ONLY_FILE_FLAGS	O_RDONLY
 
+/*
+ * The mapping of a read-only index file is extended by this amount so that
+ * it is not re-created each time an element is appended to the file.
+ */
+#define READ_ONLY_FILE_MAP_GRANULARITY	(64 * 1024)
+
 static enum lttng_trace_chunk_status _lttng_index_file_create_from_trace_chunk(
 		struct lttng_trace_chunk *chunk,
 		const char *channel_path, const char *stream_name,
@@ -219,14 +227,110 @@ error:
 }
 
 /*
- * Read index values from the given index file.
+ * Update the number of elements present in a read-only index file and extend
+ * its mapping to cover them.
+ *
+ * The relay daemon never truncates an index file that can be read: it is
+ * unlinked before being re-created. The mapping can thus safely be accessed
+ * up to the last element observed.
  *
  * Return 0 on success, -1 on error.
  */
-int lttng_index_file_read(const struct lttng_index_file *index_file,
-		struct ctf_packet_index *element)
+static int update_read_mapping(struct lttng_index_file *index_file)
 {
-	ssize_t ret;
+	int fd, ret = 0;
+	struct stat file_stat;
+	size_t map_len;
+	void *addr;
+	const off_t elements_offset = sizeof(struct ctf_packet_index_file_hdr);
+
+	fd = fs_handle_get_fd(index_file->file);
+	if (fd < 0) {
+		ERR("Failed to restore index file handle");
+		ret = -1;
+		goto end;
+	}
+
+	ret = fstat(fd, &file_stat);
+	if (ret < 0) {
+		PERROR("Failed to stat index file");
+		goto end_put_fd;
+	}
+
+	if (file_stat.st_size <= elements_offset) {
+		index_file->read.element_count = 0;
+		goto end_put_fd;
+	}
+
+	index_file->read.element_count = (file_stat.st_size - elements_offset) /
+			index_file->element_len;
+	if (file_stat.st_size <= index_file->read.len) {
+		goto end_put_fd;
+	}
+
+	map_len = ALIGN((size_t) file_stat.st_size,
+			READ_ONLY_FILE_MAP_GRANULARITY);
+	addr = mmap(NULL, map_len, PROT_READ, MAP_SHARED, fd, 0);
+	if (addr == MAP_FAILED) {
+		PERROR("Failed to map index file");
+		ret = -1;
+		goto end_put_fd;
+	}
+
+	if (index_file->read.addr) {
+		ret = munmap(index_file->read.addr, index_file->read.len);
+		if (ret) {
+			PERROR("Failed to unmap index file");
+		}
+	}
+	index_file->read.addr = addr;
+	index_file->read.len = map_len;
+	ret = 0;
+
+end_put_fd:
+	fs_handle_put_fd(index_file->file);
+end:
+	return ret;
+}
+
+/*
+ * Get the number of elements of a read-only index file.
+ *
+ * Return 0 on success, -1 on error.
+ */
+int lttng_index_file_get_element_count(struct lttng_index_file *index_file,
+		uint64_t *element_count)
+{
+	int ret;
+
+	assert(element_count);
+
+	if (!index_file->file) {
+		ret = -1;
+		goto end;
+	}
+
+	ret = update_read_mapping(index_file);
+	if (ret) {
+		goto end;
+	}
+
+	*element_count = index_file->read.element_count;
+end:
+	return ret;
+}
+
+/*
+ * Read the index values of the element at position `element_index` of a
+ * read-only index file. Elements can be accessed in any order; only reading
+ * past the elements observed so far requires system calls.
+ *
+ * Return 0 on success, -1 on error.
+ */
+int lttng_index_file_read_element(struct lttng_index_file *index_file,
+		uint64_t element_index, struct ctf_packet_index *element)
+{
+	int ret = 0;
 	const size_t len = index_file->element_len;
 
 	assert(element);
@@ -235,21 +339,69 @@ int lttng_index_file_read(const struct lttng_index_file *index_file,
 		goto error;
 	}
 
-	ret = fs_handle_read(index_file->file, element, len);
-	if (ret < 0) {
-		PERROR("read index file");
-		goto error;
-	}
-	if (ret < len) {
-		ERR("lttng_read expected %zu, returned %zd", len, ret);
-		goto error;
+	if (element_index >= index_file->read.element_count) {
+		ret = update_read_mapping(index_file);
+		if (ret) {
+			goto error;
+		}
+		if (element_index >= index_file->read.element_count) {
+			ERR("Index element %" PRIu64 " is past the end of the index file (%" PRIu64 " elements)",
+					element_index,
+					index_file->read.element_count);
+			goto error;
+		}
 	}
+
+	memcpy(element, (const char *) index_file->read.addr +
+			sizeof(struct ctf_packet_index_file_hdr) +
+			element_index * len, len);
 	return 0;
 
 error:
 	return -1;
 }
 
+/*
+ * Read the next index values from the given read-only index file.
+ *
+ * Return 0 on success, -1 on error.
+ */
+int lttng_index_file_read(struct lttng_index_file *index_file,
+		struct ctf_packet_index *element)
+{
+	int ret;
+
+	ret = lttng_index_file_read_element(index_file,
+			index_file->read.next_element, element);
+	if (ret) {
+		goto end;
+	}
+
+	index_file->read.next_element++;
+end:
+	return ret;
+}
+
+/*
+ * Position the reader of a read-only index file after its last element.
+ *
+ * Return 0 on success, -1 on error.
+ */
+int lttng_index_file_seek_end(struct lttng_index_file *index_file)
+{
+	int ret;
+	uint64_t element_count;
+
+	ret = lttng_index_file_get_element_count(index_file, &element_count);
+	if (ret) {
+		goto end;
+	}
+
+	index_file->read.next_element = element_count;
+end:
+	return ret;
+}
+
 void lttng_index_file_get(struct lttng_index_file *index_file)
 {
 	urcu_ref_get(&index_file->ref);
@@ -260,6 +412,10 @@ static void lttng_index_file_release(struct urcu_ref *ref)
 	struct lttng_index_file *index_file = caa_container_of(ref,
 			struct lttng_index_file, ref);
 
+	if (index_file->read.addr &&
+			munmap(index_file->read.addr, index_file->read.len)) {
+		PERROR("unmap index file");
+	}
 	if (fs_handle_close(index_file->file)) {
 		PERROR("close index fd");
 	}
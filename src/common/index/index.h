@@ -24,6 +24,18 @@ struct lttng_index_file {
 	uint32_t element_len;
 	struct lttng_trace_chunk *trace_chunk;
 	struct urcu_ref ref;
+	/*
+	 * The elements of read-only index files are accessed through a
+	 * mapping of the file which is extended as the file grows.
+	 */
+	struct {
+		/* Element returned by the next lttng_index_file_read(). */
+		uint64_t next_element;
+		/* Number of elements known to be present in the file. */
+		uint64_t element_count;
+		void *addr;
+		size_t len;
+	} read;
 };
 
 /*
@@ -46,8 +58,13 @@ enum lttng_trace_chunk_status lttng_index_file_create_from_trace_chunk_read_only
 
 int lttng_index_file_write(const struct lttng_index_file *index_file,
 		const struct ctf_packet_index *element);
-int lttng_index_file_read(const struct lttng_index_file *index_file,
+int lttng_index_file_read(struct lttng_index_file *index_file,
 		struct ctf_packet_index *element);
+int lttng_index_file_read_element(struct lttng_index_file *index_file,
+		uint64_t element_index, struct ctf_packet_index *element);
+int lttng_index_file_get_element_count(struct lttng_index_file *index_file,
+		uint64_t *element_count);
+int lttng_index_file_seek_end(struct lttng_index_file *index_file);
 
 void lttng_index_file_get(struct lttng_index_file *index_file);
 void lttng_index_file_put(struct lttng_index_file *index_file);
@@ -32,6 +32,7 @@
 #include <common/relayd/relayd.h>
 #include <common/utils.h>
 #include <common/consumer/consumer-stream.h>
+#include <common/consumer/consumer-snapshot.h>
 #include <common/index/index.h>
 #include <common/consumer/consumer-timer.h>
 #include <common/optional.h>
@@ -137,214 +138,392 @@ error:
 }
 
 /*
- * Take a snapshot of all the stream of a channel
- * RCU read-side lock must be held across this function to ensure existence of
- * channel. The channel lock must be held by the caller.
+ * Attach a stream of a channel being recorded in a snapshot to the channel's
+ * trace chunk and open its output. The stream lock must be held by the caller.
  *
  * Returns 0 on success, < 0 on error
  */
-static int lttng_kconsumer_snapshot_channel(
-		struct lttng_consumer_channel *channel,
-		uint64_t key, char *path, uint64_t relayd_id,
-		uint64_t nb_packets_per_stream,
-		struct lttng_consumer_local_data *ctx)
+static int snapshot_stream_open_output(struct lttng_consumer_stream *stream,
+		char *path, uint64_t relayd_id)
 {
 	int ret;
-	struct lttng_consumer_stream *stream;
-
-	DBG("Kernel consumer snapshot channel %" PRIu64, key);
-
-	rcu_read_lock();
 
-	/* Splice is not supported yet for channel snapshot. */
-	if (channel->output != CONSUMER_CHANNEL_MMAP) {
-		ERR("Unsupported output type for channel \"%s\": mmap output is required to record a snapshot",
-				channel->name);
+	assert(stream->chan->trace_chunk);
+	if (!lttng_trace_chunk_get(stream->chan->trace_chunk)) {
+		/*
+		 * Can't happen barring an internal error as the channel
+		 * holds a reference to the trace chunk.
+		 */
+		ERR("Failed to acquire reference to channel's trace chunk");
 		ret = -1;
 		goto end;
 	}
+	assert(!stream->trace_chunk);
+	stream->trace_chunk = stream->chan->trace_chunk;
 
-	cds_list_for_each_entry(stream, &channel->streams.head, send_node) {
-		unsigned long consumed_pos, produced_pos;
+	/*
+	 * Assign the received relayd ID so we can use it for streaming. The streams
+	 * are not visible to anyone so this is OK to change it.
+	 */
+	stream->net_seq_idx = relayd_id;
+	stream->chan->relayd_id = relayd_id;
+	if (relayd_id != (uint64_t) -1ULL) {
+		ret = consumer_send_relayd_stream(stream, path);
+		if (ret < 0) {
+			ERR("sending stream to relayd");
+			goto end;
+		}
+	} else {
+		ret = consumer_stream_create_output_files(stream, false);
+		if (ret < 0) {
+			goto end;
+		}
+		DBG("Kernel consumer snapshot stream (%" PRIu64 ")",
+				stream->key);
+	}
+end:
+	return ret;
+}
 
-		health_code_update();
+/*
+ * Close the output of a stream recorded in a snapshot and detach it from its
+ * trace chunk. The stream lock must be held by the caller.
+ *
+ * Returns 0 on success, < 0 on error
+ */
+static int snapshot_stream_close_output(struct lttng_consumer_stream *stream)
+{
+	int ret = 0;
+
+	if (stream->net_seq_idx == (uint64_t) -1ULL) {
+		if (stream->out_fd >= 0) {
+			ret = close(stream->out_fd);
+			if (ret < 0) {
+				PERROR("Kernel consumer snapshot close out_fd");
+			}
+			stream->out_fd = -1;
+		}
+	} else {
+		close_relayd_stream(stream);
+		stream->net_seq_idx = (uint64_t) -1ULL;
+	}
+	lttng_trace_chunk_put(stream->trace_chunk);
+	stream->trace_chunk = NULL;
+	return ret;
+}
 
+/*
+ * Flush a stream and sample the positions between which its sub-buffers are
+ * recorded in a snapshot. The stream lock must be held by the caller.
+ *
+ * Returns 0 on success, < 0 on error
+ */
+static int snapshot_stream_sample_positions(
+		struct consumer_snapshot_stream *snapshot_stream,
+		uint64_t nb_packets_per_stream)
+{
+	int ret;
+	struct lttng_consumer_stream *stream = snapshot_stream->stream;
+
+	ret = kernctl_buffer_flush_empty(stream->wait_fd);
+	if (ret < 0) {
 		/*
-		 * Lock stream because we are about to change its state.
+		 * Doing a buffer flush which does not take into
+		 * account empty packets. This is not perfect
+		 * for stream intersection, but required as a
+		 * fall-back when "flush_empty" is not
+		 * implemented by lttng-modules.
 		 */
-		pthread_mutex_lock(&stream->lock);
+		ret = kernctl_buffer_flush(stream->wait_fd);
+		if (ret < 0) {
+			ERR("Failed to flush kernel stream");
+			goto end;
+		}
+	}
 
-		assert(channel->trace_chunk);
-		if (!lttng_trace_chunk_get(channel->trace_chunk)) {
-			/*
-			 * Can't happen barring an internal error as the channel
-			 * holds a reference to the trace chunk.
-			 */
-			ERR("Failed to acquire reference to channel's trace chunk");
-			ret = -1;
-			goto end_unlock;
+	ret = lttng_kconsumer_take_snapshot(stream);
+	if (ret < 0) {
+		ERR("Taking kernel snapshot");
+		goto end;
+	}
+
+	ret = lttng_kconsumer_get_produced_snapshot(stream,
+			&snapshot_stream->produced_pos);
+	if (ret < 0) {
+		ERR("Produced kernel snapshot position");
+		goto end;
+	}
+
+	ret = lttng_kconsumer_get_consumed_snapshot(stream,
+			&snapshot_stream->consumed_pos);
+	if (ret < 0) {
+		ERR("Consumerd kernel snapshot position");
+		goto end;
+	}
+
+	snapshot_stream->consumed_pos = consumer_get_consume_start_pos(
+			snapshot_stream->consumed_pos,
+			snapshot_stream->produced_pos, nb_packets_per_stream,
+			stream->max_sb_size);
+end:
+	return ret;
+}
+
+/*
+ * Copy the sub-buffers of a stream between its sampled positions to its
+ * output. The stream lock must be held by the thread recording the snapshot.
+ *
+ * Returns 0 on success, < 0 on error
+ */
+static int snapshot_stream_copy(
+		struct consumer_snapshot_stream *snapshot_stream, void *data)
+{
+	int ret;
+	struct lttng_consumer_stream *stream = snapshot_stream->stream;
+	unsigned long consumed_pos = snapshot_stream->consumed_pos;
+
+	while ((long) (consumed_pos - snapshot_stream->produced_pos) < 0) {
+		ssize_t read_len;
+		unsigned long len, padded_len;
+		const char *subbuf_addr;
+		struct lttng_buffer_view subbuf_view;
+
+		health_code_update();
+		DBG("Kernel consumer taking snapshot at pos %lu", consumed_pos);
+
+		ret = kernctl_get_subbuf(stream->wait_fd, &consumed_pos);
+		if (ret < 0) {
+			if (ret != -EAGAIN) {
+				PERROR("kernctl_get_subbuf snapshot");
+				goto end;
+			}
+			DBG("Kernel consumer get subbuf failed. Skipping it.");
+			consumed_pos += stream->max_sb_size;
+			snapshot_stream->lost_packets++;
+			continue;
+		}
+
+		ret = kernctl_get_subbuf_size(stream->wait_fd, &len);
+		if (ret < 0) {
+			ERR("Snapshot kernctl_get_subbuf_size");
+			goto error_put_subbuf;
+		}
+
+		ret = kernctl_get_padded_subbuf_size(stream->wait_fd, &padded_len);
+		if (ret < 0) {
+			ERR("Snapshot kernctl_get_padded_subbuf_size");
+			goto error_put_subbuf;
+		}
+
+		ret = get_current_subbuf_addr(stream, &subbuf_addr);
+		if (ret) {
+			goto error_put_subbuf;
 		}
-		assert(!stream->trace_chunk);
-		stream->trace_chunk = channel->trace_chunk;
 
+		subbuf_view = lttng_buffer_view_init(
+				subbuf_addr, 0, padded_len);
+		read_len = lttng_consumer_on_read_subbuffer_mmap(
+				stream, &subbuf_view,
+				padded_len - len);
 		/*
-		 * Assign the received relayd ID so we can use it for streaming. The streams
-		 * are not visible to anyone so this is OK to change it.
+		 * We write the padded len in local tracefiles but the data len
+		 * when using a relay. Display the error but continue processing
+		 * to try to release the subbuffer.
 		 */
-		stream->net_seq_idx = relayd_id;
-		channel->relayd_id = relayd_id;
-		if (relayd_id != (uint64_t) -1ULL) {
-			ret = consumer_send_relayd_stream(stream, path);
-			if (ret < 0) {
-				ERR("sending stream to relayd");
-				goto end_unlock;
+		if (stream->net_seq_idx != (uint64_t) -1ULL) {
+			if (read_len != len) {
+				ERR("Error sending to the relay (ret: %zd != len: %lu)",
+						read_len, len);
 			}
 		} else {
-			ret = consumer_stream_create_output_files(stream,
-					false);
-			if (ret < 0) {
-				goto end_unlock;
+			if (read_len != padded_len) {
+				ERR("Error writing to tracefile (ret: %zd != len: %lu)",
+						read_len, padded_len);
 			}
-			DBG("Kernel consumer snapshot stream (%" PRIu64 ")",
-					stream->key);
 		}
 
-		ret = kernctl_buffer_flush_empty(stream->wait_fd);
+		ret = kernctl_put_subbuf(stream->wait_fd);
 		if (ret < 0) {
-			/*
-			 * Doing a buffer flush which does not take into
-			 * account empty packets. This is not perfect
-			 * for stream intersection, but required as a
-			 * fall-back when "flush_empty" is not
-			 * implemented by lttng-modules.
-			 */
-			ret = kernctl_buffer_flush(stream->wait_fd);
-			if (ret < 0) {
-				ERR("Failed to flush kernel stream");
-				goto end_unlock;
-			}
-			goto end_unlock;
+			ERR("Snapshot kernctl_put_subbuf");
+			goto end;
 		}
+		consumed_pos += stream->max_sb_size;
+	}
 
-		ret = lttng_kconsumer_take_snapshot(stream);
+	ret = 0;
+	goto end;
+
+error_put_subbuf:
+	if (kernctl_put_subbuf(stream->wait_fd) < 0) {
+		ERR("Snapshot kernctl_put_subbuf error path");
+	}
+end:
+	return ret;
+}
+
+/*
+ * Take a snapshot of all the streams of a channel, one after the other.
+ * RCU read-side lock and the channel lock must be held by the caller.
+ *
+ * Returns 0 on success, < 0 on error
+ */
+static int snapshot_channel_sequential(struct lttng_consumer_channel *channel,
+		char *path, uint64_t relayd_id, uint64_t nb_packets_per_stream)
+{
+	int ret;
+	struct lttng_consumer_stream *stream;
+
+	cds_list_for_each_entry(stream, &channel->streams.head, send_node) {
+		struct consumer_snapshot_stream snapshot_stream = {
+			.stream = stream,
+		};
+
+		health_code_update();
+
+		/*
+		 * Lock stream because we are about to change its state.
+		 */
+		pthread_mutex_lock(&stream->lock);
+		ret = snapshot_stream_open_output(stream, path, relayd_id);
 		if (ret < 0) {
-			ERR("Taking kernel snapshot");
 			goto end_unlock;
 		}
 
-		ret = lttng_kconsumer_get_produced_snapshot(stream, &produced_pos);
+		ret = snapshot_stream_sample_positions(&snapshot_stream,
+				nb_packets_per_stream);
 		if (ret < 0) {
-			ERR("Produced kernel snapshot position");
 			goto end_unlock;
 		}
 
-		ret = lttng_kconsumer_get_consumed_snapshot(stream, &consumed_pos);
+		ret = snapshot_stream_copy(&snapshot_stream, NULL);
+		channel->lost_packets += snapshot_stream.lost_packets;
 		if (ret < 0) {
-			ERR("Consumerd kernel snapshot position");
 			goto end_unlock;
 		}
 
-		consumed_pos = consumer_get_consume_start_pos(consumed_pos,
-				produced_pos, nb_packets_per_stream,
-				stream->max_sb_size);
+		ret = snapshot_stream_close_output(stream);
+		if (ret < 0) {
+			goto end_unlock;
+		}
+		pthread_mutex_unlock(&stream->lock);
+	}
 
-		while ((long) (consumed_pos - produced_pos) < 0) {
-			ssize_t read_len;
-			unsigned long len, padded_len;
-			const char *subbuf_addr;
-			struct lttng_buffer_view subbuf_view;
+	return 0;
 
-			health_code_update();
-			DBG("Kernel consumer taking snapshot at pos %lu", consumed_pos);
+end_unlock:
+	pthread_mutex_unlock(&stream->lock);
+	return ret;
+}
 
-			ret = kernctl_get_subbuf(stream->wait_fd, &consumed_pos);
-			if (ret < 0) {
-				if (ret != -EAGAIN) {
-					PERROR("kernctl_get_subbuf snapshot");
-					goto end_unlock;
-				}
-				DBG("Kernel consumer get subbuf failed. Skipping it.");
-				consumed_pos += stream->max_sb_size;
-				stream->chan->lost_packets++;
-				continue;
-			}
+/*
+ * Take a snapshot of all the streams of a channel, sampling the positions of
+ * all the streams before copying them concurrently.
+ * RCU read-side lock and the channel lock must be held by the caller.
+ *
+ * Returns 0 on success, < 0 on error
+ */
+static int snapshot_channel_parallel(struct lttng_consumer_channel *channel,
+		char *path, uint64_t relayd_id, uint64_t nb_packets_per_stream)
+{
+	int ret;
+	size_t i, stream_count = 0, locked_count = 0;
+	struct lttng_consumer_stream *stream;
+	struct consumer_snapshot_stream *snapshot_streams;
 
-			ret = kernctl_get_subbuf_size(stream->wait_fd, &len);
-			if (ret < 0) {
-				ERR("Snapshot kernctl_get_subbuf_size");
-				goto error_put_subbuf;
-			}
+	cds_list_for_each_entry(stream, &channel->streams.head, send_node) {
+		stream_count++;
+	}
 
-			ret = kernctl_get_padded_subbuf_size(stream->wait_fd, &padded_len);
-			if (ret < 0) {
-				ERR("Snapshot kernctl_get_padded_subbuf_size");
-				goto error_put_subbuf;
-			}
+	snapshot_streams = zmalloc(sizeof(*snapshot_streams) * stream_count);
+	if (!snapshot_streams) {
+		PERROR("zmalloc snapshot streams");
+		ret = -ENOMEM;
+		goto end;
+	}
 
-			ret = get_current_subbuf_addr(stream, &subbuf_addr);
-			if (ret) {
-				goto error_put_subbuf;
-			}
+	/*
+	 * The outputs are opened first since it can involve exchanges with
+	 * the relay daemon.
+	 */
+	cds_list_for_each_entry(stream, &channel->streams.head, send_node) {
+		health_code_update();
 
-			subbuf_view = lttng_buffer_view_init(
-					subbuf_addr, 0, padded_len);
-			read_len = lttng_consumer_on_read_subbuffer_mmap(
-					stream, &subbuf_view,
-					padded_len - len);
-			/*
-			 * We write the padded len in local tracefiles but the data len
-			 * when using a relay. Display the error but continue processing
-			 * to try to release the subbuffer.
-			 */
-			if (relayd_id != (uint64_t) -1ULL) {
-				if (read_len != len) {
-					ERR("Error sending to the relay (ret: %zd != len: %lu)",
-							read_len, len);
-				}
-			} else {
-				if (read_len != padded_len) {
-					ERR("Error writing to tracefile (ret: %zd != len: %lu)",
-							read_len, padded_len);
-				}
-			}
+		/*
+		 * Lock stream because we are about to change its state.
+		 */
+		pthread_mutex_lock(&stream->lock);
+		snapshot_streams[locked_count++].stream = stream;
+		ret = snapshot_stream_open_output(stream, path, relayd_id);
+		if (ret < 0) {
+			goto end_close_streams;
+		}
+	}
 
-			ret = kernctl_put_subbuf(stream->wait_fd);
-			if (ret < 0) {
-				ERR("Snapshot kernctl_put_subbuf");
-				goto end_unlock;
-			}
-			consumed_pos += stream->max_sb_size;
+	/* Sample the positions of all the streams as close together as possible. */
+	for (i = 0; i < stream_count; i++) {
+		ret = snapshot_stream_sample_positions(&snapshot_streams[i],
+				nb_packets_per_stream);
+		if (ret < 0) {
+			goto end_close_streams;
 		}
+	}
 
-		if (relayd_id == (uint64_t) -1ULL) {
-			if (stream->out_fd >= 0) {
-				ret = close(stream->out_fd);
-				if (ret < 0) {
-					PERROR("Kernel consumer snapshot close out_fd");
-					goto end_unlock;
-				}
-				stream->out_fd = -1;
-			}
-		} else {
-			close_relayd_stream(stream);
-			stream->net_seq_idx = (uint64_t) -1ULL;
+	ret = consumer_snapshot_copy_streams(snapshot_streams, stream_count,
+			snapshot_stream_copy, NULL);
+	for (i = 0; i < stream_count; i++) {
+		channel->lost_packets += snapshot_streams[i].lost_packets;
+	}
+
+end_close_streams:
+	for (i = 0; i < locked_count; i++) {
+		int close_ret;
+
+		stream = snapshot_streams[i].stream;
+		close_ret = snapshot_stream_close_output(stream);
+		if (close_ret < 0 && !ret) {
+			ret = close_ret;
 		}
-		lttng_trace_chunk_put(stream->trace_chunk);
-		stream->trace_chunk = NULL;
 		pthread_mutex_unlock(&stream->lock);
 	}
+	free(snapshot_streams);
+end:
+	return ret;
+}
 
-	/* All good! */
-	ret = 0;
-	goto end;
+/*
+ * Take a snapshot of all the stream of a channel
+ * RCU read-side lock must be held across this function to ensure existence of
+ * channel. The channel lock must be held by the caller.
+ *
+ * Returns 0 on success, < 0 on error
+ */
+static int lttng_kconsumer_snapshot_channel(
+		struct lttng_consumer_channel *channel,
+		uint64_t key, char *path, uint64_t relayd_id,
+		uint64_t nb_packets_per_stream,
+		struct lttng_consumer_local_data *ctx)
+{
+	int ret;
 
-error_put_subbuf:
-	ret = kernctl_put_subbuf(stream->wait_fd);
-	if (ret < 0) {
-		ERR("Snapshot kernctl_put_subbuf error path");
+	DBG("Kernel consumer snapshot channel %" PRIu64, key);
+
+	rcu_read_lock();
+
+	/* Splice is not supported yet for channel snapshot. */
+	if (channel->output != CONSUMER_CHANNEL_MMAP) {
+		ERR("Unsupported output type for channel \"%s\": mmap output is required to record a snapshot",
+				channel->name);
+		ret = -1;
+		goto end;
+	}
+
+	if (consumer_data.snapshot_thread_count > 1) {
+		ret = snapshot_channel_parallel(channel, path, relayd_id,
+				nb_packets_per_stream);
+	} else {
+		ret = snapshot_channel_sequential(channel, path, relayd_id,
+				nb_packets_per_stream);
 	}
-end_unlock:
-	pthread_mutex_unlock(&stream->lock);
 end:
 	rcu_read_unlock();
 	return ret;
@@ -777,7 +956,8 @@ int lttng_kconsumer_recv_cmd(struct lttng_consumer_local_data *ctx,
 			stream_pipe = ctx->consumer_metadata_pipe;
 		} else {
 			consumer_add_data_stream(new_stream);
-			stream_pipe = ctx->consumer_data_pipe;
+			stream_pipe = lttng_consumer_get_data_stream_pipe(ctx,
+					new_stream);
 		}
 
 		/* Visible to other threads */
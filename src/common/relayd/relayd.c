@@ -46,6 +46,29 @@ bool relayd_supports_get_configuration(const struct lttcomm_relayd_sock *sock)
 	return false;
 }
 
+LTTNG_HIDDEN
+bool relayd_supports_index_batching(const struct lttcomm_relayd_sock *sock)
+{
+	if (sock->major > 2) {
+		return true;
+	} else if (sock->major == 2 && sock->minor >= 13) {
+		return true;
+	}
+	return false;
+}
+
+LTTNG_HIDDEN
+bool relayd_supports_session_data_pending(
+		const struct lttcomm_relayd_sock *sock)
+{
+	if (sock->major > 2) {
+		return true;
+	} else if (sock->major == 2 && sock->minor >= 13) {
+		return true;
+	}
+	return false;
+}
+
 /*
  * Send command. Fill up the header and append the data.
  */
@@ -837,6 +860,88 @@ error:
 	return ret;
 }
 
+/*
+ * Send a data packet to the relayd: the data header and the payload are
+ * gathered in a single message.
+ *
+ * Return 0 on success or else a negative errno value.
+ */
+int relayd_send_data_packet(struct lttcomm_relayd_sock *rsock,
+		const struct lttcomm_relayd_data_hdr *hdr,
+		const void *payload, size_t payload_len)
+{
+	ssize_t ret;
+	struct iovec iov[2];
+
+	/* Code flow error. Safety net. */
+	assert(rsock);
+	assert(hdr);
+
+	if (rsock->sock.fd < 0) {
+		return -ECONNRESET;
+	}
+
+	DBG3("Relayd sending data packet of size %zu", payload_len);
+
+	iov[0].iov_base = (void *) hdr;
+	iov[0].iov_len = sizeof(*hdr);
+	iov[1].iov_base = (void *) payload;
+	iov[1].iov_len = payload_len;
+
+	ret = rsock->sock.ops->sendmsg_iov(&rsock->sock, iov, 2, 0);
+	if (ret < 0) {
+		return -errno;
+	}
+
+	return 0;
+}
+
+/*
+ * Send a metadata packet to the relayd: the metadata command, the metadata
+ * stream id and the payload are gathered in a single message.
+ *
+ * Return 0 on success or else a negative errno value.
+ */
+int relayd_send_metadata_packet(struct lttcomm_relayd_sock *rsock,
+		uint64_t stream_id, uint32_t padding,
+		const void *payload, size_t payload_len)
+{
+	ssize_t ret;
+	struct iovec iov[3];
+	struct lttcomm_relayd_hdr header;
+	struct lttcomm_relayd_metadata_payload metadata_hdr;
+
+	/* Code flow error. Safety net. */
+	assert(rsock);
+
+	if (rsock->sock.fd < 0) {
+		return -ECONNRESET;
+	}
+
+	DBG("Relayd sending metadata packet of size %zu", payload_len);
+
+	memset(&header, 0, sizeof(header));
+	header.cmd = htobe32(RELAYD_SEND_METADATA);
+	header.data_size = htobe64(sizeof(metadata_hdr) + payload_len);
+
+	metadata_hdr.stream_id = htobe64(stream_id);
+	metadata_hdr.padding_size = htobe32(padding);
+
+	iov[0].iov_base = &header;
+	iov[0].iov_len = sizeof(header);
+	iov[1].iov_base = &metadata_hdr;
+	iov[1].iov_len = sizeof(metadata_hdr);
+	iov[2].iov_base = (void *) payload;
+	iov[2].iov_len = payload_len;
+
+	ret = rsock->sock.ops->sendmsg_iov(&rsock->sock, iov, 3, 0);
+	if (ret < 0) {
+		return -errno;
+	}
+
+	return 0;
+}
+
 /*
  * Send close stream command to the relayd.
  */
@@ -1075,9 +1180,107 @@ error:
 	return ret;
 }
 
+/*
+ * Check for data pending for a batch of streams of a session in a single
+ * command. The streams are described in host byte order.
+ *
+ * Return 0 on success and set is_data_pending to 1 if data is pending for any
+ * stream of the session or 0 if not. Return a negative value on error.
+ */
+int relayd_session_data_pending(struct lttcomm_relayd_sock *rsock,
+		uint64_t id,
+		const struct lttcomm_relayd_data_pending_stream *streams,
+		uint32_t stream_count, unsigned int *is_data_pending)
+{
+	int ret, recv_ret;
+	uint32_t i;
+	size_t msg_len;
+	struct lttcomm_relayd_session_data_pending *msg = NULL;
+	struct lttcomm_relayd_generic_reply reply;
+
+	/* Code flow error. Safety net. */
+	assert(rsock);
+	assert(relayd_supports_session_data_pending(rsock));
+
+	DBG("Relayd session data pending for %" PRIu32 " streams", stream_count);
+
+	msg_len = sizeof(*msg) + sizeof(*streams) * stream_count;
+	msg = zmalloc(msg_len);
+	if (!msg) {
+		PERROR("Failed to allocate relayd session data pending command");
+		ret = -1;
+		goto error;
+	}
+
+	msg->session_id = htobe64(id);
+	msg->stream_count = htobe32(stream_count);
+	for (i = 0; i < stream_count; i++) {
+		msg->streams[i].stream_id = htobe64(streams[i].stream_id);
+		msg->streams[i].last_net_seq_num =
+				htobe64(streams[i].last_net_seq_num);
+		msg->streams[i].is_metadata = streams[i].is_metadata;
+	}
+
+	/* Send command */
+	ret = send_command(rsock, RELAYD_SESSION_DATA_PENDING, msg, msg_len, 0);
+	if (ret < 0) {
+		goto error;
+	}
+
+	/* Receive response */
+	ret = recv_reply(rsock, (void *) &reply, sizeof(reply));
+	if (ret < 0) {
+		goto error;
+	}
+
+	recv_ret = be32toh(reply.ret_code);
+	if (recv_ret < 0) {
+		ERR("Relayd session data pending replied error %d", recv_ret);
+		ret = recv_ret;
+		goto error;
+	}
+
+	*is_data_pending = recv_ret;
+
+	DBG("Relayd session data is %s pending", recv_ret ? "" : "NOT");
+
+	ret = 0;
+error:
+	free(msg);
+	return ret;
+}
+
 /*
  * Send index to the relayd.
  */
+/*
+ * Prepare the message describing an index of a relayd stream. The fields of
+ * the message are set in network byte order.
+ */
+LTTNG_HIDDEN
+void relayd_init_index_msg(const struct lttcomm_relayd_sock *rsock,
+		struct lttcomm_relayd_index *msg,
+		const struct ctf_packet_index *index, uint64_t relay_stream_id,
+		uint64_t net_seq_num)
+{
+	memset(msg, 0, sizeof(*msg));
+	msg->relay_stream_id = htobe64(relay_stream_id);
+	msg->net_seq_num = htobe64(net_seq_num);
+
+	/* The index is already in big endian. */
+	msg->packet_size = index->packet_size;
+	msg->content_size = index->content_size;
+	msg->timestamp_begin = index->timestamp_begin;
+	msg->timestamp_end = index->timestamp_end;
+	msg->events_discarded = index->events_discarded;
+	msg->stream_id = index->stream_id;
+
+	if (rsock->minor >= 8) {
+		msg->stream_instance_id = index->stream_instance_id;
+		msg->packet_seq_num = index->packet_seq_num;
+	}
+}
+
 int relayd_send_index(struct lttcomm_relayd_sock *rsock,
 		struct ctf_packet_index *index, uint64_t relay_stream_id,
 		uint64_t net_seq_num)
@@ -1097,22 +1300,8 @@ int relayd_send_index(struct lttcomm_relayd_sock *rsock,
 
 	DBG("Relayd sending index for stream ID %" PRIu64, relay_stream_id);
 
-	memset(&msg, 0, sizeof(msg));
-	msg.relay_stream_id = htobe64(relay_stream_id);
-	msg.net_seq_num = htobe64(net_seq_num);
-
-	/* The index is already in big endian. */
-	msg.packet_size = index->packet_size;
-	msg.content_size = index->content_size;
-	msg.timestamp_begin = index->timestamp_begin;
-	msg.timestamp_end = index->timestamp_end;
-	msg.events_discarded = index->events_discarded;
-	msg.stream_id = index->stream_id;
-
-	if (rsock->minor >= 8) {
-		msg.stream_instance_id = index->stream_instance_id;
-		msg.packet_seq_num = index->packet_seq_num;
-	}
+	relayd_init_index_msg(rsock, &msg, index, relay_stream_id,
+			net_seq_num);
 
 	/* Send command */
 	ret = send_command(rsock, RELAYD_SEND_INDEX, &msg,
@@ -1145,6 +1334,84 @@ error:
 	return ret;
 }
 
+/*
+ * Send a batch of indexes, prepared with relayd_init_index_msg(), to the
+ * relayd.
+ *
+ * The reply to this command is not awaited; it must be received with
+ * relayd_recv_indexes_reply() before any other command expecting a reply is
+ * sent on this socket.
+ *
+ * Return 0 on success else a negative value.
+ */
+int relayd_send_indexes(struct lttcomm_relayd_sock *rsock,
+		const struct lttcomm_relayd_index *indexes,
+		uint32_t index_count)
+{
+	int ret;
+	size_t msg_len;
+	struct lttcomm_relayd_send_indexes *msg = NULL;
+
+	/* Code flow error. Safety net. */
+	assert(rsock);
+	assert(relayd_supports_index_batching(rsock));
+
+	DBG("Relayd sending batch of %" PRIu32 " indexes", index_count);
+
+	msg_len = sizeof(*msg) + sizeof(*indexes) * index_count;
+	msg = zmalloc(msg_len);
+	if (!msg) {
+		PERROR("Failed to allocate relayd index batch");
+		ret = -1;
+		goto error;
+	}
+
+	msg->index_count = htobe32(index_count);
+	memcpy(msg->indexes, indexes, sizeof(*indexes) * index_count);
+
+	ret = send_command(rsock, RELAYD_SEND_INDEXES, msg, msg_len, 0);
+	if (ret < 0) {
+		goto error;
+	}
+
+	ret = 0;
+error:
+	free(msg);
+	return ret;
+}
+
+/*
+ * Receive the reply to the oldest RELAYD_SEND_INDEXES command sent on this
+ * socket.
+ *
+ * Return 0 on success else a negative value.
+ */
+int relayd_recv_indexes_reply(struct lttcomm_relayd_sock *rsock)
+{
+	int ret;
+	struct lttcomm_relayd_generic_reply reply;
+
+	/* Code flow error. Safety net. */
+	assert(rsock);
+
+	ret = recv_reply(rsock, (void *) &reply, sizeof(reply));
+	if (ret < 0) {
+		goto error;
+	}
+
+	reply.ret_code = be32toh(reply.ret_code);
+	if (reply.ret_code != LTTNG_OK) {
+		ret = -1;
+		ERR("Relayd send indexes replied error %d", reply.ret_code);
+	} else {
+		/* Success */
+		ret = 0;
+	}
+
+error:
+	return ret;
+}
+
 /*
  * Ask the relay to reset the metadata trace file (regeneration).
  */
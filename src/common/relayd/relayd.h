@@ -50,6 +50,12 @@ int relayd_start_data(struct lttcomm_relayd_sock *sock);
 int relayd_send_metadata(struct lttcomm_relayd_sock *sock, size_t len);
 int relayd_send_data_hdr(struct lttcomm_relayd_sock *sock,
 		struct lttcomm_relayd_data_hdr *hdr, size_t size);
+int relayd_send_data_packet(struct lttcomm_relayd_sock *rsock,
+		const struct lttcomm_relayd_data_hdr *hdr,
+		const void *payload, size_t payload_len);
+int relayd_send_metadata_packet(struct lttcomm_relayd_sock *rsock,
+		uint64_t stream_id, uint32_t padding,
+		const void *payload, size_t payload_len);
 int relayd_data_pending(struct lttcomm_relayd_sock *sock, uint64_t stream_id,
 		uint64_t last_net_seq_num);
 int relayd_quiescent_control(struct lttcomm_relayd_sock *sock,
@@ -57,6 +63,21 @@ int relayd_quiescent_control(struct lttcomm_relayd_sock *sock,
 int relayd_begin_data_pending(struct lttcomm_relayd_sock *sock, uint64_t id);
 int relayd_end_data_pending(struct lttcomm_relayd_sock *sock, uint64_t id,
 		unsigned int *is_data_inflight);
+bool relayd_supports_session_data_pending(
+		const struct lttcomm_relayd_sock *sock);
+int relayd_session_data_pending(struct lttcomm_relayd_sock *sock,
+		uint64_t id,
+		const struct lttcomm_relayd_data_pending_stream *streams,
+		uint32_t stream_count, unsigned int *is_data_pending);
+bool relayd_supports_index_batching(const struct lttcomm_relayd_sock *sock);
+void relayd_init_index_msg(const struct lttcomm_relayd_sock *rsock,
+		struct lttcomm_relayd_index *msg,
+		const struct ctf_packet_index *index, uint64_t relay_stream_id,
+		uint64_t net_seq_num);
+int relayd_send_indexes(struct lttcomm_relayd_sock *rsock,
+		const struct lttcomm_relayd_index *indexes,
+		uint32_t index_count);
+int relayd_recv_indexes_reply(struct lttcomm_relayd_sock *rsock);
 int relayd_send_index(struct lttcomm_relayd_sock *rsock,
 		struct ctf_packet_index *index, uint64_t relay_stream_id,
 		uint64_t net_seq_num);
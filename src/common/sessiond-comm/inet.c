@@ -37,6 +37,7 @@ static const struct lttcomm_proto_ops inet_ops = {
 	.listen = lttcomm_listen_inet_sock,
 	.recvmsg = lttcomm_recvmsg_inet_sock,
 	.sendmsg = lttcomm_sendmsg_inet_sock,
+	.sendmsg_iov = lttcomm_sendmsg_iov_inet_sock,
 };
 
 unsigned long lttcomm_inet_tcp_timeout;
@@ -443,6 +444,69 @@ ssize_t lttcomm_sendmsg_inet_sock(struct lttcomm_sock *sock, const void *buf,
 	return ret;
 }
 
+/*
+ * Send the buffers described by iov, gathered by the sendmsg API. The send is
+ * resumed until all the data is sent; iov is modified in the process.
+ *
+ * Return the size of sent data or -1 on error.
+ */
+LTTNG_HIDDEN
+ssize_t lttcomm_sendmsg_iov_inet_sock(struct lttcomm_sock *sock,
+		struct iovec *iov, size_t iovcnt, int flags)
+{
+	struct msghdr msg;
+	ssize_t ret, sent = 0;
+	struct sockaddr_in addr;
+
+	memset(&msg, 0, sizeof(msg));
+
+	msg.msg_iov = iov;
+	msg.msg_iovlen = iovcnt;
+
+	switch (sock->proto) {
+	case LTTCOMM_SOCK_UDP:
+		addr = sock->sockaddr.addr.sin;
+		msg.msg_name = (struct sockaddr *) &addr;
+		msg.msg_namelen = sizeof(sock->sockaddr.addr.sin);
+		break;
+	default:
+		break;
+	}
+
+	while (msg.msg_iovlen > 0) {
+		ret = sendmsg(sock->fd, &msg, flags);
+		if (ret < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			/*
+			 * Only warn about EPIPE when quiet mode is deactivated.
+			 * We consider EPIPE as expected.
+			 */
+			if (errno != EPIPE || !lttng_opt_quiet) {
+				PERROR("sendmsg inet");
+			}
+			sent = -1;
+			goto end;
+		}
+		sent += ret;
+
+		/* Skip the buffers sent completely and resume a partial send. */
+		while (msg.msg_iovlen > 0 && ret >= msg.msg_iov->iov_len) {
+			ret -= msg.msg_iov->iov_len;
+			msg.msg_iov++;
+			msg.msg_iovlen--;
+		}
+		if (msg.msg_iovlen > 0) {
+			msg.msg_iov->iov_base = (char *) msg.msg_iov->iov_base + ret;
+			msg.msg_iov->iov_len -= ret;
+		}
+	}
+
+end:
+	return sent;
+}
+
 /*
  * Shutdown cleanly and close.
  */
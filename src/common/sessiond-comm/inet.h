@@ -49,6 +49,8 @@ extern ssize_t lttcomm_recvmsg_inet_sock(struct lttcomm_sock *sock, void *buf,
 		size_t len, int flags);
 extern ssize_t lttcomm_sendmsg_inet_sock(struct lttcomm_sock *sock,
 		const void *buf, size_t len, int flags);
+extern ssize_t lttcomm_sendmsg_iov_inet_sock(struct lttcomm_sock *sock,
+		struct iovec *iov, size_t iovcnt, int flags);
 
 /* Initialize inet communication layer. */
 extern void lttcomm_inet_init(void);
@@ -147,6 +147,27 @@ struct lttcomm_relayd_quiescent_control {
 	uint64_t stream_id;
 } LTTNG_PACKED;
 
+/*
+ * Stream of a RELAYD_SESSION_DATA_PENDING command. Metadata streams are only
+ * flagged as checked, as done by the quiescent control command.
+ */
+struct lttcomm_relayd_data_pending_stream {
+	uint64_t stream_id;
+	uint64_t last_net_seq_num; /* Sequence number of the last packet */
+	uint8_t is_metadata;
+} LTTNG_PACKED;
+
+/*
+ * Check if data is pending for a batch of streams of a session in a single
+ * command (2.13+). The generic reply's ret_code is 1 if data is pending, 0 if
+ * not.
+ */
+struct lttcomm_relayd_session_data_pending {
+	uint64_t session_id;
+	uint32_t stream_count;
+	struct lttcomm_relayd_data_pending_stream streams[];
+} LTTNG_PACKED;
+
 /*
  * Index data.
  */
@@ -183,6 +204,17 @@ static inline size_t lttcomm_relayd_index_len(uint32_t major, uint32_t minor)
 	abort();
 }
 
+/*
+ * Batch of indexes sent with the RELAYD_SEND_INDEXES command (2.13+).
+ *
+ * The indexes are always in their CTF index 1.1 (2.8+) layout. A single
+ * generic reply is sent by the relay daemon for the whole batch.
+ */
+struct lttcomm_relayd_send_indexes {
+	uint32_t index_count;
+	struct lttcomm_relayd_index indexes[];
+} LTTNG_PACKED;
+
 /*
  * Create session in 2.4 adds additionnal parameters for live reading.
  */
@@ -31,6 +31,7 @@
 
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 
 #include "inet.h"
@@ -106,6 +107,9 @@ enum lttcomm_sessiond_command {
 	LTTNG_SESSION_LIST_ROTATION_SCHEDULES           = 48,
 	LTTNG_CREATE_SESSION_EXT                        = 49,
 	LTTNG_CLEAR_SESSION                             = 50,
+	LTTNG_WAIT_DATA_PENDING                         = 51,
+	LTTNG_PERSISTENT_CONNECTION                     = 52,
+	LTTNG_ENABLE_EVENTS                             = 53,
 };
 
 enum lttcomm_relayd_command {
@@ -139,6 +143,10 @@ enum lttcomm_relayd_command {
 	RELAYD_TRACE_CHUNK_EXISTS           = 21,
 	/* Get the current configuration of a relayd peer (2.12+) */
 	RELAYD_GET_CONFIGURATION            = 22,
+	/* Send a batch of packet indexes (2.13+) */
+	RELAYD_SEND_INDEXES                 = 23,
+	/* Check data pending for a batch of streams of a session (2.13+) */
+	RELAYD_SESSION_DATA_PENDING         = 24,
 
 	/* Feature branch specific commands start at 10000. */
 };
@@ -263,6 +271,8 @@ struct lttcomm_proto_ops {
 			int flags);
 	ssize_t (*sendmsg) (struct lttcomm_sock *sock, const void *buf,
 			size_t len, int flags);
+	ssize_t (*sendmsg_iov) (struct lttcomm_sock *sock, struct iovec *iov,
+			size_t iovcnt, int flags);
 };
 
 struct process_attr_integral_value_comm {
@@ -314,6 +324,16 @@ struct lttcomm_session_msg {
 			 * - unsigned char filter_bytecode[bytecode_len]
 			 */
 		} LTTNG_PACKED disable;
+		/* Enable a batch of events of a channel */
+		struct {
+			char channel_name[LTTNG_SYMBOL_NAME_LEN];
+			/*
+			 * Number of struct lttcomm_enable_events_event, each
+			 * followed by its variable-length items, transmitted
+			 * after this structure.
+			 */
+			uint32_t event_count;
+		} LTTNG_PACKED enable_events;
 		/* Create channel */
 		struct {
 			struct lttng_channel chan;
@@ -451,6 +471,26 @@ struct lttng_event_exclusion {
 #define LTTNG_EVENT_EXCLUSION_NAME_AT(_exclusion, _i) \
 	(&(_exclusion)->names[_i][0])
 
+/*
+ * Event of a LTTNG_ENABLE_EVENTS command. After this structure, the
+ * following variable-length items are transmitted:
+ * - char exclusion_names[LTTNG_SYMBOL_NAME_LEN][exclusion_count]
+ * - char filter_expression[expression_len]
+ * - unsigned char filter_bytecode[bytecode_len]
+ *
+ * The reply's payload holds the resulting lttng_error_code of each event as
+ * an int32_t.
+ */
+struct lttcomm_enable_events_event {
+	struct lttng_event event;
+	/* Length of following filter expression. */
+	uint32_t expression_len;
+	/* Length of following bytecode for filter. */
+	uint32_t bytecode_len;
+	/* Exclusion count (fixed-size strings). */
+	uint32_t exclusion_count;
+} LTTNG_PACKED;
+
 /*
  * Event command header.
  */
@@ -720,8 +760,8 @@ struct lttcomm_consumer_msg {
 } LTTNG_PACKED;
 
 /*
- * Channel monitoring message returned to the session daemon on every
- * monitor timer expiration.
+ * Channel monitoring sample returned to the session daemon on monitor timer
+ * expirations, as part of a batch.
  */
 struct lttcomm_consumer_channel_monitor_msg {
 	/* Key of the sampled channel. */
@@ -736,6 +776,23 @@ struct lttcomm_consumer_channel_monitor_msg {
 	uint64_t total_consumed;
 } LTTNG_PACKED;
 
+/*
+ * Batch of channel monitoring samples, followed by `sample_count`
+ * struct lttcomm_consumer_channel_monitor_msg.
+ *
+ * The samples of the channels sharing a monitor timer period are sent
+ * together; channels whose sample is unchanged since the last one sent are
+ * omitted. A batch never exceeds PIPE_BUF bytes so that it is written
+ * atomically to the monitoring pipe.
+ */
+struct lttcomm_consumer_channel_monitor_batch_msg {
+	uint32_t sample_count;
+} LTTNG_PACKED;
+
+#define LTTCOMM_CONSUMER_CHANNEL_MONITOR_BATCH_MAX_SAMPLES \
+	((PIPE_BUF - sizeof(struct lttcomm_consumer_channel_monitor_batch_msg)) / \
+			sizeof(struct lttcomm_consumer_channel_monitor_msg))
+
 /*
  * Status message returned to the sessiond after a received command.
  */
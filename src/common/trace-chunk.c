@@ -68,6 +68,26 @@ struct chunk_credentials {
 	struct lttng_credentials user;
 };
 
+/* File contained within a trace chunk. */
+struct trace_chunk_file {
+	char *path;
+	/* Next file of the same bucket of the chunk's file set. */
+	struct trace_chunk_file *next;
+};
+
+/*
+ * Set of the files contained within a trace chunk, hashed on their path.
+ *
+ * The set is only accessed with the chunk's lock held (or during the chunk's
+ * teardown). Its buckets are allocated when the first file is added.
+ */
+struct trace_chunk_file_set {
+	struct trace_chunk_file **buckets;
+	/* Power of two, or 0 when no bucket is allocated. */
+	size_t bucket_count;
+	size_t count;
+};
+
 /*
  * NOTE: Make sure to update:
  * - lttng_trace_chunk_copy(),
@@ -85,11 +105,8 @@ struct lttng_trace_chunk {
 	 * Only used by _owner_ mode chunks.
 	 */
 	struct lttng_dynamic_pointer_array top_level_directories;
-	/*
-	 * All files contained within the trace chunk.
-	 * Array of paths (char *).
-	 */
-	struct lttng_dynamic_pointer_array files;
+	/* All files contained within the trace chunk. */
+	struct trace_chunk_file_set files;
 	/* Is contained within an lttng_trace_chunk_registry_element? */
 	bool in_registry_element;
 	bool name_overridden;
@@ -349,13 +366,99 @@ error:
 	return NULL;
 }
 
+/*
+ * Initial number of buckets of a file set. The bucket count is doubled when
+ * the set holds as many files as it has buckets.
+ */
+#define TRACE_CHUNK_FILE_SET_INITIAL_BUCKET_COUNT 64
+
+static
+unsigned long trace_chunk_file_hash(const char *path)
+{
+	return hash_key_str(path, 0);
+}
+
+static
+void trace_chunk_file_set_fini(struct trace_chunk_file_set *set)
+{
+	size_t i;
+
+	for (i = 0; i < set->bucket_count; i++) {
+		struct trace_chunk_file *file = set->buckets[i];
+
+		while (file) {
+			struct trace_chunk_file *next = file->next;
+
+			free(file->path);
+			free(file);
+			file = next;
+		}
+	}
+	free(set->buckets);
+	*set = (typeof(*set)) {};
+}
+
+/*
+ * Return the link pointing to the file matching `path` in its bucket, or the
+ * link ending the bucket if the set doesn't contain `path`.
+ */
+static
+struct trace_chunk_file **trace_chunk_file_set_find_link(
+		struct trace_chunk_file_set *set, const char *path)
+{
+	struct trace_chunk_file **link;
+
+	assert(set->bucket_count);
+	link = &set->buckets[trace_chunk_file_hash(path) &
+			(set->bucket_count - 1)];
+	while (*link && strcmp((*link)->path, path)) {
+		link = &(*link)->next;
+	}
+	return link;
+}
+
+static
+int trace_chunk_file_set_grow(struct trace_chunk_file_set *set)
+{
+	size_t i;
+	const size_t new_bucket_count = set->bucket_count ?
+			set->bucket_count * 2 :
+			TRACE_CHUNK_FILE_SET_INITIAL_BUCKET_COUNT;
+	struct trace_chunk_file **new_buckets =
+			zmalloc(new_bucket_count * sizeof(*new_buckets));
+
+	if (!new_buckets) {
+		return -1;
+	}
+
+	for (i = 0; i < set->bucket_count; i++) {
+		struct trace_chunk_file *file = set->buckets[i];
+
+		while (file) {
+			struct trace_chunk_file *next = file->next;
+			struct trace_chunk_file **new_bucket = &new_buckets[
+					trace_chunk_file_hash(file->path) &
+					(new_bucket_count - 1)];
+
+			file->next = *new_bucket;
+			*new_bucket = file;
+			file = next;
+		}
+	}
+
+	free(set->buckets);
+	set->buckets = new_buckets;
+	set->bucket_count = new_bucket_count;
+	return 0;
+}
+
 static
 void lttng_trace_chunk_init(struct lttng_trace_chunk *chunk)
 {
 	urcu_ref_init(&chunk->ref);
 	pthread_mutex_init(&chunk->lock, NULL);
 	lttng_dynamic_pointer_array_init(&chunk->top_level_directories, free);
-	lttng_dynamic_pointer_array_init(&chunk->files, free);
+	chunk->files = (typeof(chunk->files)) {};
 }
 
 static
@@ -375,7 +478,7 @@ void lttng_trace_chunk_fini(struct lttng_trace_chunk *chunk)
 	free(chunk->path);
 	chunk->path = NULL;
 	lttng_dynamic_pointer_array_reset(&chunk->top_level_directories);
-	lttng_dynamic_pointer_array_reset(&chunk->files);
+	trace_chunk_file_set_fini(&chunk->files);
 	pthread_mutex_destroy(&chunk->lock);
 }
 
@@ -469,7 +572,7 @@ void lttng_trace_chunk_set_fd_tracker(struct lttng_trace_chunk *chunk,
 {
 	assert(!chunk->session_output_directory);
 	assert(!chunk->chunk_directory);
-	assert(lttng_dynamic_pointer_array_get_count(&chunk->files) == 0);
+	assert(chunk->files.count == 0);
 	chunk->fd_tracker = fd_tracker;
 }
 
@@ -1276,28 +1379,14 @@ end:
 	return status;
 }
 
-/*
- * TODO: Implement O(1) lookup.
- */
 static
 bool lttng_trace_chunk_find_file(struct lttng_trace_chunk *chunk,
-		const char *path, size_t *index)
+		const char *path)
 {
-	size_t i, count;
-
-	count = lttng_dynamic_pointer_array_get_count(&chunk->files);
-	for (i = 0; i < count; i++) {
-		const char *iter_path =
-				lttng_dynamic_pointer_array_get_pointer(
-					&chunk->files, i);
-		if (!strcmp(iter_path, path)) {
-			if (index) {
-				*index = i;
-			}
-			return true;
-		}
+	if (!chunk->files.count) {
+		return false;
 	}
-	return false;
+	return *trace_chunk_file_set_find_link(&chunk->files, path) != NULL;
 }
 
 static
@@ -1305,29 +1394,38 @@ enum lttng_trace_chunk_status lttng_trace_chunk_add_file(
 		struct lttng_trace_chunk *chunk,
 		const char *path)
 {
-	char *copy;
-	int ret;
+	struct trace_chunk_file *file = NULL;
+	struct trace_chunk_file **link;
 	enum lttng_trace_chunk_status status = LTTNG_TRACE_CHUNK_STATUS_OK;
 
-	if (lttng_trace_chunk_find_file(chunk, path, NULL)) {
+	if (lttng_trace_chunk_find_file(chunk, path)) {
 		return LTTNG_TRACE_CHUNK_STATUS_OK;
 	}
 	DBG("Adding new file \"%s\" to trace chunk \"%s\"",
 			path, chunk->name ? : "(unnamed)");
-	copy = strdup(path);
-	if (!copy) {
-		PERROR("Failed to copy path");
+	if (chunk->files.count >= chunk->files.bucket_count &&
+			trace_chunk_file_set_grow(&chunk->files)) {
+		ERR("Allocation failure while adding file to a trace chunk");
 		status = LTTNG_TRACE_CHUNK_STATUS_ERROR;
 		goto end;
 	}
-	ret = lttng_dynamic_pointer_array_add_pointer(
-			&chunk->files, copy);
-	if (ret) {
+	file = zmalloc(sizeof(*file));
+	if (!file) {
 		ERR("Allocation failure while adding file to a trace chunk");
-		free(copy);
 		status = LTTNG_TRACE_CHUNK_STATUS_ERROR;
 		goto end;
 	}
+	file->path = strdup(path);
+	if (!file->path) {
+		PERROR("Failed to copy path");
+		free(file);
+		status = LTTNG_TRACE_CHUNK_STATUS_ERROR;
+		goto end;
+	}
+	link = trace_chunk_file_set_find_link(&chunk->files, path);
+	assert(!*link);
+	*link = file;
+	chunk->files.count++;
 end:
 	return status;
 }
@@ -1337,17 +1435,21 @@ void lttng_trace_chunk_remove_file(
 		struct lttng_trace_chunk *chunk,
 		const char *path)
 {
-	size_t index;
-	bool found;
-	int ret;
+	struct trace_chunk_file **link;
+	struct trace_chunk_file *file;
 
-	found = lttng_trace_chunk_find_file(chunk, path, &index);
-	if (!found) {
+	if (!chunk->files.count) {
 		return;
 	}
-	ret = lttng_dynamic_pointer_array_remove_pointer(
-			&chunk->files, index);
-	assert(!ret);
+	link = trace_chunk_file_set_find_link(&chunk->files, path);
+	file = *link;
+	if (!file) {
+		return;
+	}
+	*link = file->next;
+	chunk->files.count--;
+	free(file->path);
+	free(file);
 }
 
 static
@@ -1658,23 +1760,25 @@ int lttng_trace_chunk_delete_post_release_user(
 		struct lttng_trace_chunk *trace_chunk)
 {
 	int ret = 0;
+	size_t i;
 
 	DBG("Trace chunk \"delete\" close command post-release (User)");
 
-	/* Unlink all files. */
-	while (lttng_dynamic_pointer_array_get_count(&trace_chunk->files) != 0) {
-		enum lttng_trace_chunk_status status;
-		const char *path;
+	/* Unlink all files; unlinking a file removes it from its bucket. */
+	for (i = 0; i < trace_chunk->files.bucket_count; i++) {
+		while (trace_chunk->files.buckets[i]) {
+			enum lttng_trace_chunk_status status;
+			const char *path = trace_chunk->files.buckets[i]->path;
 
-		/* Remove first. */
-		path = lttng_dynamic_pointer_array_get_pointer(
-				&trace_chunk->files, 0);
-		DBG("Unlink file: %s", path);
-		status = lttng_trace_chunk_unlink_file(trace_chunk, path);
-		if (status != LTTNG_TRACE_CHUNK_STATUS_OK) {
-			ERR("Error unlinking file '%s' when deleting chunk", path);
-			ret = -1;
-			goto end;
+			DBG("Unlink file: %s", path);
+			status = lttng_trace_chunk_unlink_file(
+					trace_chunk, path);
+			if (status != LTTNG_TRACE_CHUNK_STATUS_OK) {
+				ERR("Error unlinking file '%s' when deleting chunk",
+						path);
+				ret = -1;
+				goto end;
+			}
 		}
 	}
 end:
@@ -32,6 +32,7 @@
 #include <common/compat/fcntl.h>
 #include <common/compat/endian.h>
 #include <common/consumer/consumer-metadata-cache.h>
+#include <common/consumer/consumer-snapshot.h>
 #include <common/consumer/consumer-stream.h>
 #include <common/consumer/consumer-timer.h>
 #include <common/utils.h>
@@ -190,7 +191,7 @@ static int send_stream_to_thread(struct lttng_consumer_stream *stream,
 		stream_pipe = ctx->consumer_metadata_pipe;
 	} else {
 		consumer_add_data_stream(stream);
-		stream_pipe = ctx->consumer_data_pipe;
+		stream_pipe = lttng_consumer_get_data_stream_pipe(ctx, stream);
 	}
 
 	/*
@@ -1102,183 +1103,341 @@ error:
 }
 
 /*
- * Take a snapshot of all the stream of a channel.
- * RCU read-side lock and the channel lock must be held by the caller.
+ * Attach a stream of a channel being recorded in a snapshot to the channel's
+ * trace chunk and open its output. The stream lock must be held by the caller.
  *
  * Returns 0 on success, < 0 on error
  */
-static int snapshot_channel(struct lttng_consumer_channel *channel,
-		uint64_t key, char *path, uint64_t relayd_id,
-		uint64_t nb_packets_per_stream,
-		struct lttng_consumer_local_data *ctx)
+static int snapshot_stream_open_output(struct lttng_consumer_stream *stream,
+		char *path, uint64_t relayd_id)
 {
 	int ret;
-	unsigned use_relayd = 0;
-	unsigned long consumed_pos, produced_pos;
-	struct lttng_consumer_stream *stream;
 
-	assert(path);
-	assert(ctx);
+	assert(stream->chan->trace_chunk);
+	if (!lttng_trace_chunk_get(stream->chan->trace_chunk)) {
+		/*
+		 * Can't happen barring an internal error as the channel
+		 * holds a reference to the trace chunk.
+		 */
+		ERR("Failed to acquire reference to channel's trace chunk");
+		ret = -1;
+		goto end;
+	}
+	assert(!stream->trace_chunk);
+	stream->trace_chunk = stream->chan->trace_chunk;
 
-	rcu_read_lock();
+	stream->net_seq_idx = relayd_id;
 
 	if (relayd_id != (uint64_t) -1ULL) {
-		use_relayd = 1;
+		ret = consumer_send_relayd_stream(stream, path);
+		if (ret < 0) {
+			goto end;
+		}
+	} else {
+		ret = consumer_stream_create_output_files(stream, false);
+		if (ret < 0) {
+			goto end;
+		}
+		DBG("UST consumer snapshot stream (%" PRIu64 ")",
+				stream->key);
 	}
+end:
+	return ret;
+}
 
-	assert(!channel->monitor);
-	DBG("UST consumer snapshot channel %" PRIu64, key);
+/*
+ * Flush a stream and sample the positions between which its sub-buffers are
+ * recorded in a snapshot. The stream lock must be held by the caller.
+ *
+ * Returns 0 on success, < 0 on error
+ */
+static int snapshot_stream_sample_positions(
+		struct consumer_snapshot_stream *snapshot_stream,
+		uint64_t nb_packets_per_stream)
+{
+	int ret;
+	struct lttng_consumer_stream *stream = snapshot_stream->stream;
+
+	/*
+	 * If tracing is active, we want to perform a "full" buffer flush.
+	 * Else, if quiescent, it has already been done by the prior stop.
+	 */
+	if (!stream->quiescent) {
+		ustctl_flush_buffer(stream->ustream, 0);
+	}
+
+	ret = lttng_ustconsumer_take_snapshot(stream);
+	if (ret < 0) {
+		ERR("Taking UST snapshot");
+		goto end;
+	}
+
+	ret = lttng_ustconsumer_get_produced_snapshot(stream,
+			&snapshot_stream->produced_pos);
+	if (ret < 0) {
+		ERR("Produced UST snapshot position");
+		goto end;
+	}
+
+	ret = lttng_ustconsumer_get_consumed_snapshot(stream,
+			&snapshot_stream->consumed_pos);
+	if (ret < 0) {
+		ERR("Consumerd UST snapshot position");
+		goto end;
+	}
+
+	/*
+	 * The original value is sent back if max stream size is larger than
+	 * the possible size of the snapshot. Also, we assume that the session
+	 * daemon should never send a maximum stream size that is lower than
+	 * subbuffer size.
+	 */
+	snapshot_stream->consumed_pos = consumer_get_consume_start_pos(
+			snapshot_stream->consumed_pos,
+			snapshot_stream->produced_pos, nb_packets_per_stream,
+			stream->max_sb_size);
+end:
+	return ret;
+}
+
+/*
+ * Copy the sub-buffers of a stream between its sampled positions to its
+ * output. The stream lock must be held by the thread recording the snapshot.
+ *
+ * Returns 0 on success, < 0 on error
+ */
+static int snapshot_stream_copy(
+		struct consumer_snapshot_stream *snapshot_stream, void *data)
+{
+	int ret;
+	struct lttng_consumer_stream *stream = snapshot_stream->stream;
+	const bool use_relayd = stream->net_seq_idx != (uint64_t) -1ULL;
+	unsigned long consumed_pos = snapshot_stream->consumed_pos;
+
+	while ((long) (consumed_pos - snapshot_stream->produced_pos) < 0) {
+		ssize_t read_len;
+		unsigned long len, padded_len;
+		const char *subbuf_addr;
+		struct lttng_buffer_view subbuf_view;
 
-	cds_list_for_each_entry(stream, &channel->streams.head, send_node) {
 		health_code_update();
 
-		/* Lock stream because we are about to change its state. */
-		pthread_mutex_lock(&stream->lock);
-		assert(channel->trace_chunk);
-		if (!lttng_trace_chunk_get(channel->trace_chunk)) {
-			/*
-			 * Can't happen barring an internal error as the channel
-			 * holds a reference to the trace chunk.
-			 */
-			ERR("Failed to acquire reference to channel's trace chunk");
-			ret = -1;
-			goto error_unlock;
+		DBG("UST consumer taking snapshot at pos %lu", consumed_pos);
+
+		ret = ustctl_get_subbuf(stream->ustream, &consumed_pos);
+		if (ret < 0) {
+			if (ret != -EAGAIN) {
+				PERROR("ustctl_get_subbuf snapshot");
+				goto end;
+			}
+			DBG("UST consumer get subbuf failed. Skipping it.");
+			consumed_pos += stream->max_sb_size;
+			snapshot_stream->lost_packets++;
+			continue;
+		}
+
+		ret = ustctl_get_subbuf_size(stream->ustream, &len);
+		if (ret < 0) {
+			ERR("Snapshot ustctl_get_subbuf_size");
+			goto error_put_subbuf;
 		}
-		assert(!stream->trace_chunk);
-		stream->trace_chunk = channel->trace_chunk;
 
-		stream->net_seq_idx = relayd_id;
+		ret = ustctl_get_padded_subbuf_size(stream->ustream, &padded_len);
+		if (ret < 0) {
+			ERR("Snapshot ustctl_get_padded_subbuf_size");
+			goto error_put_subbuf;
+		}
+
+		ret = get_current_subbuf_addr(stream, &subbuf_addr);
+		if (ret) {
+			goto error_put_subbuf;
+		}
 
+		subbuf_view = lttng_buffer_view_init(
+				subbuf_addr, 0, padded_len);
+		read_len = lttng_consumer_on_read_subbuffer_mmap(
+				stream, &subbuf_view, padded_len - len);
 		if (use_relayd) {
-			ret = consumer_send_relayd_stream(stream, path);
-			if (ret < 0) {
-				goto error_unlock;
+			if (read_len != len) {
+				ret = -EPERM;
+				goto error_put_subbuf;
 			}
 		} else {
-			ret = consumer_stream_create_output_files(stream,
-					false);
-			if (ret < 0) {
-				goto error_unlock;
+			if (read_len != padded_len) {
+				ret = -EPERM;
+				goto error_put_subbuf;
 			}
-			DBG("UST consumer snapshot stream (%" PRIu64 ")",
-					stream->key);
 		}
 
-		/*
-		 * If tracing is active, we want to perform a "full" buffer flush.
-		 * Else, if quiescent, it has already been done by the prior stop.
-		 */
-		if (!stream->quiescent) {
-			ustctl_flush_buffer(stream->ustream, 0);
+		ret = ustctl_put_subbuf(stream->ustream);
+		if (ret < 0) {
+			ERR("Snapshot ustctl_put_subbuf");
+			goto end;
 		}
+		consumed_pos += stream->max_sb_size;
+	}
+
+	ret = 0;
+	goto end;
 
-		ret = lttng_ustconsumer_take_snapshot(stream);
+error_put_subbuf:
+	if (ustctl_put_subbuf(stream->ustream) < 0) {
+		ERR("Snapshot ustctl_put_subbuf");
+	}
+end:
+	return ret;
+}
+
+/*
+ * Take a snapshot of all the streams of a channel, one after the other.
+ * RCU read-side lock and the channel lock must be held by the caller.
+ *
+ * Returns 0 on success, < 0 on error
+ */
+static int snapshot_channel_sequential(struct lttng_consumer_channel *channel,
+		char *path, uint64_t relayd_id, uint64_t nb_packets_per_stream)
+{
+	int ret;
+	struct lttng_consumer_stream *stream;
+
+	cds_list_for_each_entry(stream, &channel->streams.head, send_node) {
+		struct consumer_snapshot_stream snapshot_stream = {
+			.stream = stream,
+		};
+
+		health_code_update();
+
+		/* Lock stream because we are about to change its state. */
+		pthread_mutex_lock(&stream->lock);
+		ret = snapshot_stream_open_output(stream, path, relayd_id);
 		if (ret < 0) {
-			ERR("Taking UST snapshot");
 			goto error_unlock;
 		}
 
-		ret = lttng_ustconsumer_get_produced_snapshot(stream, &produced_pos);
+		ret = snapshot_stream_sample_positions(&snapshot_stream,
+				nb_packets_per_stream);
 		if (ret < 0) {
-			ERR("Produced UST snapshot position");
 			goto error_unlock;
 		}
 
-		ret = lttng_ustconsumer_get_consumed_snapshot(stream, &consumed_pos);
+		ret = snapshot_stream_copy(&snapshot_stream, NULL);
+		channel->lost_packets += snapshot_stream.lost_packets;
 		if (ret < 0) {
-			ERR("Consumerd UST snapshot position");
-			goto error_unlock;
+			goto error_close_stream;
 		}
 
-		/*
-		 * The original value is sent back if max stream size is larger than
-		 * the possible size of the snapshot. Also, we assume that the session
-		 * daemon should never send a maximum stream size that is lower than
-		 * subbuffer size.
-		 */
-		consumed_pos = consumer_get_consume_start_pos(consumed_pos,
-				produced_pos, nb_packets_per_stream,
-				stream->max_sb_size);
-
-		while ((long) (consumed_pos - produced_pos) < 0) {
-			ssize_t read_len;
-			unsigned long len, padded_len;
-			const char *subbuf_addr;
-			struct lttng_buffer_view subbuf_view;
+		/* Simply close the stream so we can use it on the next snapshot. */
+		consumer_stream_close(stream);
+		pthread_mutex_unlock(&stream->lock);
+	}
 
-			health_code_update();
+	return 0;
 
-			DBG("UST consumer taking snapshot at pos %lu", consumed_pos);
+error_close_stream:
+	consumer_stream_close(stream);
+error_unlock:
+	pthread_mutex_unlock(&stream->lock);
+	return ret;
+}
 
-			ret = ustctl_get_subbuf(stream->ustream, &consumed_pos);
-			if (ret < 0) {
-				if (ret != -EAGAIN) {
-					PERROR("ustctl_get_subbuf snapshot");
-					goto error_close_stream;
-				}
-				DBG("UST consumer get subbuf failed. Skipping it.");
-				consumed_pos += stream->max_sb_size;
-				stream->chan->lost_packets++;
-				continue;
-			}
+/*
+ * Take a snapshot of all the streams of a channel, sampling the positions of
+ * all the streams before copying them concurrently.
+ * RCU read-side lock and the channel lock must be held by the caller.
+ *
+ * Returns 0 on success, < 0 on error
+ */
+static int snapshot_channel_parallel(struct lttng_consumer_channel *channel,
+		char *path, uint64_t relayd_id, uint64_t nb_packets_per_stream)
+{
+	int ret;
+	size_t i, stream_count = 0, locked_count = 0;
+	struct lttng_consumer_stream *stream;
+	struct consumer_snapshot_stream *snapshot_streams;
 
-			ret = ustctl_get_subbuf_size(stream->ustream, &len);
-			if (ret < 0) {
-				ERR("Snapshot ustctl_get_subbuf_size");
-				goto error_put_subbuf;
-			}
+	cds_list_for_each_entry(stream, &channel->streams.head, send_node) {
+		stream_count++;
+	}
 
-			ret = ustctl_get_padded_subbuf_size(stream->ustream, &padded_len);
-			if (ret < 0) {
-				ERR("Snapshot ustctl_get_padded_subbuf_size");
-				goto error_put_subbuf;
-			}
+	snapshot_streams = zmalloc(sizeof(*snapshot_streams) * stream_count);
+	if (!snapshot_streams) {
+		PERROR("zmalloc snapshot streams");
+		ret = -ENOMEM;
+		goto end;
+	}
 
-			ret = get_current_subbuf_addr(stream, &subbuf_addr);
-			if (ret) {
-				goto error_put_subbuf;
-			}
+	/*
+	 * The outputs are opened first since it can involve exchanges with
+	 * the relay daemon.
+	 */
+	cds_list_for_each_entry(stream, &channel->streams.head, send_node) {
+		health_code_update();
 
-			subbuf_view = lttng_buffer_view_init(
-					subbuf_addr, 0, padded_len);
-			read_len = lttng_consumer_on_read_subbuffer_mmap(
-					stream, &subbuf_view, padded_len - len);
-			if (use_relayd) {
-				if (read_len != len) {
-					ret = -EPERM;
-					goto error_put_subbuf;
-				}
-			} else {
-				if (read_len != padded_len) {
-					ret = -EPERM;
-					goto error_put_subbuf;
-				}
-			}
+		/* Lock stream because we are about to change its state. */
+		pthread_mutex_lock(&stream->lock);
+		snapshot_streams[locked_count++].stream = stream;
+		ret = snapshot_stream_open_output(stream, path, relayd_id);
+		if (ret < 0) {
+			goto end_close_streams;
+		}
+	}
 
-			ret = ustctl_put_subbuf(stream->ustream);
-			if (ret < 0) {
-				ERR("Snapshot ustctl_put_subbuf");
-				goto error_close_stream;
-			}
-			consumed_pos += stream->max_sb_size;
+	/* Sample the positions of all the streams as close together as possible. */
+	for (i = 0; i < stream_count; i++) {
+		ret = snapshot_stream_sample_positions(&snapshot_streams[i],
+				nb_packets_per_stream);
+		if (ret < 0) {
+			goto end_close_streams;
 		}
+	}
 
-		/* Simply close the stream so we can use it on the next snapshot. */
+	ret = consumer_snapshot_copy_streams(snapshot_streams, stream_count,
+			snapshot_stream_copy, NULL);
+	for (i = 0; i < stream_count; i++) {
+		channel->lost_packets += snapshot_streams[i].lost_packets;
+	}
+
+end_close_streams:
+	/* Simply close the streams so we can use them on the next snapshot. */
+	for (i = 0; i < locked_count; i++) {
+		stream = snapshot_streams[i].stream;
 		consumer_stream_close(stream);
 		pthread_mutex_unlock(&stream->lock);
 	}
+	free(snapshot_streams);
+end:
+	return ret;
+}
 
-	rcu_read_unlock();
-	return 0;
+/*
+ * Take a snapshot of all the stream of a channel.
+ * RCU read-side lock and the channel lock must be held by the caller.
+ *
+ * Returns 0 on success, < 0 on error
+ */
+static int snapshot_channel(struct lttng_consumer_channel *channel,
+		uint64_t key, char *path, uint64_t relayd_id,
+		uint64_t nb_packets_per_stream,
+		struct lttng_consumer_local_data *ctx)
+{
+	int ret;
 
-error_put_subbuf:
-	if (ustctl_put_subbuf(stream->ustream) < 0) {
-		ERR("Snapshot ustctl_put_subbuf");
+	assert(path);
+	assert(ctx);
+
+	rcu_read_lock();
+
+	assert(!channel->monitor);
+	DBG("UST consumer snapshot channel %" PRIu64, key);
+
+	if (consumer_data.snapshot_thread_count > 1) {
+		ret = snapshot_channel_parallel(channel, path, relayd_id,
+				nb_packets_per_stream);
+	} else {
+		ret = snapshot_channel_sequential(channel, path, relayd_id,
+				nb_packets_per_stream);
 	}
-error_close_stream:
-	consumer_stream_close(stream);
-error_unlock:
-	pthread_mutex_unlock(&stream->lock);
+
 	rcu_read_unlock();
 	return ret;
 }
@@ -2657,21 +2816,11 @@ static int notify_if_more_data(struct lttng_consumer_stream *stream,
 	ret = ustctl_put_subbuf(ustream);
 	assert(!ret);
 
-	/* This stream still has data. Flag it and wake up the data thread. */
+	/*
+	 * This stream still has data. Flag it so the thread consuming it reads
+	 * it again without waiting for its wait fd.
+	 */
 	stream->has_data = 1;
-
-	if (stream->monitor && !stream->hangup_flush_done && !ctx->has_wakeup) {
-		ssize_t writelen;
-
-		writelen = lttng_pipe_write(ctx->consumer_wakeup_pipe, "!", 1);
-		if (writelen < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
-			ret = writelen;
-			goto end;
-		}
-
-		/* The wake up pipe has been notified. */
-		ctx->has_wakeup = 1;
-	}
 	ret = 0;
 
 end:
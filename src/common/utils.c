@@ -1391,6 +1391,57 @@ end:
 	return ret;
 }
 
+/*
+ * Append `len` zero bytes to a file, positioned at its end, without writing
+ * them. The file is extended, leaving a hole on file systems supporting sparse
+ * files, and its position is moved to its new end.
+ *
+ * Return 0 on success. On error, -1 is returned with errno set and the file is
+ * left unchanged.
+ */
+LTTNG_HIDDEN
+int utils_append_hole(int fd, size_t len)
+{
+	int ret;
+	off_t position, new_end;
+	struct stat fd_stat;
+
+	position = lseek(fd, 0, SEEK_CUR);
+	if (position < 0) {
+		ret = -1;
+		goto end;
+	}
+
+	ret = fstat(fd, &fd_stat);
+	if (ret < 0) {
+		goto end;
+	}
+
+	if (!S_ISREG(fd_stat.st_mode) || fd_stat.st_size > position) {
+		/* Extending the file would not produce zeros at `position`. */
+		errno = EINVAL;
+		ret = -1;
+		goto end;
+	}
+
+	new_end = position + (off_t) len;
+	ret = ftruncate(fd, new_end);
+	if (ret < 0) {
+		goto end;
+	}
+
+	if (lseek(fd, new_end, SEEK_SET) < 0) {
+		const int saved_errno = errno;
+
+		(void) ftruncate(fd, position);
+		errno = saved_errno;
+		ret = -1;
+		goto end;
+	}
+end:
+	return ret;
+}
+
 static const char *get_man_bin_path(void)
 {
 	char *env_man_path = lttng_secure_getenv(DEFAULT_MAN_BIN_PATH_ENV);
@@ -0,0 +1,352 @@
+/*
+ * Copyright (C) 2021 EfficiOS Inc.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only
+ *
+ */
+
+#define _LGPL_SOURCE
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <lttng/lttng.h>
+#include <lttng/lttng-error.h>
+#include <lttng/data-pending-handle.h>
+#include <common/sessiond-comm/sessiond-comm.h>
+#include <common/defaults.h>
+#include <common/macros.h>
+#include <common/compat/poll.h>
+#include <common/optional.h>
+#include <common/time.h>
+
+#include "lttng-ctl-helper.h"
+
+struct lttng_data_pending_handle {
+	char session_name[LTTNG_NAME_MAX];
+	LTTNG_OPTIONAL(enum lttng_error_code) result;
+	/*
+	 * Session daemons that can't wait for the data to be available reply
+	 * LTTNG_ERR_UND; the data availability is then checked periodically.
+	 */
+	bool poll_data_pending;
+	struct {
+		int socket;
+		struct lttng_poll_event events;
+	} communication;
+};
+
+static
+void close_communication(struct lttng_data_pending_handle *handle)
+{
+	int ret;
+
+	if (handle->communication.socket < 0) {
+		return;
+	}
+
+	ret = close(handle->communication.socket);
+	if (ret) {
+		PERROR("Failed to close lttng-sessiond command socket");
+	}
+	handle->communication.socket = -1;
+}
+
+void lttng_data_pending_handle_destroy(
+		struct lttng_data_pending_handle *handle)
+{
+	if (!handle) {
+		return;
+	}
+
+	/* Closing the connection cancels the wait in the session daemon. */
+	close_communication(handle);
+	lttng_poll_clean(&handle->communication.events);
+	free(handle);
+}
+
+static
+struct lttng_data_pending_handle *lttng_data_pending_handle_create(
+		const char *session_name, int sessiond_socket)
+{
+	int ret;
+	struct lttng_data_pending_handle *handle = zmalloc(sizeof(*handle));
+
+	if (!handle) {
+		goto end;
+	}
+	handle->communication.socket = sessiond_socket;
+	ret = lttng_strncpy(handle->session_name, session_name,
+			sizeof(handle->session_name));
+	if (ret) {
+		goto error;
+	}
+
+	ret = lttng_poll_create(&handle->communication.events, 1, 0);
+	if (ret) {
+		goto error;
+	}
+
+	ret = lttng_poll_add(&handle->communication.events, sessiond_socket,
+			LPOLLIN | LPOLLHUP | LPOLLRDHUP | LPOLLERR);
+	if (ret) {
+		goto error;
+	}
+end:
+	return handle;
+error:
+	/* The socket remains owned by the caller. */
+	handle->communication.socket = -1;
+	lttng_data_pending_handle_destroy(handle);
+	return NULL;
+}
+
+/*
+ * Check the data availability of a session until it is available or
+ * `timeout_ms` has elapsed, for session daemons that can't wait for it.
+ */
+static
+int poll_data_pending(const char *session_name, int timeout_ms)
+{
+	int ret;
+	uint64_t waited_us = 0;
+	const uint64_t timeout_us = (uint64_t) timeout_ms * USEC_PER_MSEC;
+
+	do {
+		uint64_t sleep_us = DEFAULT_DATA_AVAILABILITY_WAIT_TIME_US;
+
+		ret = lttng_data_pending(session_name);
+		if (ret <= 0) {
+			goto end;
+		}
+
+		if (timeout_ms >= 0) {
+			if (waited_us >= timeout_us) {
+				goto end;
+			}
+			sleep_us = min_t(uint64_t, sleep_us,
+					timeout_us - waited_us);
+		}
+		usleep(sleep_us);
+		waited_us += sleep_us;
+	} while (true);
+end:
+	return ret;
+}
+
+/*
+ * Receive the reply of the session daemon once the data is available.
+ *
+ * Return 0 on success, -1 on error.
+ */
+static
+int receive_reply(struct lttng_data_pending_handle *handle)
+{
+	int ret;
+	ssize_t comm_ret;
+	uint32_t revents;
+	struct lttcomm_lttng_msg llm;
+
+	/* The sessiond connection socket is the only monitored fd. */
+	revents = LTTNG_POLL_GETEV(&handle->communication.events, 0);
+	if (!(revents & LPOLLIN)) {
+		ret = -1;
+		goto end;
+	}
+
+	comm_ret = lttcomm_recv_unix_sock(handle->communication.socket, &llm,
+			sizeof(llm));
+	if (comm_ret != (ssize_t) sizeof(llm)) {
+		ret = -1;
+		goto end;
+	}
+
+	close_communication(handle);
+	if (llm.ret_code == LTTNG_ERR_UND) {
+		handle->poll_data_pending = true;
+	} else {
+		LTTNG_OPTIONAL_SET(&handle->result,
+				(enum lttng_error_code) llm.ret_code);
+	}
+	ret = 0;
+end:
+	return ret;
+}
+
+enum lttng_data_pending_handle_status
+	lttng_data_pending_handle_wait_for_completion(
+		struct lttng_data_pending_handle *handle, int timeout_ms)
+{
+	int ret;
+	enum lttng_data_pending_handle_status status;
+
+	if (!handle) {
+		status = LTTNG_DATA_PENDING_HANDLE_STATUS_INVALID;
+		goto end;
+	}
+
+	if (handle->result.is_set) {
+		status = LTTNG_DATA_PENDING_HANDLE_STATUS_COMPLETED;
+		goto end;
+	}
+
+	if (!handle->poll_data_pending) {
+		if (handle->communication.socket < 0) {
+			status = LTTNG_DATA_PENDING_HANDLE_STATUS_ERROR;
+			goto end;
+		}
+
+		ret = lttng_poll_wait(&handle->communication.events,
+				timeout_ms);
+		if (ret == 0) {
+			status = LTTNG_DATA_PENDING_HANDLE_STATUS_TIMEOUT;
+			goto end;
+		} else if (ret < 0) {
+			status = LTTNG_DATA_PENDING_HANDLE_STATUS_ERROR;
+			goto end;
+		}
+
+		ret = receive_reply(handle);
+		if (ret) {
+			close_communication(handle);
+			status = LTTNG_DATA_PENDING_HANDLE_STATUS_ERROR;
+			goto end;
+		}
+
+		if (handle->result.is_set) {
+			status = LTTNG_DATA_PENDING_HANDLE_STATUS_COMPLETED;
+			goto end;
+		}
+	}
+
+	/* The session daemon can't wait; poll for data availability. */
+	ret = poll_data_pending(handle->session_name, timeout_ms);
+	if (ret == 1) {
+		status = LTTNG_DATA_PENDING_HANDLE_STATUS_TIMEOUT;
+		goto end;
+	}
+
+	LTTNG_OPTIONAL_SET(&handle->result,
+			ret == 0 ? LTTNG_OK : (enum lttng_error_code) -ret);
+	status = LTTNG_DATA_PENDING_HANDLE_STATUS_COMPLETED;
+end:
+	return status;
+}
+
+enum lttng_data_pending_handle_status
+	lttng_data_pending_handle_get_result(
+		const struct lttng_data_pending_handle *handle,
+		enum lttng_error_code *result)
+{
+	enum lttng_data_pending_handle_status status =
+			LTTNG_DATA_PENDING_HANDLE_STATUS_OK;
+
+	if (!handle || !result || !handle->result.is_set) {
+		status = LTTNG_DATA_PENDING_HANDLE_STATUS_INVALID;
+		goto end;
+	}
+	*result = handle->result.value;
+end:
+	return status;
+}
+
+/*
+ * Start waiting for the data of a session to be available.
+ */
+enum lttng_error_code lttng_wait_data_pending_ext(const char *session_name,
+		struct lttng_data_pending_handle **_handle)
+{
+	enum lttng_error_code ret_code = LTTNG_OK;
+	struct lttng_data_pending_handle *handle = NULL;
+	struct lttcomm_session_msg lsm = {
+		.cmd_type = LTTNG_WAIT_DATA_PENDING,
+	};
+	int sessiond_socket = -1;
+	ssize_t comm_ret;
+	int ret;
+
+	if (session_name == NULL || _handle == NULL) {
+		ret_code = LTTNG_ERR_INVALID;
+		goto error;
+	}
+	ret = lttng_strncpy(lsm.session.name, session_name,
+			sizeof(lsm.session.name));
+	if (ret) {
+		ret_code = LTTNG_ERR_INVALID;
+		goto error;
+	}
+	ret = connect_sessiond();
+	if (ret < 0) {
+		ret_code = LTTNG_ERR_NO_SESSIOND;
+		goto error;
+	} else {
+		sessiond_socket = ret;
+	}
+	handle = lttng_data_pending_handle_create(session_name,
+			sessiond_socket);
+	if (!handle) {
+		ret_code = LTTNG_ERR_NOMEM;
+		goto error;
+	}
+	sessiond_socket = -1;
+	comm_ret = lttcomm_send_creds_unix_sock(handle->communication.socket,
+			&lsm, sizeof(lsm));
+	if (comm_ret < 0) {
+		ret_code = LTTNG_ERR_FATAL;
+		goto error;
+	}
+
+	/* Transfer the handle to the caller. */
+	*_handle = handle;
+	handle = NULL;
+error:
+	if (sessiond_socket >= 0) {
+		ret = close(sessiond_socket);
+		if (ret < 0) {
+			PERROR("Failed to close the LTTng session daemon connection socket");
+		}
+	}
+	lttng_data_pending_handle_destroy(handle);
+	return ret_code;
+}
+
+/*
+ * Wait until the data of a session is ready to be read, or until
+ * `timeout_ms` has elapsed.
+ */
+int lttng_wait_data_pending(const char *session_name, int timeout_ms)
+{
+	int ret;
+	enum lttng_error_code ret_code;
+	enum lttng_data_pending_handle_status status;
+	struct lttng_data_pending_handle *handle = NULL;
+
+	ret_code = lttng_wait_data_pending_ext(session_name, &handle);
+	if (ret_code != LTTNG_OK) {
+		ret = -ret_code;
+		goto end;
+	}
+
+	status = lttng_data_pending_handle_wait_for_completion(handle,
+			timeout_ms);
+	switch (status) {
+	case LTTNG_DATA_PENDING_HANDLE_STATUS_COMPLETED:
+		break;
+	case LTTNG_DATA_PENDING_HANDLE_STATUS_TIMEOUT:
+		ret = 1;
+		goto end;
+	default:
+		ret = -LTTNG_ERR_FATAL;
+		goto end;
+	}
+
+	status = lttng_data_pending_handle_get_result(handle, &ret_code);
+	if (status != LTTNG_DATA_PENDING_HANDLE_STATUS_OK) {
+		ret = -LTTNG_ERR_FATAL;
+		goto end;
+	}
+	ret = ret_code == LTTNG_OK ? 0 : -ret_code;
+end:
+	lttng_data_pending_handle_destroy(handle);
+	return ret;
+}
@@ -20,6 +20,7 @@
 
 #include <common/common.h>
 #include <common/compat/errno.h>
+#include <common/compat/poll.h>
 #include <common/compat/string.h>
 #include <common/defaults.h>
 #include <common/dynamic-buffer.h>
@@ -27,6 +28,7 @@
 #include <common/payload.h>
 #include <common/payload-view.h>
 #include <common/sessiond-comm/sessiond-comm.h>
+#include <common/time.h>
 #include <common/tracker.h>
 #include <common/unix.h>
 #include <common/uri.h>
@@ -64,6 +66,11 @@ static char sessiond_sock_path[PATH_MAX];
 /* Variables */
 static char *tracing_group;
 static int connected;
+/*
+ * Keep the connection to the session daemon open across commands. See
+ * lttng_open_persistent_connection().
+ */
+static bool persistent_connection;
 
 /* Global */
 
@@ -483,6 +490,143 @@ static int disconnect_sessiond(void)
 	return ret;
 }
 
+/*
+ * Ask the session daemon to keep the current connection open after each
+ * successful command.
+ *
+ * Return 0 on success, a negative lttng_error_code on error.
+ */
+static int send_persistent_connection_request(void)
+{
+	int ret;
+	struct lttcomm_session_msg lsm;
+	struct lttcomm_lttng_msg llm;
+
+	memset(&lsm, 0, sizeof(lsm));
+	lsm.cmd_type = LTTNG_PERSISTENT_CONNECTION;
+
+	ret = send_session_msg(&lsm);
+	if (ret < 0) {
+		goto end;
+	}
+
+	ret = recv_data_sessiond(&llm, sizeof(llm));
+	if (ret < 0) {
+		goto end;
+	}
+
+	if (llm.ret_code != LTTNG_OK) {
+		ret = -llm.ret_code;
+		goto end;
+	}
+
+	ret = 0;
+end:
+	return ret;
+}
+
+/*
+ * Wait up to `timeout_ms` for the session daemon's reply on the command
+ * connection. A negative timeout waits indefinitely.
+ *
+ * Return 1 if the reply can be received, 0 on timeout, or a negative
+ * lttng_error_code on error.
+ */
+static int wait_sessiond_reply(int timeout_ms)
+{
+	int ret;
+	struct lttng_poll_event events;
+
+	ret = lttng_poll_create(&events, 1, 0);
+	if (ret) {
+		ret = -LTTNG_ERR_NOMEM;
+		goto end;
+	}
+
+	ret = lttng_poll_add(&events, sessiond_socket,
+			LPOLLIN | LPOLLERR | LPOLLHUP);
+	if (ret) {
+		ret = -LTTNG_ERR_FATAL;
+		goto end_clean;
+	}
+
+	ret = lttng_poll_wait(&events, timeout_ms);
+	if (ret < 0) {
+		ret = -LTTNG_ERR_FATAL;
+		goto end_clean;
+	}
+
+	/* An error or hang-up is reported when receiving the reply. */
+	ret = !!ret;
+end_clean:
+	lttng_poll_clean(&events);
+end:
+	return ret;
+}
+
+/*
+ * Connect to the session daemon to send it a command, unless the persistent
+ * connection to it is established.
+ *
+ * Return 0 on success, a negative lttng_error_code on error.
+ */
+static int open_command_connection(void)
+{
+	int ret;
+
+	if (connected) {
+		/*
+		 * Nothing is expected on the idle persistent connection: it is
+		 * readable if the session daemon closed it, which it does when
+		 * it has too many idle connections or this one idled for too
+		 * long. Reconnect in that case.
+		 */
+		ret = wait_sessiond_reply(0);
+		if (ret == 0) {
+			/* Reuse the persistent connection. */
+			goto end;
+		}
+
+		DBG("Session daemon closed the persistent connection, reconnecting");
+		disconnect_sessiond();
+	}
+
+	ret = connect_sessiond();
+	if (ret < 0) {
+		ret = -LTTNG_ERR_NO_SESSIOND;
+		goto end;
+	}
+	sessiond_socket = ret;
+	connected = 1;
+
+	if (persistent_connection) {
+		ret = send_persistent_connection_request();
+		if (ret < 0) {
+			disconnect_sessiond();
+			goto end;
+		}
+	}
+
+	ret = 0;
+end:
+	return ret;
+}
+
+/*
+ * Release the connection used to send a command to the session daemon.
+ *
+ * The persistent connection is kept for the next command unless the command
+ * failed, since the session daemon closes the connection in that case.
+ */
+static void close_command_connection(int cmd_ret)
+{
+	if (persistent_connection && cmd_ret >= 0) {
+		return;
+	}
+
+	disconnect_sessiond();
+}
+
 static int recv_sessiond_optional_data(size_t len, void **user_buf,
 	size_t *user_len)
 {
@@ -548,13 +692,9 @@ int lttng_ctl_ask_sessiond_fds_varlen(struct lttcomm_session_msg *lsm,
 	size_t payload_len;
 	struct lttcomm_lttng_msg llm;
 
-	ret = connect_sessiond();
+	ret = open_command_connection();
 	if (ret < 0) {
-		ret = -LTTNG_ERR_NO_SESSIOND;
 		goto end;
-	} else {
-		sessiond_socket = ret;
-		connected = 1;
 	}
 
 	ret = send_session_msg(lsm);
@@ -606,7 +746,7 @@ int lttng_ctl_ask_sessiond_fds_varlen(struct lttcomm_session_msg *lsm,
 	ret = llm.data_size;
 
 end:
-	disconnect_sessiond();
+	close_command_connection(ret);
 	return ret;
 }
 
@@ -617,17 +757,16 @@ int lttng_ctl_ask_sessiond_payload(struct lttng_payload_view *message,
 	int ret;
 	struct lttcomm_lttng_msg llm;
 	const int fd_count = lttng_payload_view_get_fd_handle_count(message);
+	const struct lttcomm_session_msg *lsm =
+			(typeof(lsm)) message->buffer.data;
 
 	assert(reply->buffer.size == 0);
 	assert(lttng_dynamic_pointer_array_get_count(&reply->_fd_handles) == 0);
+	assert(message->buffer.size >= sizeof(*lsm));
 
-	ret = connect_sessiond();
+	ret = open_command_connection();
 	if (ret < 0) {
-		ret = -LTTNG_ERR_NO_SESSIOND;
 		goto end;
-	} else {
-		sessiond_socket = ret;
-		connected = 1;
 	}
 
 	/* Send command to session daemon */
@@ -698,7 +837,7 @@ int lttng_ctl_ask_sessiond_payload(struct lttng_payload_view *message,
 	ret = reply->buffer.size;
 
 end:
-	disconnect_sessiond();
+	close_command_connection(ret);
 	return ret;
 }
 
@@ -814,23 +953,13 @@ static int _lttng_stop_tracing(const char *session_name, int wait)
 		goto end;
 	}
 
-	/* Check for data availability */
-	do {
-		data_ret = lttng_data_pending(session_name);
-		if (data_ret < 0) {
-			/* Return the data available call error. */
-			ret = data_ret;
-			goto error;
-		}
-
-		/*
-		 * Data sleep time before retrying (in usec). Don't sleep if the
-		 * call returned value indicates availability.
-		 */
-		if (data_ret) {
-			usleep(DEFAULT_DATA_AVAILABILITY_WAIT_TIME_US);
-		}
-	} while (data_ret != 0);
+	/* Wait for data availability */
+	data_ret = lttng_wait_data_pending(session_name, -1);
+	if (data_ret < 0) {
+		/* Return the data available call error. */
+		ret = data_ret;
+		goto error;
+	}
 
 end:
 error:
@@ -1274,6 +1403,190 @@ ask_sessiond:
 	return ret;
 }
 
+/*
+ * Append the description of an event to enable to the payload of a
+ * LTTNG_ENABLE_EVENTS command: a struct lttcomm_enable_events_event followed
+ * by the exclusion names, the filter expression and the filter bytecode.
+ *
+ * Return 0 on success or else a negative LTTng error code.
+ */
+static int append_enable_events_event(struct lttng_dynamic_buffer *buffer,
+		const struct lttng_handle *handle, struct lttng_event *ev,
+		const char *original_filter_expression,
+		int exclusion_count, char **exclusion_list)
+{
+	int ret, i;
+	char *agent_filter = NULL;
+	const char *filter_expression = original_filter_expression;
+	struct filter_parser_ctx *ctx = NULL;
+	struct lttcomm_enable_events_event event_msg;
+
+	memset(&event_msg, 0, sizeof(event_msg));
+
+	if (ev->name[0] == '\0') {
+		/* Enable all events */
+		lttng_ctl_copy_string(ev->name, "*", sizeof(ev->name));
+	}
+	memcpy(&event_msg.event, ev, sizeof(event_msg.event));
+	event_msg.exclusion_count = exclusion_count;
+
+	if (handle->domain.type == LTTNG_DOMAIN_JUL ||
+			handle->domain.type == LTTNG_DOMAIN_LOG4J ||
+			handle->domain.type == LTTNG_DOMAIN_PYTHON) {
+		/*
+		 * With an agent filter, the original filter has been added to
+		 * it thus replace the filter expression.
+		 */
+		agent_filter = set_agent_filter(filter_expression, ev);
+		if (agent_filter) {
+			filter_expression = agent_filter;
+		}
+	}
+
+	if (filter_expression) {
+		ret = filter_parser_ctx_create_from_filter_expression(
+				filter_expression, &ctx);
+		if (ret) {
+			goto end;
+		}
+
+		event_msg.bytecode_len = sizeof(ctx->bytecode->b) +
+				bytecode_get_len(&ctx->bytecode->b);
+		event_msg.expression_len = strlen(filter_expression) + 1;
+	}
+
+	ret = lttng_dynamic_buffer_append(buffer, &event_msg,
+			sizeof(event_msg));
+	if (ret) {
+		ret = -LTTNG_ERR_NOMEM;
+		goto end;
+	}
+
+	for (i = 0; i < exclusion_count; i++) {
+		if (lttng_strnlen(exclusion_list[i], LTTNG_SYMBOL_NAME_LEN) ==
+				LTTNG_SYMBOL_NAME_LEN) {
+			/* Exclusion is not NULL-terminated. */
+			ret = -LTTNG_ERR_INVALID;
+			goto end;
+		}
+
+		ret = lttng_dynamic_buffer_append(buffer, exclusion_list[i],
+				LTTNG_SYMBOL_NAME_LEN);
+		if (ret) {
+			ret = -LTTNG_ERR_EXCLUSION_NOMEM;
+			goto end;
+		}
+	}
+
+	if (filter_expression) {
+		ret = lttng_dynamic_buffer_append(buffer, filter_expression,
+				event_msg.expression_len);
+		if (ret) {
+			ret = -LTTNG_ERR_FILTER_NOMEM;
+			goto end;
+		}
+
+		ret = lttng_dynamic_buffer_append(buffer, &ctx->bytecode->b,
+				event_msg.bytecode_len);
+		if (ret) {
+			ret = -LTTNG_ERR_FILTER_NOMEM;
+			goto end;
+		}
+	}
+
+end:
+	if (ctx) {
+		filter_bytecode_free(ctx);
+		filter_ir_free(ctx);
+		filter_parser_ctx_free(ctx);
+	}
+	free(agent_filter);
+	return ret;
+}
+
+/*
+ * Enable many events of a channel at once, all with the same filter and
+ * exclusions. See event.h for the details.
+ */
+int lttng_enable_events_with_exclusions(struct lttng_handle *handle,
+		struct lttng_event *events, unsigned int event_count,
+		const char *channel_name, const char *filter_expression,
+		int exclusion_count, char **exclusion_list, int *ret_codes)
+{
+	int ret;
+	unsigned int i;
+	struct lttcomm_session_msg lsm;
+	struct lttng_dynamic_buffer payload;
+	int32_t *reply = NULL;
+
+	lttng_dynamic_buffer_init(&payload);
+
+	if (handle == NULL || events == NULL || event_count == 0 ||
+			ret_codes == NULL || exclusion_count < 0) {
+		ret = -LTTNG_ERR_INVALID;
+		goto end;
+	}
+
+	/*
+	 * Empty filter string will always be rejected by the parser
+	 * anyway, so treat this corner-case early to eliminate
+	 * lttng_fmemopen error for 0-byte allocation.
+	 */
+	if (filter_expression && filter_expression[0] == '\0') {
+		ret = -LTTNG_ERR_INVALID;
+		goto end;
+	}
+
+	memset(&lsm, 0, sizeof(lsm));
+	lsm.cmd_type = LTTNG_ENABLE_EVENTS;
+	COPY_DOMAIN_PACKED(lsm.domain, handle->domain);
+	lttng_ctl_copy_string(lsm.session.name, handle->session_name,
+			sizeof(lsm.session.name));
+	/* If no channel name, send empty string. */
+	lttng_ctl_copy_string(lsm.u.enable_events.channel_name,
+			channel_name ? channel_name : "",
+			sizeof(lsm.u.enable_events.channel_name));
+	lsm.u.enable_events.event_count = event_count;
+
+	for (i = 0; i < event_count; i++) {
+		const struct lttng_event_extended *ev_ext =
+				events[i].extended.ptr;
+
+		/* Userspace probes must be enabled one by one. */
+		if (events[i].type == LTTNG_EVENT_USERSPACE_PROBE ||
+				(ev_ext && ev_ext->probe_location)) {
+			ret = -LTTNG_ERR_INVALID;
+			goto end;
+		}
+
+		ret = append_enable_events_event(&payload, handle, &events[i],
+				filter_expression, exclusion_count,
+				exclusion_list);
+		if (ret) {
+			goto end;
+		}
+	}
+
+	ret = lttng_ctl_ask_sessiond_varlen_no_cmd_header(&lsm, payload.data,
+			payload.size, (void **) &reply);
+	if (ret < 0) {
+		goto end;
+	}
+	if ((size_t) ret != event_count * sizeof(*reply)) {
+		ret = -LTTNG_ERR_FATAL;
+		goto end;
+	}
+
+	for (i = 0; i < event_count; i++) {
+		ret_codes[i] = reply[i] == LTTNG_OK ? 0 : -reply[i];
+	}
+	ret = 0;
+end:
+	free(reply);
+	lttng_dynamic_buffer_reset(&payload);
+	return ret;
+}
+
 int lttng_disable_event_ext(struct lttng_handle *handle,
 		struct lttng_event *ev, const char *channel_name,
 		const char *original_filter_expression)
@@ -2889,6 +3202,43 @@ end:
 	return ret;
 }
 
+/*
+ * Keep the connection to the session daemon open for the subsequent commands.
+ */
+int lttng_open_persistent_connection(void)
+{
+	int ret;
+
+	if (persistent_connection) {
+		ret = 0;
+		goto end;
+	}
+
+	persistent_connection = true;
+	ret = open_command_connection();
+	if (ret < 0) {
+		persistent_connection = false;
+	}
+end:
+	return ret;
+}
+
+/*
+ * Close the persistent connection to the session daemon.
+ */
+int lttng_close_persistent_connection(void)
+{
+	int ret;
+
+	persistent_connection = false;
+	ret = disconnect_sessiond();
+	if (ret < 0) {
+		ret = -LTTNG_ERR_FATAL;
+	}
+
+	return ret;
+}
+
 /*
  * Regenerate the metadata for a session.
  * Return 0 on success, a negative error code on error.
@@ -3183,5 +3533,6 @@ static void __attribute__((constructor)) init(void)
  */
 static void __attribute__((destructor)) lttng_ctl_exit(void)
 {
+	(void) lttng_close_persistent_connection();
 	free(tracing_group);
 }
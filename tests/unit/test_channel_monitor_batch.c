@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2021 EfficiOS Inc.
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <urcu.h>
+
+#include <tap/tap.h>
+
+#include <common/compat/errno.h>
+#include <common/defaults.h>
+#include <common/sessiond-comm/sessiond-comm.h>
+#include <bin/lttng-sessiond/notification-thread.h>
+#include <bin/lttng-sessiond/notification-thread-events.h>
+
+/* For error.h */
+int lttng_opt_quiet = 1;
+int lttng_opt_verbose;
+int lttng_opt_mi;
+
+/* Number of TAP tests in this file */
+#define NUM_TESTS 6
+
+struct monitor_batch {
+	struct lttcomm_consumer_channel_monitor_batch_msg header;
+	struct lttcomm_consumer_channel_monitor_msg
+			samples[LTTCOMM_CONSUMER_CHANNEL_MONITOR_BATCH_MAX_SAMPLES];
+} LTTNG_PACKED;
+
+/*
+ * Write a batch of `sample_count` samples, of which only the first
+ * `written_sample_count` are actually written, to `fd`.
+ */
+static
+void write_batch(int fd, uint32_t sample_count, uint32_t written_sample_count)
+{
+	uint32_t i;
+	ssize_t ret;
+	struct monitor_batch batch = {};
+	const size_t len = sizeof(batch.header) +
+			written_sample_count * sizeof(batch.samples[0]);
+
+	assert(written_sample_count <=
+			LTTCOMM_CONSUMER_CHANNEL_MONITOR_BATCH_MAX_SAMPLES);
+	batch.header.sample_count = sample_count;
+	for (i = 0; i < written_sample_count; i++) {
+		batch.samples[i].key = i;
+		batch.samples[i].lowest = i;
+		batch.samples[i].highest = i * 2;
+		batch.samples[i].total_consumed = i * 4;
+	}
+
+	ret = write(fd, &batch, len);
+	assert(ret == len);
+}
+
+static
+bool pipe_is_empty(int fd)
+{
+	char c;
+
+	return read(fd, &c, 1) == -1 && errno == EAGAIN;
+}
+
+static
+void test_channel_sample_batches(void)
+{
+	int ret, pipe_fds[2];
+	struct notification_thread_state state = {};
+
+	state.channels_ht = cds_lfht_new(DEFAULT_HT_SIZE, 1, 0,
+			CDS_LFHT_AUTO_RESIZE | CDS_LFHT_ACCOUNTING, NULL);
+	assert(state.channels_ht);
+	ret = pipe(pipe_fds);
+	assert(!ret);
+	ret = fcntl(pipe_fds[0], F_SETFL, O_NONBLOCK);
+	assert(!ret);
+
+	/*
+	 * The samples are for channels the notification thread doesn't know,
+	 * which is not an error: they are read and dropped.
+	 */
+	write_batch(pipe_fds[1], 3, 3);
+	write_batch(pipe_fds[1],
+			LTTCOMM_CONSUMER_CHANNEL_MONITOR_BATCH_MAX_SAMPLES,
+			LTTCOMM_CONSUMER_CHANNEL_MONITOR_BATCH_MAX_SAMPLES);
+	ret = handle_notification_thread_channel_sample(&state, pipe_fds[0],
+			LTTNG_DOMAIN_UST);
+	ok(ret == 0, "Batch of 3 channel samples handled");
+	ret = handle_notification_thread_channel_sample(&state, pipe_fds[0],
+			LTTNG_DOMAIN_KERNEL);
+	ok(ret == 0, "Batch of %zu channel samples handled",
+			(size_t) LTTCOMM_CONSUMER_CHANNEL_MONITOR_BATCH_MAX_SAMPLES);
+	ok(pipe_is_empty(pipe_fds[0]),
+			"Whole batches are consumed from the monitoring pipe");
+
+	write_batch(pipe_fds[1], 0, 0);
+	ret = handle_notification_thread_channel_sample(&state, pipe_fds[0],
+			LTTNG_DOMAIN_UST);
+	ok(ret == 0 && pipe_is_empty(pipe_fds[0]),
+			"Empty batch handled");
+
+	write_batch(pipe_fds[1],
+			LTTCOMM_CONSUMER_CHANNEL_MONITOR_BATCH_MAX_SAMPLES + 1,
+			0);
+	ret = handle_notification_thread_channel_sample(&state, pipe_fds[0],
+			LTTNG_DOMAIN_UST);
+	ok(ret == -1, "Batch exceeding the maximal sample count rejected");
+
+	/* Close the write end so that the truncated batch can't block. */
+	write_batch(pipe_fds[1], 2, 1);
+	ret = close(pipe_fds[1]);
+	assert(!ret);
+	ret = handle_notification_thread_channel_sample(&state, pipe_fds[0],
+			LTTNG_DOMAIN_UST);
+	ok(ret == -1, "Truncated batch rejected");
+
+	ret = close(pipe_fds[0]);
+	assert(!ret);
+	ret = cds_lfht_destroy(state.channels_ht, NULL);
+	assert(!ret);
+}
+
+int main(int argc, char **argv)
+{
+	plan_tests(NUM_TESTS);
+
+	diag("Channel monitor sample batch unit tests");
+
+	rcu_register_thread();
+
+	test_channel_sample_batches();
+
+	rcu_unregister_thread();
+	return exit_status();
+}
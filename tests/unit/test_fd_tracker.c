@@ -33,7 +33,7 @@ int lttng_opt_verbose;
 int lttng_opt_mi;
 
 /* Number of TAP tests in this file */
-#define NUM_TESTS 61
+#define NUM_TESTS 68
 /* 3 for stdin, stdout, and stderr */
 #define STDIO_FD_COUNT 3
 #define TRACKER_FD_LIMIT 50
@@ -747,6 +747,124 @@ end:
 	free(unlinked_files_directory);
 }
 
+static
+bool fd_refers_to_file(int fd, struct lttng_directory_handle *dir_handle,
+		const char *path)
+{
+	struct stat fd_stat, file_stat;
+
+	if (fstat(fd, &fd_stat) ||
+			lttng_directory_handle_stat(dir_handle, path, &file_stat)) {
+		return false;
+	}
+
+	return fd_stat.st_dev == file_stat.st_dev &&
+			fd_stat.st_ino == file_stat.st_ino;
+}
+
+static
+struct fs_handle *open_numbered_file(struct fd_tracker *tracker,
+		struct lttng_directory_handle *directory,
+		unsigned int index,
+		char **file_path)
+{
+	int ret;
+	mode_t mode = S_IWUSR | S_IRUSR;
+
+	ret = asprintf(file_path, "file-%u", index);
+	assert(ret >= 0);
+	return fd_tracker_open_fs_handle(tracker, directory, *file_path,
+			O_RDWR | O_CREAT, &mode);
+}
+
+/*
+ * Validate that the tracker gives the handles that were used since its last
+ * scan of the active handles a "second chance" and suspends the handles that
+ * were not used instead.
+ */
+static
+void test_suspendable_second_chance(void)
+{
+	int ret, fd, i;
+	const int files_to_create = TRACKER_FD_LIMIT + 2;
+	struct fd_tracker *tracker;
+	char *output_files[files_to_create];
+	struct fs_handle *handles[files_to_create];
+	int fds[TRACKER_FD_LIMIT];
+	struct lttng_directory_handle *dir_handle = NULL;
+	char *test_directory = NULL, *unlinked_files_directory = NULL;
+
+	memset(output_files, 0, sizeof(output_files));
+	memset(handles, 0, sizeof(handles));
+
+	get_temporary_directories(&test_directory, &unlinked_files_directory);
+
+	tracker = fd_tracker_create(unlinked_files_directory, TRACKER_FD_LIMIT);
+	if (!tracker) {
+		goto end;
+	}
+
+	dir_handle = lttng_directory_handle_create(test_directory);
+	assert(dir_handle);
+
+	ret = open_files(tracker, dir_handle, TRACKER_FD_LIMIT, handles,
+			output_files);
+	ok(!ret, "Created %d files with a limit of %d simultaneously-opened file descriptor",
+			TRACKER_FD_LIMIT, TRACKER_FD_LIMIT);
+
+	/* Use all handles; the tracker is now at its capacity. */
+	for (i = 0; i < TRACKER_FD_LIMIT; i++) {
+		fds[i] = fs_handle_get_fd(handles[i]);
+		assert(fds[i] >= 0);
+		fs_handle_put_fd(handles[i]);
+	}
+
+	/*
+	 * All handles are referenced: they all get a second chance and the
+	 * first handle of the list, handles[0], is suspended.
+	 */
+	handles[TRACKER_FD_LIMIT] = open_numbered_file(tracker, dir_handle,
+			TRACKER_FD_LIMIT, &output_files[TRACKER_FD_LIMIT]);
+	assert(handles[TRACKER_FD_LIMIT]);
+
+	/*
+	 * Only handles[1] is used before the next suspension: it is skipped
+	 * and handles[2] is suspended.
+	 */
+	fd = fs_handle_get_fd(handles[1]);
+	assert(fd >= 0);
+	fs_handle_put_fd(handles[1]);
+
+	handles[TRACKER_FD_LIMIT + 1] = open_numbered_file(tracker, dir_handle,
+			TRACKER_FD_LIMIT + 1, &output_files[TRACKER_FD_LIMIT + 1]);
+	assert(handles[TRACKER_FD_LIMIT + 1]);
+
+	ok(!fd_refers_to_file(fds[0], dir_handle, output_files[0]),
+			"Handle is suspended when all active handles were used since the last suspension");
+	ok(fd_refers_to_file(fds[1], dir_handle, output_files[1]),
+			"Recently used handle is not suspended");
+	ok(!fd_refers_to_file(fds[2], dir_handle, output_files[2]),
+			"Least recently used handle is suspended");
+
+	fd = fs_handle_get_fd(handles[2]);
+	ok(fd >= 0 && fd_refers_to_file(fd, dir_handle, output_files[2]),
+			"Suspended handle is restored to the right file");
+	if (fd >= 0) {
+		fs_handle_put_fd(handles[2]);
+	}
+
+	ret = cleanup_files(tracker, test_directory, files_to_create, handles,
+			output_files);
+	ok(!ret, "Close all opened filesystem handles");
+	ret = rmdir(test_directory);
+	ok(ret == 0, "Test directory is empty");
+	fd_tracker_destroy(tracker);
+	lttng_directory_handle_put(dir_handle);
+end:
+	free(test_directory);
+	free(unlinked_files_directory);
+}
+
 static
 void test_unlink(void)
 {
@@ -907,6 +1025,8 @@ int main(int argc, char **argv)
 	test_suspendable_limit();
 	diag("Suspendable - restoration test");
 	test_suspendable_restore();
+	diag("Suspendable - second chance given to recently used handles");
+	test_suspendable_second_chance();
 
 	diag("Mixed - check that file descriptor limit is enforced");
 	test_mixed_limit();
@@ -28,10 +28,11 @@
 #define SESSION1 "test1"
 
 #define MAX_SESSIONS 10000
+#define FIND_SESSIONS 100
 #define RANDOM_STRING_LEN	11
 
 /* Number of TAP tests in this file */
-#define NUM_TESTS 11
+#define NUM_TESTS 17
 
 static struct ltt_session_list *session_list;
 
@@ -266,6 +267,64 @@ static void test_duplicate_session(void)
 	   "Duplicate session creation");
 }
 
+static void test_session_find_by_name(void)
+{
+	int i, failed = 0;
+	char name[NAME_MAX];
+	char long_name[NAME_MAX + 1];
+	struct ltt_session *session, *destroyed_session;
+
+	for (i = 0; i < FIND_SESSIONS; i++) {
+		sprintf(name, "find%d", i);
+		if (create_one_session(name) < 0) {
+			diag("session %d (name: %s) creation failed", i, name);
+			++failed;
+		}
+	}
+
+	session_lock_list();
+	for (i = 0; i < FIND_SESSIONS; i++) {
+		sprintf(name, "find%d", i);
+		session = session_find_by_name(name);
+		if (!session || strcmp(session->name, name)) {
+			diag("session %s not found by name", name);
+			++failed;
+		}
+		session_put(session);
+	}
+	ok(failed == 0, "Find by name: found %d sessions", FIND_SESSIONS);
+
+	ok(session_find_by_name("unknown") == NULL,
+	   "Find by name: unknown session not found");
+
+	memset(long_name, 'a', NAME_MAX);
+	long_name[NAME_MAX] = '\0';
+	ok(session_find_by_name(long_name) == NULL,
+	   "Find by name: name longer than a session name not found");
+
+	/* Keep a reference to the destroyed session. */
+	destroyed_session = session_find_by_name("find0");
+	assert(destroyed_session);
+	session_destroy(destroyed_session);
+	ok(session_find_by_name("find0") == NULL,
+	   "Find by name: destroyed session not found while still referenced");
+	session_unlock_list();
+
+	ok(create_one_session("find0") == 0,
+	   "Find by name: name of a referenced destroyed session reused");
+
+	session = session_find_by_name_no_list_lock("find0");
+	ok(session != NULL && session != destroyed_session,
+	   "Find by name: new session found without the session list lock");
+	session_put_no_list_lock(session);
+
+	session_lock_list();
+	session_put(destroyed_session);
+	session_unlock_list();
+
+	empty_session_list();
+}
+
 static void test_session_name_generation(void)
 {
 	struct ltt_session *session = NULL;
@@ -356,6 +415,8 @@ int main(int argc, char **argv)
 
 	empty_session_list();
 
+	test_session_find_by_name();
+
 	test_session_name_generation();
 
 	test_large_session_number();
@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2021 EfficiOS Inc.
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <urcu.h>
+
+#include <common/compat/directory-handle.h>
+#include <common/compat/errno.h>
+#include <common/error.h>
+#include <common/trace-chunk.h>
+#include <tap/tap.h>
+
+/* For error.h */
+int lttng_opt_quiet = 1;
+int lttng_opt_verbose;
+int lttng_opt_mi;
+
+/* Number of TAP tests in this file */
+#define NUM_TESTS 7
+#define TMP_DIR_PATTERN "/tmp/test-trace-chunk-XXXXXX"
+/* Enough files to grow the chunk's file set past its initial size. */
+#define FILE_COUNT 300
+#define FILE_MODE (S_IRUSR | S_IWUSR)
+
+static
+void get_file_name(unsigned int index, char *name, size_t name_len)
+{
+	int ret;
+
+	ret = snprintf(name, name_len, "stream_%u", index);
+	assert(ret > 0 && ret < name_len);
+}
+
+static
+bool open_chunk_file(struct lttng_trace_chunk *chunk, const char *name)
+{
+	int fd, ret;
+	enum lttng_trace_chunk_status status;
+
+	status = lttng_trace_chunk_open_file(chunk, name, O_WRONLY | O_CREAT,
+			FILE_MODE, &fd, false);
+	if (status != LTTNG_TRACE_CHUNK_STATUS_OK) {
+		return false;
+	}
+
+	ret = close(fd);
+	assert(!ret);
+	return true;
+}
+
+/*
+ * Open files through a trace chunk, unlink some of them, and validate that
+ * the chunk's "delete" close command unlinks exactly the files that remain.
+ */
+static
+void test_chunk_files(void)
+{
+	int ret;
+	unsigned int i;
+	char *test_directory;
+	char tmp_path_pattern[] = TMP_DIR_PATTERN;
+	char name[32];
+	struct stat statbuf;
+	struct lttng_trace_chunk *chunk;
+	struct lttng_directory_handle *dir_handle;
+	enum lttng_trace_chunk_status status;
+	bool success;
+
+	test_directory = mkdtemp(tmp_path_pattern);
+	assert(test_directory);
+	dir_handle = lttng_directory_handle_create(test_directory);
+	assert(dir_handle);
+
+	chunk = lttng_trace_chunk_create(0, time(NULL), NULL);
+	assert(chunk);
+	status = lttng_trace_chunk_set_credentials_current_user(chunk);
+	assert(status == LTTNG_TRACE_CHUNK_STATUS_OK);
+	status = lttng_trace_chunk_set_as_user(chunk, dir_handle);
+	assert(status == LTTNG_TRACE_CHUNK_STATUS_OK);
+
+	success = true;
+	for (i = 0; i < FILE_COUNT; i++) {
+		get_file_name(i, name, sizeof(name));
+		success &= open_chunk_file(chunk, name);
+	}
+	ok(success, "Opened %d files through the trace chunk", FILE_COUNT);
+
+	get_file_name(0, name, sizeof(name));
+	ok(open_chunk_file(chunk, name),
+			"Opened a file of the trace chunk a second time");
+
+	/* Unlink the files with an even index. */
+	success = true;
+	for (i = 0; i < FILE_COUNT; i += 2) {
+		get_file_name(i, name, sizeof(name));
+		success &= lttng_trace_chunk_unlink_file(chunk, name) ==
+				LTTNG_TRACE_CHUNK_STATUS_OK;
+	}
+	ok(success, "Unlinked half of the files of the trace chunk");
+
+	success = true;
+	for (i = 0; i < FILE_COUNT; i++) {
+		const bool expect_file = i % 2;
+
+		get_file_name(i, name, sizeof(name));
+		success &= (lttng_directory_handle_stat(
+				dir_handle, name, &statbuf) == 0) ==
+				expect_file;
+	}
+	ok(success, "Only the files that were not unlinked exist");
+
+	status = lttng_trace_chunk_open_file(chunk, "missing_file", O_RDONLY,
+			0, &ret, true);
+	ok(status == LTTNG_TRACE_CHUNK_STATUS_NO_FILE,
+			"Opening a missing file through the trace chunk reports it as missing");
+
+	status = lttng_trace_chunk_set_close_command(chunk,
+			LTTNG_TRACE_CHUNK_COMMAND_TYPE_DELETE);
+	ok(status == LTTNG_TRACE_CHUNK_STATUS_OK,
+			"Set the \"delete\" close command of the trace chunk");
+
+	/*
+	 * Releasing the chunk unlinks the files it contains. The release
+	 * fails early if a file is unlinked twice or is missing, leaving files
+	 * in the directory.
+	 */
+	lttng_trace_chunk_put(chunk);
+	lttng_directory_handle_put(dir_handle);
+	ret = rmdir(test_directory);
+	ok(ret == 0, "\"delete\" close command unlinked the remaining files");
+}
+
+int main(int argc, char **argv)
+{
+	plan_tests(NUM_TESTS);
+	diag("Trace chunk unit tests");
+
+	rcu_register_thread();
+
+	test_chunk_files();
+
+	rcu_barrier();
+	rcu_unregister_thread();
+	return exit_status();
+}
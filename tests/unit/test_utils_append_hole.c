@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2021 EfficiOS Inc.
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <tap/tap.h>
+
+#include <common/utils.h>
+
+/* For error.h */
+int lttng_opt_quiet = 1;
+int lttng_opt_verbose;
+int lttng_opt_mi;
+
+/* Number of TAP tests in this file */
+#define NUM_TESTS 13
+#define TMP_FILE_PATTERN "/tmp/utils-append-hole-XXXXXX"
+#define HOLE_LEN 8192
+
+static const char file_contents[] = "packet";
+
+static
+int create_temporary_file(void)
+{
+	int fd;
+	char path[] = TMP_FILE_PATTERN;
+
+	fd = mkstemp(path);
+	assert(fd >= 0);
+	/* The file is removed once its fd is closed. */
+	(void) unlink(path);
+	return fd;
+}
+
+static
+off_t file_size(int fd)
+{
+	int ret;
+	struct stat fd_stat;
+
+	ret = fstat(fd, &fd_stat);
+	assert(!ret);
+	return fd_stat.st_size;
+}
+
+static
+bool range_is_zero(int fd, off_t offset, size_t len)
+{
+	char buf[HOLE_LEN];
+	ssize_t read_ret;
+	size_t i;
+
+	assert(len <= sizeof(buf));
+	read_ret = pread(fd, buf, len, offset);
+	if (read_ret != (ssize_t) len) {
+		return false;
+	}
+
+	for (i = 0; i < len; i++) {
+		if (buf[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static
+void test_append_hole_empty_file(void)
+{
+	int ret, fd;
+
+	fd = create_temporary_file();
+
+	ret = utils_append_hole(fd, HOLE_LEN);
+	ok(ret == 0, "Append a hole to an empty file");
+	ok(file_size(fd) == HOLE_LEN, "File is extended by the hole's length");
+	ok(lseek(fd, 0, SEEK_CUR) == HOLE_LEN,
+			"File position is moved to the end of the hole");
+	ok(range_is_zero(fd, 0, HOLE_LEN), "Hole reads as zeros");
+
+	ret = close(fd);
+	assert(!ret);
+}
+
+static
+void test_append_hole_after_data(void)
+{
+	int ret, fd;
+	ssize_t write_ret, read_ret;
+	char read_buf[sizeof(file_contents)];
+	const off_t data_end = sizeof(file_contents) + HOLE_LEN +
+			sizeof(file_contents);
+
+	fd = create_temporary_file();
+	write_ret = write(fd, file_contents, sizeof(file_contents));
+	assert(write_ret == sizeof(file_contents));
+
+	ret = utils_append_hole(fd, HOLE_LEN);
+	ok(ret == 0, "Append a hole after the data of a file");
+	ok(range_is_zero(fd, sizeof(file_contents), HOLE_LEN),
+			"Hole appended after data reads as zeros");
+
+	write_ret = write(fd, file_contents, sizeof(file_contents));
+	assert(write_ret == sizeof(file_contents));
+	ok(file_size(fd) == data_end,
+			"Data written after the hole is appended to the file");
+	read_ret = pread(fd, read_buf, sizeof(read_buf),
+			sizeof(file_contents) + HOLE_LEN);
+	ok(read_ret == sizeof(read_buf) &&
+			!memcmp(read_buf, file_contents, sizeof(read_buf)),
+			"Data written after the hole is intact");
+
+	ret = utils_append_hole(fd, 0);
+	ok(ret == 0 && file_size(fd) == data_end &&
+			lseek(fd, 0, SEEK_CUR) == data_end,
+			"Appending an empty hole leaves the file unchanged");
+
+	ret = close(fd);
+	assert(!ret);
+}
+
+static
+void test_append_hole_invalid(void)
+{
+	int ret, fd, pipe_fds[2];
+	ssize_t write_ret;
+	off_t seek_ret;
+
+	fd = create_temporary_file();
+	write_ret = write(fd, file_contents, sizeof(file_contents));
+	assert(write_ret == sizeof(file_contents));
+	seek_ret = lseek(fd, 0, SEEK_SET);
+	assert(seek_ret == 0);
+
+	ret = utils_append_hole(fd, HOLE_LEN);
+	ok(ret == -1 && errno == EINVAL,
+			"Appending a hole before the end of a file is refused");
+	ok(file_size(fd) == sizeof(file_contents) &&
+			lseek(fd, 0, SEEK_CUR) == 0,
+			"File is left unchanged when appending a hole fails");
+
+	ret = close(fd);
+	assert(!ret);
+
+	ret = pipe(pipe_fds);
+	assert(!ret);
+	ret = utils_append_hole(pipe_fds[1], HOLE_LEN);
+	ok(ret == -1, "Appending a hole to a pipe fails");
+	(void) close(pipe_fds[0]);
+	(void) close(pipe_fds[1]);
+
+	ret = utils_append_hole(-1, HOLE_LEN);
+	ok(ret == -1 && errno == EBADF,
+			"Appending a hole to an invalid fd fails with EBADF");
+}
+
+int main(int argc, char **argv)
+{
+	plan_tests(NUM_TESTS);
+
+	diag("utils_append_hole tests");
+
+	test_append_hole_empty_file();
+	test_append_hole_after_data();
+	test_append_hole_invalid();
+
+	return exit_status();
+}